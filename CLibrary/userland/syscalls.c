@@ -8,6 +8,7 @@
 #include "../install/x86_64-elf/include/sys/times.h"
 #include "../install/x86_64-elf/include/sys/types.h"
 #include "sysmac.h"
+#include <stdarg.h>
 
 extern char  _end;
 static char* __heap_cursor__;
@@ -493,6 +494,126 @@ munmap(void* __addr__, size_t __len__)
     return 0;
 }
 
+/* new_address is only read with MREMAP_FIXED, like the usual variadic mremap */
+void*
+mremap(void* __addr__, size_t __oldlen__, size_t __newlen__, int __flags__, ...)
+{
+    void* NewAddr = NULL;
+    if (__flags__ & MremapFixed)
+    {
+        va_list Ap;
+        va_start(Ap, __flags__);
+        NewAddr = va_arg(Ap, void*);
+        va_end(Ap);
+    }
+
+    int64_t r = Syscall(SysMremap,
+                        (uint64_t)__addr__,
+                        (uint64_t)__oldlen__,
+                        (uint64_t)__newlen__,
+                        (uint64_t)__flags__,
+                        (uint64_t)NewAddr,
+                        0);
+    if (r < 0)
+    {
+        errno = (int)(-r);
+        return (void*)-1;
+    }
+    return (void*)(uintptr_t)r;
+}
+
+int
+madvise(void* __addr__, size_t __len__, int __advice__)
+{
+    int64_t r =
+        Syscall(SysMadvise, (uint64_t)__addr__, (uint64_t)__len__, (uint64_t)__advice__, 0, 0, 0);
+    if (r < 0)
+    {
+        errno = (int)(-r);
+        return -1;
+    }
+    return 0;
+}
+
+int
+ftruncate(int __fd__, off_t __len__)
+{
+    int64_t r = Syscall(SysFtruncate, (uint64_t)__fd__, (uint64_t)__len__, 0, 0, 0, 0);
+    if (r < 0)
+    {
+        errno = (int)(-r);
+        return -1;
+    }
+    return 0;
+}
+
+int
+memfd_create(const char* __name__, unsigned int __flags__)
+{
+    int64_t r = Syscall(SysMemfdCreate, (uint64_t)__name__, (uint64_t)__flags__, 0, 0, 0, 0);
+    if (r < 0)
+    {
+        errno = (int)(-r);
+        return -1;
+    }
+    return (int)r;
+}
+
+/*POSIX shm objects are plain files under /dev/shm*/
+static int
+__shm_path__(const char* __name__, char* __out__, size_t __cap__)
+{
+    static const char __dir__[] = "/dev/shm/";
+    size_t            __n__     = 0;
+
+    if (!__name__)
+    {
+        return -1;
+    }
+    while (*__name__ == '/')
+    {
+        __name__++;
+    }
+    for (const char* __p__ = __dir__; *__p__; __p__++)
+    {
+        __out__[__n__++] = *__p__;
+    }
+    while (*__name__)
+    {
+        if (*__name__ == '/' || __n__ + 1 >= __cap__)
+        {
+            return -1;
+        }
+        __out__[__n__++] = *__name__++;
+    }
+    __out__[__n__] = '\0';
+    return 0;
+}
+
+int
+shm_open(const char* __name__, int __oflag__, mode_t __mode__)
+{
+    char __path__[96];
+    if (__shm_path__(__name__, __path__, sizeof(__path__)) != 0)
+    {
+        errno = EINVAL;
+        return -1;
+    }
+    return open(__path__, __oflag__, (int)__mode__);
+}
+
+int
+shm_unlink(const char* __name__)
+{
+    char __path__[96];
+    if (__shm_path__(__name__, __path__, sizeof(__path__)) != 0)
+    {
+        errno = EINVAL;
+        return -1;
+    }
+    return unlink(__path__);
+}
+
 int
 brk(void* __new_end__)
 {
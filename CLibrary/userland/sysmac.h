@@ -14,6 +14,7 @@ enum SysNo
     SysPoll                = 7,
     SysLseek               = 8,
     SysMmap                = 9,
+    SysMprotect            = 10,
     SysMunmap              = 11,
     SysBrk                 = 12,
     SysRtSigaction         = 13,
@@ -210,9 +211,14 @@ enum SysNo
     SysClockSettime        = 227,
     SysClockGettime        = 228,
     SysClockGetres         = 229,
-    SysClockNanosleep      = 230
+    SysClockNanosleep      = 230,
+    SysMemfdCreate         = 319
 };
 
+/*mremap flags*/
+#define MremapMaymove 0x1
+#define MremapFixed   0x2
+
 /*SysMac*/
 #define Syscall(__SysNum__, __Arg1__, __Arg2__, __Arg3__, __Arg4__, __Arg5__, __Arg6__)            \
     ({                                                                                             \
@@ -0,0 +1,276 @@
+#include <AxeThreads.h>
+#include <Fpu.h>
+#include <KHeap.h>
+#include <PerCPUData.h>
+#include <String.h>
+
+FpuInfo  Fpu         = {FpuX87 | FpuSse, FpuLegacySize, 0, 0};
+FpuStats FpuCounters = {0};
+int      FpuLazy     = 1;
+
+/*Thread whose state is in this CPU's registers, trusted only while its FpuCpu agrees*/
+static PerCpu(Thread*, FpuOwner);
+
+static int FpuProbed;
+
+static inline void
+__FpuCpuid__(uint32_t __Leaf__, uint32_t __Sub__, uint32_t* __Regs__)
+{
+    __asm__ volatile("cpuid"
+                     : "=a"(__Regs__[0]), "=b"(__Regs__[1]), "=c"(__Regs__[2]), "=d"(__Regs__[3])
+                     : "a"(__Leaf__), "c"(__Sub__));
+}
+
+static inline bool
+__FpuTsSet__(void)
+{
+    uint64_t Cr0;
+    __asm__ volatile("mov %%cr0, %0" : "=r"(Cr0));
+    return (Cr0 & (1UL << 3)) != 0;
+}
+
+/*CR0 writes serialize, only touch TS when it has to change*/
+static inline void
+__FpuSetTs__(void)
+{
+    uint64_t Cr0;
+    __asm__ volatile("mov %%cr0, %0" : "=r"(Cr0));
+    if (!(Cr0 & (1UL << 3)))
+    {
+        __asm__ volatile("mov %0, %%cr0" ::"r"(Cr0 | (1UL << 3)) : "memory");
+    }
+}
+
+static inline void
+__FpuClearTs__(void)
+{
+    if (__FpuTsSet__())
+    {
+        __asm__ volatile("clts" ::: "memory");
+    }
+}
+
+static inline void
+__FpuSave__(uint8_t* __State__)
+{
+    uint32_t Low  = (uint32_t)Fpu.Features;
+    uint32_t High = (uint32_t)(Fpu.Features >> 32);
+
+    if (Fpu.UseXsaveOpt)
+    {
+        __asm__ volatile("xsaveopt64 (%0)" ::"r"(__State__), "a"(Low), "d"(High) : "memory");
+    }
+    else if (Fpu.UseXsave)
+    {
+        __asm__ volatile("xsave64 (%0)" ::"r"(__State__), "a"(Low), "d"(High) : "memory");
+    }
+    else
+    {
+        __asm__ volatile("fxsave64 (%0)" ::"r"(__State__) : "memory");
+    }
+}
+
+static inline void
+__FpuRestore__(const uint8_t* __State__)
+{
+    uint32_t Low  = (uint32_t)Fpu.Features;
+    uint32_t High = (uint32_t)(Fpu.Features >> 32);
+
+    if (Fpu.UseXsave)
+    {
+        __asm__ volatile("xrstor64 (%0)" ::"r"(__State__), "a"(Low), "d"(High) : "memory");
+    }
+    else
+    {
+        __asm__ volatile("fxrstor64 (%0)" ::"r"(__State__) : "memory");
+    }
+}
+
+/* Every CPU enables the same XCR0, the boot CPU also decides what that is and sizes the area */
+void
+InitializeFpu(SysErr* __Err__ _unused)
+{
+    uint32_t Regs[4];
+
+    if (!FpuProbed)
+    {
+        __FpuCpuid__(1, 0, Regs);
+        if (Regs[2] & (1U << 26)) /*XSAVE*/
+        {
+            __FpuCpuid__(0xD, 0, Regs);
+            uint64_t Supported = ((uint64_t)Regs[3] << 32) | Regs[0];
+            uint64_t Features  = Supported & (FpuX87 | FpuSse | FpuAvx | FpuAvx512);
+
+            /*AVX needs SSE, AVX-512 needs AVX and all three of its components*/
+            if (!(Features & FpuAvx) || (Features & FpuAvx512) != FpuAvx512)
+            {
+                Features &= ~FpuAvx512;
+            }
+
+            Fpu.Features = Features;
+            Fpu.UseXsave = 1;
+
+            __FpuCpuid__(0xD, 1, Regs);
+            Fpu.UseXsaveOpt = Regs[0] & 1;
+        }
+    }
+
+    if (Fpu.UseXsave)
+    {
+        uint64_t Cr4;
+        __asm__ volatile("mov %%cr4, %0" : "=r"(Cr4));
+        __asm__ volatile("mov %0, %%cr4" ::"r"(Cr4 | (1UL << 18)) : "memory"); /*OSXSAVE*/
+        __asm__ volatile("xsetbv" ::"c"(0),
+                         "a"((uint32_t)Fpu.Features),
+                         "d"((uint32_t)(Fpu.Features >> 32)));
+    }
+
+    uint32_t Mxcsr = FpuDefaultMxcsr;
+    __asm__ volatile("ldmxcsr %0" ::"m"(Mxcsr));
+
+    if (!FpuProbed)
+    {
+        if (Fpu.UseXsave)
+        {
+            /*EBX is the size for the components now enabled in XCR0*/
+            __FpuCpuid__(0xD, 0, Regs);
+            Fpu.Size = Regs[1];
+        }
+
+        FpuProbed = 1;
+        PInfo("FPU: %s, %u byte state, XCR0 0x%lx, %s\n",
+              Fpu.UseXsaveOpt ? "xsaveopt" : (Fpu.UseXsave ? "xsave" : "fxsave"),
+              Fpu.Size,
+              Fpu.Features,
+              FpuLazy ? "lazy" : "eager");
+    }
+}
+
+/* A zeroed XSAVE header means every component starts in its init state */
+int
+FpuAllocState(Thread* __ThreadPtr__)
+{
+    uint8_t* Area = (uint8_t*)KMalloc(Fpu.Size + FpuAlign);
+    if (Probe_IF_Error(Area) || !Area)
+    {
+        return -BadAlloc;
+    }
+
+    uint8_t* State = (uint8_t*)(((uintptr_t)Area + FpuAlign - 1) & ~(uintptr_t)(FpuAlign - 1));
+    memset(State, 0, Fpu.Size);
+    *(uint16_t*)(State + 0)  = FpuDefaultFcw;
+    *(uint32_t*)(State + 24) = FpuDefaultMxcsr;
+
+    __ThreadPtr__->FpuArea  = Area;
+    __ThreadPtr__->FpuState = State;
+    __ThreadPtr__->FpuCpu   = FpuNoCpu;
+    return SysOkay;
+}
+
+void
+FpuFreeState(Thread* __ThreadPtr__, SysErr* __Err__)
+{
+    if (__ThreadPtr__->FpuArea)
+    {
+        KFree(__ThreadPtr__->FpuArea, __Err__);
+    }
+    __ThreadPtr__->FpuArea  = NULL;
+    __ThreadPtr__->FpuState = NULL;
+}
+
+/* Fork: a running source may have newer state in the registers than in memory */
+void
+FpuCopyState(Thread* __Dst__, Thread* __Src__)
+{
+    if (!__Dst__->FpuState || !__Src__->FpuState)
+    {
+        return;
+    }
+
+    uint64_t Flags;
+    __asm__ volatile("pushfq; popq %0; cli" : "=r"(Flags)::"memory");
+
+    if (__Src__ == ThisThread() && !__FpuTsSet__())
+    {
+        __FpuSave__(__Src__->FpuState);
+    }
+
+    __asm__ volatile("pushq %0; popfq" ::"r"(Flags) : "memory");
+
+    memcpy(__Dst__->FpuState, __Src__->FpuState, Fpu.Size);
+}
+
+/* TS clear means the registers hold __Prev__'s state, TS set means memory is already current */
+void
+FpuSwitchOut(Thread* __Prev__)
+{
+    if (!__Prev__ || !__Prev__->FpuState)
+    {
+        return;
+    }
+
+    if (__FpuTsSet__())
+    {
+        if (!FpuLazy)
+        {
+            __FpuClearTs__();
+        }
+        return;
+    }
+
+    __FpuSave__(__Prev__->FpuState);
+    __atomic_fetch_add(&FpuCounters.Saves, 1, __ATOMIC_RELAXED);
+}
+
+void
+FpuSwitchIn(Thread* __Next__)
+{
+    if (!__Next__ || !__Next__->FpuState)
+    {
+        __FpuSetTs__();
+        return;
+    }
+
+    uint32_t CpuId = ThisCpuId();
+
+    if (!FpuLazy)
+    {
+        __FpuClearTs__();
+        __FpuRestore__(__Next__->FpuState);
+        ThisCpuWrite(FpuOwner, __Next__);
+        __Next__->FpuCpu = CpuId;
+        __atomic_fetch_add(&FpuCounters.Restores, 1, __ATOMIC_RELAXED);
+        return;
+    }
+
+    /*Nothing else loaded here since it left, and it has not loaded anywhere else*/
+    if (ThisCpuRead(FpuOwner) == __Next__ && __Next__->FpuCpu == CpuId)
+    {
+        __FpuClearTs__();
+        __atomic_fetch_add(&FpuCounters.Reuses, 1, __ATOMIC_RELAXED);
+        return;
+    }
+
+    __FpuSetTs__();
+}
+
+/* #NM, the current thread touched the FPU with TS set. Runs with interrupts off */
+int
+FpuTrap(void)
+{
+    Thread* Current = ThisThread();
+    if (!Current || !Current->FpuState)
+    {
+        return -NoOperations;
+    }
+
+    /*Whoever owned the registers was saved when it switched out*/
+    __asm__ volatile("clts" ::: "memory");
+    __FpuRestore__(Current->FpuState);
+    ThisCpuWrite(FpuOwner, Current);
+    Current->FpuCpu = ThisCpuId();
+
+    __atomic_fetch_add(&FpuCounters.Traps, 1, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&FpuCounters.Restores, 1, __ATOMIC_RELAXED);
+    return SysOkay;
+}
@@ -1,61 +1,632 @@
 
 #include <AxeSchd.h>
+#include <Fpu.h>
 #include <IDT.h>
+#include <Ipi.h>
+#include <String.h>
 #include <Sync.h>
 #include <Timer.h>
 // #define __SchdDBG
 
 CpuScheduler CpuSchedulers[MaxCPUs];
 
-static inline void
-ThreadFxSave(void* __State__)
+/*Round length per priority, same weights the old skip strides gave (64:1 kernel to idle)*/
+static const uint32_t SchedQuanta[SchedPriorities] = {1, 2, 4, 8, 16, 32, 64};
+
+/*Fair class weights, the same 2x step per level with Normal at SchedNiceWeight*/
+static const uint32_t SchedWeights[SchedPriorities] = {256, 512, 1024, 2048, 4096, 8192, 16384};
+
+int SchedFair         = 1;
+int SchedReapDeferred = 1;
+
+/*How a thread comes back to a run queue*/
+#define EnqueueWoken     0 /*New or woken, placed from the queue's floor*/
+#define EnqueuePreempted 1 /*Left the CPU still runnable*/
+#define EnqueueResume    2 /*RT thread cut short inside its turn, back at the head of its level*/
+
+static inline uint32_t
+__SchedLevel__(Thread* __ThreadPtr__)
+{
+    uint32_t Level = (uint32_t)__ThreadPtr__->Priority;
+    return Level < SchedPriorities ? Level : ThreadPriorityNormal;
+}
+
+/* Tail insert, caller holds SchedulerLock */
+static void
+__ReadyPush__(CpuScheduler* __Sched__, ReadyArray* __Array__, Thread* __ThreadPtr__)
+{
+    uint32_t Level = __SchedLevel__(__ThreadPtr__);
+
+    __ThreadPtr__->Next = NULL;
+    __ThreadPtr__->Prev = __Array__->Tail[Level];
+
+    if (__Array__->Tail[Level])
+    {
+        __Array__->Tail[Level]->Next = __ThreadPtr__;
+    }
+    else
+    {
+        __Array__->Head[Level] = __ThreadPtr__;
+    }
+
+    __Array__->Tail[Level] = __ThreadPtr__;
+    __Array__->Bitmap |= 1U << Level;
+    __Sched__->ReadyCount++;
+}
+
+/* Head of the highest non empty level, Expired is swapped in once Active drains */
+static Thread*
+__ReadyPop__(CpuScheduler* __Sched__)
+{
+    if (!__Sched__->Active->Bitmap)
+    {
+        ReadyArray* Drained = __Sched__->Active;
+        __Sched__->Active   = __Sched__->Expired;
+        __Sched__->Expired  = Drained;
+    }
+
+    ReadyArray* Array = __Sched__->Active;
+    if (!Array->Bitmap)
+    {
+        return NULL;
+    }
+
+    uint32_t Level     = 31 - __builtin_clz(Array->Bitmap);
+    Thread*  ThreadPtr = Array->Head[Level];
+
+    Array->Head[Level] = ThreadPtr->Next;
+    if (ThreadPtr->Next)
+    {
+        ThreadPtr->Next->Prev = NULL;
+    }
+    else
+    {
+        Array->Tail[Level] = NULL;
+        Array->Bitmap &= ~(1U << Level);
+    }
+
+    ThreadPtr->Next = NULL;
+    ThreadPtr->Prev = NULL;
+
+    if (__Sched__->ReadyCount > 0)
+    {
+        __Sched__->ReadyCount--;
+    }
+
+    return ThreadPtr;
+}
+
+/* A thread with quanta left stays in this round, an empty one is refilled for the next */
+static void
+__ReadyInsert__(CpuScheduler* __Sched__, Thread* __ThreadPtr__)
+{
+    if (__ThreadPtr__->Quanta)
+    {
+        __ReadyPush__(__Sched__, __Sched__->Active, __ThreadPtr__);
+        return;
+    }
+
+    __ThreadPtr__->Quanta = SchedQuanta[__SchedLevel__(__ThreadPtr__)];
+    __ReadyPush__(__Sched__, __Sched__->Expired, __ThreadPtr__);
+}
+
+/* Vruntime order, equal keys go right so they stay FIFO. Caller holds SchedulerLock */
+static void
+__FairPush__(CpuScheduler* __Sched__, Thread* __ThreadPtr__, int __Waking__)
+{
+    if (__Waking__)
+    {
+        /*A new thread starts level with the queue, a sleeper keeps at most half a period*/
+        uint64_t Floor = __Sched__->MinVruntime;
+        if (__ThreadPtr__->ContextSwitches)
+        {
+            Floor -= SchedLatencyNs / 2;
+        }
+        if (!__ThreadPtr__->ContextSwitches || (int64_t)(__ThreadPtr__->Vruntime - Floor) < 0)
+        {
+            __ThreadPtr__->Vruntime = Floor;
+        }
+    }
+
+    __ThreadPtr__->Weight = SchedWeights[__SchedLevel__(__ThreadPtr__)];
+
+    RbNode** Link     = &__Sched__->FairTree.Root;
+    RbNode*  Parent   = NULL;
+    int      Leftmost = 1;
+    while (*Link)
+    {
+        Parent = *Link;
+        if ((int64_t)(__ThreadPtr__->Vruntime - RbEntry(Parent, Thread, RunNode)->Vruntime) < 0)
+        {
+            Link = &Parent->Left;
+        }
+        else
+        {
+            Link     = &Parent->Right;
+            Leftmost = 0;
+        }
+    }
+
+    RbLink(&__ThreadPtr__->RunNode, Parent, Link);
+    RbInsert(&__Sched__->FairTree, &__ThreadPtr__->RunNode, Leftmost);
+    __Sched__->FairWeight += __ThreadPtr__->Weight;
+    __Sched__->ReadyCount++;
+}
+
+static void
+__FairUnlink__(CpuScheduler* __Sched__, Thread* __ThreadPtr__)
+{
+    RbErase(&__Sched__->FairTree, &__ThreadPtr__->RunNode);
+    __Sched__->FairWeight -= __ThreadPtr__->Weight;
+
+    if (__Sched__->ReadyCount > 0)
+    {
+        __Sched__->ReadyCount--;
+    }
+}
+
+/* Smallest Vruntime, the cached leftmost node */
+static Thread*
+__FairPop__(CpuScheduler* __Sched__)
+{
+    RbNode* First = RbFirst(&__Sched__->FairTree);
+    if (!First)
+    {
+        return NULL;
+    }
+
+    Thread* ThreadPtr = RbEntry(First, Thread, RunNode);
+    __FairUnlink__(__Sched__, ThreadPtr);
+    return ThreadPtr;
+}
+
+/* Charge the time since ExecStart and move the floor up, on the thread's own CPU */
+static void
+__FairCharge__(CpuScheduler* __Sched__, Thread* __ThreadPtr__, uint64_t __NowNs__)
+{
+    uint64_t Delta = __NowNs__ - __ThreadPtr__->ExecStart;
+    if ((int64_t)Delta <= 0)
+    {
+        return;
+    }
+
+    uint32_t Weight = SchedWeights[__SchedLevel__(__ThreadPtr__)];
+    __ThreadPtr__->ExecStart = __NowNs__;
+    __ThreadPtr__->Vruntime += Delta * SchedNiceWeight / Weight;
+    __ThreadPtr__->RunNs += Delta;
+
+    SysErr  err;
+    SysErr* Error = &err;
+    AcquireSpinLock(&__Sched__->SchedulerLock, Error);
+
+    __Sched__->RunNs += Delta;
+
+    /*Least served of the running thread and the queue*/
+    uint64_t Floor = __ThreadPtr__->Vruntime;
+    RbNode*  First = RbFirst(&__Sched__->FairTree);
+    if (First && (int64_t)(RbEntry(First, Thread, RunNode)->Vruntime - Floor) < 0)
+    {
+        Floor = RbEntry(First, Thread, RunNode)->Vruntime;
+    }
+    if ((int64_t)(Floor - __Sched__->MinVruntime) > 0)
+    {
+        __Sched__->MinVruntime = Floor;
+    }
+
+    ReleaseSpinLock(&__Sched__->SchedulerLock, Error);
+}
+
+/* Level with the queue head, equal keys queue behind it */
+static void
+__FairYield__(CpuScheduler* __Sched__, Thread* __ThreadPtr__)
+{
+    if (!SchedFair)
+    {
+        return;
+    }
+
+    SysErr  err;
+    SysErr* Error = &err;
+    AcquireSpinLock(&__Sched__->SchedulerLock, Error);
+
+    RbNode* First = RbFirst(&__Sched__->FairTree);
+    if (First && (int64_t)(__ThreadPtr__->Vruntime - RbEntry(First, Thread, RunNode)->Vruntime) < 0)
+    {
+        __ThreadPtr__->Vruntime = RbEntry(First, Thread, RunNode)->Vruntime;
+    }
+
+    ReleaseSpinLock(&__Sched__->SchedulerLock, Error);
+}
+
+/* Weighted share of the latency period, which stretches once slices would drop below a tick */
+static uint64_t
+__FairSlice__(CpuScheduler* __Sched__, Thread* __ThreadPtr__)
+{
+    uint64_t Runnable = (uint64_t)__atomic_load_n(&__Sched__->ReadyCount, __ATOMIC_RELAXED) + 1;
+    uint64_t Total    = __atomic_load_n(&__Sched__->FairWeight, __ATOMIC_RELAXED);
+    uint64_t Period   = SchedLatencyNs;
+
+    Total += __ThreadPtr__->Weight;
+    if (Runnable > SchedLatencyNs / SchedMinSliceNs)
+    {
+        Period = Runnable * SchedMinSliceNs;
+    }
+
+    uint64_t Slice = Period * __ThreadPtr__->Weight / Total;
+    return Slice < SchedMinSliceNs ? SchedMinSliceNs : Slice;
+}
+
+/* Highest queued RtPriority, 0 while the RT queue is empty. Caller holds SchedulerLock */
+static inline uint32_t
+__RtTop__(CpuScheduler* __Sched__)
+{
+    if (__Sched__->Rt.Bitmap[1])
+    {
+        return 127 - __builtin_clzll(__Sched__->Rt.Bitmap[1]);
+    }
+    if (__Sched__->Rt.Bitmap[0])
+    {
+        return 63 - __builtin_clzll(__Sched__->Rt.Bitmap[0]);
+    }
+    return 0;
+}
+
+static inline uint32_t
+__RtLevel__(Thread* __ThreadPtr__)
+{
+    uint32_t Level = __ThreadPtr__->RtPriority;
+    return Level && Level < SchedRtLevels ? Level : 1;
+}
+
+/* Tail, or head for a thread cut short inside its turn. Caller holds SchedulerLock */
+static void
+__RtPush__(CpuScheduler* __Sched__, Thread* __ThreadPtr__, int __AtHead__)
+{
+    RtQueue* Rt    = &__Sched__->Rt;
+    uint32_t Level = __RtLevel__(__ThreadPtr__);
+
+    if (__AtHead__ && Rt->Head[Level])
+    {
+        __ThreadPtr__->Prev   = NULL;
+        __ThreadPtr__->Next   = Rt->Head[Level];
+        Rt->Head[Level]->Prev = __ThreadPtr__;
+        Rt->Head[Level]       = __ThreadPtr__;
+    }
+    else
+    {
+        __ThreadPtr__->Next = NULL;
+        __ThreadPtr__->Prev = Rt->Tail[Level];
+
+        if (Rt->Tail[Level])
+        {
+            Rt->Tail[Level]->Next = __ThreadPtr__;
+        }
+        else
+        {
+            Rt->Head[Level] = __ThreadPtr__;
+        }
+        Rt->Tail[Level] = __ThreadPtr__;
+    }
+
+    Rt->Bitmap[Level / 64] |= 1ULL << (Level % 64);
+    __Sched__->ReadyCount++;
+}
+
+/* The throttle window rolls over lazily, whoever looks at it first. Caller holds SchedulerLock */
+static void
+__RtRollPeriod__(CpuScheduler* __Sched__, uint64_t __NowNs__)
+{
+    if (__NowNs__ - __Sched__->RtPeriodStart >= SchedRtPeriodNs)
+    {
+        __Sched__->RtPeriodStart = __NowNs__;
+        __Sched__->RtRuntime     = 0;
+        __Sched__->RtThrottled   = 0;
+    }
+}
+
+/* RT work that may run now, 0 when there is none or the budget is spent */
+static inline int
+__RtPending__(CpuScheduler* __Sched__)
+{
+    __RtRollPeriod__(__Sched__, GetSystemNanos());
+    return __RtTop__(__Sched__) && !__Sched__->RtThrottled;
+}
+
+static Thread*
+__RtPop__(CpuScheduler* __Sched__)
+{
+    if (!__RtPending__(__Sched__))
+    {
+        return NULL;
+    }
+
+    RtQueue* Rt        = &__Sched__->Rt;
+    uint32_t Level     = __RtTop__(__Sched__);
+    Thread*  ThreadPtr = Rt->Head[Level];
+
+    Rt->Head[Level] = ThreadPtr->Next;
+    if (ThreadPtr->Next)
+    {
+        ThreadPtr->Next->Prev = NULL;
+    }
+    else
+    {
+        Rt->Tail[Level] = NULL;
+        Rt->Bitmap[Level / 64] &= ~(1ULL << (Level % 64));
+    }
+
+    ThreadPtr->Next = NULL;
+    ThreadPtr->Prev = NULL;
+
+    if (__Sched__->ReadyCount > 0)
+    {
+        __Sched__->ReadyCount--;
+    }
+
+    return ThreadPtr;
+}
+
+/* Charge RT runtime against this CPU's budget, on the thread's own CPU */
+static void
+__RtCharge__(CpuScheduler* __Sched__, Thread* __ThreadPtr__, uint64_t __NowNs__)
 {
-    __asm__ volatile("fxsave %0" : "=m"(*(char (*)[512])__State__));
+    uint64_t Delta = __NowNs__ - __ThreadPtr__->ExecStart;
+    if ((int64_t)Delta <= 0)
+    {
+        return;
+    }
+    __ThreadPtr__->ExecStart = __NowNs__;
+    __ThreadPtr__->RunNs += Delta;
+
+    SysErr  err;
+    SysErr* Error = &err;
+    AcquireSpinLock(&__Sched__->SchedulerLock, Error);
+
+    __RtRollPeriod__(__Sched__, __NowNs__);
+    __Sched__->RtRuntime += Delta;
+    __Sched__->RunNs += Delta;
+    if (!__Sched__->RtThrottled && __Sched__->RtRuntime >= SchedRtRuntimeNs)
+    {
+        __Sched__->RtThrottled = 1;
+        __Sched__->RtThrottles++;
+    }
+
+    ReleaseSpinLock(&__Sched__->SchedulerLock, Error);
 }
 
 static inline void
-ThreadFxRestore(const void* __State__)
+__SchedCharge__(CpuScheduler* __Sched__, Thread* __ThreadPtr__, uint64_t __NowNs__)
 {
-    __asm__ volatile("fxrstor %0" ::"m"(*(const char (*)[512])__State__));
+    if (__ThreadPtr__->Policy != ThreadPolicyNormal)
+    {
+        __RtCharge__(__Sched__, __ThreadPtr__, __NowNs__);
+        return;
+    }
+    __FairCharge__(__Sched__, __ThreadPtr__, __NowNs__);
 }
 
-void
-AddThreadToReadyQueue(uint32_t __CpuId__, Thread* __ThreadPtr__, SysErr* __Err__)
+/* Fifo runs until it stops or is outranked, Rr also until its turn is up */
+static inline int
+__RtInTurn__(Thread* __ThreadPtr__, uint64_t __Now__)
 {
-    if (__CpuId__ >= MaxCPUs || Probe_IF_Error(__ThreadPtr__) || !__ThreadPtr__)
+    if (__ThreadPtr__->Policy == ThreadPolicyFifo)
+    {
+        return 1;
+    }
+
+    uint64_t Ran = (__Now__ - __ThreadPtr__->StartTime) * (1000000000ULL / TimerTargetFrequency);
+    return Ran < __ThreadPtr__->TimeSlice;
+}
+
+/* Tick on an RT thread: keep the CPU unless throttled, outranked, or an Rr turn ends with peers */
+static int
+__RtKeepRunning__(CpuScheduler* __Sched__, Thread* __Current__, uint64_t __Now__)
+{
+    __RtCharge__(__Sched__, __Current__, GetSystemNanos());
+
+    SysErr  err;
+    SysErr* Error = &err;
+    AcquireSpinLock(&__Sched__->SchedulerLock, Error);
+
+    uint32_t Top  = __RtTop__(__Sched__);
+    uint32_t Mine = __RtLevel__(__Current__);
+    int      Keep = !__Sched__->RtThrottled && Top <= Mine;
+    if (Keep && Top == Mine)
+    {
+        Keep = __RtInTurn__(__Current__, __Now__);
+    }
+
+    ReleaseSpinLock(&__Sched__->SchedulerLock, Error);
+    return Keep;
+}
+
+/* Tick on a fair CPU: keep going inside the slice unless a queued thread leads by a granule */
+static int
+__FairKeepRunning__(CpuScheduler* __Sched__, Thread* __Current__, uint64_t __Now__)
+{
+    __FairCharge__(__Sched__, __Current__, GetSystemNanos());
+
+    if (!__atomic_load_n(&__Sched__->ReadyCount, __ATOMIC_SEQ_CST))
+    {
+        return 1;
+    }
+
+    uint64_t Ran = (__Now__ - __Current__->StartTime) * (1000000000ULL / TimerTargetFrequency);
+    if (Ran >= __Current__->TimeSlice)
+    {
+        return 0;
+    }
+
+    SysErr  err;
+    SysErr* Error = &err;
+    AcquireSpinLock(&__Sched__->SchedulerLock, Error);
+
+    /*Queued RT work always goes first*/
+    RbNode* First = RbFirst(&__Sched__->FairTree);
+    int     Keep  = !__RtPending__(__Sched__);
+    if (Keep && First)
+    {
+        int64_t Lead = (int64_t)(__Current__->Vruntime - RbEntry(First, Thread, RunNode)->Vruntime);
+        Keep         = Lead <= (int64_t)SchedWakeupGranNs;
+    }
+
+    ReleaseSpinLock(&__Sched__->SchedulerLock, Error);
+    return Keep;
+}
+
+/* Tick on a running thread, 0 once it should give the CPU up */
+static int
+__SchedKeepRunning__(CpuScheduler* __Sched__, Thread* __Current__, uint64_t __Now__)
+{
+    if (__Current__->Policy != ThreadPolicyNormal)
+    {
+        return __RtKeepRunning__(__Sched__, __Current__, __Now__);
+    }
+    return SchedFair && __FairKeepRunning__(__Sched__, __Current__, __Now__);
+}
+
+/*Wakeups onto an idle CPU, or that would preempt its thread, IPI it rather than wait a tick*/
+int SchedWakeIpi = 1;
+
+/* The woken thread should not wait for the target's next tick. Caller holds its SchedulerLock */
+static int
+__SchedWakePreempts__(CpuScheduler* __Sched__, Thread* __Woken__)
+{
+    Thread* Current = __Sched__->CurrentThread;
+
+    /*Idle, possibly halted for up to TimerIdleMaxTicks*/
+    if (!Current || Current == __Sched__->IdleThread)
+    {
+        return 1;
+    }
+
+    if (__Woken__->Policy != ThreadPolicyNormal)
+    {
+        return Current->Policy == ThreadPolicyNormal ||
+               __RtLevel__(__Woken__) > __RtLevel__(Current);
+    }
+    if (Current->Policy != ThreadPolicyNormal)
+    {
+        return 0;
+    }
+    if (SchedFair)
+    {
+        /*Same lead __FairKeepRunning__ gives up the CPU for*/
+        return (int64_t)(Current->Vruntime - __Woken__->Vruntime) > (int64_t)SchedWakeupGranNs;
+    }
+    return __SchedLevel__(__Woken__) > __SchedLevel__(Current);
+}
+
+/* One reschedule IPI in flight per CPU, the next Schedule there covers any later wakeup */
+static void
+__SchedKick__(uint32_t __CpuId__)
+{
+    CpuScheduler* Scheduler = &CpuSchedulers[__CpuId__];
+
+    if (__atomic_exchange_n(&Scheduler->ReschedPending, 1, __ATOMIC_SEQ_CST))
     {
-        SlotError(__Err__, -BadArgs);
         return;
     }
+    if (IpiSend(__CpuId__, IpiVectorResched) == SysOkay)
+    {
+        __atomic_fetch_add(&Scheduler->ReschedIpis, 1, __ATOMIC_RELAXED);
+    }
+    else
+    {
+        __atomic_store_n(&Scheduler->ReschedPending, 0, __ATOMIC_SEQ_CST);
+    }
+}
+
+static void
+__EnqueueReady__(uint32_t __CpuId__, Thread* __ThreadPtr__, int __How__, SysErr* __Err__)
+{
+    /*Affinity moved off this CPU since it last ran here, follow it*/
+    if (!CpuMaskTest(&__ThreadPtr__->CpuAffinity, __CpuId__))
+    {
+        uint32_t Allowed = CalculateOptimalCpu(__ThreadPtr__);
+        if (Allowed < Smp.CpuCount)
+        {
+            __CpuId__ = Allowed;
+        }
+    }
 
     CpuScheduler* Scheduler = &CpuSchedulers[__CpuId__];
 
     __atomic_store_n(&__ThreadPtr__->State, ThreadStateReady, __ATOMIC_SEQ_CST);
-    __atomic_store_n(&__ThreadPtr__->LastCpu, __CpuId__, __ATOMIC_SEQ_CST);
-    __ThreadPtr__->Next = NULL;
-    __ThreadPtr__->Prev = NULL;
+    uint32_t From = __atomic_exchange_n(&__ThreadPtr__->LastCpu, __CpuId__, __ATOMIC_SEQ_CST);
+    int      Moved = From != __CpuId__ && From < MaxCPUs && __ThreadPtr__->ContextSwitches;
+
+    /*Run delay starts here, __SchedPickNext__ closes it*/
+    __ThreadPtr__->QueuedAt    = GetSystemNanos();
+    __ThreadPtr__->QueuedWoken = __How__ == EnqueueWoken;
 
     AcquireSpinLock(&Scheduler->SchedulerLock, __Err__);
 
-    if (Probe_IF_Error(Scheduler->ReadyQueue) || !Scheduler->ReadyQueue)
+    if (Moved)
     {
-        Scheduler->ReadyQueue = __ThreadPtr__;
+        __ThreadPtr__->Migrations++;
+        Scheduler->Migrations++;
+    }
+    if (__How__ == EnqueueWoken)
+    {
+        Scheduler->Wakeups++;
+        Scheduler->WakeupsLocal += ThisCpuId() == __CpuId__;
+    }
+
+    if (__ThreadPtr__->Policy != ThreadPolicyNormal)
+    {
+        __RtPush__(Scheduler, __ThreadPtr__, __How__ == EnqueueResume);
+    }
+    else if (SchedFair)
+    {
+        /*Vruntime is only comparable within the queue it was earned on*/
+        if (Moved)
+        {
+            __ThreadPtr__->Vruntime = __ThreadPtr__->Vruntime - CpuSchedulers[From].MinVruntime +
+                                      Scheduler->MinVruntime;
+        }
+        __FairPush__(Scheduler, __ThreadPtr__, __How__ == EnqueueWoken);
+    }
+    else if (__How__ != EnqueueWoken)
+    {
+        __ReadyInsert__(Scheduler, __ThreadPtr__);
     }
     else
     {
-        Thread* Tail = Scheduler->ReadyQueue;
-        while (Tail->Next)
+        /*New and woken threads join the running round*/
+        if (!__ThreadPtr__->Quanta)
         {
-            Tail = Tail->Next;
+            __ThreadPtr__->Quanta = SchedQuanta[__SchedLevel__(__ThreadPtr__)];
         }
-        Tail->Next          = __ThreadPtr__;
-        __ThreadPtr__->Prev = Tail;
+        __ReadyPush__(Scheduler, Scheduler->Active, __ThreadPtr__);
     }
 
-    /* increment while still holding the lock */
-    Scheduler->ReadyCount++;
+    if (Scheduler->ReadyCount > Scheduler->QueueMax)
+    {
+        Scheduler->QueueMax = Scheduler->ReadyCount;
+    }
+
+    int Kick = __How__ == EnqueueWoken && SchedWakeIpi &&
+               __SchedWakePreempts__(Scheduler, __ThreadPtr__);
 
     ReleaseSpinLock(&Scheduler->SchedulerLock, __Err__);
+
+    if (Kick)
+    {
+        __SchedKick__(__CpuId__);
+    }
+}
+
+void
+AddThreadToReadyQueue(uint32_t __CpuId__, Thread* __ThreadPtr__, SysErr* __Err__)
+{
+    if (__CpuId__ >= MaxCPUs || Probe_IF_Error(__ThreadPtr__) || !__ThreadPtr__)
+    {
+        SlotError(__Err__, -BadArgs);
+        return;
+    }
+
+    __EnqueueReady__(__CpuId__, __ThreadPtr__, EnqueueWoken, __Err__);
 }
 
 Thread*
@@ -72,30 +643,252 @@ RemoveThreadFromReadyQueue(uint32_t __CpuId__)
     SysErr* Error = &err;
     AcquireSpinLock(&Scheduler->SchedulerLock, Error);
 
-    Thread* ThreadPtr = Scheduler->ReadyQueue;
-    if (Probe_IF_Error(ThreadPtr) || !ThreadPtr)
+    /*RT first, unless its budget for this period is spent*/
+    Thread* ThreadPtr = __RtPop__(Scheduler);
+    if (!ThreadPtr && SchedFair)
+    {
+        ThreadPtr = __FairPop__(Scheduler);
+    }
+    if (!ThreadPtr)
+    {
+        ThreadPtr = __ReadyPop__(Scheduler);
+    }
+
+    /*Still queued from before a policy switch*/
+    if (!ThreadPtr && !SchedFair)
+    {
+        ThreadPtr = __FairPop__(Scheduler);
+    }
+
+    ReleaseSpinLock(&Scheduler->SchedulerLock, Error);
+
+    if (!ThreadPtr)
     {
-        ReleaseSpinLock(&Scheduler->SchedulerLock, Error);
         return Error_TO_Pointer(-Dangling);
     }
+    return ThreadPtr;
+}
 
-    Scheduler->ReadyQueue = ThreadPtr->Next;
-    if (ThreadPtr->Next)
+/*Idle CPUs pull work from the busiest queue instead of halting*/
+int SchedIdleSteal = 1;
+
+typedef struct
+{
+    Thread*     Cold;
+    Thread*     Hot;
+    ReadyArray* ColdArray;
+    ReadyArray* HotArray;
+    uint32_t    ColdLevel;
+    uint32_t    HotLevel;
+    uint32_t    Budget;
+
+} StealScan;
+
+static inline int
+__AllowedOn__(Thread* __ThreadPtr__, uint32_t __CpuId__)
+{
+    if (__ThreadPtr__->Flags & ThreadFlagPinned)
     {
-        ThreadPtr->Next->Prev = NULL;
+        return 0;
     }
+    return CpuMaskTest(&__ThreadPtr__->CpuAffinity, __CpuId__);
+}
 
-    ThreadPtr->Next = NULL;
-    ThreadPtr->Prev = NULL;
+/* Unlink from the middle of a level, or from the fair tree for a NULL array. Caller holds lock */
+static void
+__ReadyUnlink__(CpuScheduler* __Sched__,
+                ReadyArray*   __Array__,
+                uint32_t      __Level__,
+                Thread*       __ThreadPtr__)
+{
+    if (!__Array__)
+    {
+        __FairUnlink__(__Sched__, __ThreadPtr__);
+        return;
+    }
 
-    /* decrement while still holding the lock */
-    if (Scheduler->ReadyCount > 0)
+    if (__ThreadPtr__->Prev)
+    {
+        __ThreadPtr__->Prev->Next = __ThreadPtr__->Next;
+    }
+    else
     {
-        Scheduler->ReadyCount--;
+        __Array__->Head[__Level__] = __ThreadPtr__->Next;
     }
 
-    ReleaseSpinLock(&Scheduler->SchedulerLock, Error);
-    return ThreadPtr;
+    if (__ThreadPtr__->Next)
+    {
+        __ThreadPtr__->Next->Prev = __ThreadPtr__->Prev;
+    }
+    else
+    {
+        __Array__->Tail[__Level__] = __ThreadPtr__->Prev;
+    }
+
+    if (!__Array__->Head[__Level__])
+    {
+        __Array__->Bitmap &= ~(1U << __Level__);
+    }
+
+    __ThreadPtr__->Next = NULL;
+    __ThreadPtr__->Prev = NULL;
+
+    if (__Sched__->ReadyCount > 0)
+    {
+        __Sched__->ReadyCount--;
+    }
+}
+
+/* 1 once a cold candidate is found. A thread that started within SchedMigrateCost ticks is hot */
+static int
+__StealTry__(StealScan*  __Scan__,
+             Thread*     __Cand__,
+             ReadyArray* __Array__,
+             uint32_t    __Level__,
+             uint32_t    __CpuId__,
+             uint64_t    __Now__)
+{
+    __Scan__->Budget--;
+    /*Still being switched out on the victim, its stack is in use*/
+    if (!__AllowedOn__(__Cand__, __CpuId__) || __atomic_load_n(&__Cand__->OnCpu, __ATOMIC_ACQUIRE))
+    {
+        return 0;
+    }
+
+    if (!__Cand__->ContextSwitches || __Now__ - __Cand__->StartTime > SchedMigrateCost)
+    {
+        __Scan__->Cold      = __Cand__;
+        __Scan__->ColdArray = __Array__;
+        __Scan__->ColdLevel = __Level__;
+        return 1;
+    }
+
+    if (!__Scan__->Hot)
+    {
+        __Scan__->Hot      = __Cand__;
+        __Scan__->HotArray = __Array__;
+        __Scan__->HotLevel = __Level__;
+    }
+    return 0;
+}
+
+/* Longest waiting first */
+static void
+__StealScan__(StealScan* __Scan__, ReadyArray* __Array__, uint32_t __CpuId__, uint64_t __Now__)
+{
+    for (uint32_t Level = SchedPriorities; Level-- > 0 && !__Scan__->Cold;)
+    {
+        for (Thread* Cand = __Array__->Head[Level]; Cand && __Scan__->Budget; Cand = Cand->Next)
+        {
+            if (__StealTry__(__Scan__, Cand, __Array__, Level, __CpuId__, __Now__))
+            {
+                return;
+            }
+        }
+    }
+}
+
+/* Least served first, a NULL array marks a tree candidate */
+static void
+__StealScanFair__(StealScan* __Scan__, RbTree* __Tree__, uint32_t __CpuId__, uint64_t __Now__)
+{
+    for (RbNode* Node = RbFirst(__Tree__); Node && __Scan__->Budget; Node = RbNext(Node))
+    {
+        if (__StealTry__(__Scan__, RbEntry(Node, Thread, RunNode), NULL, 0, __CpuId__, __Now__))
+        {
+            return;
+        }
+    }
+}
+
+Thread*
+StealReadyThread(uint32_t __CpuId__, uint32_t __VictimCpu__)
+{
+    if (__CpuId__ >= MaxCPUs || __VictimCpu__ >= MaxCPUs || __CpuId__ == __VictimCpu__)
+    {
+        return Error_TO_Pointer(-BadArgs);
+    }
+
+    CpuScheduler* Victim = &CpuSchedulers[__VictimCpu__];
+    StealScan     Scan   = {NULL, NULL, NULL, NULL, 0, 0, SchedStealScan};
+
+    SysErr  err;
+    SysErr* Error = &err;
+    AcquireSpinLock(&Victim->SchedulerLock, Error);
+
+    /*Fair tree, then expired threads, which would wait out the whole round on the victim*/
+    uint64_t Now = GetSystemTicks();
+    __StealScanFair__(&Scan, &Victim->FairTree, __CpuId__, Now);
+    if (!Scan.Cold)
+    {
+        __StealScan__(&Scan, Victim->Expired, __CpuId__, Now);
+    }
+    if (!Scan.Cold)
+    {
+        __StealScan__(&Scan, Victim->Active, __CpuId__, Now);
+    }
+
+    Thread* Taken = NULL;
+    if (Scan.Cold)
+    {
+        Taken = Scan.Cold;
+        __ReadyUnlink__(Victim, Scan.ColdArray, Scan.ColdLevel, Taken);
+    }
+    else if (Scan.Hot && Victim->ReadyCount >= SchedHotBacklog)
+    {
+        /*A refill costs less than waiting behind a long queue*/
+        Taken = Scan.Hot;
+        __ReadyUnlink__(Victim, Scan.HotArray, Scan.HotLevel, Taken);
+    }
+
+    if (Taken)
+    {
+        /*Rebase onto the thief's queue now, so a later enqueue there does not do it again*/
+        Taken->Vruntime -= Victim->MinVruntime;
+        Taken->Vruntime += CpuSchedulers[__CpuId__].MinVruntime;
+        __atomic_store_n(&Taken->LastCpu, __CpuId__, __ATOMIC_SEQ_CST);
+        Taken->Migrations++;
+    }
+
+    ReleaseSpinLock(&Victim->SchedulerLock, Error);
+
+    if (!Taken)
+    {
+        return Error_TO_Pointer(-NoSuch);
+    }
+
+    __atomic_fetch_add(&CpuSchedulers[__CpuId__].Steals, 1, __ATOMIC_SEQ_CST);
+    __atomic_fetch_add(&CpuSchedulers[__CpuId__].Migrations, 1, __ATOMIC_SEQ_CST);
+    return Taken;
+}
+
+/* Busiest CPU in the nearest cache domain with work queued, unlocked reads are a hint */
+static uint32_t
+__BusiestCpu__(uint32_t __CpuId__)
+{
+    uint32_t Busiest[CpuDistRemote + 1];
+    uint32_t MaxLoad[CpuDistRemote + 1] = {0};
+
+    for (uint32_t CpuIndex = 0; CpuIndex < Smp.CpuCount; CpuIndex++)
+    {
+        uint32_t Load = __atomic_load_n(&CpuSchedulers[CpuIndex].ReadyCount, __ATOMIC_RELAXED);
+        uint32_t Dist = CpuDistance(__CpuId__, CpuIndex);
+        if (CpuIndex != __CpuId__ && Load > MaxLoad[Dist])
+        {
+            MaxLoad[Dist] = Load;
+            Busiest[Dist] = CpuIndex;
+        }
+    }
+
+    /*An SMT sibling or LLC peer hands over a thread whose cache lines are still close*/
+    for (uint32_t Dist = CpuDistSmt; Dist <= CpuDistRemote; Dist++)
+    {
+        if (MaxLoad[Dist])
+        {
+            return Busiest[Dist];
+        }
+    }
+    return MaxCPUs;
 }
 
 void
@@ -138,11 +931,37 @@ AddThreadToZombieQueue(uint32_t __CpuId__, Thread* __ThreadPtr__, SysErr* __Err_
     __atomic_store_n(&__ThreadPtr__->State, ThreadStateZombie, __ATOMIC_SEQ_CST);
     AcquireSpinLock(&Scheduler->SchedulerLock, __Err__);
 
+    int WakeReaper         = !Scheduler->ZombieQueue;
     __ThreadPtr__->Next    = Scheduler->ZombieQueue;
     Scheduler->ZombieQueue = __ThreadPtr__;
 
     ReleaseSpinLock(&Scheduler->SchedulerLock, __Err__);
     __atomic_fetch_sub(&Scheduler->ThreadCount, 1, __ATOMIC_SEQ_CST);
+
+    /*Only the first zombie wakes it, the reaper drains the queue before parking again*/
+    if (WakeReaper && SchedReapDeferred && Scheduler->Reaper)
+    {
+        ThreadUnblock(Scheduler->Reaper, __Err__);
+    }
+}
+
+/* Wheel callback, runs unlocked on the CPU the sleep was armed on */
+static void
+__SleepExpired__(void* __Arg__)
+{
+    Thread* ThreadPtr = (Thread*)__Arg__;
+
+    if (__atomic_load_n(&ThreadPtr->State, __ATOMIC_SEQ_CST) != ThreadStateSleeping)
+    {
+        return;
+    }
+
+    SysErr  err;
+    SysErr* Error = &err;
+
+    __atomic_store_n(&ThreadPtr->WaitReason, WaitReasonNone, __ATOMIC_SEQ_CST);
+    __atomic_store_n(&ThreadPtr->WakeupTime, 0, __ATOMIC_SEQ_CST);
+    AddThreadToReadyQueue(ThreadPtr->SleepTimer.Cpu, ThreadPtr, Error);
 }
 
 void
@@ -154,18 +973,11 @@ AddThreadToSleepingQueue(uint32_t __CpuId__, Thread* __ThreadPtr__, SysErr* __Er
         return;
     }
 
-    CpuScheduler* Scheduler = &CpuSchedulers[__CpuId__];
-
-    SysErr  err;
-    SysErr* Error = &err;
-
     __atomic_store_n(&__ThreadPtr__->State, ThreadStateSleeping, __ATOMIC_SEQ_CST);
-    AcquireSpinLock(&Scheduler->SchedulerLock, Error);
-
-    __ThreadPtr__->Next      = Scheduler->SleepingQueue;
-    Scheduler->SleepingQueue = __ThreadPtr__;
 
-    ReleaseSpinLock(&Scheduler->SchedulerLock, Error);
+    /*Parked on the wheel, a tick only looks at the slot that is due*/
+    TimerInit(&__ThreadPtr__->SleepTimer, __SleepExpired__, __ThreadPtr__);
+    TimerArmAt(&__ThreadPtr__->SleepTimer, __CpuId__, __ThreadPtr__->WakeupTime);
 }
 
 void
@@ -205,6 +1017,22 @@ GetCpuReadyCount(uint32_t __CpuId__)
     return __atomic_load_n(&CpuSchedulers[__CpuId__].ReadyCount, __ATOMIC_SEQ_CST);
 }
 
+/* Queued plus the one on the CPU, what a newcomer would wait behind */
+uint32_t
+GetCpuRunnable(uint32_t __CpuId__)
+{
+    if (__CpuId__ >= MaxCPUs)
+    {
+        return Nothing;
+    }
+
+    CpuScheduler* Scheduler = &CpuSchedulers[__CpuId__];
+    Thread*       Current   = __atomic_load_n(&Scheduler->CurrentThread, __ATOMIC_RELAXED);
+    uint32_t      Ready     = __atomic_load_n(&Scheduler->ReadyCount, __ATOMIC_RELAXED);
+
+    return Ready + (Current && Current != Scheduler->IdleThread);
+}
+
 uint64_t
 GetCpuContextSwitches(uint32_t __CpuId__)
 {
@@ -234,63 +1062,8 @@ WakeupSleepingThreads(uint32_t __CpuId__, SysErr* __Err__)
         return;
     }
 
-    CpuScheduler* Scheduler    = &CpuSchedulers[__CpuId__];
-    uint64_t      CurrentTicks = GetSystemTicks();
-
-    AcquireSpinLock(&Scheduler->SchedulerLock, __Err__);
-
-    Thread* Current = Scheduler->SleepingQueue;
-    Thread* Prev    = NULL;
-
-    while (Current)
-    {
-        Thread* Next = Current->Next;
-
-        if (__atomic_load_n(&Current->WakeupTime, __ATOMIC_SEQ_CST) <= CurrentTicks)
-        {
-            /* unlink from sleeping */
-            if (Prev)
-            {
-                Prev->Next = Next;
-            }
-            else
-            {
-                Scheduler->SleepingQueue = Next;
-            }
-
-            __atomic_store_n(&Current->WaitReason, WaitReasonNone, __ATOMIC_SEQ_CST);
-            __atomic_store_n(&Current->WakeupTime, 0, __ATOMIC_SEQ_CST);
-            Current->State = ThreadStateReady;
-            Current->Prev  = NULL;
-            Current->Next  = NULL;
-
-            /* splice into ready tail under lock */
-            if (Probe_IF_Error(Scheduler->ReadyQueue) || !Scheduler->ReadyQueue)
-            {
-                Scheduler->ReadyQueue = Current;
-            }
-            else
-            {
-                Thread* Tail = Scheduler->ReadyQueue;
-                while (Tail->Next)
-                {
-                    Tail = Tail->Next;
-                }
-                Tail->Next    = Current;
-                Current->Prev = Tail;
-            }
-
-            Scheduler->ReadyCount++;
-        }
-        else
-        {
-            Prev = Current;
-        }
-
-        Current = Next;
-    }
-
-    ReleaseSpinLock(&Scheduler->SchedulerLock, __Err__);
+    /*Due sleepers are requeued by their timer callbacks*/
+    TimerWheelRun(__CpuId__, GetSystemTicks());
 }
 
 void
@@ -305,8 +1078,20 @@ CleanupZombieThreads(uint32_t __CpuId__, SysErr* __Err__)
     CpuScheduler* Scheduler = &CpuSchedulers[__CpuId__];
     AcquireSpinLock(&Scheduler->SchedulerLock, __Err__);
 
-    Thread* Current        = Scheduler->ZombieQueue;
-    Scheduler->ZombieQueue = NULL;
+    /*At most SchedReapBatch off the head, the rest waits for the next pass*/
+    Thread*  Current = Scheduler->ZombieQueue;
+    Thread*  Last    = Current;
+    uint32_t Count   = Current ? 1 : 0;
+    while (Last && Last->Next && Count < SchedReapBatch)
+    {
+        Last = Last->Next;
+        Count++;
+    }
+    if (Last)
+    {
+        Scheduler->ZombieQueue = Last->Next;
+        Last->Next             = NULL;
+    }
 
     ReleaseSpinLock(&Scheduler->SchedulerLock, __Err__);
 
@@ -316,6 +1101,7 @@ CleanupZombieThreads(uint32_t __CpuId__, SysErr* __Err__)
         DestroyThread(Current, __Err__);
         Current = Next;
     }
+    __atomic_fetch_add(&Scheduler->Reaped, Count, __ATOMIC_SEQ_CST);
 }
 
 void
@@ -330,13 +1116,22 @@ InitializeCpuScheduler(uint32_t __CpuId__, SysErr* __Err__)
     CpuScheduler* Scheduler = &CpuSchedulers[__CpuId__];
 
     /* Reset all queues to empty */
-    Scheduler->ReadyQueue    = NULL;
+    for (uint32_t Level = 0; Level < SchedPriorities; Level++)
+    {
+        Scheduler->ReadyArrays[0].Head[Level] = NULL;
+        Scheduler->ReadyArrays[0].Tail[Level] = NULL;
+        Scheduler->ReadyArrays[1].Head[Level] = NULL;
+        Scheduler->ReadyArrays[1].Tail[Level] = NULL;
+    }
+    Scheduler->ReadyArrays[0].Bitmap = 0;
+    Scheduler->ReadyArrays[1].Bitmap = 0;
+    Scheduler->Active                = &Scheduler->ReadyArrays[0];
+    Scheduler->Expired               = &Scheduler->ReadyArrays[1];
+
     Scheduler->WaitingQueue  = NULL;
     Scheduler->ZombieQueue   = NULL;
-    Scheduler->SleepingQueue = NULL;
     Scheduler->CurrentThread = NULL;
     Scheduler->NextThread    = NULL;
-    Scheduler->IdleThread    = NULL;
 
     /* Reset all */
     __atomic_store_n(&Scheduler->ThreadCount, 0, __ATOMIC_SEQ_CST);
@@ -346,8 +1141,46 @@ InitializeCpuScheduler(uint32_t __CpuId__, SysErr* __Err__)
     __atomic_store_n(&Scheduler->LoadAverage, 0, __ATOMIC_SEQ_CST);
     __atomic_store_n(&Scheduler->ScheduleTicks, 0, __ATOMIC_SEQ_CST);
     __atomic_store_n(&Scheduler->LastSchedule, 0, __ATOMIC_SEQ_CST);
+    __atomic_store_n(&Scheduler->Steals, 0, __ATOMIC_SEQ_CST);
+    __atomic_store_n(&Scheduler->Voluntary, 0, __ATOMIC_SEQ_CST);
+
+    RbInit(&Scheduler->FairTree);
+    Scheduler->FairWeight  = 0;
+    Scheduler->MinVruntime = 0;
+
+    for (uint32_t Level = 0; Level < SchedRtLevels; Level++)
+    {
+        Scheduler->Rt.Head[Level] = NULL;
+        Scheduler->Rt.Tail[Level] = NULL;
+    }
+    Scheduler->Rt.Bitmap[0]  = 0;
+    Scheduler->Rt.Bitmap[1]  = 0;
+    Scheduler->RtRuntime     = 0;
+    Scheduler->RtPeriodStart = 0;
+    Scheduler->RtThrottled   = 0;
+    Scheduler->RtThrottles   = 0;
+
+    Scheduler->Yields         = 0;
+    Scheduler->IdlePicks      = 0;
+    Scheduler->Wakeups        = 0;
+    Scheduler->WakeupsLocal   = 0;
+    Scheduler->Migrations     = 0;
+    Scheduler->RunNs          = 0;
+    Scheduler->RunDelayNs     = 0;
+    Scheduler->QueueSum       = 0;
+    Scheduler->QueueTicks     = 0;
+    Scheduler->QueueMax       = 0;
+    Scheduler->TickMaxNs      = 0;
+    Scheduler->Reaped         = 0;
+    Scheduler->ReschedPending = 0;
+    Scheduler->ReschedIpis    = 0;
+    for (uint32_t Bucket = 0; Bucket < SchedLatBuckets; Bucket++)
+    {
+        Scheduler->WakeLat[Bucket] = 0;
+    }
 
     InitializeSpinLock(&Scheduler->SchedulerLock, "CpuScheduler", __Err__);
+    InitializeTimerWheel(__CpuId__, __Err__);
 
     PDebug("CPU %u scheduler initialized\n", __CpuId__);
 }
@@ -401,9 +1234,6 @@ LoadThreadContextToInterruptFrame(Thread* __ThreadPtr__, InterruptFrame* __Frame
         __asm__ volatile("mov %0, %%cr3" ::"r"(__Pd__) : "memory");
     }
 
-    /*FPU*/
-    ThreadFxRestore(__ThreadPtr__->Context.FpuState);
-
     ThreadContext* Context = &__ThreadPtr__->Context;
 
     __Frame__->Rax = Context->Rax;
@@ -429,89 +1259,123 @@ LoadThreadContextToInterruptFrame(Thread* __ThreadPtr__, InterruptFrame* __Frame
     __Frame__->Ss     = Context->Ss;
 }
 
-void
-Schedule(uint32_t __CpuId__, InterruptFrame* __Frame__, SysErr* __Err__)
+/* Queue the outgoing thread by its state, its registers are already saved */
+static void
+__SchedPutPrev__(uint32_t __CpuId__, Thread* __Current__, uint64_t __Now__, SysErr* __Err__)
 {
-    if (__CpuId__ >= MaxCPUs || Probe_IF_Error(__Frame__) || !__Frame__)
+    CpuScheduler* Scheduler = &CpuSchedulers[__CpuId__];
+
+    if (__Current__ == Scheduler->IdleThread)
     {
-        PError("Bad Arguments to the Schedular, CPUID %u\n", __CpuId__);
-        SlotError(__Err__, -BadArgs);
+        /*The idle context is never queued, only its time is kept*/
+        __atomic_fetch_add(
+            &Scheduler->IdleTicks, __Now__ - __Current__->StartTime, __ATOMIC_SEQ_CST);
         return;
     }
 
-    CpuScheduler* Scheduler  = &CpuSchedulers[__CpuId__];
-    Thread*       Current    = Scheduler->CurrentThread;
-    Thread*       NextThread = NULL;
-
-    /*for trace*/
-#ifdef __SchdDBG
-    DumpCpuSchedulerInfo(__CpuId__, __Err__);
-#endif
+    /*By elapsed ticks, a tickless stretch is one interrupt but many ticks*/
+    __atomic_fetch_add(&__Current__->CpuTime, __Now__ - __Current__->StartTime, __ATOMIC_SEQ_CST);
+    __SchedCharge__(Scheduler, __Current__, GetSystemNanos());
 
-    __atomic_fetch_add(&Scheduler->ScheduleTicks, 1, __ATOMIC_SEQ_CST);
-    __atomic_store_n(&Scheduler->LastSchedule, GetSystemTicks(), __ATOMIC_SEQ_CST);
-
-    if (Current)
+    /*Still runnable is involuntary, yields included, as getrusage counts them*/
+    if (__Current__->State == ThreadStateRunning || __Current__->State == ThreadStateReady)
     {
-        /*FPU*/
-        ThreadFxSave(Current->Context.FpuState);
-
-        /*Save*/
-        SaveInterruptFrameToThread(Current, __Frame__, __Err__);
-
-        __atomic_fetch_add(&Current->CpuTime, 1, __ATOMIC_SEQ_CST);
+        __Current__->Involuntary++;
+        Scheduler->Yields += __Current__->State == ThreadStateReady;
+    }
+    else
+    {
+        __Current__->Voluntary++;
+    }
 
-        /* Handle current thread */
-        switch (Current->State)
-        {
-            case ThreadStateRunning:
-                /* Thread was preempted normally */
-                AddThreadToReadyQueue(__CpuId__, Current, __Err__);
-                break;
+    /* Handle current thread */
+    switch (__Current__->State)
+    {
+        case ThreadStateRunning:
+            /* Thread was preempted, an RT one outranked mid-turn keeps its place */
+            __EnqueueReady__(__CpuId__,
+                             __Current__,
+                             __Current__->Policy != ThreadPolicyNormal &&
+                                     __RtInTurn__(__Current__, __Now__)
+                                 ? EnqueueResume
+                                 : EnqueuePreempted,
+                             __Err__);
+            break;
 
-            case ThreadStateTerminated:
-                /* Thread has finished */
-                AddThreadToZombieQueue(__CpuId__, Current, __Err__);
-                break;
+        case ThreadStateTerminated:
+            /* Thread has finished */
+            AddThreadToZombieQueue(__CpuId__, __Current__, __Err__);
+            break;
 
-            case ThreadStateBlocked:
-                /* Thread is waiting for I/O or resource */
-                AddThreadToWaitingQueue(__CpuId__, Current, __Err__);
+        case ThreadStateBlocked:
+            /* Thread is waiting for I/O or resource */
+            if (__atomic_load_n(&__Current__->BlockState, __ATOMIC_SEQ_CST) != BlockNone)
+            {
+                /* Wait queue sleepers park off every queue, their waker requeues them */
+                uint32_t Going = BlockGoing;
+                if (!__atomic_compare_exchange_n(&__Current__->BlockState,
+                                                 &Going,
+                                                 BlockParked,
+                                                 false,
+                                                 __ATOMIC_SEQ_CST,
+                                                 __ATOMIC_SEQ_CST))
+                {
+                    /* Woken before we got here */
+                    __atomic_store_n(&__Current__->BlockState, BlockNone, __ATOMIC_SEQ_CST);
+                    __EnqueueReady__(__CpuId__, __Current__, EnqueueWoken, __Err__);
+                }
                 break;
+            }
+            AddThreadToWaitingQueue(__CpuId__, __Current__, __Err__);
+            break;
 
-            case ThreadStateSleeping:
-                /* Thread is sleeping */
-                AddThreadToSleepingQueue(__CpuId__, Current, __Err__);
-                break;
+        case ThreadStateSleeping:
+            /* Thread is sleeping */
+            AddThreadToSleepingQueue(__CpuId__, __Current__, __Err__);
+            break;
 
-            case ThreadStateReady:
-                /* Thread yielded CPU voluntarily */
-                AddThreadToReadyQueue(__CpuId__, Current, __Err__);
-                break;
+        case ThreadStateReady:
+            /* Thread yielded CPU voluntarily, behind the fair head so it really gives way */
+            __FairYield__(Scheduler, __Current__);
+            __EnqueueReady__(__CpuId__, __Current__, EnqueuePreempted, __Err__);
+            break;
 
-            default:
-                /* Unknown state */
-                Current->State = ThreadStateReady;
-                AddThreadToReadyQueue(__CpuId__, Current, __Err__);
-                break;
-        }
+        default:
+            /* Unknown state */
+            __Current__->State = ThreadStateReady;
+            __EnqueueReady__(__CpuId__, __Current__, EnqueuePreempted, __Err__);
+            break;
     }
+}
 
-SelectAgain:
+/* Pick what runs next and make it current, NULL only before the idle thread exists */
+static Thread*
+__SchedPickNext__(uint32_t __CpuId__, Thread* __Prev__, uint64_t __Now__, SysErr* __Err__)
+{
+    CpuScheduler* Scheduler = &CpuSchedulers[__CpuId__];
 
-    /*Routine*/
-    WakeupSleepingThreads(__CpuId__, __Err__);
-    CleanupZombieThreads(__CpuId__, __Err__);
+    /* Highest priority with quanta left, one bitmap scan */
+    Thread* NextThread = RemoveThreadFromReadyQueue(__CpuId__);
 
-    NextThread = RemoveThreadFromReadyQueue(__CpuId__);
+    /* Nothing queued here, pull from the busiest CPU before going idle */
+    if (Probe_IF_Error(NextThread) && SchedIdleSteal)
+    {
+        uint32_t Victim = __BusiestCpu__(__CpuId__);
+        if (Victim < MaxCPUs)
+        {
+            NextThread = StealReadyThread(__CpuId__, Victim);
+        }
+    }
 
-    /* CPU is idle */
+    /* CPU is idle, halt in its own context so the last thread is not resumed */
     if (Probe_IF_Error(NextThread))
     {
-        Scheduler->CurrentThread = NULL;
-        __atomic_fetch_add(&Scheduler->IdleTicks, 1, __ATOMIC_SEQ_CST);
-        SlotError(__Err__, -NoSuch);
-        return;
+        if (!Scheduler->IdleThread)
+        {
+            Scheduler->CurrentThread = NULL;
+            return NULL;
+        }
+        NextThread = Scheduler->IdleThread;
     }
 
     /* Override CS and SS selectors based on ring */
@@ -526,62 +1390,303 @@ SelectAgain:
         NextThread->Context.Ss = KernelDataSelector;
     }
 
-    /* Frequency stride based on thread priority */
-    uint32_t Stride = 1;
-    switch (NextThread->Priority)
+    /* Every pick spends one quantum, at zero the next preempt moves it to Expired */
+    if (NextThread->Quanta)
     {
-        case ThreadPrioritykernel:
-            Stride = 1;
-            break; /* Kernel threads run constantly */
-        case ThreadPrioritySuper:
-            Stride = 2;
-            break;
-        case ThreadPriorityUltra:
-            Stride = 4;
-            break;
-        case ThreadPriorityHigh:
-            Stride = 8;
-            break;
-        case ThreadPriorityNormal:
-            Stride = 16;
-            break;
-        case ThreadPriorityLow:
-            Stride = 32;
-            break;
-        case ThreadPriorityIdle:
-            Stride = 64;
-            break;
+        NextThread->Quanta--;
+    }
 
-        default:
-            Stride = 16;
-            break; /* Default to normal priority */
+    /* Slice from what is queued behind it, runtime is charged from here */
+    if (NextThread != Scheduler->IdleThread)
+    {
+        NextThread->Weight    = SchedWeights[__SchedLevel__(NextThread)];
+        NextThread->TimeSlice = NextThread->Policy == ThreadPolicyRr
+                                    ? SchedRrSliceNs
+                                    : __FairSlice__(Scheduler, NextThread);
     }
+    uint64_t Nanos        = GetSystemNanos();
+    NextThread->ExecStart = Nanos;
 
-    if (__atomic_load_n(&NextThread->Cooldown, __ATOMIC_SEQ_CST) > 0)
+    /* Close the run delay opened by __EnqueueReady__, the idle thread is never queued */
+    if (NextThread->QueuedAt)
     {
-        __atomic_fetch_sub(&NextThread->Cooldown, 1, __ATOMIC_SEQ_CST);
-        AddThreadToReadyQueue(__CpuId__, NextThread, __Err__);
+        uint64_t Delay = Nanos - NextThread->QueuedAt;
+        if ((int64_t)Delay < 0)
+        {
+            Delay = 0;
+        }
 
-        /* Select another thread to run */
-        goto SelectAgain;
+        NextThread->RunDelayNs += Delay;
+        Scheduler->RunDelayNs += Delay;
+        if (NextThread->QueuedWoken)
+        {
+            uint64_t Us     = Delay / 1000;
+            uint32_t Bucket = Us > 1 ? 63 - __builtin_clzll(Us) : 0;
+            Scheduler->WakeLat[Bucket < SchedLatBuckets ? Bucket : SchedLatBuckets - 1]++;
+        }
+        NextThread->QueuedAt = 0;
     }
-    else
+    else if (NextThread == Scheduler->IdleThread)
+    {
+        Scheduler->IdlePicks++;
+    }
+
+    /* Queued elsewhere before its old CPU got off its stack, wait that out */
+    if (NextThread != __Prev__)
     {
-        /*Reset*/
-        __atomic_store_n(&NextThread->Cooldown, Stride - 1, __ATOMIC_SEQ_CST);
+        while (__atomic_load_n(&NextThread->OnCpu, __ATOMIC_ACQUIRE))
+        {
+            __asm__ volatile("pause");
+        }
+        NextThread->OnCpu = 1;
     }
 
     Scheduler->CurrentThread = NextThread;
     NextThread->State        = ThreadStateRunning;
     NextThread->LastCpu      = __CpuId__;
-    __atomic_store_n(&NextThread->StartTime, GetSystemTicks(), __ATOMIC_SEQ_CST);
+    SetCurrentThread(__CpuId__, NextThread, __Err__);
+    __atomic_store_n(&NextThread->StartTime, __Now__, __ATOMIC_SEQ_CST);
     __atomic_fetch_add(&Scheduler->ContextSwitches, 1, __ATOMIC_SEQ_CST);
     __atomic_fetch_add(&NextThread->ContextSwitches, 1, __ATOMIC_SEQ_CST);
 
-    /*Restore*/
-    LoadThreadContextToInterruptFrame(NextThread, __Frame__, __Err__);
+    return NextThread;
+}
 
-    SetCurrentThread(__CpuId__, NextThread, __Err__);
+/* Queue length held since the last schedule, for the average in /proc/schedstat */
+static inline void
+__SchedSampleQueue__(CpuScheduler* __Sched__, uint64_t __Now__)
+{
+    uint64_t Last = __Sched__->LastSchedule;
+    if (Last && __Now__ > Last)
+    {
+        __Sched__->QueueSum += (uint64_t)__Sched__->ReadyCount * (__Now__ - Last);
+        __Sched__->QueueTicks += __Now__ - Last;
+    }
+    __atomic_store_n(&__Sched__->LastSchedule, __Now__, __ATOMIC_SEQ_CST);
+}
+
+/* Worst case of the timer path, for the tick latency benches */
+static inline void
+__SchedTickDone__(CpuScheduler* __Sched__, uint64_t __Entered__)
+{
+    uint64_t Spent = GetSystemNanos() - __Entered__;
+    if (Spent > __Sched__->TickMaxNs)
+    {
+        __Sched__->TickMaxNs = Spent;
+    }
+}
+
+/* Sleepers, zombies and the periodic push balance, run on every timer schedule */
+static void
+__SchedRoutine__(uint32_t __CpuId__, SysErr* __Err__)
+{
+    /*Normally the reaper's job, kept here for comparison and for CPUs without one*/
+    int ReapHere = !SchedReapDeferred || !CpuSchedulers[__CpuId__].Reaper;
+
+    WakeupSleepingThreads(__CpuId__, __Err__);
+    if (ReapHere)
+    {
+        CleanupZombieThreads(__CpuId__, __Err__);
+    }
+
+    /* Push pass for queues that never drain far enough to steal from */
+    if (__CpuId__ == 0 && SchedIdleSteal &&
+        !(CpuSchedulers[__CpuId__].ScheduleTicks % SchedBalanceTicks))
+    {
+        LoadBalanceThreads(__Err__);
+    }
+}
+
+/* A thread that left through SwitchTo returns into SwitchResume on its own stack */
+void
+LoadSwitchFrameToInterruptFrame(Thread* __ThreadPtr__, InterruptFrame* __Frame__, SysErr* __Err__)
+{
+    if (Probe_IF_Error(__ThreadPtr__) || !__ThreadPtr__ || Probe_IF_Error(__Frame__) || !__Frame__)
+    {
+        SlotError(__Err__, -BadArgs);
+        return;
+    }
+
+    uint64_t __Pd__ = __ThreadPtr__->PageDirectory;
+    if (__Pd__)
+    {
+        __asm__ volatile("mov %0, %%cr3" ::"r"(__Pd__) : "memory");
+    }
+
+    __Frame__->Rip    = (uint64_t)SwitchResume;
+    __Frame__->Rsp    = __ThreadPtr__->SwitchRsp;
+    __Frame__->Rflags = 0x002; /*ScheduleSwitch puts its own flags back once it is resumed*/
+    __Frame__->Cs     = KernelCodeSelector;
+    __Frame__->Ss     = KernelDataSelector;
+
+    __ThreadPtr__->SwitchRsp = 0;
+}
+
+/* Timer or reschedule IPI, only the tick runs the periodic routine and counts as one */
+static void
+__ScheduleFrame__(uint32_t __CpuId__, InterruptFrame* __Frame__, int __Tick__, SysErr* __Err__)
+{
+    if (__CpuId__ >= MaxCPUs || Probe_IF_Error(__Frame__) || !__Frame__)
+    {
+        PError("Bad Arguments to the Schedular, CPUID %u\n", __CpuId__);
+        SlotError(__Err__, -BadArgs);
+        return;
+    }
+
+    CpuScheduler* Scheduler  = &CpuSchedulers[__CpuId__];
+    Thread*       Current    = Scheduler->CurrentThread;
+    Thread*       NextThread = NULL;
+    uint64_t      Entered    = GetSystemNanos();
+
+    /*for trace*/
+#ifdef __SchdDBG
+    DumpCpuSchedulerInfo(__CpuId__, __Err__);
+#endif
+
+    /*Whatever a reschedule IPI on its way was sent for is seen by this pass*/
+    __atomic_store_n(&Scheduler->ReschedPending, 0, __ATOMIC_SEQ_CST);
+
+    uint64_t Now = GetSystemTicks();
+    if (__Tick__)
+    {
+        __atomic_fetch_add(&Scheduler->ScheduleTicks, 1, __ATOMIC_SEQ_CST);
+    }
+    __SchedSampleQueue__(Scheduler, Now);
+
+    /*No switch at all while the current thread is inside its turn*/
+    if (Current && Current != Scheduler->IdleThread && Current->State == ThreadStateRunning &&
+        __SchedKeepRunning__(Scheduler, Current, Now))
+    {
+        if (__Tick__)
+        {
+            __SchedRoutine__(__CpuId__, __Err__);
+            __SchedTickDone__(Scheduler, Entered);
+        }
+        return;
+    }
+
+    if (Current)
+    {
+        /*FPU, only if it was loaded during this run*/
+        FpuSwitchOut(Current);
+
+        /*Save*/
+        SaveInterruptFrameToThread(Current, __Frame__, __Err__);
+        __SchedPutPrev__(__CpuId__, Current, Now, __Err__);
+    }
+
+    if (__Tick__)
+    {
+        __SchedRoutine__(__CpuId__, __Err__);
+    }
+
+    NextThread = __SchedPickNext__(__CpuId__, Current, Now, __Err__);
+    if (!NextThread)
+    {
+        SlotError(__Err__, -NoSuch);
+        return;
+    }
+
+    /*Restore, the FPU state follows on first use*/
+    FpuSwitchIn(NextThread);
+    if (NextThread->SwitchRsp)
+    {
+        LoadSwitchFrameToInterruptFrame(NextThread, __Frame__, __Err__);
+    }
+    else
+    {
+        LoadThreadContextToInterruptFrame(NextThread, __Frame__, __Err__);
+    }
+
+    /*The interrupt exit still runs on the old thread's stack, it clears OnCpu once off it*/
+    if (Current && Current != NextThread)
+    {
+        ThisCpuData()->LeavingOnCpu = &Current->OnCpu;
+    }
+    if (__Tick__)
+    {
+        __SchedTickDone__(Scheduler, Entered);
+    }
+}
+
+void
+Schedule(uint32_t __CpuId__, InterruptFrame* __Frame__, SysErr* __Err__)
+{
+    __ScheduleFrame__(__CpuId__, __Frame__, 1, __Err__);
+}
+
+/* IpiVectorResched, the same preemption rules as the tick without its periodic work */
+void
+ScheduleIpi(uint32_t __CpuId__, InterruptFrame* __Frame__, SysErr* __Err__)
+{
+    if (__CpuId__ >= MaxCPUs)
+    {
+        SlotError(__Err__, -BadArgs);
+        return;
+    }
+
+    IpiStats[__CpuId__].Resched++;
+    if (!__atomic_load_n(&CpuSchedulers[__CpuId__].ReschedPending, __ATOMIC_SEQ_CST))
+    {
+        IpiStats[__CpuId__].ReschedStale++;
+        return;
+    }
+
+    __ScheduleFrame__(__CpuId__, __Frame__, 0, __Err__);
+
+    /*Out of one-shot idle into periodic, now that something runs here*/
+    TimerReprogram();
+}
+
+/*
+    Voluntary switch for kernel threads: the call chain stays on the thread's
+    own stack and only callee-saved registers are kept, no interrupt frame,
+    no EOI and no field by field context copy. User threads in a syscall run
+    on the shared per-CPU stack, so they still leave through int $0x20.
+*/
+void
+ScheduleSwitch(SysErr* __Err__)
+{
+    uint64_t Flags;
+    __asm__ volatile("pushfq; popq %0; cli" : "=r"(Flags)::"memory");
+
+    uint32_t      CpuId     = ThisCpuId();
+    CpuScheduler* Scheduler = &CpuSchedulers[CpuId];
+    Thread*       Current   = Scheduler->CurrentThread;
+
+    if (!Current || Current->Type != ThreadTypeKernel || Current == Scheduler->IdleThread ||
+        !Scheduler->IdleThread)
+    {
+        __asm__ volatile("int $0x20");
+        __asm__ volatile("pushq %0; popfq" ::"r"(Flags) : "memory");
+        return;
+    }
+
+    uint64_t Now = GetSystemTicks();
+    __atomic_store_n(&Scheduler->ReschedPending, 0, __ATOMIC_SEQ_CST);
+    __SchedSampleQueue__(Scheduler, Now);
+    __atomic_fetch_add(&Scheduler->Voluntary, 1, __ATOMIC_SEQ_CST);
+
+    FpuSwitchOut(Current);
+    __SchedPutPrev__(CpuId, Current, Now, __Err__);
+
+    Thread* NextThread = __SchedPickNext__(CpuId, Current, Now, __Err__);
+    FpuSwitchIn(NextThread);
+
+    /*A new sleeper or a change in runnable count may move the tickless deadline*/
+    TimerReprogram();
+
+    if (NextThread != Current)
+    {
+        if (NextThread->PageDirectory)
+        {
+            __asm__ volatile("mov %0, %%cr3" ::"r"(NextThread->PageDirectory) : "memory");
+        }
+        SwitchTo(Current, NextThread);
+    }
+
+    /*Back on this thread, possibly on another CPU*/
+    __asm__ volatile("pushq %0; popfq" ::"r"(Flags) : "memory");
 }
 
 void
@@ -599,8 +1704,22 @@ DumpCpuSchedulerInfo(uint32_t __CpuId__, SysErr* __Err__)
     PInfo("  Threads: %u, Ready: %u\n",
           __atomic_load_n(&Scheduler->ThreadCount, __ATOMIC_SEQ_CST),
           __atomic_load_n(&Scheduler->ReadyCount, __ATOMIC_SEQ_CST));
-    PInfo("  Context Switches: %llu\n",
-          __atomic_load_n(&Scheduler->ContextSwitches, __ATOMIC_SEQ_CST));
+    PInfo("  Context Switches: %llu (voluntary %llu), Steals: %llu\n",
+          __atomic_load_n(&Scheduler->ContextSwitches, __ATOMIC_SEQ_CST),
+          __atomic_load_n(&Scheduler->Voluntary, __ATOMIC_SEQ_CST),
+          __atomic_load_n(&Scheduler->Steals, __ATOMIC_SEQ_CST));
+    PInfo("  Fair: weight %llu, min vruntime %llu\n",
+          Scheduler->FairWeight,
+          Scheduler->MinVruntime);
+    PInfo("  RT: levels 0x%016llx%016llx, runtime %llu ns, throttled %u (%llu periods)\n",
+          Scheduler->Rt.Bitmap[1],
+          Scheduler->Rt.Bitmap[0],
+          Scheduler->RtRuntime,
+          Scheduler->RtThrottled,
+          Scheduler->RtThrottles);
+    PInfo("  Ready levels: active 0x%02x, expired 0x%02x\n",
+          Scheduler->Active->Bitmap,
+          Scheduler->Expired->Bitmap);
     PInfo("  Current Thread: %u\n",
           Scheduler->CurrentThread ? Scheduler->CurrentThread->ThreadId : 0);
 }
@@ -620,12 +1739,94 @@ GetNextThread(uint32_t __CpuId__)
     return RemoveThreadFromReadyQueue(__CpuId__);
 }
 
+/* One per CPU, pinned, parks on its own scheduler lock while there is nothing to free */
+static void
+__ReaperLoop__(void* __Arg__)
+{
+    SysErr  err;
+    SysErr* Error = &err;
+
+    uint32_t      CpuId     = (uint32_t)(uint64_t)__Arg__;
+    CpuScheduler* Scheduler = &CpuSchedulers[CpuId];
+
+    for (;;)
+    {
+        AcquireSpinLock(&Scheduler->SchedulerLock, Error);
+        if (!Scheduler->ZombieQueue)
+        {
+            /*A zombie queued from here on finds the queue empty and unblocks us*/
+            ThreadBlock(&Scheduler->SchedulerLock, WaitReasonZombie, Scheduler, Error);
+            continue;
+        }
+        ReleaseSpinLock(&Scheduler->SchedulerLock, Error);
+
+        CleanupZombieThreads(CpuId, Error);
+
+        /*A long storm is freed in batches, so it shares the CPU like any other work*/
+        ThreadYield(Error);
+    }
+}
+
+static void
+__IdleLoop__(void* __Arg__ _unused)
+{
+    for (;;)
+    {
+        /*Timer is one-shot here, so this sleeps until the next event*/
+        __asm__ volatile("sti; hlt");
+    }
+}
+
 void
 InitializeScheduler(SysErr* __Err__)
 {
     for (uint32_t CpuIndex = 0; CpuIndex < Smp.CpuCount; CpuIndex++)
     {
         InitializeCpuScheduler(CpuIndex, __Err__);
+
+        if (!CpuSchedulers[CpuIndex].Reaper)
+        {
+            Thread* Reaper = CreateThread(
+                ThreadTypeKernel, __ReaperLoop__, (void*)(uint64_t)CpuIndex, ThreadPriorityNormal);
+            if (Probe_IF_Error(Reaper) || !Reaper)
+            {
+                SlotError(__Err__, -BadAlloc);
+            }
+            else
+            {
+                strcpy(Reaper->Name, "Reaper", sizeof(Reaper->Name));
+                CpuMaskZero(&Reaper->CpuAffinity);
+                CpuMaskSet(&Reaper->CpuAffinity, CpuIndex);
+                Reaper->Flags |= ThreadFlagPinned | ThreadFlagSystem;
+
+                /*Starts parked, the first zombie queued here wakes it*/
+                Reaper->State      = ThreadStateBlocked;
+                Reaper->WaitReason = WaitReasonZombie;
+                Reaper->BlockState = BlockParked;
+                Reaper->LastCpu    = CpuIndex;
+                CpuSchedulers[CpuIndex].Reaper = Reaper;
+            }
+        }
+
+        if (CpuSchedulers[CpuIndex].IdleThread)
+        {
+            continue;
+        }
+
+        Thread* Idle = CreateThread(ThreadTypeKernel, __IdleLoop__, NULL, ThreadPriorityIdle);
+        if (Probe_IF_Error(Idle) || !Idle)
+        {
+            SlotError(__Err__, -BadAlloc);
+            continue;
+        }
+
+        strcpy(Idle->Name, "Idle", sizeof(Idle->Name));
+
+        /*Never borrow a user space that could be reaped while this CPU sleeps*/
+        Idle->PageDirectory                = Vmm.KernelPml4Physical;
+        Idle->State                        = ThreadStateRunning;
+        Idle->Flags                       |= ThreadFlagPinned | ThreadFlagSystem;
+        CpuSchedulers[CpuIndex].IdleThread = Idle;
     }
 
     PSuccess("Scheduler initialized for %u CPUs\n", Smp.CpuCount);
@@ -0,0 +1,106 @@
+#include <AxeSchd.h>
+#include <PerCPUData.h>
+
+/*Where SwitchTo builds the iretq frame for a thread without a switch frame, interrupts are off*/
+static PerCpu(uint64_t, SwitchScratch[64]);
+
+/*Offsets used by __SwitchToContext__*/
+_Static_assert(__builtin_offsetof(ThreadContext, Rsi) == 32, "ThreadContext layout");
+_Static_assert(__builtin_offsetof(ThreadContext, Rsp) == 56, "ThreadContext layout");
+_Static_assert(__builtin_offsetof(ThreadContext, R15) == 120, "ThreadContext layout");
+_Static_assert(__builtin_offsetof(ThreadContext, Rip) == 128, "ThreadContext layout");
+_Static_assert(__builtin_offsetof(ThreadContext, Rflags) == 136, "ThreadContext layout");
+_Static_assert(__builtin_offsetof(ThreadContext, Cs) == 144, "ThreadContext layout");
+_Static_assert(__builtin_offsetof(ThreadContext, Ss) == 146, "ThreadContext layout");
+
+void __SwitchStacks__(uint64_t* __PrevRsp__, uint64_t __NextRsp__, uint32_t* __PrevOnCpu__);
+void __SwitchToContext__(uint64_t*      __PrevRsp__,
+                         ThreadContext* __Context__,
+                         uint64_t       __Stack__,
+                         uint32_t*      __PrevOnCpu__);
+
+/*
+    __SwitchStacks__(PrevRsp, NextRsp, PrevOnCpu). A call already lets the
+    compiler assume every caller-saved register is gone, so the frame is just
+    the six callee-saved ones under the return address.
+*/
+__asm__(".global __SwitchStacks__\n"
+        "__SwitchStacks__:\n"
+        " pushq %rbp\n"
+        " pushq %rbx\n"
+        " pushq %r12\n"
+        " pushq %r13\n"
+        " pushq %r14\n"
+        " pushq %r15\n"
+        " movq %rsp, (%rdi)\n"
+        " movq %rsi, %rsp\n"
+        " movl $0, (%rdx) # Off the old stack, it may be resumed anywhere now\n"
+        ".global SwitchResume\n"
+        "SwitchResume:\n"
+        " popq %r15\n"
+        " popq %r14\n"
+        " popq %r13\n"
+        " popq %r12\n"
+        " popq %rbx\n"
+        " popq %rbp\n"
+        " ret\n");
+
+/*
+    __SwitchToContext__(PrevRsp, Context, Stack, PrevOnCpu). Same frame for
+    the outgoing thread, then enter one that was preempted or never ran the
+    way the interrupt exit would, through an iretq frame built on Stack.
+*/
+__asm__(".global __SwitchToContext__\n"
+        "__SwitchToContext__:\n"
+        " pushq %rbp\n"
+        " pushq %rbx\n"
+        " pushq %r12\n"
+        " pushq %r13\n"
+        " pushq %r14\n"
+        " pushq %r15\n"
+        " movq %rsp, (%rdi)\n"
+        " movq %rdx, %rsp\n"
+        " movl $0, (%rcx)\n"
+        " movzwq 146(%rsi), %rax # SS\n"
+        " pushq %rax\n"
+        " pushq 56(%rsi) # RSP\n"
+        " pushq 136(%rsi) # RFLAGS\n"
+        " movzwq 144(%rsi), %rax # CS\n"
+        " pushq %rax\n"
+        " pushq 128(%rsi) # RIP\n"
+        " movq 0(%rsi), %rax\n"
+        " movq 8(%rsi), %rbx\n"
+        " movq 16(%rsi), %rcx\n"
+        " movq 24(%rsi), %rdx\n"
+        " movq 40(%rsi), %rdi\n"
+        " movq 48(%rsi), %rbp\n"
+        " movq 64(%rsi), %r8\n"
+        " movq 72(%rsi), %r9\n"
+        " movq 80(%rsi), %r10\n"
+        " movq 88(%rsi), %r11\n"
+        " movq 96(%rsi), %r12\n"
+        " movq 104(%rsi), %r13\n"
+        " movq 112(%rsi), %r14\n"
+        " movq 120(%rsi), %r15\n"
+        " movq 32(%rsi), %rsi\n"
+        " testb $3, 8(%rsp) # Into ring 3, restore the user GS base\n"
+        " jz 1f\n"
+        " swapgs\n"
+        "1:\n"
+        " iretq\n");
+
+/* Caller has interrupts off and has already made __Next__ current on this CPU */
+void
+SwitchTo(Thread* __Prev__, Thread* __Next__)
+{
+    uint64_t NextRsp = __Next__->SwitchRsp;
+    if (NextRsp)
+    {
+        __Next__->SwitchRsp = 0;
+        __SwitchStacks__(&__Prev__->SwitchRsp, NextRsp, &__Prev__->OnCpu);
+        return;
+    }
+
+    uint64_t Stack = (uint64_t)ThisCpuPtr(SwitchScratch) + sizeof(SwitchScratch);
+    __SwitchToContext__(&__Prev__->SwitchRsp, &__Next__->Context, Stack, &__Prev__->OnCpu);
+}
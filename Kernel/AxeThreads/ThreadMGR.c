@@ -1,53 +1,34 @@
 
 #include <AxeSchd.h>
 #include <AxeThreads.h>
+#include <Fpu.h>
 #include <KHeap.h>
 #include <PerCPUData.h>
 #include <SMP.h>
 #include <Sync.h>
 #include <Timer.h>
 #include <VMM.h>
+#include <WorkQueue.h>
 
 uint32_t        NextThreadId = 1;
 Thread*         ThreadList   = NULL;
 SpinLock        ThreadListLock;
-Thread*         CurrentThreads[MaxCPUs];
-static SpinLock CurrentThreadLock; /*Mutexes would have been fine ig*/
-Thread*         IdleThread;
-
-static void
-Idler(void* __Arg__)
-{
-    for (;;)
-    {
-        __asm__("hlt");
-    }
-}
+static Thread*  ThreadHash[ThreadHashBuckets]; /*Written under ThreadListLock, read under RCU*/
+static uint32_t ThreadTotal = 0;
 
 void
 InitializeThreadManager(SysErr* __Err__)
 {
     InitializeSpinLock(&ThreadListLock, "ThreadList", __Err__);
-    InitializeSpinLock(&CurrentThreadLock, "CurrentThread", __Err__);
     NextThreadId = 1;
     ThreadList   = NULL;
 
     for (uint32_t CpuIndex = 0; CpuIndex < MaxCPUs; CpuIndex++)
     {
-        CurrentThreads[CpuIndex] = NULL;
+        CpuDataArray[CpuIndex].CurrentThread = NULL;
     }
 
-    SysErr  err;
-    SysErr* Error = &err;
-
-    /*Idle thread*/
-    IdleThread = CreateThread(ThreadTypeKernel, Idler, NULL, ThreadPriorityIdle);
-
-    if (Probe_IF_Error(IdleThread))
-    {
-        SlotError(__Err__, -BadAlloc);
-        return;
-    }
+    /*Idle threads are per CPU, made by InitializeScheduler*/
 
     PSuccess("Thread Manager initialized\n");
 }
@@ -66,14 +47,8 @@ GetCurrentThread(uint32_t __CpuId__)
         return Error_TO_Pointer(-Limits);
     }
 
-    SysErr  err;
-    SysErr* Error = &err;
-
-    AcquireSpinLock(&CurrentThreadLock, Error);
-    Thread* Result = CurrentThreads[__CpuId__];
-    ReleaseSpinLock(&CurrentThreadLock, Error);
-
-    return Result;
+    /*Only the owning CPU writes it, a plain load is enough (ThisThread() for our own)*/
+    return __atomic_load_n(&CpuDataArray[__CpuId__].CurrentThread, __ATOMIC_ACQUIRE);
 }
 
 void
@@ -85,9 +60,7 @@ SetCurrentThread(uint32_t __CpuId__, Thread* __ThreadPtr__, SysErr* __Err__)
         return;
     }
 
-    AcquireSpinLock(&CurrentThreadLock, __Err__);
-    CurrentThreads[__CpuId__] = __ThreadPtr__;
-    ReleaseSpinLock(&CurrentThreadLock, __Err__);
+    __atomic_store_n(&CpuDataArray[__CpuId__].CurrentThread, __ThreadPtr__, __ATOMIC_RELEASE);
 }
 
 Thread*
@@ -101,7 +74,6 @@ CreateThread(ThreadType     __Type__,
     Thread* NewThread = (Thread*)KMalloc(sizeof(Thread));
     if (Probe_IF_Error(NewThread) || !NewThread)
     {
-        ReleaseSpinLock(&ThreadListLock, Error);
         return Error_TO_Pointer(-BadAlloc);
     }
     PDebug("TCB allocated at %p\n", NewThread);
@@ -125,17 +97,16 @@ CreateThread(ThreadType     __Type__,
     /*ring 0*/
     if (__Type__ == ThreadTypeKernel)
     {
-        void* KernelStackBase = KMalloc(8192);
+        void* KernelStackBase = AllocKernelStack();
         if (Probe_IF_Error(KernelStackBase) || !KernelStackBase)
         {
             KFree(NewThread, Error);
-            ReleaseSpinLock(&ThreadListLock, Error);
             return Error_TO_Pointer(-BadAlloc);
         }
         NewThread->KernelStack =
-            (uint64_t)KernelStackBase + 8192; /** Stack grows downwards; store top */
-        NewThread->UserStack = 0;             /** Kernel thread has no user stack */
-        NewThread->StackSize = 8192;
+            (uint64_t)KernelStackBase + KStackSize; /** Stack grows downwards; store top */
+        NewThread->UserStack = 0;                   /** Kernel thread has no user stack */
+        NewThread->StackSize = KStackSize;
         PDebug("CreateThread: Kernel stack allocated at %p (top: %p)\n",
                KernelStackBase,
                (void*)NewThread->KernelStack);
@@ -144,31 +115,42 @@ CreateThread(ThreadType     __Type__,
     /*ring 3*/
     else
     {
-        void* KernelStackBase = KMalloc(8192);
-        void* UserStackBase   = KMalloc(8192);
+        void* KernelStackBase = AllocKernelStack();
+        void* UserStackBase   = KMalloc(KStackSize);
         if (Probe_IF_Error(KernelStackBase) || !KernelStackBase || Probe_IF_Error(UserStackBase) ||
             !UserStackBase)
         {
-            if (KernelStackBase)
+            if (!Probe_IF_Error(KernelStackBase) && KernelStackBase)
             {
-                KFree(KernelStackBase, Error);
+                FreeKernelStack(KernelStackBase);
             }
             if (UserStackBase)
             {
                 KFree(UserStackBase, Error);
             }
             KFree(NewThread, Error);
-            ReleaseSpinLock(&ThreadListLock, Error);
             return Error_TO_Pointer(-BadAlloc);
         }
-        NewThread->KernelStack = (uint64_t)KernelStackBase + 8192;
-        NewThread->UserStack   = (uint64_t)UserStackBase + 8192;
-        NewThread->StackSize   = 8192;
+        NewThread->KernelStack = (uint64_t)KernelStackBase + KStackSize;
+        NewThread->UserStack   = (uint64_t)UserStackBase + KStackSize;
+        NewThread->StackSize   = KStackSize;
         PDebug("Stacks allocated - Kernel: %p, User: %p\n",
                (void*)NewThread->KernelStack,
                (void*)NewThread->UserStack);
     }
 
+    /*FPU/SSE/AVX area, sized from CPUID*/
+    if (FpuAllocState(NewThread) != SysOkay)
+    {
+        FreeKernelStack((void*)(NewThread->KernelStack - NewThread->StackSize));
+        if (NewThread->UserStack)
+        {
+            KFree((void*)(NewThread->UserStack - NewThread->StackSize), Error);
+        }
+        KFree(NewThread, Error);
+        return Error_TO_Pointer(-BadAlloc);
+    }
+
     NewThread->Context.Rip    = (uint64_t)__EntryPoint__;
     NewThread->Context.Rsp    = (NewThread->KernelStack & ~0xFULL) - 16;
     NewThread->Context.Rflags = 0x202;
@@ -194,26 +176,35 @@ CreateThread(ThreadType     __Type__,
     NewThread->Context.Gs  = NewThread->Context.Ss;
     NewThread->Context.Rdi = (uint64_t)__Argument__;
     PDebug("RIP=%p, RSP=%p\n", (void*)NewThread->Context.Rip, (void*)NewThread->Context.Rsp);
-    NewThread->CpuAffinity  = 0xFFFFFFFF;
     NewThread->LastCpu      = 0xFFFFFFFF;
-    NewThread->TimeSlice    = 10;
-    NewThread->Cooldown     = 0;
+    NewThread->TimeSlice    = SchedLatencyNs;
+    NewThread->Quanta       = 0;
     NewThread->StartTime    = GetSystemTicks();
     NewThread->CreationTick = GetSystemTicks();
     NewThread->WaitReason   = WaitReasonNone;
+    CpuMaskFill(&NewThread->CpuAffinity);
+    TimerInit(&NewThread->SleepTimer, NULL, NewThread);
 
     NewThread->PageDirectory = 0;
     NewThread->VirtualBase   = UserVirtualBase;
     NewThread->MemoryUsage   = (NewThread->StackSize * 2) / 1024;
 
-    PDebug("current head: %p\n", ThreadList);
-    NewThread->Next = ThreadList;
+    AcquireSpinLock(&ThreadListLock, Error);
+
+    NewThread->ListNext = ThreadList;
     if (ThreadList)
     {
-        ThreadList->Prev = NewThread;
+        ThreadList->ListPrev = NewThread;
     }
     ThreadList = NewThread;
-    PDebug("new head: %p\n", ThreadList);
+
+    /*Fully built before it is published, lock free readers may find it at once*/
+    Thread** Bucket     = &ThreadHash[NewThread->ThreadId & (ThreadHashBuckets - 1)];
+    NewThread->HashNext = *Bucket;
+    __atomic_store_n(Bucket, NewThread, __ATOMIC_RELEASE);
+    ThreadTotal++;
+
+    ReleaseSpinLock(&ThreadListLock, Error);
 
     PDebug("Created thread %u (%s)\n",
            NewThread->ThreadId,
@@ -232,28 +223,44 @@ DestroyThread(Thread* __ThreadPtr__, SysErr* __Err__)
     }
 
     __ThreadPtr__->State = ThreadStateTerminated;
+    TimerCancel(&__ThreadPtr__->SleepTimer);
 
     AcquireSpinLock(&ThreadListLock, __Err__);
 
-    if (__ThreadPtr__->Prev)
+    if (__ThreadPtr__->ListPrev)
     {
-        __ThreadPtr__->Prev->Next = __ThreadPtr__->Next;
+        __ThreadPtr__->ListPrev->ListNext = __ThreadPtr__->ListNext;
     }
-    else
+    else if (ThreadList == __ThreadPtr__)
     {
-        ThreadList = __ThreadPtr__->Next;
+        ThreadList = __ThreadPtr__->ListNext;
     }
 
-    if (__ThreadPtr__->Next)
+    if (__ThreadPtr__->ListNext)
     {
-        __ThreadPtr__->Next->Prev = __ThreadPtr__->Prev;
+        __ThreadPtr__->ListNext->ListPrev = __ThreadPtr__->ListPrev;
+    }
+
+    /*Readers already on it keep walking through its HashNext, still intact*/
+    Thread** Link = &ThreadHash[__ThreadPtr__->ThreadId & (ThreadHashBuckets - 1)];
+    while (*Link && *Link != __ThreadPtr__)
+    {
+        Link = &(*Link)->HashNext;
+    }
+    if (*Link)
+    {
+        __atomic_store_n(Link, __ThreadPtr__->HashNext, __ATOMIC_RELEASE);
+        ThreadTotal--;
     }
 
     ReleaseSpinLock(&ThreadListLock, __Err__);
 
+    /*Nobody may still be looking at it once FindThreadById readers drain*/
+    SynchronizeRcu();
+
     if (__ThreadPtr__->KernelStack)
     {
-        KFree((void*)(__ThreadPtr__->KernelStack - __ThreadPtr__->StackSize), __Err__);
+        FreeKernelStack((void*)(__ThreadPtr__->KernelStack - __ThreadPtr__->StackSize));
     }
 
     if (__ThreadPtr__->UserStack)
@@ -261,6 +268,7 @@ DestroyThread(Thread* __ThreadPtr__, SysErr* __Err__)
         KFree((void*)(__ThreadPtr__->UserStack - __ThreadPtr__->StackSize), __Err__);
     }
 
+    FpuFreeState(__ThreadPtr__, __Err__);
     KFree(__ThreadPtr__, __Err__);
 
     PDebug("Destroyed thread %u\n", __ThreadPtr__->ThreadId);
@@ -324,17 +332,60 @@ SetThreadPriority(Thread* __ThreadPtr__, ThreadPriority __Priority__, SysErr* __
 }
 
 void
-SetThreadAffinity(Thread* __ThreadPtr__, uint32_t __CpuMask__, SysErr* __Err__)
+SetThreadAffinity(Thread* __ThreadPtr__, const CpuMask* __CpuMask__, SysErr* __Err__)
 {
-    if (Probe_IF_Error(__ThreadPtr__) || !__ThreadPtr__)
+    if (Probe_IF_Error(__ThreadPtr__) || !__ThreadPtr__ || !__CpuMask__ ||
+        !CpuMaskWeight(__CpuMask__, Smp.CpuCount))
     {
         SlotError(__Err__, -BadArgs);
         return;
     }
 
-    __ThreadPtr__->CpuAffinity = __CpuMask__;
+    __ThreadPtr__->CpuAffinity = *__CpuMask__;
 
-    PDebug("Set thread %u affinity to 0x%x\n", __ThreadPtr__->ThreadId, __CpuMask__);
+    PDebug("Set thread %u affinity to %u CPU(s)\n",
+           __ThreadPtr__->ThreadId,
+           CpuMaskWeight(__CpuMask__, Smp.CpuCount));
+}
+
+/* Queued threads switch class at their next enqueue, a running one at its next tick */
+int
+SetThreadPolicy(Thread* __ThreadPtr__, uint32_t __Policy__, uint32_t __RtPriority__)
+{
+    if (Probe_IF_Error(__ThreadPtr__) || !__ThreadPtr__)
+    {
+        return -BadArgs;
+    }
+
+    switch (__Policy__)
+    {
+        case ThreadPolicyNormal:
+            if (__RtPriority__)
+            {
+                return -BadArgs;
+            }
+            break;
+
+        case ThreadPolicyFifo:
+        case ThreadPolicyRr:
+            if (!__RtPriority__ || __RtPriority__ > ThreadRtPriorityMax)
+            {
+                return -BadArgs;
+            }
+            break;
+
+        default:
+            return -BadArgs;
+    }
+
+    __atomic_store_n(&__ThreadPtr__->RtPriority, __RtPriority__, __ATOMIC_SEQ_CST);
+    __atomic_store_n(&__ThreadPtr__->Policy, __Policy__, __ATOMIC_SEQ_CST);
+
+    PDebug("Set thread %u policy %u, rt priority %u\n",
+           __ThreadPtr__->ThreadId,
+           __Policy__,
+           __RtPriority__);
+    return SysOkay;
 }
 
 uint32_t
@@ -367,6 +418,31 @@ FindLeastLoadedCpu(void)
     return BestCpu;
 }
 
+/* Runnable threads on __CpuId__ and its SMT siblings */
+static uint32_t
+__CoreLoad__(uint32_t __CpuId__)
+{
+    uint32_t Load = 0;
+    CpuMaskForEach(Sibling, &Smp.Cpus[__CpuId__].SmtMask, Smp.CpuCount)
+    {
+        Load += GetCpuRunnable(Sibling);
+    }
+    return Load;
+}
+
+/* 0 for an idle CPU on an idle core, 1 for an idle CPU whose sibling is busy, then by load */
+static uint32_t
+__PlacementCost__(uint32_t __CpuId__)
+{
+    uint32_t Load = GetCpuRunnable(__CpuId__);
+    if (Load)
+    {
+        return Load + 1;
+    }
+    return __CoreLoad__(__CpuId__) ? 1 : 0;
+}
+
+/* Cheapest allowed CPU, ties go to the one sharing the most cache with where it last ran */
 uint32_t
 CalculateOptimalCpu(Thread* __ThreadPtr__)
 {
@@ -375,30 +451,32 @@ CalculateOptimalCpu(Thread* __ThreadPtr__)
         return Nothing;
     }
 
-    if (__ThreadPtr__->CpuAffinity != 0xFFFFFFFF)
+    uint32_t Near     = __ThreadPtr__->LastCpu;
+    uint32_t BestCpu  = Nothing;
+    uint32_t BestCost = 0xFFFFFFFF;
+
+    if (Near >= Smp.CpuCount)
     {
-        uint32_t BestCpu       = 0;
-        uint32_t MinLoad       = 0xFFFFFFFF;
-        bool     FoundValidCpu = false;
+        Near = GetCurrentCpuId();
+    }
 
-        for (uint32_t CpuIndex = 0; CpuIndex < Smp.CpuCount; CpuIndex++)
+    CpuMaskForEach(CpuIndex, &__ThreadPtr__->CpuAffinity, Smp.CpuCount)
+    {
+        if (Smp.Cpus[CpuIndex].Status != CPU_STATUS_ONLINE)
         {
-            if (__ThreadPtr__->CpuAffinity & (1 << CpuIndex))
-            {
-                uint32_t Load = GetCpuLoad(CpuIndex);
-                if (Probe_IF_Error(FoundValidCpu) || !FoundValidCpu || Load < MinLoad)
-                {
-                    MinLoad       = Load;
-                    BestCpu       = CpuIndex;
-                    FoundValidCpu = true;
-                }
-            }
+            continue;
         }
 
-        return FoundValidCpu ? BestCpu : Nothing;
+        uint32_t Cost = __PlacementCost__(CpuIndex) * (CpuDistRemote + 1);
+        Cost += CpuDistance(Near, CpuIndex);
+        if (Cost < BestCost)
+        {
+            BestCost = Cost;
+            BestCpu  = CpuIndex;
+        }
     }
 
-    return FindLeastLoadedCpu();
+    return BestCpu;
 }
 
 void
@@ -461,54 +539,48 @@ ThreadExecuteMultiple(Thread** __ThreadArray__, uint32_t __ThreadCount__, SysErr
 void
 LoadBalanceThreads(SysErr* __Err__)
 {
-    uint32_t CpuLoads[MaxCPUs];
-    uint32_t MaxLoad = 0;
-    uint32_t MinLoad = 0xFFFFFFFF;
+    uint32_t Total, Average, MaxLoad, MinLoad;
+    GetSystemLoadStats(&Total, &Average, &MaxLoad, &MinLoad, __Err__);
+
+    /* Only perform migration if load difference is significant */
+    if (MaxLoad <= MinLoad + 2)
+    {
+        return;
+    }
+
     uint32_t MaxCpu  = 0;
     uint32_t MinCpu  = 0;
-
-    /* Gather load information */
+    uint32_t MinCore = 0xFFFFFFFF;
     for (uint32_t CpuIndex = 0; CpuIndex < Smp.CpuCount; CpuIndex++)
     {
-        CpuLoads[CpuIndex] = GetCpuLoad(CpuIndex);
-
-        if (CpuLoads[CpuIndex] > MaxLoad)
+        uint32_t Load = GetCpuLoad(CpuIndex);
+        if (Load == MaxLoad)
         {
-            MaxLoad = CpuLoads[CpuIndex];
-            MaxCpu  = CpuIndex;
+            MaxCpu = CpuIndex;
         }
 
-        if (CpuLoads[CpuIndex] < MinLoad)
+        /*Of the least loaded, the one whose SMT siblings are least busy*/
+        uint32_t Core = Load == MinLoad ? __CoreLoad__(CpuIndex) : 0xFFFFFFFF;
+        if (Core < MinCore)
         {
-            MinLoad = CpuLoads[CpuIndex];
+            MinCore = Core;
             MinCpu  = CpuIndex;
         }
     }
 
-    /* Only perform migration if load difference is significant */
-    if (MaxLoad > MinLoad + 2)
+    /*Same pick as an idle steal: affinity respected, cache hot threads left alone*/
+    Thread* ThreadToMigrate = StealReadyThread(MinCpu, MaxCpu);
+    if (Probe_IF_Error(ThreadToMigrate) || !ThreadToMigrate)
     {
-        Thread* ThreadToMigrate = GetNextThread(MaxCpu);
-        if (ThreadToMigrate)
-        {
-            if (ThreadToMigrate->CpuAffinity == 0xFFFFFFFF ||
-                (ThreadToMigrate->CpuAffinity & (1 << MinCpu)))
-            {
-                ThreadToMigrate->LastCpu = MinCpu;
-                AddThreadToReadyQueue(MinCpu, ThreadToMigrate, __Err__);
-
-                PDebug("Migrated Thread %u from CPU %u to CPU %u\n",
-                       ThreadToMigrate->ThreadId,
-                       MaxCpu,
-                       MinCpu);
-            }
-            else
-            {
-                /* Put thread back into original CPU’s ready queue if migration failed */
-                AddThreadToReadyQueue(MaxCpu, ThreadToMigrate, __Err__);
-            }
-        }
+        return;
     }
+
+    AddThreadToReadyQueue(MinCpu, ThreadToMigrate, __Err__);
+
+    PDebug("Migrated Thread %u from CPU %u to CPU %u\n",
+           ThreadToMigrate->ThreadId,
+           MaxCpu,
+           MinCpu);
 }
 
 void
@@ -561,15 +633,31 @@ GetSystemLoadStats(uint32_t*       __TotalThreads__,
 }
 
 void
-ThreadYield(SysErr* __Err__ _unused)
+ThreadYield(SysErr* __Err__)
 {
-    /*Software Interrupt*/
-    __asm__ volatile("int $0x20");
+    /*Ready rather than Running, so Schedule queues it behind its peers*/
+    Thread* Current = ThisThread();
+    if (Current)
+    {
+        Current->State = ThreadStateReady;
+    }
+    ScheduleSwitch(__Err__);
 }
 
 void
 ThreadSleep(uint64_t __Milliseconds__, SysErr* __Err__)
 {
+    /*Its pool hands the backlog to another worker while it is away*/
+    Thread* Self = ThisThread();
+    if (Self && (Self->Flags & ThreadFlagWorker))
+    {
+        WorkerSleeping(Self);
+    }
+
+    /*An idle CPU may steal us between reading the CPU id and its current thread*/
+    uint64_t Flags;
+    __asm__ volatile("pushfq; popq %0; cli" : "=r"(Flags)::"memory");
+
     uint32_t CpuId   = GetCurrentCpuId();
     Thread*  Current = GetCurrentThread(CpuId);
 
@@ -579,10 +667,13 @@ ThreadSleep(uint64_t __Milliseconds__, SysErr* __Err__)
         Current->WaitReason = WaitReasonSleep;
         Current->WakeupTime = GetSystemTicks() + __Milliseconds__;
 
-        __asm__ volatile("int $0x20");
+        ScheduleSwitch(__Err__);
+        __asm__ volatile("pushq %0; popfq" ::"r"(Flags) : "memory");
     }
     else
     {
+        __asm__ volatile("pushq %0; popfq" ::"r"(Flags) : "memory");
+
         /*busy wait*/
         uint64_t WakeupTime = GetSystemTicks() + __Milliseconds__;
         while (GetSystemTicks() < WakeupTime)
@@ -590,13 +681,103 @@ ThreadSleep(uint64_t __Milliseconds__, SysErr* __Err__)
             __asm__ volatile("hlt");
         }
     }
+
+    if (Self && (Self->Flags & ThreadFlagWorker))
+    {
+        WorkerWaking(Self);
+    }
+}
+
+/* Caller holds __Lock__ and has queued the current thread where its waker will find it */
+void
+ThreadBlock(SpinLock* __Lock__, uint32_t __Reason__, void* __On__, SysErr* __Err__)
+{
+    Thread* Current = ThisThread();
+
+    if (Probe_IF_Error(Current) || !Current)
+    {
+        ReleaseSpinLock(__Lock__, __Err__);
+        SlotError(__Err__, -NoOperations);
+        return;
+    }
+
+    Current->WaitingOn  = __On__;
+    Current->WaitReason = __Reason__;
+    __atomic_store_n(&Current->BlockState, BlockGoing, __ATOMIC_SEQ_CST);
+    __atomic_store_n(&Current->State, ThreadStateBlocked, __ATOMIC_SEQ_CST);
+
+    /*A wakeup from here on is caught by Schedule, whether it is this yield or a preemption*/
+    ReleaseSpinLock(__Lock__, __Err__);
+    if (Current->Flags & ThreadFlagWorker)
+    {
+        WorkerSleeping(Current);
+    }
+    ScheduleSwitch(__Err__);
+    if (Current->Flags & ThreadFlagWorker)
+    {
+        WorkerWaking(Current);
+    }
+
+    Current->WaitReason = WaitReasonNone;
+}
+
+void
+ThreadUnblock(Thread* __ThreadPtr__, SysErr* __Err__)
+{
+    if (Probe_IF_Error(__ThreadPtr__) || !__ThreadPtr__)
+    {
+        SlotError(__Err__, -BadArgs);
+        return;
+    }
+
+    while (1)
+    {
+        uint32_t State = __atomic_load_n(&__ThreadPtr__->BlockState, __ATOMIC_SEQ_CST);
+
+        if (State == BlockGoing)
+        {
+            /*Still getting off its CPU, Schedule will requeue it instead of parking it*/
+            if (__atomic_compare_exchange_n(&__ThreadPtr__->BlockState,
+                                            &State,
+                                            BlockWoken,
+                                            false,
+                                            __ATOMIC_SEQ_CST,
+                                            __ATOMIC_SEQ_CST))
+            {
+                return;
+            }
+        }
+        else if (State == BlockParked)
+        {
+            if (__atomic_compare_exchange_n(&__ThreadPtr__->BlockState,
+                                            &State,
+                                            BlockNone,
+                                            false,
+                                            __ATOMIC_SEQ_CST,
+                                            __ATOMIC_SEQ_CST))
+            {
+                /*Back where it last ran, its cache is most likely still there*/
+                uint32_t CpuId = __ThreadPtr__->LastCpu;
+                if (CpuId >= MaxCPUs)
+                {
+                    CpuId = GetCurrentCpuId();
+                }
+                AddThreadToReadyQueue(CpuId, __ThreadPtr__, __Err__);
+                return;
+            }
+        }
+        else
+        {
+            /*Not blocked on a wait queue, or someone else woke it first*/
+            return;
+        }
+    }
 }
 
 void
 ThreadExit(uint32_t __ExitCode__, SysErr* __Err__)
 {
-    uint32_t CpuId   = GetCurrentCpuId();
-    Thread*  Current = GetCurrentThread(CpuId);
+    Thread* Current = GetCurrentThread(GetCurrentCpuId());
 
     if (Probe_IF_Error(Current) || !Current || Probe_IF_Error(Current))
     {
@@ -604,54 +785,33 @@ ThreadExit(uint32_t __ExitCode__, SysErr* __Err__)
         return;
     }
 
-    Current->State    = ThreadStateZombie;
     Current->ExitCode = __ExitCode__;
 
     PInfo("Thread %u exiting with code %u\n", Current->ThreadId, __ExitCode__);
 
-    AddThreadToZombieQueue(CpuId, Current, __Err__);
-    ThreadYield(__Err__);
+    /*The switch queues it as a zombie, the reaper frees it once this CPU is off its stack*/
+    Current->State = ThreadStateTerminated;
+    ScheduleSwitch(__Err__);
 }
 
+/* Lock free. Caller is inside RcuReadLock and done with the thread before it unlocks */
 Thread*
 FindThreadById(uint32_t __ThreadId__)
 {
-    SysErr  err;
-    SysErr* Error = &err;
-    AcquireSpinLock(&ThreadListLock, Error);
-
-    Thread* Current = ThreadList;
-    while (Current)
+    Thread* Current =
+        __atomic_load_n(&ThreadHash[__ThreadId__ & (ThreadHashBuckets - 1)], __ATOMIC_ACQUIRE);
+    while (Current && Current->ThreadId != __ThreadId__)
     {
-        if (Current->ThreadId == __ThreadId__)
-        {
-            ReleaseSpinLock(&ThreadListLock, Error);
-            return Current;
-        }
-        Current = Current->Next;
+        Current = __atomic_load_n(&Current->HashNext, __ATOMIC_ACQUIRE);
     }
 
-    ReleaseSpinLock(&ThreadListLock, Error);
-    return Error_TO_Pointer(-NoSuch);
+    return Current ? Current : Error_TO_Pointer(-NoSuch);
 }
 
 uint32_t
 GetThreadCount(void)
 {
-    uint32_t Count = 0;
-
-    SysErr  err;
-    SysErr* Error = &err;
-    AcquireSpinLock(&ThreadListLock, Error);
-    Thread* Current = ThreadList;
-    while (Current)
-    {
-        Count++;
-        Current = Current->Next;
-    }
-    ReleaseSpinLock(&ThreadListLock, Error);
-
-    return Count;
+    return __atomic_load_n(&ThreadTotal, __ATOMIC_RELAXED);
 }
 
 void
@@ -670,7 +830,7 @@ WakeSleepingThreads(SysErr* __Err__)
             Current->WaitReason = WaitReasonNone;
             Current->WakeupTime = 0;
         }
-        Current = Current->Next;
+        Current = Current->ListNext;
     }
 
     ReleaseSpinLock(&ThreadListLock, __Err__);
@@ -697,9 +857,11 @@ DumpThreadInfo(Thread* __ThreadPtr__, SysErr* __Err__)
           __ThreadPtr__->KernelStack,
           __ThreadPtr__->UserStack,
           __ThreadPtr__->StackSize);
-    PInfo("  Memory: %u KB, Affinity: 0x%x\n",
+    PInfo("  Memory: %u KB, Affinity: %u of %u CPUs (0x%lx)\n",
           __ThreadPtr__->MemoryUsage,
-          __ThreadPtr__->CpuAffinity);
+          CpuMaskWeight(&__ThreadPtr__->CpuAffinity, Smp.CpuCount),
+          Smp.CpuCount,
+          __ThreadPtr__->CpuAffinity.Bits[0]);
 }
 
 void
@@ -716,7 +878,7 @@ DumpAllThreads(SysErr* __Err__)
               Current->Name,
               Current->State,
               Current->LastCpu);
-        Current = Current->Next;
+        Current = Current->ListNext;
         Count++;
     }
 
@@ -0,0 +1,688 @@
+#include <AxeSchd.h>
+#include <AxeThreads.h>
+#include <KHeap.h>
+#include <PerCPUData.h>
+#include <SMP.h>
+#include <String.h>
+#include <Sync.h>
+#include <Timer.h>
+#include <WorkQueue.h>
+
+WorkPool  WorkPools[MaxCPUs];
+WorkPool  UnboundPool;
+Workqueue SystemWq;
+Workqueue SystemUnboundWq;
+
+static Thread*  WorkManager = NULL;
+static SpinLock ManagerLock;
+static uint32_t ManagerKicks = 0;
+static int      WorkReady    = 0;
+
+/* Caller holds the pool lock. An idle worker to unblock once it is dropped, or asks the manager */
+static KWorker*
+__WantWorker__(WorkPool* __Pool__, int* __Manager__)
+{
+    *__Manager__ = 0;
+
+    if (!__Pool__->Head || __Pool__->Running + __Pool__->Waking >= __Pool__->Concurrency)
+    {
+        return NULL;
+    }
+
+    KWorker* Idle = __Pool__->IdleList;
+    if (Idle)
+    {
+        __Pool__->IdleList = Idle->IdleNext;
+        Idle->IdleNext     = NULL;
+        Idle->Waking       = 1;
+        __Pool__->Idle--;
+        __Pool__->Waking++;
+        return Idle;
+    }
+
+    /*One request in flight at a time, the worker it starts counts as Waking*/
+    if (!__Pool__->NeedWorker && __Pool__->Count < WorkPoolMaxWorkers)
+    {
+        __Pool__->NeedWorker = 1;
+        *__Manager__         = 1;
+    }
+    return NULL;
+}
+
+static void
+__KickManager__(void)
+{
+    SysErr  err;
+    SysErr* Error = &err;
+
+    AcquireSpinLock(&ManagerLock, Error);
+    ManagerKicks++;
+    ReleaseSpinLock(&ManagerLock, Error);
+
+    if (WorkManager)
+    {
+        ThreadUnblock(WorkManager, Error);
+    }
+}
+
+/* Acts on __WantWorker__, with no lock held */
+static void
+__Kick__(KWorker* __Idle__, int __Manager__)
+{
+    SysErr  err;
+    SysErr* Error = &err;
+
+    if (__Idle__)
+    {
+        ThreadUnblock(__Idle__->Thread, Error);
+    }
+    if (__Manager__)
+    {
+        __KickManager__();
+    }
+}
+
+/* Caller holds the pool lock, the detached flushers are unblocked after it is dropped */
+static Thread*
+__TakeFlushers__(WorkPool* __Pool__)
+{
+    Thread* Flushers   = __Pool__->Flushers;
+    __Pool__->Flushers = NULL;
+    return Flushers;
+}
+
+static void
+__WakeFlushers__(Thread* __Flushers__)
+{
+    SysErr  err;
+    SysErr* Error = &err;
+
+    while (__Flushers__)
+    {
+        /*Read the link first, once unblocked it may flush again and relink itself*/
+        Thread* Next           = __Flushers__->WaitNext;
+        __Flushers__->WaitNext = NULL;
+        ThreadUnblock(__Flushers__, Error);
+        __Flushers__ = Next;
+    }
+}
+
+/* Pending is already set and __Work__->Pool chosen, safe from tick context */
+static void
+__InsertWork__(WorkPool* __Pool__, Work* __Work__)
+{
+    SysErr  err;
+    SysErr* Error = &err;
+
+    AcquireSpinLock(&__Pool__->Lock, Error);
+
+    __Work__->Next     = NULL;
+    __Work__->QueuedAt = GetSystemNanos();
+    if (__Pool__->Tail)
+    {
+        __Pool__->Tail->Next = __Work__;
+    }
+    else
+    {
+        __Pool__->Head = __Work__;
+    }
+    __Pool__->Tail = __Work__;
+    __Pool__->Queued++;
+
+    int      Manager;
+    KWorker* Idle = __WantWorker__(__Pool__, &Manager);
+
+    ReleaseSpinLock(&__Pool__->Lock, Error);
+
+    __Kick__(Idle, Manager);
+}
+
+/* Retires the longest idle worker past WorkIdleKeep, runs in tick context */
+static void
+__IdleExpired__(void* __Arg__)
+{
+    SysErr  err;
+    SysErr* Error = &err;
+
+    WorkPool* Pool   = (WorkPool*)__Arg__;
+    KWorker*  Victim = NULL;
+    int       Rearm  = 0;
+
+    AcquireSpinLock(&Pool->Lock, Error);
+
+    Pool->IdleArmed = 0;
+    if (Pool->Idle > WorkIdleKeep)
+    {
+        /*Most recently idle sit at the head and are still warm, take the tail*/
+        KWorker** Link = &Pool->IdleList;
+        while ((*Link)->IdleNext)
+        {
+            Link = &(*Link)->IdleNext;
+        }
+        Victim         = *Link;
+        *Link          = NULL;
+        Victim->Retire = 1;
+        Pool->Idle--;
+
+        Rearm           = Pool->Idle > WorkIdleKeep;
+        Pool->IdleArmed = Rearm;
+    }
+
+    ReleaseSpinLock(&Pool->Lock, Error);
+
+    if (Victim)
+    {
+        ThreadUnblock(Victim->Thread, Error);
+    }
+    if (Rearm)
+    {
+        TimerArm(&Pool->IdleTimer, WorkIdleMs);
+    }
+}
+
+/* Unlinks the calling worker from its pool and exits, Retire was set by __IdleExpired__ */
+static void
+__RetireWorker__(KWorker* __Self__)
+{
+    SysErr  err;
+    SysErr* Error = &err;
+
+    WorkPool* Pool = __Self__->Pool;
+
+    AcquireSpinLock(&Pool->Lock, Error);
+
+    KWorker** Link = &Pool->Workers;
+    while (*Link && *Link != __Self__)
+    {
+        Link = &(*Link)->Next;
+    }
+    if (*Link)
+    {
+        *Link = __Self__->Next;
+    }
+    Pool->Count--;
+    Pool->Retired++;
+
+    ReleaseSpinLock(&Pool->Lock, Error);
+
+    Thread* Self = __Self__->Thread;
+    Self->Flags &= ~ThreadFlagWorker;
+    Self->Worker = NULL;
+    KFree(__Self__, Error);
+
+    ThreadExit(0, Error);
+}
+
+static void
+__WorkerLoop__(void* __Arg__)
+{
+    SysErr  err;
+    SysErr* Error = &err;
+
+    KWorker*  Self = (KWorker*)__Arg__;
+    WorkPool* Pool = Self->Pool;
+
+    for (;;)
+    {
+        AcquireSpinLock(&Pool->Lock, Error);
+
+        if (Self->Waking)
+        {
+            Self->Waking = 0;
+            Pool->Waking--;
+        }
+
+        if (Self->Retire)
+        {
+            ReleaseSpinLock(&Pool->Lock, Error);
+            __RetireWorker__(Self);
+        }
+
+        Work* Item = Pool->Head;
+        if (!Item || Pool->Running >= Pool->Concurrency)
+        {
+            /*Going idle past the keep count starts the retire clock, then look again*/
+            if (Pool->Idle + 1 > WorkIdleKeep && !Pool->IdleArmed)
+            {
+                Pool->IdleArmed = 1;
+                ReleaseSpinLock(&Pool->Lock, Error);
+                TimerArm(&Pool->IdleTimer, WorkIdleMs);
+                continue;
+            }
+
+            /*Work queued from here on pops us off the idle list and unblocks us*/
+            Self->IdleNext = Pool->IdleList;
+            Pool->IdleList = Self;
+            Pool->Idle++;
+            ThreadBlock(&Pool->Lock, WaitReasonWork, Pool, Error);
+            continue;
+        }
+
+        Pool->Head = Item->Next;
+        if (!Pool->Head)
+        {
+            Pool->Tail = NULL;
+        }
+        Item->Next = NULL;
+
+        /*Current before Pending drops, so FlushWork never sees the item as neither*/
+        __atomic_store_n(&Self->Current, Item, __ATOMIC_SEQ_CST);
+        __atomic_store_n(&Item->Pending, 0, __ATOMIC_SEQ_CST);
+        Pool->Running++;
+
+        uint64_t Latency = GetSystemNanos() - Item->QueuedAt;
+        Pool->LatencyNs += Latency;
+        if (Latency > Pool->LatencyMaxNs)
+        {
+            Pool->LatencyMaxNs = Latency;
+        }
+
+        /*Backlog left and room to run more of it at once, the unbound pool fans out here*/
+        int      Manager;
+        KWorker* Idle = __WantWorker__(Pool, &Manager);
+
+        ReleaseSpinLock(&Pool->Lock, Error);
+        __Kick__(Idle, Manager);
+
+        /*It may requeue or free itself, so Item is not touched after this*/
+        Item->Func(Item);
+
+        AcquireSpinLock(&Pool->Lock, Error);
+        __atomic_store_n(&Self->Current, NULL, __ATOMIC_SEQ_CST);
+        Pool->Running--;
+        Pool->Executed++;
+        Thread* Flushers = __TakeFlushers__(Pool);
+        ReleaseSpinLock(&Pool->Lock, Error);
+
+        __WakeFlushers__(Flushers);
+    }
+}
+
+/* Adds a worker to the pool and starts it, never called with a spinlock held */
+static int
+__StartWorker__(WorkPool* __Pool__, SysErr* __Err__)
+{
+    KWorker* Worker = (KWorker*)KMalloc(sizeof(KWorker));
+    Thread*  T      = NULL;
+
+    if (!Probe_IF_Error(Worker) && Worker)
+    {
+        T = CreateThread(ThreadTypeKernel, __WorkerLoop__, Worker, ThreadPriorityNormal);
+    }
+
+    AcquireSpinLock(&__Pool__->Lock, __Err__);
+    __Pool__->NeedWorker = 0;
+
+    if (Probe_IF_Error(T) || !T)
+    {
+        ReleaseSpinLock(&__Pool__->Lock, __Err__);
+        if (!Probe_IF_Error(Worker) && Worker)
+        {
+            KFree(Worker, __Err__);
+        }
+        SlotError(__Err__, -BadAlloc);
+        return -BadAlloc;
+    }
+
+    Worker->Thread    = T;
+    Worker->Pool      = __Pool__;
+    Worker->Current   = NULL;
+    Worker->Waking    = 1;
+    Worker->Retire    = 0;
+    Worker->IdleNext  = NULL;
+    Worker->Next      = __Pool__->Workers;
+    __Pool__->Workers = Worker;
+    __Pool__->Count++;
+    __Pool__->Waking++;
+    __Pool__->Created++;
+
+    ReleaseSpinLock(&__Pool__->Lock, __Err__);
+
+    T->Worker = Worker;
+    T->Flags |= ThreadFlagWorker | ThreadFlagSystem;
+
+    if (__Pool__->Cpu < MaxCPUs)
+    {
+        strcpy(T->Name, "Worker", sizeof(T->Name));
+        CpuMaskZero(&T->CpuAffinity);
+        CpuMaskSet(&T->CpuAffinity, __Pool__->Cpu);
+        T->Flags |= ThreadFlagPinned;
+        AddThreadToReadyQueue(__Pool__->Cpu, T, __Err__);
+    }
+    else
+    {
+        strcpy(T->Name, "UnboundWorker", sizeof(T->Name));
+        ThreadExecute(T, __Err__);
+    }
+
+    return SysOkay;
+}
+
+/* Starts workers for the pools that asked for one, parked while none has */
+static void
+__ManagerLoop__(void* __Arg__ _unused)
+{
+    SysErr  err;
+    SysErr* Error = &err;
+
+    for (;;)
+    {
+        AcquireSpinLock(&ManagerLock, Error);
+        if (!ManagerKicks)
+        {
+            /*A kick from here on finds us Blocked and unblocks us*/
+            ThreadBlock(&ManagerLock, WaitReasonWork, &ManagerKicks, Error);
+            continue;
+        }
+        ManagerKicks = 0;
+        ReleaseSpinLock(&ManagerLock, Error);
+
+        for (uint32_t CpuIndex = 0; CpuIndex <= Smp.CpuCount && CpuIndex <= MaxCPUs; CpuIndex++)
+        {
+            WorkPool* Pool = (CpuIndex < Smp.CpuCount) ? &WorkPools[CpuIndex] : &UnboundPool;
+            if (__atomic_load_n(&Pool->NeedWorker, __ATOMIC_SEQ_CST))
+            {
+                __StartWorker__(Pool, Error);
+            }
+        }
+    }
+}
+
+static void
+__InitPool__(WorkPool* __Pool__, uint32_t __CpuId__, uint32_t __Concurrency__, SysErr* __Err__)
+{
+    InitializeSpinLock(&__Pool__->Lock, "WorkPool", __Err__);
+    __Pool__->Head         = NULL;
+    __Pool__->Tail         = NULL;
+    __Pool__->Workers      = NULL;
+    __Pool__->IdleList     = NULL;
+    __Pool__->Flushers     = NULL;
+    __Pool__->Cpu          = __CpuId__;
+    __Pool__->Concurrency  = __Concurrency__;
+    __Pool__->Count        = 0;
+    __Pool__->Idle         = 0;
+    __Pool__->Running      = 0;
+    __Pool__->Waking       = 0;
+    __Pool__->NeedWorker   = 0;
+    __Pool__->IdleArmed    = 0;
+    __Pool__->Queued       = 0;
+    __Pool__->Executed     = 0;
+    __Pool__->Created      = 0;
+    __Pool__->Retired      = 0;
+    __Pool__->LatencyNs    = 0;
+    __Pool__->LatencyMaxNs = 0;
+    TimerInit(&__Pool__->IdleTimer, __IdleExpired__, __Pool__);
+}
+
+void
+InitializeWorkqueues(SysErr* __Err__)
+{
+    InitializeSpinLock(&ManagerLock, "WorkManager", __Err__);
+
+    for (uint32_t CpuIndex = 0; CpuIndex < Smp.CpuCount && CpuIndex < MaxCPUs; CpuIndex++)
+    {
+        __InitPool__(&WorkPools[CpuIndex], CpuIndex, 1, __Err__);
+    }
+    __InitPool__(&UnboundPool, MaxCPUs, Smp.CpuCount ? Smp.CpuCount : 1, __Err__);
+
+    Thread* Manager = CreateThread(ThreadTypeKernel, __ManagerLoop__, NULL, ThreadPriorityHigh);
+    if (Probe_IF_Error(Manager) || !Manager)
+    {
+        SlotError(__Err__, -BadAlloc);
+        return;
+    }
+
+    /*Starts parked, the first pool short of workers wakes it*/
+    strcpy(Manager->Name, "WorkManager", sizeof(Manager->Name));
+    Manager->Flags     |= ThreadFlagSystem;
+    Manager->State      = ThreadStateBlocked;
+    Manager->WaitReason = WaitReasonWork;
+    Manager->BlockState = BlockParked;
+    Manager->LastCpu    = 0;
+    WorkManager         = Manager;
+
+    /*One worker per pool up front, the rest come on demand*/
+    for (uint32_t CpuIndex = 0; CpuIndex < Smp.CpuCount && CpuIndex < MaxCPUs; CpuIndex++)
+    {
+        __StartWorker__(&WorkPools[CpuIndex], __Err__);
+    }
+    __StartWorker__(&UnboundPool, __Err__);
+
+    InitWorkqueue(&SystemWq, "System", WorkqueueBound);
+    InitWorkqueue(&SystemUnboundWq, "SystemUnbound", WorkqueueUnbound);
+    WorkReady = 1;
+
+    PSuccess("Workqueues up, %u bound pools and one unbound\n", Smp.CpuCount);
+}
+
+void
+InitWork(Work* __Work__, WorkFunc __Func__, void* __Arg__)
+{
+    __Work__->Func     = __Func__;
+    __Work__->Arg      = __Arg__;
+    __Work__->Next     = NULL;
+    __Work__->Pool     = NULL;
+    __Work__->Pending  = 0;
+    __Work__->QueuedAt = 0;
+}
+
+static void
+__DelayedFire__(void* __Arg__)
+{
+    DelayedWork* Delayed = (DelayedWork*)__Arg__;
+    __InsertWork__(Delayed->Work.Pool, &Delayed->Work);
+}
+
+void
+InitDelayedWork(DelayedWork* __Work__, WorkFunc __Func__, void* __Arg__)
+{
+    InitWork(&__Work__->Work, __Func__, __Arg__);
+    TimerInit(&__Work__->Timer, __DelayedFire__, __Work__);
+    __Work__->Cpu = 0;
+}
+
+void
+InitWorkqueue(Workqueue* __Queue__, const char* __Name__, uint32_t __Type__)
+{
+    __Queue__->Name   = __Name__;
+    __Queue__->Type   = __Type__;
+    __Queue__->Queued = 0;
+}
+
+/* Bound queues go to the CPU's pool, falling back to the unbound one for a CPU without workers */
+static WorkPool*
+__PoolFor__(Workqueue* __Queue__, uint32_t __CpuId__)
+{
+    if (__Queue__->Type == WorkqueueBound && __CpuId__ < Smp.CpuCount && __CpuId__ < MaxCPUs &&
+        WorkPools[__CpuId__].Count)
+    {
+        return &WorkPools[__CpuId__];
+    }
+    return &UnboundPool;
+}
+
+int
+QueueWorkOn(uint32_t __CpuId__, Workqueue* __Queue__, Work* __Work__)
+{
+    if (Probe_IF_Error(__Queue__) || !__Queue__ || Probe_IF_Error(__Work__) || !__Work__ ||
+        !__Work__->Func)
+    {
+        return -BadArgs;
+    }
+    if (!WorkReady)
+    {
+        return -NotInit;
+    }
+
+    /*Already waiting to run, it will see whatever the caller set up*/
+    if (__atomic_exchange_n(&__Work__->Pending, 1, __ATOMIC_SEQ_CST))
+    {
+        return 0;
+    }
+
+    WorkPool* Pool = __PoolFor__(__Queue__, __CpuId__);
+    __Work__->Pool = Pool;
+    __atomic_fetch_add(&__Queue__->Queued, 1, __ATOMIC_RELAXED);
+
+    __InsertWork__(Pool, __Work__);
+    return 1;
+}
+
+int
+QueueWork(Workqueue* __Queue__, Work* __Work__)
+{
+    return QueueWorkOn(GetCurrentCpuId(), __Queue__, __Work__);
+}
+
+int
+QueueDelayedWork(Workqueue* __Queue__, DelayedWork* __Work__, uint64_t __Milliseconds__)
+{
+    if (Probe_IF_Error(__Queue__) || !__Queue__ || Probe_IF_Error(__Work__) || !__Work__ ||
+        !__Work__->Work.Func)
+    {
+        return -BadArgs;
+    }
+    if (!WorkReady)
+    {
+        return -NotInit;
+    }
+
+    if (__atomic_exchange_n(&__Work__->Work.Pending, 1, __ATOMIC_SEQ_CST))
+    {
+        return 0;
+    }
+
+    /*Pool picked now, so a bound item runs on the CPU that queued it whatever the timer does*/
+    __Work__->Cpu       = GetCurrentCpuId();
+    __Work__->Work.Pool = __PoolFor__(__Queue__, __Work__->Cpu);
+    __atomic_fetch_add(&__Queue__->Queued, 1, __ATOMIC_RELAXED);
+
+    if (!__Milliseconds__)
+    {
+        __InsertWork__(__Work__->Work.Pool, &__Work__->Work);
+        return 1;
+    }
+
+    /*Ticks are milliseconds*/
+    TimerArmAt(&__Work__->Timer, __Work__->Cpu, GetSystemTicks() + __Milliseconds__);
+    return 1;
+}
+
+/* 1 if it was still waiting out its delay and never runs, 0 if it already reached its pool */
+int
+CancelDelayedWork(DelayedWork* __Work__)
+{
+    if (Probe_IF_Error(__Work__) || !__Work__)
+    {
+        return -BadArgs;
+    }
+
+    if (TimerCancel(&__Work__->Timer) != 1)
+    {
+        return 0;
+    }
+
+    SysErr  err;
+    SysErr* Error = &err;
+
+    WorkPool* Pool = __Work__->Work.Pool;
+    AcquireSpinLock(&Pool->Lock, Error);
+    __atomic_store_n(&__Work__->Work.Pending, 0, __ATOMIC_SEQ_CST);
+    Thread* Flushers = __TakeFlushers__(Pool);
+    ReleaseSpinLock(&Pool->Lock, Error);
+
+    __WakeFlushers__(Flushers);
+    return 1;
+}
+
+/* Caller holds the pool lock */
+static int
+__WorkBusy__(WorkPool* __Pool__, Work* __Work__)
+{
+    if (__atomic_load_n(&__Work__->Pending, __ATOMIC_SEQ_CST))
+    {
+        return 1;
+    }
+
+    for (KWorker* Worker = __Pool__->Workers; Worker; Worker = Worker->Next)
+    {
+        if (Worker->Current == __Work__)
+        {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+/* Waits until the last queueing of __Work__ has run, including any delay it still has */
+void
+FlushWork(Work* __Work__)
+{
+    if (Probe_IF_Error(__Work__) || !__Work__ || !__Work__->Pool)
+    {
+        return;
+    }
+
+    SysErr  err;
+    SysErr* Error = &err;
+
+    WorkPool* Pool = __Work__->Pool;
+
+    for (;;)
+    {
+        AcquireSpinLock(&Pool->Lock, Error);
+        if (!__WorkBusy__(Pool, __Work__))
+        {
+            ReleaseSpinLock(&Pool->Lock, Error);
+            return;
+        }
+
+        /*Every item finishing on the pool wakes the flushers, each looks again*/
+        Thread* Current   = ThisThread();
+        Current->WaitNext = Pool->Flushers;
+        Pool->Flushers    = Current;
+        ThreadBlock(&Pool->Lock, WaitReasonWork, __Work__, Error);
+    }
+}
+
+void
+WorkerSleeping(Thread* __ThreadPtr__)
+{
+    KWorker* Self = __ThreadPtr__->Worker;
+
+    /*Parking on the idle list or retiring, not blocking inside an item*/
+    if (!Self || !Self->Current)
+    {
+        return;
+    }
+
+    SysErr  err;
+    SysErr* Error = &err;
+
+    WorkPool* Pool = Self->Pool;
+    AcquireSpinLock(&Pool->Lock, Error);
+
+    Pool->Running--;
+    int      Manager;
+    KWorker* Idle = __WantWorker__(Pool, &Manager);
+
+    ReleaseSpinLock(&Pool->Lock, Error);
+    __Kick__(Idle, Manager);
+}
+
+void
+WorkerWaking(Thread* __ThreadPtr__)
+{
+    KWorker* Self = __ThreadPtr__->Worker;
+    if (!Self || !Self->Current)
+    {
+        return;
+    }
+
+    SysErr  err;
+    SysErr* Error = &err;
+
+    AcquireSpinLock(&Self->Pool->Lock, Error);
+    Self->Pool->Running++;
+    ReleaseSpinLock(&Self->Pool->Lock, Error);
+}
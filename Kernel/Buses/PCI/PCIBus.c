@@ -273,6 +273,24 @@ PciGetBarType(PciDevice* __Device__, uint8_t __BarIndex__)
     return (uint32_t)__Device__->BarTypes[__BarIndex__];
 }
 
+/* Registers want VmmCacheUC, prefetchable apertures (framebuffers, rings) VmmCacheWC */
+void*
+PciMapBar(PciDevice* __Device__, uint8_t __BarIndex__, VmmCacheType __Type__)
+{
+    if (Probe_IF_Error(__Device__) || !__Device__ || __BarIndex__ >= 6)
+    {
+        return Error_TO_Pointer(-BadArgs);
+    }
+
+    PciBarType Type = __Device__->BarTypes[__BarIndex__];
+    if ((Type != PciBarTypeMem32 && Type != PciBarTypeMem64) || !__Device__->BarSizes[__BarIndex__])
+    {
+        return Error_TO_Pointer(-BadEntity);
+    }
+
+    return IoRemap(__Device__->Bars[__BarIndex__], __Device__->BarSizes[__BarIndex__], __Type__);
+}
+
 uint32_t
 PciMakeAddress(uint8_t __Bus__, uint8_t __Device__, uint8_t __Function__, uint8_t __Offset__)
 {
@@ -72,6 +72,13 @@ KernelWorkerThread(void* __Argument__)
         InitComplete = true;
     }
 
+    /*Shmfs*/
+    if (ShmFsInit() != SysOkay)
+    {
+        InitComplete = false;
+        PError("shmfs init failed\n");
+    }
+
     if (InitComplete == true)
     {
         PSuccess("[Early kernel init complete]\n");
@@ -102,6 +109,25 @@ KernelWorkerThread(void* __Argument__)
     /*Testing*/
     //__TEST__Proc();
     __TEST__DriverManager(); /*Test NEW driver manager*/
+    //__TEST__IoRemap(); /*Console redraw and MMIO timings per memory type*/
+    //__TEST__SchedQueues(); /*Run queue pick latency from 10 to 10k runnable threads*/
+    //__TEST__SchedBalance(); /*Busy threads spawned on CPU 0, with and without stealing*/
+    //__TEST__TicklessIdle(); /*Timer interrupts per CPU while the machine sits idle*/
+    //__TEST__TimerWheel(); /*Tick cost with 10k armed timers against a sleeper list walk*/
+    //__TEST__MutexContention(); /*8 threads on VfsLock, spinning against sleeping waiters*/
+    //__TEST__PerCpu(); /*Cpu id, spinlock and gettid cost, legacy LAPIC lookup against gs*/
+    //__TEST__FpuSwitch(); /*Yield cost for int and SSE threads, eager against lazy FPU*/
+    //__TEST__SwitchPingPong(); /*Yield, pipe and semaphore ping-pong, SwitchTo against int 0x20*/
+    //__TEST__SchedFair(); /*Hog share spread and sleeper wakeup lateness, priority against fair*/
+    //__TEST__SchedRt(); /*RT sleeper wakeup lateness under saturating load, RT throttling*/
+    //__TEST__CpuTopology(); /*Spinner placement against SMT, core and package boundaries*/
+    //__TEST__SchedStat(); /*Per-thread run delay and switch counts, /proc/schedstat and schedlat*/
+    //__TEST__ZombieStorm(); /*Worst tick cost of a 10k thread exit storm, tick against reaper*/
+    //__TEST__KStacks(); /*Thread create/destroy rate, heap stacks against cached guarded ones*/
+    //__TEST__KStackOverflow(); /*Runs a thread off its stack, halts on the overflow report*/
+    //__TEST__PidLookup(); /*getpid and kill with 10k live processes, table scan against hash*/
+    //__TEST__WorkQueue(); /*Workqueue latency and throughput, pool growth under blocking items*/
+    //__TEST__IpiPingPong(); /*Cross-CPU semaphore ping-pong, tick wakeups against IPIs*/
 
     if (InitComplete == true)
     {
@@ -159,6 +185,9 @@ _start(void)
     SysErr  err;
     SysErr* Error = &err;
 
+    /*Per-CPU data through GS, every spinlock reads the CPU id from it*/
+    InitializePerCpuData(0, Error);
+
     if (EarlyLimineFrambuffer.response && EarlyLimineFrambuffer.response->framebuffer_count > 0)
     {
         struct limine_framebuffer* FrameBuffer = EarlyLimineFrambuffer.response->framebuffers[0];
@@ -189,6 +218,7 @@ _start(void)
 
         /*CPU/IDT/GDT/ISR/IRQ/TSS*/
         InitializeGdt(Error);
+        InitializePerCpuData(0, Error); /*The GS reload cleared its base*/
         InitializeIdt(Error);
 
         /*FPU,SSE,Floats*/
@@ -198,14 +228,34 @@ _start(void)
         Cr0 &= ~(1UL << 2); /* EM = 0 */
         Cr0 |= (1UL << 1);  /* MP = 1 */
         Cr0 &= ~(1UL << 3); /* TS = 0 */
+        Cr0 |= (1UL << 16); /* WP = 1, kernel writes to COW pages must fault */
         __asm__ volatile("mov %0, %%cr0" ::"r"(Cr0) : "memory");
         Cr4 |= (1UL << 9) | (1UL << 10);
         __asm__ volatile("mov %0, %%cr4" ::"r"(Cr4) : "memory");
         __asm__ volatile("fninit");
+        InitializeFpu(Error);
+
+        /*Memory types*/
+        InitializePat(Error);
 
         /*Memory managers*/
         InitializePmm(Error);
         InitializeVmm(Error);
+        InitializeIoRemap(Error);
+        InitializeKernelStacks(Error);
+        SetFaultStack(&Tss, IdtEntries, Error);
+
+        /*Glyph stores are write only, let them combine instead of going out one by one*/
+        if (FrameBuffer->address)
+        {
+            uint32_t* FrameBufferWC = (uint32_t*)IoRemap(VirtToPhys(FrameBuffer->address),
+                                                         FrameBuffer->pitch * FrameBuffer->height,
+                                                         VmmCacheWC);
+            if (!Probe_IF_Error(FrameBufferWC) && FrameBufferWC)
+            {
+                Console.FrameBuffer = FrameBufferWC;
+            }
+        }
         InitializeKHeap(Error);
 
         /*Timer*/
@@ -217,8 +267,11 @@ _start(void)
 
         /*Threading/SMP*/
         InitializeSmp(Error);
+        InitializeIpi(Error);
         InitializeThreadManager(Error);
         InitializeScheduler(Error);
+        InitializeSpaceReapers(Error);
+        InitializeWorkqueues(Error);
 
         /*Kernel worker*/
         Thread* KernelWorker =
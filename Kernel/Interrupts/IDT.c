@@ -1,5 +1,8 @@
 #include <Errnos.h>
 #include <IDT.h>
+#include <Ipi.h>
+#include <PerCPUData.h>
+#include <VMM.h>
 
 IdtEntry IdtEntries[256];
 
@@ -39,6 +42,22 @@ SetIdtEntry(
     IdtEntries[__Index__].Reserved   = 0;
 }
 
+/* Gives #DF a guarded kernel stack through Ist1 of this TSS, left on the current stack if none */
+void
+SetFaultStack(TaskStateSegment* __Tss__, IdtEntry* __Idt__, SysErr* __Err__)
+{
+    void* Stack = AllocKernelStack();
+    if (Probe_IF_Error(Stack) || !Stack)
+    {
+        __Idt__[IdtDoubleFault].Ist = 0;
+        SlotError(__Err__, -BadAlloc);
+        return;
+    }
+
+    __Tss__->Ist1               = (uint64_t)Stack + KStackSize;
+    __Idt__[IdtDoubleFault].Ist = IdtFaultIst;
+}
+
 void
 InitializePic(SysErr* __Err__)
 {
@@ -186,6 +205,12 @@ InitializeIdt(SysErr* __Err__)
                     __Err__);
     }
 
+    /*Local APIC IPIs, APs copy these along with the rest of the table*/
+    SetIdtEntry(
+        IpiVectorResched, (uint64_t)IrqResched, KernelCodeSelector, IdtTypeInterruptGate, __Err__);
+    SetIdtEntry(
+        IpiVectorCall, (uint64_t)IrqCall, KernelCodeSelector, IdtTypeInterruptGate, __Err__);
+
     /*Initialize legacy PIC for compatibility (though we use APIC)*/
     InitializePic(__Err__);
 
@@ -306,7 +331,15 @@ IRQ_STUB(13, 45)
 IRQ_STUB(14, 46)
 IRQ_STUB(15, 47)
 
+/*IPI stubs, vectors from Ipi.h*/
+IRQ_STUB(Resched, 240)
+IRQ_STUB(Call, 241)
+
 __asm__("IsrCommonStub:\n\t"
+        "testb $3, 24(%rsp)\n\t" /*From ring 3, switch to the kernel GS base*/
+        "jz 1f\n\t"
+        "swapgs\n\t"
+        "1:\n\t"
         "pushq %rax\n\t" /*Save general-purpose registers*/
         "pushq %rbx\n\t"
         "pushq %rcx\n\t"
@@ -340,10 +373,22 @@ __asm__("IsrCommonStub:\n\t"
         "popq %rbx\n\t"
         "popq %rax\n\t"
         "addq $16, %rsp\n\t" /*Remove error code and vector number from stack*/
-        "iretq\n\t"          /*Return from interrupt*/
+        "testb $3, 8(%rsp)\n\t" /*Back to ring 3, restore the user GS base*/
+        "jz 2f\n\t"
+        "swapgs\n\t"
+        "2:\n\t"
+        "iretq\n\t" /*Return from interrupt*/
 );
 
+/*Offsets used by IrqCommonStub, gs points at this CPU's PerCpuData*/
+_Static_assert(__builtin_offsetof(PerCpuData, LeavingOnCpu) == 4352, "PerCpuData layout");
+_Static_assert(__builtin_offsetof(PerCpuData, ExitStack) == 4360, "PerCpuData layout");
+
 __asm__("IrqCommonStub:\n\t"
+        "testb $3, 24(%rsp)\n\t" /*From ring 3, switch to the kernel GS base*/
+        "jz 1f\n\t"
+        "swapgs\n\t"
+        "1:\n\t"
         "pushq %rax\n\t" /*Save general-purpose registers*/
         "pushq %rbx\n\t"
         "pushq %rcx\n\t"
@@ -377,5 +422,36 @@ __asm__("IrqCommonStub:\n\t"
         "popq %rbx\n\t"
         "popq %rax\n\t"
         "addq $16, %rsp\n\t" /*Remove dummy error code and vector number*/
-        "iretq\n\t"          /*Return from interrupt*/
+        "cmpq $0, %gs:4352\n\t" /*Left a preempted thread, OnCpu waits for us to be off its stack*/
+        "jz 3f\n\t"
+        "pushq %rax\n\t"
+        "pushq %rbx\n\t"
+        "movq %gs:0, %rbx\n\t"
+        "leaq 4360+256-56(%rbx), %rbx\n\t" /*RBX, RAX and the iretq frame, top of ExitStack*/
+        "movq 0(%rsp), %rax\n\t"
+        "movq %rax, 0(%rbx)\n\t"
+        "movq 8(%rsp), %rax\n\t"
+        "movq %rax, 8(%rbx)\n\t"
+        "movq 16(%rsp), %rax\n\t"
+        "movq %rax, 16(%rbx)\n\t"
+        "movq 24(%rsp), %rax\n\t"
+        "movq %rax, 24(%rbx)\n\t"
+        "movq 32(%rsp), %rax\n\t"
+        "movq %rax, 32(%rbx)\n\t"
+        "movq 40(%rsp), %rax\n\t"
+        "movq %rax, 40(%rbx)\n\t"
+        "movq 48(%rsp), %rax\n\t"
+        "movq %rax, 48(%rbx)\n\t"
+        "movq %rbx, %rsp\n\t"
+        "movq %gs:4352, %rax\n\t"
+        "movq $0, %gs:4352\n\t"
+        "movl $0, (%rax)\n\t" /*Off the old stack, it may be resumed anywhere now*/
+        "popq %rbx\n\t"
+        "popq %rax\n\t"
+        "3:\n\t"
+        "testb $3, 8(%rsp)\n\t" /*Back to ring 3, restore the user GS base*/
+        "jz 2f\n\t"
+        "swapgs\n\t"
+        "2:\n\t"
+        "iretq\n\t" /*Return from interrupt*/
 );
@@ -1,4 +1,6 @@
+#include <AxeSchd.h>
 #include <IDT.h>
+#include <Ipi.h>
 #include <Timer.h>
 
 void
@@ -13,6 +15,22 @@ IrqHandler(InterruptFrame* __Frame__)
         return; /*APIC will send EOI*/
     }
 
+    if (__Frame__->IntNo == IpiVectorResched)
+    {
+        SysErr  err;
+        SysErr* Error = &err;
+        ScheduleIpi(GetCurrentCpuId(), __Frame__, Error);
+        IpiEoi();
+        return;
+    }
+
+    if (__Frame__->IntNo == IpiVectorCall)
+    {
+        IpiCallHandler();
+        IpiEoi();
+        return;
+    }
+
     /*Legacy PIC interrupts > Handle EOI*/
     /*If interrupt came from slave PIC (vectors 40-47), EOI to slave first*/
     if (__Frame__->IntNo >= 40)
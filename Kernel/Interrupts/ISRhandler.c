@@ -1,14 +1,45 @@
+#include <AxeThreads.h>
 #include <Errnos.h>
+#include <Fpu.h>
 #include <GDT.h>
 #include <IDT.h>
+#include <Ipi.h>
 #include <PerCPUData.h>
 #include <SMP.h>
 #include <SymAP.h>
+#include <VMM.h>
 
 void
 IsrHandler(InterruptFrame* __Frame__)
 {
-    /*TODO: Send IPI of panic to all the APs*/
+    /*Another CPU is reporting a fatal exception, stay out of its way*/
+    if (__Frame__->IntNo == 2 && IpiStopping)
+    {
+        for (;;)
+        {
+            __asm__ volatile("cli; hlt");
+        }
+    }
+
+    /* Page faults the VMM can resolve (COW, ...) return straight to the faulting code */
+    if (__Frame__->IntNo == 14)
+    {
+        uint64_t FaultAddr;
+        __asm__ volatile("movq %%cr2, %0" : "=r"(FaultAddr));
+        if (HandlePageFault(FaultAddr, __Frame__->ErrCode) == SysOkay)
+        {
+            return;
+        }
+    }
+
+    /* Device not available, CR0.TS was left set for a lazy FPU load */
+    if (__Frame__->IntNo == 7 && FpuTrap() == SysOkay)
+    {
+        return;
+    }
+
+    /*Halt the other CPUs before the dump, as an NMI it gets through with interrupts off*/
+    IpiStopOthers();
 
     __asm__ volatile("cli");
 
@@ -17,6 +48,11 @@ IsrHandler(InterruptFrame* __Frame__)
 
     uint32_t CurrentCpu = GetCurrentCpuId();
 
+    /*A guard page hit pushing the #PF frame becomes #DF, CR2 still names the guard*/
+    uint64_t Cr2;
+    __asm__ volatile("movq %%cr2, %0" : "=r"(Cr2));
+    int Overflow = (__Frame__->IntNo == 8 || __Frame__->IntNo == 14) && KernelStackGuard(Cr2);
+
     KrnPrintf("\n");
     PError("EXCEPTION: %s (Vector: %lu) on CPU %u\n",
            ExceptionNames[__Frame__->IntNo],
@@ -24,6 +60,21 @@ IsrHandler(InterruptFrame* __Frame__)
            CurrentCpu);
     KrnPrintf("Error Code: 0x%016lx\n", __Frame__->ErrCode);
 
+    if (Overflow)
+    {
+        Thread* Current = GetCurrentThread(CurrentCpu);
+        VmmKStack.GuardHits++;
+        PError("KERNEL STACK OVERFLOW: guard page at 0x%016lx\n", Cr2 & ~(uint64_t)(PageSize - 1));
+        if (Current)
+        {
+            KrnPrintf("  Thread %u (%s), stack 0x%016lx - 0x%016lx\n",
+                      Current->ThreadId,
+                      Current->Name,
+                      Current->KernelStack - Current->StackSize,
+                      Current->KernelStack);
+        }
+    }
+
     KrnPrintf("\n");
 
     KrnPrintf("\nCPU STATE:\n");
@@ -83,8 +134,12 @@ IsrHandler(InterruptFrame* __Frame__)
 
     DumpControlRegisters(Error);
     DumpInstruction(__Frame__->Rip, Error);
-    KrnPrintf("\nSTACK DUMP (64 bytes from RSP):\n");
-    DumpMemory(__Frame__->Rsp, 64, Error);
+    /*RSP is on the guard page, reading it would only fault again*/
+    if (!Overflow)
+    {
+        KrnPrintf("\nSTACK DUMP (64 bytes from RSP):\n");
+        DumpMemory(__Frame__->Rsp, 64, Error);
+    }
 
     KrnPrintf("\nSTACK TRACE:\n");
     uint64_t* rbp = (uint64_t*)__Frame__->Rbp;
@@ -9,8 +9,10 @@
 #include <DevFS.h>
 #include <DrvMgr.h>
 #include <EarlyBootFB.h>
+#include <Fpu.h>
 #include <GDT.h>
 #include <IDT.h>
+#include <Ipi.h>
 #include <KExports.h>
 #include <KHeap.h>
 #include <KrnPrintf.h>
@@ -25,12 +27,15 @@
 #include <POSIXSignals.h>
 #include <SMP.h>
 #include <Serial.h>
+#include <ShmFs.h>
 #include <SymAP.h>
 #include <Sync.h>
+#include <SysABI.h>
 #include <Syscall.h>
 #include <Timer.h>
 #include <VFS.h>
 #include <VMM.h>
+#include <WorkQueue.h>
 
 /*for sensitive testing*/
 extern SpinLock TestLock;
@@ -40,4 +45,23 @@ extern bool InitComplete;
 
 /*TEST handles*/
 void __TEST__Proc(void);
-void __TEST__DriverManager(void);
\ No newline at end of file
+void __TEST__DriverManager(void);
+void __TEST__IoRemap(void);
+void __TEST__SchedQueues(void);
+void __TEST__SchedBalance(void);
+void __TEST__TicklessIdle(void);
+void __TEST__TimerWheel(void);
+void __TEST__MutexContention(void);
+void __TEST__PerCpu(void);
+void __TEST__FpuSwitch(void);
+void __TEST__SwitchPingPong(void);
+void __TEST__SchedFair(void);
+void __TEST__SchedRt(void);
+void __TEST__CpuTopology(void);
+void __TEST__SchedStat(void);
+void __TEST__ZombieStorm(void);
+void __TEST__KStacks(void);
+void __TEST__KStackOverflow(void);
+void __TEST__PidLookup(void);
+void __TEST__WorkQueue(void);
+void __TEST__IpiPingPong(void);
\ No newline at end of file
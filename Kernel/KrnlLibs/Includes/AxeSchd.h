@@ -5,35 +5,134 @@
 #include <IDT.h>
 #include <Sync.h>
 
+#define SchedPriorities 7 /*ThreadPriorityIdle .. ThreadPrioritykernel*/
+
+/*Balancing*/
+#define SchedMigrateCost  2  /*Ticks since a thread last started during which its cache is hot*/
+#define SchedHotBacklog   4  /*Queue length at which a hot thread is worth moving anyway*/
+#define SchedStealScan    16 /*Candidates looked at per steal, keeps the victim lock short*/
+#define SchedBalanceTicks 64 /*Ticks between push balancing passes, run by CPU 0*/
+
+/*
+    Fair class. Runtime is charged as Vruntime, scaled by the thread's weight,
+    and the smallest Vruntime runs next. A latency period is split among the
+    runnable threads by weight, so slices shrink as the queue grows, down to
+    one tick. Waking threads are placed just behind MinVruntime, so a sleeper
+    is served promptly but cannot bank credit.
+*/
+#define SchedLatencyNs    12000000ULL /*Every runnable thread gets a turn within this*/
+#define SchedMinSliceNs   1000000ULL  /*Slice floor, one tick*/
+#define SchedWakeupGranNs 1000000ULL  /*Vruntime lead a woken thread needs to preempt*/
+#define SchedNiceWeight   1024        /*Weight of ThreadPriorityNormal*/
+
+/*
+    Real-time classes. Fifo and Rr threads sit in per-priority FIFOs ahead of
+    the fair class and keep the CPU until they block, yield or something of
+    higher RtPriority is queued, Rr also rotates among equals every slice.
+    Together they may use SchedRtRuntimeNs of every SchedRtPeriodNs on a CPU,
+    past that they are throttled until the period ends.
+*/
+#define SchedRtLevels    (ThreadRtPriorityMax + 1)
+#define SchedRrSliceNs   100000000ULL  /*Rr turn before going behind its equals*/
+#define SchedRtPeriodNs  1000000000ULL /*Throttle accounting window*/
+#define SchedRtRuntimeNs 950000000ULL  /*RT share of each window, the rest is kept for others*/
+
+/*
+    Exited threads are freed by a reaper thread on each CPU, parked until its
+    zombie queue goes non-empty, so an exit storm costs the tick nothing.
+*/
+#define SchedReapBatch 32 /*Zombies freed per pass, the reaper yields in between*/
+
+/*
+    Statistics. Plain adds on paths the switch already takes, each counter is
+    only written by its own CPU or under its SchedulerLock, and readers take
+    them unlocked, so nothing is paid unless /proc/schedstat is read.
+*/
+#define SchedLatBuckets 16 /*WakeLat, woken to running: bucket N counts [2^N, 2^(N+1)) us*/
+
+/*Per-priority FIFOs, bit N of Bitmap is set while Head[N] is non empty*/
+typedef struct
+{
+    Thread*  Head[SchedPriorities];
+    Thread*  Tail[SchedPriorities];
+    uint32_t Bitmap;
+
+} ReadyArray;
+
+/*Per-RtPriority FIFOs, bit N of Bitmap is set while Head[N] is non empty*/
+typedef struct
+{
+    Thread*  Head[SchedRtLevels];
+    Thread*  Tail[SchedRtLevels];
+    uint64_t Bitmap[2];
+
+} RtQueue;
+
 typedef struct
 {
-    Thread*  ReadyQueue;      /*Ready queue*/
-    Thread*  WaitingQueue;    /*Blocked threads*/
-    Thread*  ZombieQueue;     /*Terminated threads*/
-    Thread*  SleepingQueue;   /*Sleeping threads*/
-    Thread*  CurrentThread;   /*Currently running thread*/
-    Thread*  NextThread;      /*Next thread to run*/
-    Thread*  IdleThread;      /*Idle thread for this CPU*/
-    uint32_t ThreadCount;     /*Total threads on this CPU*/
-    uint32_t ReadyCount;      /*Ready threads count*/
-    uint32_t Priority;        /*Current priority level*/
-    uint64_t LastSchedule;    /*Last schedule time*/
-    uint64_t ScheduleTicks;   /*Schedule counter*/
-    SpinLock SchedulerLock;   /*Protect scheduler state*/
-    uint64_t ContextSwitches; /*Context switch count*/
-    uint64_t IdleTicks;       /*Time spent idle*/
-    uint32_t LoadAverage;     /*Load average*/
+    ReadyArray  ReadyArrays[2];  /*Backing store for Active and Expired*/
+    ReadyArray* Active;          /*Picked from, highest priority first*/
+    ReadyArray* Expired;         /*Used up their quanta, swapped in once Active drains*/
+    Thread*     WaitingQueue;    /*Blocked threads*/
+    Thread*     ZombieQueue;     /*Terminated threads*/
+    Thread*     CurrentThread;   /*Currently running thread*/
+    Thread*     NextThread;      /*Next thread to run*/
+    Thread*     IdleThread;      /*Idle thread for this CPU*/
+    uint32_t    ThreadCount;     /*Total threads on this CPU*/
+    uint32_t    ReadyCount;      /*Ready threads count*/
+    uint32_t    Priority;        /*Current priority level*/
+    uint64_t    LastSchedule;    /*Last schedule time*/
+    uint64_t    ScheduleTicks;   /*Schedule counter*/
+    SpinLock    SchedulerLock;   /*Protect scheduler state*/
+    uint64_t    ContextSwitches; /*Context switch count*/
+    uint64_t    IdleTicks;       /*Time spent idle*/
+    uint32_t    LoadAverage;     /*Load average*/
+    uint64_t    Steals;          /*Threads pulled here from other CPUs*/
+    uint64_t    Voluntary;       /*Switches through ScheduleSwitch, not an interrupt*/
+    RbTree      FairTree;        /*Ready threads by Vruntime, while SchedFair*/
+    uint64_t    FairWeight;      /*Sum of the weights in FairTree*/
+    uint64_t    MinVruntime;     /*Never goes back, new and woken threads are placed from it*/
+    RtQueue     Rt;              /*Fifo and Rr threads, picked before anything else*/
+    uint64_t    RtRuntime;       /*RT nanoseconds run in the current period*/
+    uint64_t    RtPeriodStart;   /*GetSystemNanos when the period began*/
+    uint32_t    RtThrottled;     /*Budget spent, RT waits for the next period*/
+    uint64_t    RtThrottles;     /*Periods that hit the budget*/
+    uint64_t    Yields;          /*Switches away from a thread that stayed Ready*/
+    uint64_t    IdlePicks;       /*Switches to the idle thread*/
+    uint64_t    Wakeups;         /*Woken threads queued here*/
+    uint64_t    WakeupsLocal;    /*Of those, woken by this CPU*/
+    uint64_t    Migrations;      /*Threads queued or stolen here that last ran elsewhere*/
+    uint64_t    RunNs;           /*Nanoseconds charged to threads here, idle excluded*/
+    uint64_t    RunDelayNs;      /*Nanoseconds picked threads spent queued*/
+    uint64_t    QueueSum;        /*ReadyCount integrated over ticks*/
+    uint64_t    QueueTicks;      /*Ticks QueueSum covers*/
+    uint32_t    QueueMax;        /*Longest ready queue seen*/
+    uint64_t    WakeLat[SchedLatBuckets];
+    uint64_t    TickMaxNs;       /*Longest timer Schedule(), stats readers may reset it*/
+    Thread*     Reaper;          /*Frees ZombieQueue, parked while it is empty*/
+    uint64_t    Reaped;          /*Zombies freed*/
+    uint32_t    ReschedPending;  /*Reschedule IPI sent, cleared by the next Schedule here*/
+    uint64_t    ReschedIpis;     /*Reschedule IPIs sent to this CPU*/
 
 } CpuScheduler;
 
 extern CpuScheduler CpuSchedulers[MaxCPUs];
+extern int          SchedIdleSteal;
+extern int          SchedFair; /*0 picks by priority arrays and quanta, as before*/
+extern int          SchedReapDeferred; /*0 frees SchedReapBatch zombies per tick instead*/
+extern int          SchedWakeIpi; /*0 leaves wakeups to the target's next tick, no IPI*/
 
 void    InitializeScheduler(SysErr* __Err__);
 void    InitializeCpuScheduler(uint32_t __CpuId__, SysErr* __Err__);
 void    Schedule(uint32_t __CpuId__, InterruptFrame* __Frame__, SysErr* __Err__);
+void    ScheduleIpi(uint32_t __CpuId__, InterruptFrame* __Frame__, SysErr* __Err__);
+void    ScheduleSwitch(SysErr* __Err__);
+void    SwitchTo(Thread* __Prev__, Thread* __Next__);
+void    SwitchResume(void); /*Pops a SwitchTo frame, entered from an interrupt return*/
 Thread* GetNextThread(uint32_t __CpuId__);
 void    AddThreadToReadyQueue(uint32_t __CpuId__, Thread* __ThreadPtr__, SysErr* __Err__);
 Thread* RemoveThreadFromReadyQueue(uint32_t __CpuId__);
+Thread* StealReadyThread(uint32_t __CpuId__, uint32_t __VictimCpu__);
 void    AddThreadToWaitingQueue(uint32_t __CpuId__, Thread* __ThreadPtr__, SysErr* __Err__);
 void    AddThreadToZombieQueue(uint32_t __CpuId__, Thread* __ThreadPtr__, SysErr* __Err__);
 void    AddThreadToSleepingQueue(uint32_t __CpuId__, Thread* __ThreadPtr__, SysErr* __Err__);
@@ -41,8 +140,12 @@ void SaveInterruptFrameToThread(Thread* __ThreadPtr__, InterruptFrame* __Frame__
 void LoadThreadContextToInterruptFrame(Thread*         __ThreadPtr__,
                                        InterruptFrame* __Frame__,
                                        SysErr*         __Err__);
+void LoadSwitchFrameToInterruptFrame(Thread*         __ThreadPtr__,
+                                     InterruptFrame* __Frame__,
+                                     SysErr*         __Err__);
 uint32_t GetCpuThreadCount(uint32_t __CpuId__);
 uint32_t GetCpuReadyCount(uint32_t __CpuId__);
+uint32_t GetCpuRunnable(uint32_t __CpuId__);
 uint64_t GetCpuContextSwitches(uint32_t __CpuId__);
 uint32_t GetCpuLoadAverage(uint32_t __CpuId__);
 void     WakeupSleepingThreads(uint32_t __CpuId__, SysErr* __Err__);
@@ -2,8 +2,11 @@
 
 #include <AllTypes.h>
 #include <Errnos.h>
+#include <PerCPUData.h>
+#include <RbTree.h>
 #include <SMP.h>
 #include <Sync.h>
+#include <TimerWheel.h>
 #include <VMM.h>
 
 typedef enum
@@ -52,17 +55,19 @@ typedef struct
     uint64_t Rflags;
     uint16_t Cs, Ss, Ds, Es, Fs, Gs;
 
-    /*FPU/SSE*/
-    uint8_t FpuState[512] __attribute__((aligned(16)));
-
 } ThreadContext;
 
+struct PosixProc;
+struct KWorker;
+
 typedef struct Thread
 {
     /*Core ID*/
-    uint32_t ThreadId;
-    uint32_t ProcessId; /*Parent*/
-    char     Name[64];
+    uint32_t          ThreadId;
+    uint32_t          ProcessId; /*Parent*/
+    struct PosixProc* Proc;      /*Same process, saves the PID lookup, NULL for kernel threads*/
+    struct KWorker*   Worker;    /*Workqueue worker it runs as, while ThreadFlagWorker*/
+    char              Name[64];
 
     /*State mgr*/
     ThreadState    State;
@@ -72,6 +77,9 @@ typedef struct Thread
 
     /*CPU snap*/
     ThreadContext Context;
+    uint8_t*      FpuState; /*Fpu.Size bytes, loaded lazily, see Fpu.h*/
+    void*         FpuArea;  /*Allocation FpuState is aligned within*/
+    uint32_t      FpuCpu;   /*CPU whose registers it was last loaded into*/
     uint64_t      KernelStack;
     uint64_t      UserStack;
     uint32_t      StackSize;
@@ -82,22 +90,36 @@ typedef struct Thread
     uint32_t MemoryUsage;
 
     /*Scheduling*/
-    uint32_t CpuAffinity;
+    CpuMask  CpuAffinity; /*CPUs it may run on, every bit set by default*/
     uint32_t LastCpu;
-    uint64_t TimeSlice;
+    uint64_t TimeSlice; /*Nanoseconds, set on every fair pick from the latency target*/
     uint64_t CpuTime;
     uint64_t StartTime;
     uint64_t WakeupTime;
+    uint32_t Quanta;     /*Picks left this round, refilled from Priority*/
+    KTimer   SleepTimer; /*Armed on the CPU wheel while Sleeping*/
+    uint64_t SwitchRsp;  /*Saved by SwitchTo, 0 while it resumes from Context*/
+    uint32_t OnCpu;      /*Set until the CPU it is leaving is off its stack*/
+    uint64_t Vruntime;   /*Nanoseconds run, scaled by SchedNiceWeight / Weight*/
+    uint64_t ExecStart;  /*GetSystemNanos at the last charge*/
+    uint32_t Weight;     /*From Priority, fixed while it sits in the fair tree*/
+    RbNode   RunNode;    /*Fair tree link while Ready*/
+    uint32_t Policy;     /*ThreadPolicyNormal, Fifo or Rr, applies from its next enqueue*/
+    uint32_t RtPriority; /*1 .. ThreadRtPriorityMax under Fifo and Rr, higher runs first*/
 
     /*Sync*/
-    void*    WaitingOn;
-    uint32_t WaitReason;
-    uint32_t ExitCode;
-    uint32_t Cooldown;
+    void*          WaitingOn;  /*Cleared by the waker when it hands the object over*/
+    uint32_t       WaitReason;
+    uint32_t       BlockState; /*BlockNone .. BlockWoken, see ThreadBlock*/
+    struct Thread* WaitNext;   /*Link on a WaitQueue, separate from the run queues*/
+    uint32_t       ExitCode;
 
     /*Linked lists*/
     struct Thread* Next;
     struct Thread* Prev;
+    struct Thread* ListNext; /*ThreadList, kept apart from the queue links above*/
+    struct Thread* ListPrev;
+    struct Thread* HashNext; /*TID bucket, walked under RcuReadLock*/
     struct Thread* Parent;
     struct Thread* Children;
 
@@ -113,6 +135,13 @@ typedef struct Thread
     uint64_t ContextSwitches;
     uint64_t PageFaults;
     uint64_t SystemCalls;
+    uint64_t RunNs;        /*Nanoseconds on a CPU, from the class charges*/
+    uint64_t RunDelayNs;   /*Nanoseconds runnable but still queued*/
+    uint64_t QueuedAt;     /*GetSystemNanos at the last enqueue, 0 once picked*/
+    uint32_t QueuedWoken;  /*That enqueue was a wakeup, its delay also goes to WakeLat*/
+    uint64_t Voluntary;    /*Left the CPU to block, sleep or exit*/
+    uint64_t Involuntary;  /*Left the CPU still runnable, preempted or yielding*/
+    uint64_t Migrations;   /*Queued or stolen onto a CPU other than the one it last ran on*/
 
     /*Debugging*/
     uint64_t CreationTick;
@@ -127,6 +156,13 @@ typedef struct Thread
 #define ThreadFlagTraced    (1 << 3)
 #define ThreadFlagSuspended (1 << 4)
 #define ThreadFlagCritical  (1 << 5)
+#define ThreadFlagWorker    (1 << 6) /*Workqueue worker, ThreadBlock and ThreadSleep tell its pool*/
+
+/*Scheduling policies, same numbers as SCHED_OTHER, SCHED_FIFO and SCHED_RR*/
+#define ThreadPolicyNormal  0
+#define ThreadPolicyFifo    1
+#define ThreadPolicyRr      2
+#define ThreadRtPriorityMax 99
 
 #define WaitReasonNone      0
 #define WaitReasonMutex     1
@@ -135,15 +171,23 @@ typedef struct Thread
 #define WaitReasonSleep     4
 #define WaitReasonSignal    5
 #define WaitReasonChild     6
+#define WaitReasonZombie    7 /*Thread reaper with nothing to free*/
+#define WaitReasonWork      8 /*Idle worker, workqueue manager or FlushWork*/
+#define WaitReasonSpace     9 /*Space reaper with no dead address space queued*/
+
+/*ThreadBlock handshake, so a wakeup racing the switch away is never lost*/
+#define BlockNone   0 /*Not on a wait queue*/
+#define BlockGoing  1 /*Queued, still on its CPU*/
+#define BlockParked 2 /*Off CPU, only ThreadUnblock requeues it*/
+#define BlockWoken  3 /*Unblocked before it got off CPU, Schedule requeues it*/
 
 #define UserVirtualBase 0x0000000000400000ULL
-#define KStackSize      8192
+
+#define ThreadHashBuckets 1024 /*FindThreadById chains, sequential TIDs spread evenly*/
 
 extern uint32_t NextThreadId;
-extern Thread*  ThreadList;
+extern Thread*  ThreadList; /*Every thread, linked through ListNext*/
 extern SpinLock ThreadListLock;
-extern Thread*  CurrentThreads[MaxCPUs];
-extern Thread*  IdleThread;
 
 /*Thread Manager Core*/
 void    InitializeThreadManager(SysErr* __Err__);
@@ -161,12 +205,15 @@ void    ResumeThread(Thread* __ThreadPtr__, SysErr* __Err__);
 
 /*Thread Properties*/
 void SetThreadPriority(Thread* __ThreadPtr__, ThreadPriority __Priority__, SysErr* __Err__);
-void SetThreadAffinity(Thread* __ThreadPtr__, uint32_t __CpuMask__, SysErr* __Err__);
+void SetThreadAffinity(Thread* __ThreadPtr__, const CpuMask* __CpuMask__, SysErr* __Err__);
+int  SetThreadPolicy(Thread* __ThreadPtr__, uint32_t __Policy__, uint32_t __RtPriority__);
 
 /*Thread Control*/
 void ThreadYield(SysErr* __Err__);
 void ThreadSleep(uint64_t __Milliseconds__, SysErr* __Err__);
 void ThreadExit(uint32_t __ExitCode__, SysErr* __Err__);
+void ThreadBlock(SpinLock* __Lock__, uint32_t __Reason__, void* __On__, SysErr* __Err__);
+void ThreadUnblock(Thread* __ThreadPtr__, SysErr* __Err__);
 
 /*Thread Queries*/
 Thread*  FindThreadById(uint32_t __ThreadId__);
@@ -197,9 +244,12 @@ KEXPORT(SuspendThread);
 KEXPORT(ResumeThread);
 KEXPORT(SetThreadPriority);
 KEXPORT(SetThreadAffinity);
+KEXPORT(SetThreadPolicy);
 KEXPORT(ThreadYield);
 KEXPORT(ThreadSleep);
 KEXPORT(ThreadExit);
+KEXPORT(ThreadBlock);
+KEXPORT(ThreadUnblock);
 KEXPORT(FindThreadById);
 KEXPORT(GetThreadCount);
 KEXPORT(ThreadExecute);
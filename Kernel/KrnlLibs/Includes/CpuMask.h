@@ -0,0 +1,116 @@
+#pragma once
+
+#include <AllTypes.h>
+
+/*
+    Bitmap of CPU ids, one bit per MaxCPUs slot. Walks stop at the CPU
+    count the caller passes in (Smp.CpuCount), so a machine with 4 CPUs
+    only looks at the first word however wide MaxCPUs is.
+*/
+
+#define MaxCPUs 256
+
+#define CpuMaskWords ((MaxCPUs + 63) / 64)
+#define CpuMaskBytes (CpuMaskWords * 8)
+
+typedef struct
+{
+    uint64_t Bits[CpuMaskWords];
+
+} CpuMask;
+
+static inline void
+CpuMaskZero(CpuMask* __Mask__)
+{
+    for (uint32_t Word = 0; Word < CpuMaskWords; Word++)
+    {
+        __Mask__->Bits[Word] = 0;
+    }
+}
+
+/* Every slot, CPUs that never come up are skipped by the walkers */
+static inline void
+CpuMaskFill(CpuMask* __Mask__)
+{
+    for (uint32_t Word = 0; Word < CpuMaskWords; Word++)
+    {
+        __Mask__->Bits[Word] = ~0ULL;
+    }
+}
+
+static inline void
+CpuMaskSet(CpuMask* __Mask__, uint32_t __CpuId__)
+{
+    if (__CpuId__ < MaxCPUs)
+    {
+        __Mask__->Bits[__CpuId__ / 64] |= 1ULL << (__CpuId__ % 64);
+    }
+}
+
+static inline void
+CpuMaskClear(CpuMask* __Mask__, uint32_t __CpuId__)
+{
+    if (__CpuId__ < MaxCPUs)
+    {
+        __Mask__->Bits[__CpuId__ / 64] &= ~(1ULL << (__CpuId__ % 64));
+    }
+}
+
+static inline int
+CpuMaskTest(const CpuMask* __Mask__, uint32_t __CpuId__)
+{
+    return __CpuId__ < MaxCPUs && (__Mask__->Bits[__CpuId__ / 64] >> (__CpuId__ % 64)) & 1;
+}
+
+/* No libgcc to back __builtin_popcountll without -mpopcnt */
+static inline uint32_t
+__CpuMaskPopcount__(uint64_t __Bits__)
+{
+    __Bits__ = __Bits__ - ((__Bits__ >> 1) & 0x5555555555555555ULL);
+    __Bits__ = (__Bits__ & 0x3333333333333333ULL) + ((__Bits__ >> 2) & 0x3333333333333333ULL);
+    __Bits__ = (__Bits__ + (__Bits__ >> 4)) & 0x0F0F0F0F0F0F0F0FULL;
+    return (uint32_t)((__Bits__ * 0x0101010101010101ULL) >> 56);
+}
+
+/* Set bits below __Count__ */
+static inline uint32_t
+CpuMaskWeight(const CpuMask* __Mask__, uint32_t __Count__)
+{
+    uint32_t Weight = 0;
+    for (uint32_t Word = 0; Word < CpuMaskWords && Word * 64 < __Count__; Word++)
+    {
+        uint64_t Bits = __Mask__->Bits[Word];
+        if (__Count__ - Word * 64 < 64)
+        {
+            Bits &= (1ULL << (__Count__ - Word * 64)) - 1;
+        }
+        Weight += __CpuMaskPopcount__(Bits);
+    }
+    return Weight;
+}
+
+/* First set bit at or after __From__ and below __Count__, __Count__ when there is none */
+static inline uint32_t
+CpuMaskNext(const CpuMask* __Mask__, uint32_t __From__, uint32_t __Count__)
+{
+    if (__Count__ > MaxCPUs)
+    {
+        __Count__ = MaxCPUs;
+    }
+
+    for (uint32_t CpuId = __From__; CpuId < __Count__;)
+    {
+        uint64_t Bits = __Mask__->Bits[CpuId / 64] >> (CpuId % 64);
+        if (Bits)
+        {
+            CpuId += __builtin_ctzll(Bits);
+            return CpuId < __Count__ ? CpuId : __Count__;
+        }
+        CpuId = (CpuId / 64 + 1) * 64;
+    }
+    return __Count__;
+}
+
+#define CpuMaskForEach(__CpuId__, __Mask__, __Count__)                                             \
+    for (uint32_t __CpuId__ = CpuMaskNext((__Mask__), 0, (__Count__)); __CpuId__ < (__Count__);  \
+         __CpuId__ = CpuMaskNext((__Mask__), __CpuId__ + 1, (__Count__)))
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <AllTypes.h>
+#include <Errnos.h>
+
+/*
+    Lazy FPU switching. CR0.TS is set whenever the incoming thread's state is
+    not the one sitting in this CPU's registers, so integer-only threads never
+    pay for a save or restore. The first FPU/SSE instruction traps (#NM) and
+    loads the state. A thread that did load it is saved on the way out, with
+    XSAVEOPT where available so untouched components are skipped.
+*/
+
+#define FpuLegacySize 512 /*FXSAVE image*/
+#define FpuAlign      64  /*XSAVE needs 64, FXSAVE 16*/
+#define FpuNoCpu      0xFFFFFFFF
+
+/*XCR0 components*/
+#define FpuX87    (1ULL << 0)
+#define FpuSse    (1ULL << 1)
+#define FpuAvx    (1ULL << 2)
+#define FpuAvx512 (7ULL << 5) /*Opmask, ZMM_Hi256, Hi16_ZMM, all or nothing*/
+
+#define FpuDefaultFcw   0x037F
+#define FpuDefaultMxcsr 0x1F80
+
+typedef struct
+{
+    uint64_t Features;    /*XCR0, or x87|SSE without XSAVE*/
+    uint32_t Size;        /*Bytes of state per thread, from CPUID leaf 0xD*/
+    uint32_t UseXsave;    /*XSAVE/XRSTOR instead of FXSAVE/FXRSTOR*/
+    uint32_t UseXsaveOpt; /*Skip components not modified since the last XRSTOR*/
+
+} FpuInfo;
+
+typedef struct
+{
+    uint64_t Traps;    /*#NM taken*/
+    uint64_t Saves;    /*Outgoing thread had its state loaded*/
+    uint64_t Restores; /*State loaded into the registers*/
+    uint64_t Reuses;   /*Switched back in with its state still loaded*/
+
+} FpuStats;
+
+extern FpuInfo  Fpu;
+extern FpuStats FpuCounters;
+extern int      FpuLazy; /*0 saves and restores on every switch, as before*/
+
+struct Thread;
+
+void InitializeFpu(SysErr* __Err__);
+int  FpuAllocState(struct Thread* __ThreadPtr__);
+void FpuFreeState(struct Thread* __ThreadPtr__, SysErr* __Err__);
+void FpuCopyState(struct Thread* __Dst__, struct Thread* __Src__);
+void FpuSwitchOut(struct Thread* __Prev__);
+void FpuSwitchIn(struct Thread* __Next__);
+int  FpuTrap(void);
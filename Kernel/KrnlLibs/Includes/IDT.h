@@ -25,6 +25,10 @@
 #define IdtIrqBase       32
 #define IdtMaxIsrEntries 20
 
+/*#DF switches to a stack of its own, a kernel stack overflow cannot push its frame*/
+#define IdtDoubleFault 8
+#define IdtFaultIst    1 /*TSS Ist1*/
+
 #define RflagsCarryFlag     0
 #define RflagsParityFlag    2
 #define RflagsAuxFlag       4
@@ -78,6 +82,7 @@ void SetIdtEntry(
     int __Index__, uint64_t __Handler__, uint16_t __Selector__, uint8_t __Flags__, SysErr* __Err__);
 void InitializePic(SysErr* __Err__);
 void InitializeIdt(SysErr* __Err__);
+void SetFaultStack(TaskStateSegment* __Tss__, IdtEntry* __Idt__, SysErr* __Err__);
 void IsrHandler(InterruptFrame* __Frame__);
 void IrqHandler(InterruptFrame* __Frame__);
 
@@ -123,5 +128,7 @@ extern void Irq12(void);
 extern void Irq13(void);
 extern void Irq14(void);
 extern void Irq15(void);
+extern void IrqResched(void);
+extern void IrqCall(void);
 
 KEXPORT(SetIdtEntry);
\ No newline at end of file
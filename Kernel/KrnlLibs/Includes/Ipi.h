@@ -0,0 +1,63 @@
+#pragma once
+
+#include <AllTypes.h>
+#include <Errnos.h>
+#include <KExports.h>
+#include <SMP.h>
+#include <Sync.h>
+
+/*
+    Inter-processor interrupts through the local APIC ICR. The reschedule
+    vector has its target run Schedule right away instead of at its next
+    tick, the call vector runs queued functions there with interrupts off.
+    Stopping the other CPUs goes out as an NMI, so it also lands on a CPU
+    spinning with interrupts disabled.
+*/
+#define IpiVectorResched 0xF0
+#define IpiVectorCall    0xF1
+
+#define IpiRegIcrLow       0x300
+#define IpiRegIcrHigh      0x310
+#define IpiDeliveryFixed   (0 << 8)
+#define IpiDeliveryNmi     (4 << 8)
+#define IpiDeliveryPending (1 << 12) /*Set until the previous IPI from this APIC is accepted*/
+#define IpiLevelAssert     (1 << 14)
+#define IpiToSelf          (1 << 18)
+#define IpiToAllButSelf    (3 << 18)
+
+#define IpiCallDepth 16 /*Calls queued per CPU, past this senders wait for room*/
+
+typedef void (*IpiFunc)(void* __Arg__);
+
+/*On the caller's stack, it waits until every target has run Func*/
+typedef struct
+{
+    IpiFunc  Func;
+    void*    Arg;
+    uint32_t Remaining;
+
+} IpiCallData;
+
+/*Taken on each CPU*/
+typedef struct
+{
+    uint64_t Resched;
+    uint64_t ReschedStale; /*Of those, a Schedule had already run by the time it arrived*/
+    uint64_t Calls;
+
+} IpiCpuStats;
+
+extern IpiCpuStats       IpiStats[MaxCPUs];
+extern volatile uint32_t IpiStopping;
+
+void InitializeIpi(SysErr* __Err__);
+int  IpiSend(uint32_t __CpuId__, uint32_t __Vector__);
+int  IpiCallCpu(uint32_t __CpuId__, IpiFunc __Func__, void* __Arg__);
+int  IpiCallOthers(IpiFunc __Func__, void* __Arg__);
+void IpiCallHandler(void);
+void IpiStopOthers(void);
+void IpiEoi(void);
+
+KEXPORT(IpiSend);
+KEXPORT(IpiCallCpu);
+KEXPORT(IpiCallOthers);
@@ -4,6 +4,7 @@
 #include <Errnos.h>
 #include <KExports.h>
 #include <Sync.h>
+#include <VMM.h>
 
 #define MaxPciDevices    256
 #define PciConfigAddress 0xCF8
@@ -96,6 +97,7 @@ int PciDisableMsi(PciDevice* __Device__);
 uint64_t PciGetBarAddress(PciDevice* __Device__, uint8_t __BarIndex__);
 uint64_t PciGetBarSize(PciDevice* __Device__, uint8_t __BarIndex__);
 uint32_t PciGetBarType(PciDevice* __Device__, uint8_t __BarIndex__);
+void*    PciMapBar(PciDevice* __Device__, uint8_t __BarIndex__, VmmCacheType __Type__);
 
 void PciDumpDevice(PciDevice* __Device__, SysErr* __Err__);
 void PciDumpAllDevices(SysErr* __Err__);
@@ -121,3 +123,4 @@ KEXPORT(PciEnableMsi);
 KEXPORT(PciGetBarAddress);
 KEXPORT(PciGetBarSize);
 KEXPORT(PciGetBarType);
+KEXPORT(PciMapBar);
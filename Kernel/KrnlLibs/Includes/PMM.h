@@ -13,6 +13,7 @@
 #define BitsPerUint64     64
 #define MaxMemoryRegions  64
 #define PmmBitmapNotFound 0xFFFFFFFFFFFFFFFF
+#define PmmHugeFrames     512
 
 #define MemoryTypeUsable   0
 #define MemoryTypeReserved 1
@@ -61,6 +62,8 @@ uint64_t AllocPage(void);
 void     FreePage(uint64_t __PhysAddr__, SysErr* __Err__);
 uint64_t AllocPages(size_t __Count__);
 void     FreePages(uint64_t __PhysAddr__, size_t __Count__, SysErr* __Err__);
+uint64_t AllocHugePage(void);
+void     FreeHugePage(uint64_t __PhysAddr__, SysErr* __Err__);
 
 void PmmDumpStats(SysErr* __Err__);          //
 void PmmDumpRegions(SysErr* __Err__);        //
@@ -78,5 +81,7 @@ KEXPORT(AllocPage);
 KEXPORT(FreePage);
 KEXPORT(AllocPages);
 KEXPORT(FreePages);
+KEXPORT(AllocHugePage);
+KEXPORT(FreeHugePage);
 KEXPORT(PhysToVirt);
 KEXPORT(VirtToPhys);
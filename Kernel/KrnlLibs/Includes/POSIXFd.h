@@ -47,6 +47,8 @@ int  PosixIoctl(PosixFdTable* __Tab__, int __Fd__, unsigned long __Cmd__, void*
 int  PosixAccess(PosixFdTable* __Tab__, const char* __Path__, long __Mode__);
 int  PosixStatPath(const char* __Path__, VfsStat* __Out__);
 int  PosixFstat(PosixFdTable* __Tab__, int __Fd__, VfsStat* __Out__);
+File* PosixFdFile(PosixFdTable* __Tab__, int __Fd__);
+int   PosixFdInstall(PosixFdTable* __Tab__, File* __File__, long __Flags__);
 int  PosixMkdir(const char* __Path__, long __Mode__);
 int  PosixRmdir(const char* __Path__);
 int  PosixUnlink(const char* __Path__);
@@ -68,6 +70,8 @@ KEXPORT(PosixIoctl)
 KEXPORT(PosixAccess)
 KEXPORT(PosixStatPath)
 KEXPORT(PosixFstat)
+KEXPORT(PosixFdFile)
+KEXPORT(PosixFdInstall)
 KEXPORT(PosixMkdir)
 KEXPORT(PosixRmdir)
 KEXPORT(PosixUnlink)
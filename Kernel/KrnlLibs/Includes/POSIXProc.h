@@ -24,6 +24,16 @@ typedef struct PosixRusage
     uint64_t InvoluntaryCtxt;
 } PosixRusage;
 
+/* Scheduler counters summed over a process's threads */
+typedef struct PosixSchedStat
+{
+    uint64_t RunNs;
+    uint64_t RunDelayNs;
+    uint64_t RunCount;
+    uint64_t VoluntaryCtxt;
+    uint64_t InvoluntaryCtxt;
+} PosixSchedStat;
+
 typedef struct PosixCred
 {
     long Ruid;
@@ -35,6 +45,18 @@ typedef struct PosixCred
     long Umask;
 } PosixCred;
 
+#define PosixMaxMapRecs 32
+
+/* A user range whose frames a filesystem lent through Map, given back through Unmap */
+typedef struct PosixMapRec
+{
+    uint64_t Va;
+    uint64_t Len;
+    long     Off;
+    Vnode*   Node;
+
+} PosixMapRec;
+
 typedef struct PosixProc
 {
     long                 Pid;
@@ -44,6 +66,7 @@ typedef struct PosixProc
     long                 TtyFd;
     const char*          TtyName;
     VirtualMemorySpace*  Space;
+    uint64_t             MmapNext; /* next free anonymous mmap address */
     Thread*              MainThread;
     PosixCred            Cred;
     char                 Cwd[256];
@@ -54,21 +77,29 @@ typedef struct PosixProc
     uint64_t             SigMask;
     SpinLock             Lock;
     PosixTimes           Times;
+    PosixSchedStat       Sched; /* Frozen at exit, read through PosixGetSchedStat */
     char                 Comm[64];
     char*                CmdlineBuf;
     long                 CmdlineLen;
     char*                EnvironBuf;
     long                 EnvironLen;
     struct PosixFdTable* Fds;
+    PosixMapRec          MapRecs[PosixMaxMapRecs];
+    struct PosixProc*    HashNext; /* PID bucket, walked under RcuReadLock */
+    long                 TableIdx; /* slot in PosixProcs.Items */
 
 } PosixProc;
 
+/* PosixFind buckets, PIDs are handed out in order so they spread */
+#define PosixPidBuckets 1024
+
 typedef struct PosixProcTable
 {
     PosixProc** Items;
     long        Count;
     long        Cap;
     SpinLock    Lock;
+    PosixProc*  Hash[PosixPidBuckets]; /* written under Lock, read lock free */
 } PosixProcTable;
 
 #ifndef WNOHANG
@@ -100,6 +131,18 @@ int        PosixFchdir(PosixProc* __Proc__, int __Fd__);
 int        PosixSetUmask(PosixProc* __Proc__, long __Mask__);
 int        PosixGetTty(PosixProc* __Proc__, char* __Out__, long __Len__);
 PosixProc* PosixFind(long __Pid__);
+int        PosixMapRecAdd(PosixProc* __Proc__,
+                          uint64_t   __Va__,
+                          uint64_t   __Len__,
+                          long       __Off__,
+                          Vnode*     __Node__);
+int        PosixMapRecDrop(PosixProc* __Proc__, uint64_t __Va__, uint64_t __Len__);
+int        PosixMapRecMove(PosixProc* __Proc__,
+                           uint64_t   __Va__,
+                           uint64_t   __Len__,
+                           uint64_t   __NewVa__);
+int        PosixMapRecFree(PosixProc* __Proc__);
+int        PosixGetSchedStat(PosixProc* __Proc__, PosixSchedStat* __Out__);
 /*Global Helpers*/
 char __ProcStateCode__(PosixProc* __Proc__);
 
@@ -118,4 +161,8 @@ KEXPORT(PosixChdir)
 KEXPORT(PosixFchdir)
 KEXPORT(PosixSetUmask)
 KEXPORT(PosixGetTty)
-KEXPORT(PosixFind)
\ No newline at end of file
+KEXPORT(PosixFind)
+KEXPORT(PosixMapRecAdd)
+KEXPORT(PosixMapRecDrop)
+KEXPORT(PosixMapRecMove)
+KEXPORT(PosixMapRecFree)
\ No newline at end of file
@@ -38,6 +38,10 @@ typedef struct ProcFsFileCtx
 
 long ProcFsMakeStat(PosixProc* __Proc__, char* __Buf__, long __Cap__);
 long ProcFsMakeStatus(PosixProc* __Proc__, char* __Buf__, long __Cap__);
+long ProcFsMakeMeminfo(char* __Buf__, long __Cap__);
+long ProcFsMakeSchedstat(char* __Buf__, long __Cap__);
+long ProcFsMakeSchedlat(char* __Buf__, long __Cap__);
+long ProcFsMakeProcSchedstat(PosixProc* __Proc__, char* __Buf__, long __Cap__);
 long ProcFsListFds(PosixProc* __Proc__, char* __Buf__, long __Cap__);
 long ProcFsWriteState(PosixProc* __Proc__, const char* __Buf__, long __Len__);
 long ProcFsWriteExec(PosixProc* __Proc__, const char* __Buf__, long __Len__);
@@ -2,18 +2,90 @@
 
 #include <Errnos.h>
 #include <IDT.h>
+#include <SMP.h>
 
-typedef struct
+struct Thread;
+
+typedef struct PerCpuData
+{
+
+    struct PerCpuData* Self;          /* gs:0, so ThisCpuData() is one load*/
+    uint32_t           CpuId;         /* What GetCurrentCpuId returns*/
+    uint32_t           Reserved;
+    struct Thread*     CurrentThread; /* Set by the scheduler on every switch*/
+    uint64_t           PerCpuOffset;  /* Added to a PerCpu() variable's link address*/
+    GdtEntry           Gdt[MaxGdt];   /* GDT*/
+    GdtPointer         GdtPtr;
+    IdtEntry           Idt[MaxIdt]; /* IDT*/
+    IdtPointer         IdtPtr;
+    TaskStateSegment   Tss;        /* TSS*/
+    uint64_t           StackTop;   /* Stack*/
+    uint64_t           ApicBase;   /* APIC Base*/
+    uint64_t           LocalTicks; /* Timer Data*/
+    uint32_t           LocalInterrupts;
+    uint32_t           TimerOneShot; /* Tickless, armed for the next event*/
+    uint32_t*          LeavingOnCpu; /* Preempted thread's OnCpu, cleared by the IRQ exit*/
+    uint64_t           ExitStack[32]; /* That exit's iretq runs from here, off the old stack*/
+
+} PerCpuData;
+
+/*
+    In the kernel GS_BASE points at this CPU's PerCpuData, the user GS sits
+    in KERNEL_GS_BASE. Every entry from and exit to ring 3 does swapgs.
+*/
+#define MsrGsBase       0xC0000101
+#define MsrKernelGsBase 0xC0000102
+
+extern PerCpuData CpuDataArray[MaxCPUs];
+
+/*PerCpu() variables link into .percpu, the boot CPU uses that copy and every AP gets its own*/
+extern char __PerCpuStart[];
+extern char __PerCpuEnd[];
+
+#define PerCpu(__Type__, __Name__) __attribute__((section(".percpu"))) __Type__ __Name__
+
+static inline PerCpuData*
+ThisCpuData(void)
+{
+    PerCpuData* Data;
+    __asm__ volatile("movq %%gs:%c1, %0" : "=r"(Data) : "i"(__builtin_offsetof(PerCpuData, Self)));
+    return Data;
+}
+
+static inline uint32_t
+ThisCpuId(void)
+{
+    uint32_t Id;
+    __asm__ volatile("movl %%gs:%c1, %0" : "=r"(Id) : "i"(__builtin_offsetof(PerCpuData, CpuId)));
+    return Id;
+}
+
+static inline struct Thread*
+ThisThread(void)
+{
+    struct Thread* Current;
+    __asm__ volatile("movq %%gs:%c1, %0"
+                     : "=r"(Current)
+                     : "i"(__builtin_offsetof(PerCpuData, CurrentThread)));
+    return Current;
+}
+
+static inline uint64_t
+__ThisCpuOffset__(void)
 {
+    uint64_t Offset;
+    __asm__ volatile("movq %%gs:%c1, %0"
+                     : "=r"(Offset)
+                     : "i"(__builtin_offsetof(PerCpuData, PerCpuOffset)));
+    return Offset;
+}
+
+#define ThisCpuPtr(__Name__)                                                                       \
+    ((__typeof__(&(__Name__)))((uintptr_t)&(__Name__) + __ThisCpuOffset__()))
+#define ThisCpuRead(__Name__)             (*ThisCpuPtr(__Name__))
+#define ThisCpuWrite(__Name__, __Value__) (*ThisCpuPtr(__Name__) = (__Value__))
+#define PerCpuPtr(__Name__, __CpuId__)                                                             \
+    ((__typeof__(&(__Name__)))((uintptr_t)&(__Name__) + CpuDataArray[__CpuId__].PerCpuOffset))
 
-    GdtEntry         Gdt[MaxGdt]; /* GDT*/
-    GdtPointer       GdtPtr;
-    IdtEntry         Idt[MaxIdt]; /* IDT*/
-    IdtPointer       IdtPtr;
-    TaskStateSegment Tss;        /* TSS*/
-    uint64_t         StackTop;   /* Stack*/
-    uint64_t         ApicBase;   /* APIC Base*/
-    uint64_t         LocalTicks; /* Timer Data*/
-    uint32_t         LocalInterrupts;
-
-} PerCpuData;
\ No newline at end of file
+void InitializePerCpuData(uint32_t __CpuId__, SysErr* __Err__);
+int  AllocatePerCpuArea(uint32_t __CpuId__);
@@ -0,0 +1,60 @@
+#pragma once
+
+#include <AllTypes.h>
+
+/*
+    Intrusive red-black tree. The node lives inside the owning struct, the
+    caller walks down with its own compare and links the node where the walk
+    ended, RbInsert only recolours and rotates. The leftmost node is cached
+    so the smallest key is one load.
+*/
+
+#define RbRed   0
+#define RbBlack 1
+
+typedef struct RbNode
+{
+    struct RbNode* Parent;
+    struct RbNode* Left;
+    struct RbNode* Right;
+    uint32_t       Color;
+
+} RbNode;
+
+typedef struct
+{
+    RbNode* Root;
+    RbNode* Leftmost;
+
+} RbTree;
+
+#define RbEntry(__Node__, __Type__, __Member__)                                                    \
+    ((__Type__*)((char*)(__Node__) - __builtin_offsetof(__Type__, __Member__)))
+
+static inline void
+RbInit(RbTree* __Tree__)
+{
+    __Tree__->Root     = NULL;
+    __Tree__->Leftmost = NULL;
+}
+
+static inline RbNode*
+RbFirst(RbTree* __Tree__)
+{
+    return __Tree__->Leftmost;
+}
+
+/* __Link__ is the NULL child slot of __Parent__ the walk stopped at */
+static inline void
+RbLink(RbNode* __Node__, RbNode* __Parent__, RbNode** __Link__)
+{
+    __Node__->Parent = __Parent__;
+    __Node__->Left   = NULL;
+    __Node__->Right  = NULL;
+    __Node__->Color  = RbRed;
+    *__Link__        = __Node__;
+}
+
+void    RbInsert(RbTree* __Tree__, RbNode* __Node__, int __Leftmost__);
+void    RbErase(RbTree* __Tree__, RbNode* __Node__);
+RbNode* RbNext(RbNode* __Node__);
@@ -1,12 +1,11 @@
 #pragma once
 
 #include <AllTypes.h>
+#include <CpuMask.h>
 #include <Errnos.h>
 #include <KrnPrintf.h>
 #include <LimineServices.h>
 
-#define MaxCPUs 256
-
 typedef enum
 {
 
@@ -25,8 +24,35 @@ typedef struct
     volatile uint32_t       Started;
     struct limine_smp_info* LimineInfo;
 
+    /*Topology, split out of ApicId by InitializeTopology*/
+    uint32_t PackageId;
+    uint32_t CoreId;      /*Unique across packages*/
+    uint32_t LlcId;       /*CPUs with the same LlcId share the last level cache*/
+    CpuMask  SmtMask;     /*This CPU and its SMT siblings*/
+    CpuMask  LlcMask;
+    CpuMask  PackageMask;
+
 } CpuInfo;
 
+/*How far apart two CPUs are, smaller shares more cache*/
+#define CpuDistSelf    0
+#define CpuDistSmt     1
+#define CpuDistLlc     2
+#define CpuDistPackage 3
+#define CpuDistRemote  4
+
+typedef struct
+{
+    uint32_t SmtShift;     /*ApicId >> SmtShift is the core*/
+    uint32_t PackageShift; /*ApicId >> PackageShift is the package*/
+    uint32_t LlcShift;     /*ApicId >> LlcShift is the LLC domain*/
+    uint32_t Packages;
+    uint32_t Cores;
+    uint32_t Llcs;
+    uint32_t Source; /*CPUID leaf the shifts came from, 0x1F, 0xB or 1*/
+
+} CpuTopology;
+
 typedef struct
 {
     uint32_t CpuCount;
@@ -34,6 +60,8 @@ typedef struct
     uint32_t BspApicId;
     CpuInfo  Cpus[MaxCPUs];
 
+    CpuTopology Topology;
+
 } SmpManager;
 
 extern SmpManager        Smp;
@@ -42,4 +70,6 @@ extern volatile uint32_t CpuStartupCount;
 void     InitializeSmp(SysErr* __Err__);
 void     ApEntryPoint(struct limine_smp_info* __CpuInfo__);
 uint32_t GetCurrentCpuId(void);
-void     PerCpuInterruptInit(uint32_t __CpuId__, uint64_t __InterruptStack__, SysErr* __Err__);
\ No newline at end of file
+void     PerCpuInterruptInit(uint32_t __CpuId__, uint64_t __InterruptStack__, SysErr* __Err__);
+void     InitializeTopology(SysErr* __Err__);
+uint32_t CpuDistance(uint32_t __CpuA__, uint32_t __CpuB__);
\ No newline at end of file
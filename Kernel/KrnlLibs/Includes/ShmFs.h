@@ -0,0 +1,62 @@
+#pragma once
+
+#include <AllTypes.h>
+#include <Errnos.h>
+#include <KExports.h>
+#include <KHeap.h>
+#include <Sync.h>
+#include <VFS.h>
+#include <VMM.h>
+
+#define ShmMaxObjects 64
+#define ShmMaxName    64
+#define ShmMaxPages   65536 /* 256MB per object */
+
+/*
+    A shared memory object is just a list of zeroed frames. Every mapping of
+    it points at the same frames (PTEBORROWED | PTESHARED), so the object lives
+    until it is unlinked, closed everywhere and no page of it is mapped.
+*/
+typedef struct ShmObject
+{
+    char      Name[ShmMaxName];
+    uint64_t* Frames;
+    uint64_t  Pages;
+    long      Size;
+    long      Ino;
+    long      Opens;  /* open files */
+    long      Maps;   /* pages handed out through Map */
+    long      Io;     /* reads and writes copying with ShmLock dropped */
+    int       Linked; /* reachable by name under /dev/shm */
+    Vnode     Node;
+
+} ShmObject;
+
+typedef struct ShmFsStats
+{
+    uint64_t Objects;
+    uint64_t Pages;
+
+} ShmFsStats;
+
+extern ShmFsStats ShmStats;
+
+int   ShmFsInit(void);
+File* ShmMemfdOpen(const char* __Name__, long __Flags__);
+
+int    ShmOpen(Vnode* __Node__, File* __File__);
+int    ShmClose(File* __File__);
+long   ShmRead(File* __File__, void* __Buf__, long __Len__);
+long   ShmWrite(File* __File__, const void* __Buf__, long __Len__);
+long   ShmLseek(File* __File__, long __Off__, int __Whence__);
+int    ShmStat(Vnode* __Node__, VfsStat* __Out__);
+long   ShmReaddir(Vnode* __Dir__, void* __Buf__, long __BufLen__);
+Vnode* ShmLookup(Vnode* __Dir__, const char* __Name__);
+int    ShmCreate(Vnode* __Dir__, const char* __Name__, long __Flags__, VfsPerm __Perm__);
+int    ShmUnlink(Vnode* __Dir__, const char* __Name__);
+int    ShmTruncate(Vnode* __Node__, long __Len__);
+int    ShmMap(Vnode* __Node__, void** __Out__, long __Off__, long __Len__);
+int    ShmUnmap(Vnode* __Node__, void* __Addr__, long __Len__);
+
+KEXPORT(ShmFsInit);
+KEXPORT(ShmMemfdOpen);
@@ -18,14 +18,39 @@ void AcquireSpinLock(SpinLock* __Lock__, SysErr* __Err__ _unused);
 void ReleaseSpinLock(SpinLock* __Lock__, SysErr* __Err__ _unused);
 bool TryAcquireSpinLock(SpinLock* __Lock__);
 
+struct Thread;
+
+/*FIFO of blocked threads, linked through Thread.WaitNext*/
+typedef struct
+{
+    struct Thread* Head; /*Oldest waiter, woken first*/
+    struct Thread* Tail;
+    uint32_t       Count;
+    SpinLock       Lock;
+
+} WaitQueue;
+
+void InitializeWaitQueue(WaitQueue* __Queue__, const char* __Name__, SysErr* __Err__);
+void WaitQueueBlock(WaitQueue* __Queue__, uint32_t __Reason__, void* __On__, SysErr* __Err__);
+struct Thread* WaitQueuePop(WaitQueue* __Queue__);
+uint32_t       WaitQueueWakeAll(WaitQueue* __Queue__, SysErr* __Err__);
+
+#define MutexSpinMax 4096 /*Pauses spent on a running owner before going to sleep*/
+
 typedef struct
 {
     volatile uint32_t Lock;
-    uint32_t          Owner;
+    uint32_t          Owner;  /*CPU the holder took it on*/
     uint32_t          RecursionCount;
     const char*       Name;
+    struct Thread*    Holder; /*NULL while no scheduler runs, then it is CPU owned*/
+    WaitQueue         Waiters;
+    uint64_t          Sleeps; /*Acquires that had to block*/
+
 } Mutex;
 
+extern int MutexBlocking;
+
 void InitializeMutex(Mutex* __Mutex__, const char* __Name__, SysErr* __Err__);
 void AcquireMutex(Mutex* __Mutex__, SysErr* __Err__);
 void ReleaseMutex(Mutex* __Mutex__, SysErr* __Err__);
@@ -33,10 +58,10 @@ bool TryAcquireMutex(Mutex* __Mutex__);
 
 typedef struct
 {
-    volatile int32_t  Count;
-    volatile uint32_t WaitQueue;
-    SpinLock          QueueLock;
-    const char*       Name;
+    volatile int32_t Count;
+    WaitQueue        Waiters;
+    const char*      Name;
+
 } Semaphore;
 
 void InitializeSemaphore(Semaphore*  __Semaphore__,
@@ -47,6 +72,17 @@ void AcquireSemaphore(Semaphore* __Semaphore__, SysErr* __Err__ _unused);
 void ReleaseSemaphore(Semaphore* __Semaphore__, SysErr* __Err__ _unused);
 bool TryAcquireSemaphore(Semaphore* __Semaphore__);
 
+/*
+    Lock free lookups. A reader runs with interrupts off and its CPU's
+    sequence is odd while it is inside, SynchronizeRcu spins until every
+    CPU that was inside has left. After that nothing can still hold what
+    was unlinked before the call, so it may be freed. Readers must not
+    block, writers still serialise among themselves with a lock.
+*/
+uint64_t RcuReadLock(void); /*Returns the interrupt flags to hand back*/
+void     RcuReadUnlock(uint64_t __Flags__);
+void     SynchronizeRcu(void);
+
 extern SpinLock ConsoleLock;
 
 KEXPORT(InitializeSpinLock);
@@ -54,6 +90,11 @@ KEXPORT(AcquireSpinLock);
 KEXPORT(ReleaseSpinLock);
 KEXPORT(TryAcquireSpinLock);
 
+KEXPORT(InitializeWaitQueue);
+KEXPORT(WaitQueueBlock);
+KEXPORT(WaitQueuePop);
+KEXPORT(WaitQueueWakeAll);
+
 KEXPORT(InitializeMutex);
 KEXPORT(AcquireMutex);
 KEXPORT(ReleaseMutex);
@@ -63,3 +104,7 @@ KEXPORT(InitializeSemaphore);
 KEXPORT(AcquireSemaphore);
 KEXPORT(ReleaseSemaphore);
 KEXPORT(TryAcquireSemaphore);
+
+KEXPORT(RcuReadLock);
+KEXPORT(RcuReadUnlock);
+KEXPORT(SynchronizeRcu);
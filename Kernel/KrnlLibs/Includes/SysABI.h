@@ -12,6 +12,7 @@ enum SysNo
     SysPoll                = 7,
     SysLseek               = 8,
     SysMmap                = 9,
+    SysMprotect            = 10,
     SysMunmap              = 11,
     SysBrk                 = 12,
     SysRtSigaction         = 13,
@@ -208,5 +209,36 @@ enum SysNo
     SysClockSettime        = 227,
     SysClockGettime        = 228,
     SysClockGetres         = 229,
-    SysClockNanosleep      = 230
+    SysClockNanosleep      = 230,
+    SysMemfdCreate         = 319
 };
+
+/*mmap/mprotect ABI*/
+#define ProtRead     0x1
+#define ProtWrite    0x2
+#define ProtExec     0x4
+#define MapShared    0x01
+#define MapPrivate   0x02
+#define MapFixed     0x10
+#define MapAnonymous 0x20
+#define MapNoreserve 0x4000
+#define MapPopulate  0x8000
+
+/*mremap ABI*/
+#define MremapMaymove 0x1
+#define MremapFixed   0x2
+
+/*madvise ABI*/
+#define MadvNormal     0
+#define MadvRandom     1
+#define MadvSequential 2
+#define MadvWillneed   3
+#define MadvDontneed   4
+#define MadvFree       8
+#define MadvHugepage   14
+#define MadvNohugepage 15
+
+/*open ABI (newlib values)*/
+#define OpenCreate   0x200
+#define OpenTrunc    0x400
+#define OpenExcl     0x800
@@ -117,6 +117,60 @@ int64_t __Handle__SchedYield(uint64_t __U1__,
                              uint64_t __U4__,
                              uint64_t __U5__,
                              uint64_t __U6__);
+int64_t __Handle__SchedSetscheduler(uint64_t __Pid__,
+                                    uint64_t __Policy__,
+                                    uint64_t __ParamPtr__,
+                                    uint64_t __U4__,
+                                    uint64_t __U5__,
+                                    uint64_t __U6__);
+int64_t __Handle__SchedGetscheduler(uint64_t __Pid__,
+                                    uint64_t __U2__,
+                                    uint64_t __U3__,
+                                    uint64_t __U4__,
+                                    uint64_t __U5__,
+                                    uint64_t __U6__);
+int64_t __Handle__SchedSetparam(uint64_t __Pid__,
+                                uint64_t __ParamPtr__,
+                                uint64_t __U3__,
+                                uint64_t __U4__,
+                                uint64_t __U5__,
+                                uint64_t __U6__);
+int64_t __Handle__SchedGetparam(uint64_t __Pid__,
+                                uint64_t __ParamPtr__,
+                                uint64_t __U3__,
+                                uint64_t __U4__,
+                                uint64_t __U5__,
+                                uint64_t __U6__);
+int64_t __Handle__SchedGetPriorityMax(uint64_t __Policy__,
+                                      uint64_t __U2__,
+                                      uint64_t __U3__,
+                                      uint64_t __U4__,
+                                      uint64_t __U5__,
+                                      uint64_t __U6__);
+int64_t __Handle__SchedGetPriorityMin(uint64_t __Policy__,
+                                      uint64_t __U2__,
+                                      uint64_t __U3__,
+                                      uint64_t __U4__,
+                                      uint64_t __U5__,
+                                      uint64_t __U6__);
+int64_t __Handle__SchedRrGetInterval(uint64_t __Pid__,
+                                     uint64_t __TsPtr__,
+                                     uint64_t __U3__,
+                                     uint64_t __U4__,
+                                     uint64_t __U5__,
+                                     uint64_t __U6__);
+int64_t __Handle__SchedSetaffinity(uint64_t __Pid__,
+                                   uint64_t __Len__,
+                                   uint64_t __MaskPtr__,
+                                   uint64_t __U4__,
+                                   uint64_t __U5__,
+                                   uint64_t __U6__);
+int64_t __Handle__SchedGetaffinity(uint64_t __Pid__,
+                                   uint64_t __Len__,
+                                   uint64_t __MaskPtr__,
+                                   uint64_t __U4__,
+                                   uint64_t __U5__,
+                                   uint64_t __U6__);
 int64_t __Handle__Nanosleep(uint64_t __ReqPtr__,
                             uint64_t __RemPtr__,
                             uint64_t __U3__,
@@ -219,6 +273,36 @@ int64_t __Handle__Munmap(uint64_t __Addr__,
                          uint64_t __U4__,
                          uint64_t __U5__,
                          uint64_t __U6__);
+int64_t __Handle__Mprotect(uint64_t __Addr__,
+                           uint64_t __Len__,
+                           uint64_t __Prot__,
+                           uint64_t __U4__,
+                           uint64_t __U5__,
+                           uint64_t __U6__);
+int64_t __Handle__Madvise(uint64_t __Addr__,
+                          uint64_t __Len__,
+                          uint64_t __Advice__,
+                          uint64_t __U4__,
+                          uint64_t __U5__,
+                          uint64_t __U6__);
+int64_t __Handle__Mremap(uint64_t __Addr__,
+                         uint64_t __OldLen__,
+                         uint64_t __NewLen__,
+                         uint64_t __Flags__,
+                         uint64_t __NewAddr__,
+                         uint64_t __U6__);
+int64_t __Handle__Ftruncate(uint64_t __Fd__,
+                            uint64_t __Len__,
+                            uint64_t __U3__,
+                            uint64_t __U4__,
+                            uint64_t __U5__,
+                            uint64_t __U6__);
+int64_t __Handle__MemfdCreate(uint64_t __Name__,
+                              uint64_t __Flags__,
+                              uint64_t __U3__,
+                              uint64_t __U4__,
+                              uint64_t __U5__,
+                              uint64_t __U6__);
 int64_t __Handle__Brk(uint64_t __NewBrk__,
                       uint64_t __U2__,
                       uint64_t __U3__,
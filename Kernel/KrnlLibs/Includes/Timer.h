@@ -17,6 +17,7 @@ typedef enum
 
 #define TimerTargetFrequency 1000
 #define TimerVector          32
+#define TimerIdleMaxTicks    32 /*Longest one-shot sleep, remote enqueues wait at most this*/
 
 typedef struct
 {
@@ -26,6 +27,8 @@ typedef struct
     uint32_t  TimerFrequency;
     uint64_t  SystemTicks;
     uint32_t  TimerInitialized;
+    uint64_t  TscBase;    /*TSC at tick zero*/
+    uint64_t  TscPerTick; /*Non zero once ticks are read off the TSC and may be skipped*/
 
 } TimerManager;
 
@@ -35,8 +38,10 @@ extern volatile uint32_t TimerInterruptCount;
 void     InitializeTimer(SysErr* __Err__);
 void     TimerHandler(InterruptFrame* __Frame__, SysErr* __Err__);
 uint64_t GetSystemTicks(void);
+uint64_t GetSystemNanos(void);
 void     Sleep(uint32_t __Milliseconds__, SysErr* __Err__);
 uint32_t GetTimerInterruptCount(void);
+void     TimerReprogram(void);
 
 int DetectHpetTimer(void);
 int DetectApicTimer(void);
@@ -47,5 +52,6 @@ int InitializePitTimer(void);
 
 uint64_t ReadMsr(uint32_t __Msr__);
 void     WriteMsr(uint32_t __Msr__, uint64_t __Value__);
+uint64_t ReadTsc(void);
 
 void SetupApicTimerForThisCpu(SysErr* __Err__);
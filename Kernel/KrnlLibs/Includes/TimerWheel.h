@@ -0,0 +1,69 @@
+#pragma once
+
+#include <AllTypes.h>
+#include <Errnos.h>
+#include <KExports.h>
+#include <SMP.h>
+#include <Sync.h>
+
+/*
+    Per-CPU hierarchical timing wheel, tick granularity. Level N slots span
+    64^N ticks, so a deadline lands in the lowest level that can hold it and
+    drops a level each time the level below wraps. A tick only touches the
+    slot that expires plus, every 64 ticks, one slot being cascaded.
+*/
+
+#define WheelLevels 4
+#define WheelBits   6
+#define WheelSlots  (1U << WheelBits)
+#define WheelMask   (WheelSlots - 1)
+#define WheelSpan   (1ULL << (WheelLevels * WheelBits)) /*Furthest deadline held exactly*/
+
+typedef void (*TimerCallback)(void* __Arg__);
+
+typedef struct KTimer
+{
+    uint64_t       Expires; /*Tick the callback is due at*/
+    TimerCallback  Callback;
+    void*          Arg;
+    uint32_t       Cpu;    /*Wheel it sits on while armed*/
+    uint32_t       Armed;  /*Cleared before the callback runs*/
+    uint32_t       Bucket; /*Level * WheelSlots + slot*/
+    struct KTimer* Next;
+    struct KTimer* Prev;
+
+} KTimer;
+
+typedef struct
+{
+    KTimer*  Slots[WheelLevels][WheelSlots];
+    uint64_t Pending[WheelLevels]; /*Bit per non empty slot*/
+    uint64_t Clock;                /*Next tick to be processed*/
+    uint32_t Count;
+    SpinLock Lock;
+
+} TimerWheel;
+
+typedef struct
+{
+    uint64_t Armed;
+    uint64_t Fired;
+    uint64_t Cancelled;
+    uint64_t Cascaded;
+
+} TimerWheelStats;
+
+extern TimerWheel      TimerWheels[MaxCPUs];
+extern TimerWheelStats TimerStats;
+
+void     InitializeTimerWheel(uint32_t __CpuId__, SysErr* __Err__);
+void     TimerInit(KTimer* __Timer__, TimerCallback __Callback__, void* __Arg__);
+int      TimerArm(KTimer* __Timer__, uint64_t __Ticks__);
+int      TimerArmAt(KTimer* __Timer__, uint32_t __CpuId__, uint64_t __Expires__);
+int      TimerCancel(KTimer* __Timer__);
+void     TimerWheelRun(uint32_t __CpuId__, uint64_t __Now__);
+uint64_t TimerNextExpiry(uint32_t __CpuId__);
+
+KEXPORT(TimerInit);
+KEXPORT(TimerArm);
+KEXPORT(TimerCancel);
@@ -203,6 +203,7 @@ typedef struct VnodeOps
     int (*Chown)(Vnode*, long, long);
     int (*Truncate)(Vnode*, long);
     int (*Sync)(Vnode*);
+    /* Map: kernel address of file bytes [Off, Off+Len) that stay valid while mapped */
     int (*Map)(Vnode*, void**, long, long);
     int (*Unmap)(Vnode*, void*, long);
 
@@ -289,12 +290,16 @@ File* VfsOpen(const char*, long);
 File* VfsOpenAt(Dentry*, const char*, long);
 int   VfsClose(File*);
 long  VfsRead(File*, void*, long);
+long  VfsPread(File*, void*, long, long);
 long  VfsWrite(File*, const void*, long);
 long  VfsLseek(File*, long, int);
 int   VfsIoctl(File*, unsigned long, void*);
 int   VfsFsync(File*);
+int   VfsFtruncate(File*, long);
 int   VfsFstats(File*, VfsStat*);
 int   VfsStats(const char*, VfsStat*);
+int   VfsMap(File*, void**, long, long);
+int   VfsUnmap(File*, void*, long);
 
 long VfsReaddir(const char*, void*, long);
 long VfsReaddirF(File*, void*, long);
@@ -406,12 +411,16 @@ KEXPORT(VfsOpen);
 KEXPORT(VfsOpenAt);
 KEXPORT(VfsClose);
 KEXPORT(VfsRead);
+KEXPORT(VfsPread);
 KEXPORT(VfsWrite);
 KEXPORT(VfsLseek);
 KEXPORT(VfsIoctl);
 KEXPORT(VfsFsync);
+KEXPORT(VfsFtruncate);
 KEXPORT(VfsFstats);
 KEXPORT(VfsStats);
+KEXPORT(VfsMap);
+KEXPORT(VfsUnmap);
 KEXPORT(VfsReaddir);
 KEXPORT(VfsReaddirF);
 KEXPORT(VfsCreate);
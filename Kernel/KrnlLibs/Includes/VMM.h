@@ -10,6 +10,10 @@
 #define VirtualAddressSpace 0x0000800000000000ULL
 #define KernelVirtualBase   0xFFFF800000000000ULL
 #define UserVirtualBase     0x0000000000400000ULL
+#define UserMmapBase        0x0000100000000000ULL
+
+#define HugePageSize 0x200000ULL
+#define HugePageMask (HugePageSize - 1)
 
 #define PTEPRESENT      (1ULL << 0)
 #define PTEWRITABLE     (1ULL << 1)
@@ -22,12 +26,48 @@
 #define PTEGLOBAL       (1ULL << 8)
 #define PTENOEXECUTE    (1ULL << 63)
 
-typedef struct
+/* PAT index bit, bit 7 in a 4KB PTE but bit 12 in a 2MB PDE (bit 7 is PS there) */
+#define PTEPAT     (1ULL << 7)
+#define PTEPATHUGE (1ULL << 12)
+
+/* Software bits (ignored by the MMU) */
+#define PTEBORROWED (1ULL << 9)  /* frame belongs to someone else, never freed here */
+#define PTECOW      (1ULL << 10) /* read-only until written, then privately copied */
+#define PTESHARED   (1ULL << 11) /* MAP_SHARED, writes land in the lent frame itself */
+
+/* Software bits of not-present entries, a reserved but untouched user page */
+#define PTELAZY       (1ULL << 52) /* zero filled on first touch, flags kept in the entry */
+#define PTESEQUENTIAL (1ULL << 53) /* MADV_SEQUENTIAL, a fault fills the pages after it too */
+#define PTEGROWSDOWN  (1ULL << 54) /* stack reservation, filled 4KB at a time, never a 2MB page */
+
+/*
+    Every user stack is a grows-down reservation under UserStackTop. Only the
+    top UserStackCommit bytes are backed at exec, faults below fill one page at
+    a time down to UserStackLow, and the gap under that is never mapped.
+*/
+#define UserStackTop     0x00007FFFFFFFF000ULL
+#define UserStackReserve 0x0000000000800000ULL /* 8MB */
+#define UserStackCommit  0x0000000000004000ULL /* 16KB, argv/envp/auxv live here */
+#define UserStackGuard   0x0000000000100000ULL /* 1MB */
+#define UserStackLow     (UserStackTop - UserStackReserve)
+
+/* Page fault error code */
+#define PfPresent (1ULL << 0)
+#define PfWrite   (1ULL << 1)
+#define PfUser    (1ULL << 2)
+
+typedef struct VirtualMemorySpace
 {
     uint64_t* Pml4;
     uint64_t  PhysicalBase;
     uint32_t  RefCount;
 
+    /*Teardown cursor, only touched once RefCount hits zero*/
+    uint32_t                   ReapL4;
+    uint32_t                   ReapL3;
+    uint32_t                   ReapL2;
+    struct VirtualMemorySpace* ReapNext;
+
 } VirtualMemorySpace;
 
 typedef struct
@@ -38,11 +78,130 @@ typedef struct
 
 } VirtualMemoryManager;
 
+typedef struct
+{
+    uint64_t Mapped;    /* 2MB user mappings currently live */
+    uint64_t Hits;      /* aligned runs served with a 2MB page */
+    uint64_t Fallbacks; /* aligned runs that fell back to 4KB */
+    uint64_t Splits;    /* 2MB mappings broken into 512 PTEs */
+
+} VmmHugeStats;
+
+typedef struct
+{
+    uint64_t Faults;    /* lazy entries filled on first touch */
+    uint64_t Around;    /* extra pages filled by sequential fault around */
+    uint64_t Populated; /* pages filled ahead of time (MADV_WILLNEED) */
+    uint64_t Dropped;   /* frames handed back by MADV_DONTNEED/MADV_FREE */
+    uint64_t Collapsed; /* 4KB runs folded into a 2MB page (MADV_HUGEPAGE) */
+
+} VmmLazyStats;
+
+typedef struct
+{
+    uint64_t Grown;     /* stack pages filled by faults below the initial commit */
+    uint64_t GuardHits; /* faults that landed in the guard gap */
+
+} VmmStackStats;
+
+/* Advice understood by AdviseUserRange */
+typedef enum
+{
+    VmmAdviseWillNeed,
+    VmmAdviseDontNeed,
+    VmmAdviseFree,
+    VmmAdviseSequential,
+    VmmAdviseHuge
+
+} VmmAdvice;
+
+#define FaultAroundPages 16    /* pages filled past a sequential fault */
+
+/*
+    IA32_PAT as programmed on every CPU, indexed by PAT:PCD:PWT. Entries 0-3
+    keep the power-on defaults so untouched mappings mean the same thing, 4-5
+    match the layout the bootloader hands over (its framebuffer is PAT5).
+*/
+#define PatMsr    0x277
+#define PatLayout 0x0007010500070406ULL /* WB WT UC- UC WP WC UC- UC */
+
+/* Memory types IoRemap can produce */
+typedef enum
+{
+    VmmCacheWB,
+    VmmCacheWT,
+    VmmCacheUC,
+    VmmCacheWC
+
+} VmmCacheType;
+
+/* Kernel window IoRemap carves out, one PML4 slot created before any user space exists */
+#define IoRemapBase       0xFFFFFE0000000000ULL
+#define IoRemapSize       0x0000008000000000ULL /* 512GB */
+#define IoRemapMaxRegions 128
+
+typedef struct
+{
+    uint64_t Regions; /* live IoRemap regions */
+    uint64_t Pages;   /* 4KB pages behind them */
+    uint64_t Huge;    /* 2MB entries used for large aligned runs */
+
+} VmmIoStats;
+
+/*
+    Kernel thread stacks get a PML4 slot of their own, every stack sits on an
+    unmapped guard page so running off the bottom faults instead of scribbling
+    over its neighbour. Freed stacks stay mapped, first in a small per-CPU
+    cache, then in a shared pool. Past that they are unmapped for good: only
+    the local TLB is flushed, so their window is never handed out again.
+*/
+#define KStackBase     0xFFFFFD8000000000ULL
+#define KStackWindow   0x0000008000000000ULL /* 512GB */
+#define KStackSize     8192
+#define KStackSlot     (PageSize + KStackSize) /* guard page, then the stack */
+#define KStackCacheMax 8                       /* freed stacks kept by each CPU */
+#define KStackPoolMax  256                     /* freed stacks kept mapped for everyone */
+
+typedef struct
+{
+    uint64_t Allocs;    /* stacks handed out */
+    uint64_t CacheHits; /* served from the CPU's own cache */
+    uint64_t PoolHits;  /* served from the shared pool */
+    uint64_t Mapped;    /* stacks backed by frames, in use or kept */
+    uint64_t Retired;   /* unmapped windows, never reused */
+    uint64_t GuardHits; /* faults that landed on a guard page */
+
+} VmmKStackStats;
+
+/*Dead spaces are handed to a per-CPU reaper thread, past these limits the caller frees inline*/
+#define ReaperMaxPending 16    /* queued spaces per CPU */
+#define ReaperLowWater   16384 /* free 4KB frames (64MB) */
+#define ReaperBatch      4096  /* frames freed between yields */
+
+typedef struct
+{
+    uint64_t Queued;  /* spaces handed to a reaper */
+    uint64_t Inline;  /* spaces torn down by the caller (backpressure) */
+    uint64_t Pending; /* spaces waiting on a reaper right now */
+    uint64_t Frames;  /* frames released by reapers */
+
+} VmmReapStats;
+
 extern VirtualMemoryManager Vmm;
+extern VmmHugeStats         VmmHuge;
+extern VmmReapStats         VmmReap;
+extern VmmLazyStats         VmmLazy;
+extern VmmIoStats           VmmIo;
+extern VmmStackStats        VmmStack;
+extern VmmKStackStats       VmmKStack;
+extern int                  KStackCaching; /*0 maps every stack fresh and unmaps it on free*/
 
 void                InitializeVmm(SysErr* __Err__);
 VirtualMemorySpace* CreateVirtualSpace(void);
 void                DestroyVirtualSpace(VirtualMemorySpace* __Space__, SysErr* __Err__);
+bool                ReapVirtualSpace(VirtualMemorySpace* __Space__,
+                                     uint64_t            __Budget__,
+                                     uint64_t*           __Freed__);
 int                 MapPage(VirtualMemorySpace* __Space__,
                             uint64_t            __VirtAddr__,
                             uint64_t            __PhysAddr__,
@@ -54,6 +213,53 @@ void                SwitchVirtualSpace(VirtualMemorySpace* __Space__, SysErr* __
 uint64_t* GetPageTable(uint64_t* __Pml4__, uint64_t __VirtAddr__, int __Level__, int __Create__);
 void      FlushTlb(uint64_t __VirtAddr__, SysErr* __Err__);
 void      FlushAllTlb(SysErr* __Err__);
+void      ShootdownTlb(SysErr* __Err__);
+
+int MapHugePage(VirtualMemorySpace* __Space__,
+                uint64_t            __VirtAddr__,
+                uint64_t            __PhysAddr__,
+                uint64_t            __Flags__);
+int SplitHugePage(VirtualMemorySpace* __Space__, uint64_t __VirtAddr__);
+int UserRangeValid(uint64_t __VirtAddr__, uint64_t __Len__);
+int MapUserRange(VirtualMemorySpace* __Space__,
+                 uint64_t            __VirtAddr__,
+                 uint64_t            __Len__,
+                 uint64_t            __Flags__);
+int UnmapUserRange(VirtualMemorySpace* __Space__, uint64_t __VirtAddr__, uint64_t __Len__);
+int ProtectUserRange(VirtualMemorySpace* __Space__,
+                     uint64_t            __VirtAddr__,
+                     uint64_t            __Len__,
+                     uint64_t            __Flags__);
+int ReserveUserRange(VirtualMemorySpace* __Space__,
+                     uint64_t            __VirtAddr__,
+                     uint64_t            __Len__,
+                     uint64_t            __Flags__);
+int PopulateUserRange(VirtualMemorySpace* __Space__, uint64_t __VirtAddr__, uint64_t __Len__);
+uint64_t CountUserRange(VirtualMemorySpace* __Space__, uint64_t __VirtAddr__, uint64_t __Len__);
+int      UserRangeIsFree(VirtualMemorySpace* __Space__, uint64_t __VirtAddr__, uint64_t __Len__);
+uint64_t UserRangeFlags(VirtualMemorySpace* __Space__, uint64_t __VirtAddr__);
+int      MoveUserRange(VirtualMemorySpace* __Space__,
+                       uint64_t            __OldAddr__,
+                       uint64_t            __NewAddr__,
+                       uint64_t            __Len__);
+int AdviseUserRange(VirtualMemorySpace* __Space__,
+                    uint64_t            __VirtAddr__,
+                    uint64_t            __Len__,
+                    VmmAdvice           __Advice__);
+int HandlePageFault(uint64_t __FaultAddr__, uint64_t __ErrCode__);
+
+void  InitializePat(SysErr* __Err__);
+void  InitializeIoRemap(SysErr* __Err__);
+void* IoRemap(uint64_t __PhysAddr__, uint64_t __Size__, VmmCacheType __Type__);
+int   IoUnmap(void* __VirtAddr__);
+
+void  InitializeKernelStacks(SysErr* __Err__);
+void* AllocKernelStack(void); /* lowest usable byte, KStackSize above it */
+void  FreeKernelStack(void* __Stack__);
+int   KernelStackGuard(uint64_t __Addr__);
+
+void InitializeSpaceReapers(SysErr* __Err__);
+int  QueueSpaceReap(VirtualMemorySpace* __Space__);
 
 void VmmDumpSpace(VirtualMemorySpace* __Space__, SysErr* __Err__); //
 void VmmDumpStats(SysErr* __Err__);                                //
@@ -68,4 +274,24 @@ KEXPORT(GetPhysicalAddress);
 KEXPORT(GetPageTable);
 KEXPORT(FlushTlb);
 KEXPORT(FlushAllTlb);
+KEXPORT(ShootdownTlb);
+KEXPORT(MapHugePage);
+KEXPORT(SplitHugePage);
+KEXPORT(MapUserRange);
+KEXPORT(UnmapUserRange);
+KEXPORT(ProtectUserRange);
+KEXPORT(ReserveUserRange);
+KEXPORT(PopulateUserRange);
+KEXPORT(CountUserRange);
+KEXPORT(UserRangeIsFree);
+KEXPORT(UserRangeFlags);
+KEXPORT(MoveUserRange);
+KEXPORT(AdviseUserRange);
+KEXPORT(HandlePageFault);
+KEXPORT(ReapVirtualSpace);
+KEXPORT(QueueSpaceReap);
+KEXPORT(AllocKernelStack);
+KEXPORT(FreeKernelStack);
+KEXPORT(IoRemap);
+KEXPORT(IoUnmap);
 KEXPORT(Vmm);
\ No newline at end of file
@@ -0,0 +1,128 @@
+#pragma once
+
+#include <AllTypes.h>
+#include <AxeThreads.h>
+#include <Errnos.h>
+#include <KExports.h>
+#include <SMP.h>
+#include <Sync.h>
+#include <TimerWheel.h>
+
+/*
+    Deferred work. A Work item is queued on a Workqueue and later run by a
+    kernel worker thread out of a pool. Bound queues feed the pool of the CPU
+    the item is queued on, whose workers are pinned there, unbound queues all
+    share one pool whose workers run wherever the scheduler puts them.
+
+    A pool keeps Concurrency workers running items and no more: when one
+    blocks inside an item, an idle worker takes over the backlog, and if none
+    is idle the manager thread starts another. Idle workers past WorkIdleKeep
+    retire one every WorkIdleMs, so a burst of blocking items does not leave
+    its workers behind.
+*/
+#define WorkPoolMaxWorkers 32   /*Per pool, past this the backlog waits for a running worker*/
+#define WorkIdleKeep       2    /*Idle workers a pool holds on to*/
+#define WorkIdleMs         1000 /*Between two retirements of surplus idle workers*/
+
+#define WorkqueueBound   0
+#define WorkqueueUnbound 1
+
+struct Work;
+struct WorkPool;
+
+typedef void (*WorkFunc)(struct Work* __Work__);
+
+typedef struct Work
+{
+    WorkFunc         Func;
+    void*            Arg;
+    struct Work*     Next;     /*Pool backlog*/
+    struct WorkPool* Pool;     /*Last queued on, FlushWork waits there*/
+    uint32_t         Pending;  /*From queueing until a worker takes it, queueing again is a no-op*/
+    uint64_t         QueuedAt; /*GetSystemNanos when it reached the pool*/
+
+} Work;
+
+typedef struct
+{
+    Work     Work;
+    KTimer   Timer; /*On the wheel of the CPU that queued it until the delay is up*/
+    uint32_t Cpu;
+
+} DelayedWork;
+
+typedef struct
+{
+    const char* Name;
+    uint32_t    Type; /*WorkqueueBound or WorkqueueUnbound*/
+    uint64_t    Queued;
+
+} Workqueue;
+
+typedef struct KWorker
+{
+    Thread*          Thread;
+    struct WorkPool* Pool;
+    Work*            Current;  /*Item being run, it is not touched again once Func returns*/
+    uint32_t         Waking;   /*Counted in Pool->Waking until it looks at the backlog*/
+    uint32_t         Retire;   /*Taken off the idle list to exit*/
+    struct KWorker*  Next;     /*Every worker of the pool*/
+    struct KWorker*  IdleNext; /*Idle list, most recently idle first*/
+
+} KWorker;
+
+typedef struct WorkPool
+{
+    SpinLock Lock;
+    Work*    Head;
+    Work*    Tail;
+    KWorker* Workers;
+    KWorker* IdleList;
+    Thread*  Flushers;    /*FlushWork callers, linked through WaitNext*/
+    uint32_t Cpu;         /*Bound CPU, MaxCPUs for the unbound pool*/
+    uint32_t Concurrency; /*Workers it wants running items at once*/
+    uint32_t Count;
+    uint32_t Idle;
+    uint32_t Running;     /*Inside an item and not blocked*/
+    uint32_t Waking;      /*Started or unblocked, not at the backlog yet*/
+    uint32_t NeedWorker;  /*The manager has been asked for one more*/
+    uint32_t IdleArmed;
+    KTimer   IdleTimer;
+
+    /*Statistics*/
+    uint64_t Queued;
+    uint64_t Executed;
+    uint64_t Created;
+    uint64_t Retired;
+    uint64_t LatencyNs; /*Queued to picked up, summed over Executed*/
+    uint64_t LatencyMaxNs;
+
+} WorkPool;
+
+extern WorkPool  WorkPools[MaxCPUs];
+extern WorkPool  UnboundPool;
+extern Workqueue SystemWq;
+extern Workqueue SystemUnboundWq;
+
+void InitializeWorkqueues(SysErr* __Err__);
+void InitWork(Work* __Work__, WorkFunc __Func__, void* __Arg__);
+void InitDelayedWork(DelayedWork* __Work__, WorkFunc __Func__, void* __Arg__);
+void InitWorkqueue(Workqueue* __Queue__, const char* __Name__, uint32_t __Type__);
+int  QueueWork(Workqueue* __Queue__, Work* __Work__);
+int  QueueWorkOn(uint32_t __CpuId__, Workqueue* __Queue__, Work* __Work__);
+int  QueueDelayedWork(Workqueue* __Queue__, DelayedWork* __Work__, uint64_t __Milliseconds__);
+int  CancelDelayedWork(DelayedWork* __Work__);
+void FlushWork(Work* __Work__);
+
+/*Scheduler hooks, called by ThreadBlock and ThreadSleep for ThreadFlagWorker threads*/
+void WorkerSleeping(Thread* __ThreadPtr__);
+void WorkerWaking(Thread* __ThreadPtr__);
+
+KEXPORT(InitWork);
+KEXPORT(InitDelayedWork);
+KEXPORT(InitWorkqueue);
+KEXPORT(QueueWork);
+KEXPORT(QueueWorkOn);
+KEXPORT(QueueDelayedWork);
+KEXPORT(CancelDelayedWork);
+KEXPORT(FlushWork);
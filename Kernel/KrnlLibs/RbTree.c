@@ -0,0 +1,311 @@
+#include <RbTree.h>
+
+static inline int
+__RbIsBlack__(RbNode* __Node__)
+{
+    return !__Node__ || __Node__->Color == RbBlack;
+}
+
+/* Point whatever held __Old__ (its parent or the root) at __New__ */
+static inline void
+__RbReplaceChild__(RbTree* __Tree__, RbNode* __Parent__, RbNode* __Old__, RbNode* __New__)
+{
+    if (!__Parent__)
+    {
+        __Tree__->Root = __New__;
+    }
+    else if (__Parent__->Left == __Old__)
+    {
+        __Parent__->Left = __New__;
+    }
+    else
+    {
+        __Parent__->Right = __New__;
+    }
+}
+
+static void
+__RbRotateLeft__(RbTree* __Tree__, RbNode* __Node__)
+{
+    RbNode* Right = __Node__->Right;
+
+    __Node__->Right = Right->Left;
+    if (Right->Left)
+    {
+        Right->Left->Parent = __Node__;
+    }
+
+    Right->Parent = __Node__->Parent;
+    __RbReplaceChild__(__Tree__, __Node__->Parent, __Node__, Right);
+
+    Right->Left      = __Node__;
+    __Node__->Parent = Right;
+}
+
+static void
+__RbRotateRight__(RbTree* __Tree__, RbNode* __Node__)
+{
+    RbNode* Left = __Node__->Left;
+
+    __Node__->Left = Left->Right;
+    if (Left->Right)
+    {
+        Left->Right->Parent = __Node__;
+    }
+
+    Left->Parent = __Node__->Parent;
+    __RbReplaceChild__(__Tree__, __Node__->Parent, __Node__, Left);
+
+    Left->Right      = __Node__;
+    __Node__->Parent = Left;
+}
+
+void
+RbInsert(RbTree* __Tree__, RbNode* __Node__, int __Leftmost__)
+{
+    if (__Leftmost__)
+    {
+        __Tree__->Leftmost = __Node__;
+    }
+
+    RbNode* Node = __Node__;
+    RbNode* Parent;
+
+    while ((Parent = Node->Parent) && Parent->Color == RbRed)
+    {
+        /*A red parent is never the root, so the grandparent exists*/
+        RbNode* Grand = Parent->Parent;
+
+        if (Parent == Grand->Left)
+        {
+            RbNode* Uncle = Grand->Right;
+            if (Uncle && Uncle->Color == RbRed)
+            {
+                Parent->Color = RbBlack;
+                Uncle->Color  = RbBlack;
+                Grand->Color  = RbRed;
+                Node          = Grand;
+                continue;
+            }
+
+            if (Node == Parent->Right)
+            {
+                __RbRotateLeft__(__Tree__, Parent);
+                Node   = Parent;
+                Parent = Node->Parent;
+            }
+
+            Parent->Color = RbBlack;
+            Grand->Color  = RbRed;
+            __RbRotateRight__(__Tree__, Grand);
+        }
+        else
+        {
+            RbNode* Uncle = Grand->Left;
+            if (Uncle && Uncle->Color == RbRed)
+            {
+                Parent->Color = RbBlack;
+                Uncle->Color  = RbBlack;
+                Grand->Color  = RbRed;
+                Node          = Grand;
+                continue;
+            }
+
+            if (Node == Parent->Left)
+            {
+                __RbRotateRight__(__Tree__, Parent);
+                Node   = Parent;
+                Parent = Node->Parent;
+            }
+
+            Parent->Color = RbBlack;
+            Grand->Color  = RbRed;
+            __RbRotateLeft__(__Tree__, Grand);
+        }
+    }
+
+    __Tree__->Root->Color = RbBlack;
+}
+
+/* __Node__ (possibly NULL) carries an extra black, __Parent__ is where it hangs */
+static void
+__RbEraseFixup__(RbTree* __Tree__, RbNode* __Node__, RbNode* __Parent__)
+{
+    RbNode* Node   = __Node__;
+    RbNode* Parent = __Parent__;
+    RbNode* Other;
+
+    while (__RbIsBlack__(Node) && Node != __Tree__->Root)
+    {
+        if (Parent->Left == Node)
+        {
+            Other = Parent->Right;
+            if (Other->Color == RbRed)
+            {
+                Other->Color  = RbBlack;
+                Parent->Color = RbRed;
+                __RbRotateLeft__(__Tree__, Parent);
+                Other = Parent->Right;
+            }
+
+            if (__RbIsBlack__(Other->Left) && __RbIsBlack__(Other->Right))
+            {
+                Other->Color = RbRed;
+                Node         = Parent;
+                Parent       = Node->Parent;
+                continue;
+            }
+
+            if (__RbIsBlack__(Other->Right))
+            {
+                Other->Left->Color = RbBlack;
+                Other->Color       = RbRed;
+                __RbRotateRight__(__Tree__, Other);
+                Other = Parent->Right;
+            }
+
+            Other->Color        = Parent->Color;
+            Parent->Color       = RbBlack;
+            Other->Right->Color = RbBlack;
+            __RbRotateLeft__(__Tree__, Parent);
+            Node = __Tree__->Root;
+            break;
+        }
+        else
+        {
+            Other = Parent->Left;
+            if (Other->Color == RbRed)
+            {
+                Other->Color  = RbBlack;
+                Parent->Color = RbRed;
+                __RbRotateRight__(__Tree__, Parent);
+                Other = Parent->Left;
+            }
+
+            if (__RbIsBlack__(Other->Left) && __RbIsBlack__(Other->Right))
+            {
+                Other->Color = RbRed;
+                Node         = Parent;
+                Parent       = Node->Parent;
+                continue;
+            }
+
+            if (__RbIsBlack__(Other->Left))
+            {
+                Other->Right->Color = RbBlack;
+                Other->Color        = RbRed;
+                __RbRotateLeft__(__Tree__, Other);
+                Other = Parent->Left;
+            }
+
+            Other->Color       = Parent->Color;
+            Parent->Color      = RbBlack;
+            Other->Left->Color = RbBlack;
+            __RbRotateRight__(__Tree__, Parent);
+            Node = __Tree__->Root;
+            break;
+        }
+    }
+
+    if (Node)
+    {
+        Node->Color = RbBlack;
+    }
+}
+
+void
+RbErase(RbTree* __Tree__, RbNode* __Node__)
+{
+    if (__Tree__->Leftmost == __Node__)
+    {
+        __Tree__->Leftmost = RbNext(__Node__);
+    }
+
+    RbNode*  Node = __Node__;
+    RbNode*  Child;
+    RbNode*  Parent;
+    uint32_t Color;
+
+    if (Node->Left && Node->Right)
+    {
+        /*Two children: the in-order successor takes the node's place and colour*/
+        RbNode* Old = Node;
+
+        Node = Node->Right;
+        while (Node->Left)
+        {
+            Node = Node->Left;
+        }
+
+        Child  = Node->Right;
+        Parent = Node->Parent;
+        Color  = Node->Color;
+
+        if (Child)
+        {
+            Child->Parent = Parent;
+        }
+        __RbReplaceChild__(__Tree__, Parent, Node, Child);
+
+        if (Node->Parent == Old)
+        {
+            Parent = Node;
+        }
+
+        Node->Parent = Old->Parent;
+        Node->Color  = Old->Color;
+        Node->Right  = Old->Right;
+        Node->Left   = Old->Left;
+        __RbReplaceChild__(__Tree__, Old->Parent, Old, Node);
+
+        Old->Left->Parent = Node;
+        if (Old->Right)
+        {
+            Old->Right->Parent = Node;
+        }
+    }
+    else
+    {
+        Child  = Node->Left ? Node->Left : Node->Right;
+        Parent = Node->Parent;
+        Color  = Node->Color;
+
+        if (Child)
+        {
+            Child->Parent = Parent;
+        }
+        __RbReplaceChild__(__Tree__, Parent, Node, Child);
+    }
+
+    if (Color == RbBlack)
+    {
+        __RbEraseFixup__(__Tree__, Child, Parent);
+    }
+
+    __Node__->Parent = NULL;
+    __Node__->Left   = NULL;
+    __Node__->Right  = NULL;
+}
+
+RbNode*
+RbNext(RbNode* __Node__)
+{
+    RbNode* Node = __Node__;
+
+    if (Node->Right)
+    {
+        Node = Node->Right;
+        while (Node->Left)
+        {
+            Node = Node->Left;
+        }
+        return Node;
+    }
+
+    RbNode* Parent;
+    while ((Parent = Node->Parent) && Node == Parent->Right)
+    {
+        Node = Parent;
+    }
+    return Parent;
+}
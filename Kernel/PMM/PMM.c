@@ -203,6 +203,67 @@ FreePages(uint64_t __PhysAddr__, size_t __Count__, SysErr* __Err__)
     }
 }
 
+uint64_t
+AllocHugePage(void)
+{
+    if (Pmm.Stats.FreePages < PmmHugeFrames)
+    {
+        return Nothing;
+    }
+
+    /*A 2MB aligned window is exactly 8 bitmap words, so test whole words.
+      Window 0 is skipped since physical 0 is never handed out*/
+    uint64_t Words = PmmHugeFrames / BitsPerUint64;
+
+    for (uint64_t StartIndex = PmmHugeFrames; StartIndex + PmmHugeFrames <= Pmm.TotalPages;
+         StartIndex += PmmHugeFrames)
+    {
+        uint64_t Word  = StartIndex / BitsPerUint64;
+        int      Found = 1;
+
+        for (uint64_t Index = 0; Index < Words; Index++)
+        {
+            if (Pmm.Bitmap[Word + Index])
+            {
+                Found = 0;
+                break;
+            }
+        }
+
+        if (!Found)
+        {
+            continue;
+        }
+
+        for (uint64_t Index = 0; Index < Words; Index++)
+        {
+            Pmm.Bitmap[Word + Index] = ~0ULL;
+        }
+
+        Pmm.Stats.UsedPages += PmmHugeFrames;
+        Pmm.Stats.FreePages -= PmmHugeFrames;
+
+        uint64_t PhysAddr = StartIndex * PageSize;
+        PDebug("Allocated huge page at: 0x%016lx\n", PhysAddr);
+
+        return PhysAddr;
+    }
+
+    return Nothing;
+}
+
+void
+FreeHugePage(uint64_t __PhysAddr__, SysErr* __Err__)
+{
+    if ((__PhysAddr__ % (PmmHugeFrames * PageSize)) != 0)
+    {
+        SlotError(__Err__, -NotCanonical);
+        return;
+    }
+
+    FreePages(__PhysAddr__, PmmHugeFrames, __Err__);
+}
+
 int
 PmmValidatePage(uint64_t __PhysAddr__)
 {
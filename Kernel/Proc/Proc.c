@@ -1,6 +1,7 @@
 #include <AllTypes.h>
 #include <AxeSchd.h>
 #include <AxeThreads.h>
+#include <Fpu.h>
 #include <KHeap.h>
 #include <KrnPrintf.h>
 #include <POSIXFd.h>
@@ -36,6 +37,7 @@ static int        __DetachThread__(PosixProc* __Proc__);
 /*static int __CloneSpace__(VirtualMemorySpace*  __Src__,
                                                VirtualMemorySpace** __Out__);*/
 static int  __ForkCopyFds__(PosixProc* __Parent__, PosixProc* __Child__);
+static int  __ForkCopyMapRecs__(PosixProc* __Parent__, PosixProc* __Child__);
 static int  __SetDefaultFds__(PosixProc* __Proc__);
 static int  __BuildArgsEnv__(const char* const* __Argv__,
                              const char* const* __Envp__,
@@ -43,6 +45,7 @@ static int  __BuildArgsEnv__(const char* const* __Argv__,
                              PosixProc*         __Proc__);
 static int  __PopulateTimesStart__(PosixProc* __Proc__);
 static int  __UpdateTimesOnExit__(PosixProc* __Proc__);
+static int  __SumSchedStat__(PosixProc* __Proc__, PosixSchedStat* __Out__);
 static int  __CreateTableIfNeeded__(void);
 static int  __TableInsert__(PosixProc* __Proc__);
 static int  __TableRemove__(PosixProc* __Proc__);
@@ -53,6 +56,8 @@ static int  __EnsureCwdRoot__(PosixProc* __Proc__);
 static void __WakeParent__(PosixProc* __Parent__, PosixProc* __Child__, SysErr* __Err__);
 static int  __DeliverPendingSignals__(PosixProc* __Proc__);
 
+static PosixProc* __PidLookup__(long __Pid__);
+
 static inline long
 __Min__(long a, long IdxUal)
 {
@@ -105,7 +110,7 @@ __CurrentProc__(void)
     {
         return Error_TO_Pointer(-BadEntity);
     }
-    return PosixFind((long)Thrd->ProcessId);
+    return Thrd->Proc ? Thrd->Proc : PosixFind((long)Thrd->ProcessId);
 }
 
 PosixProc*
@@ -264,6 +269,7 @@ PosixProcExecve(PosixProc*         __Proc__,
         Th->State         = ThreadStateReady;
         Th->PageDirectory = (uint64_t)__Proc__->Space->PhysicalBase;
         Th->ProcessId     = __Proc__->Pid;
+        Th->Proc          = __Proc__;
 
         if (__AttachThread__(__Proc__, Th) != SysOkay)
         {
@@ -291,6 +297,7 @@ PosixProcExecve(PosixProc*         __Proc__,
         Th->State         = ThreadStateReady;
         Th->PageDirectory = (uint64_t)__Proc__->Space->PhysicalBase;
         Th->ProcessId     = __Proc__->Pid;
+        Th->Proc          = __Proc__;
 
         PDebug("Thread RIP=0x%llx RSP=0x%llx PD=0x%llx\n",
                (unsigned long long)Th->Context.Rip,
@@ -337,10 +344,11 @@ PosixFork(PosixProc* __Parent__, PosixProc** __OutChild__)
         return -BadEntity;
     }
 
-    Child->Ppid = __Parent__->Pid;
-    Child->Pgrp = __Parent__->Pgrp;
-    Child->Sid  = __Parent__->Sid;
-    Child->Cred = __Parent__->Cred;
+    Child->Ppid     = __Parent__->Pid;
+    Child->Pgrp     = __Parent__->Pgrp;
+    Child->Sid      = __Parent__->Sid;
+    Child->Cred     = __Parent__->Cred;
+    Child->MmapNext = __Parent__->MmapNext;
     strcpy(Child->Cwd, __Parent__->Cwd, MaxPathLen);
     strcpy(Child->Root, __Parent__->Root, MaxPathLen);
 
@@ -349,6 +357,11 @@ PosixFork(PosixProc* __Parent__, PosixProc** __OutChild__)
         PosixExit(Child, -1);
         return -ErrReturn;
     }
+    if (__ForkCopyMapRecs__(__Parent__, Child) != SysOkay)
+    {
+        PosixExit(Child, -1);
+        return -BadAlloc;
+    }
 
     Thread* Pth = __Parent__->MainThread;
     Thread* Cth = CreateThread(ThreadTypeUser, (void*)__ParentRip__, NULL, Pth->Priority);
@@ -370,6 +383,10 @@ PosixFork(PosixProc* __Parent__, PosixProc** __OutChild__)
     Cth->State          = ThreadStateReady;
     Cth->PageDirectory  = (uint64_t)Child->Space->PhysicalBase;
     Cth->ProcessId      = (uint32_t)Child->Pid;
+    Cth->Proc           = Child;
+    Cth->Policy         = Pth->Policy;
+    Cth->RtPriority     = Pth->RtPriority;
+    FpuCopyState(Cth, Pth);
 
     SysErr  err;
     SysErr* Error = &err;
@@ -405,29 +422,86 @@ PosixFork(PosixProc* __Parent__, PosixProc** __OutChild__)
                 uint64_t __Pde__ = __Pd__[l2];
                 if (!(__Pde__ & PTEPRESENT))
                 {
+                    /* Untouched lazy run, the child reserves the same */
+                    if (__Pde__ & PTELAZY)
+                    {
+                        ReserveUserRange(Child->Space,
+                                         (l4 << 39) | (l3 << 30) | (l2 << 21),
+                                         HugePageSize,
+                                         __Pde__ & (PTEWRITABLE | PTEUSER | PTENOEXECUTE |
+                                                    PTESEQUENTIAL | PTEGROWSDOWN));
+                    }
                     continue;
                 }
                 if (__Pde__ & (1ULL << 7))
                 {
-                    continue; /* skip huge */
+                    uint64_t __HugeVa__ = ((l4 << 39) | (l3 << 30) | (l2 << 21));
+                    if (!(__Pde__ & PTEUSER) || !__IsUserVa__(__HugeVa__))
+                    {
+                        continue; /* kernel huge */
+                    }
+
+                    uint64_t __SrcHuge__ = __Pde__ & 0x000FFFFFFFE00000ULL;
+                    uint64_t __NewHuge__ = AllocHugePage();
+                    if (__NewHuge__ == 0)
+                    {
+                        PosixExit(Child, -1);
+                        return -NotCanonical;
+                    }
+
+                    memcpy(PhysToVirt(__NewHuge__),
+                           PhysToVirt(__SrcHuge__),
+                           (size_t)HugePageSize);
+
+                    uint64_t __HugeFlags__ =
+                        __Pde__ & (PTEWRITABLE | PTEUSER | PTEWRITETHROUGH | PTECACHEDISABLE |
+                                   PTEACCESSED | PTEDIRTY | PTENOEXECUTE);
+
+                    if (MapHugePage(Child->Space, __HugeVa__, __NewHuge__, __HugeFlags__) !=
+                        SysOkay)
+                    {
+                        FreeHugePage(__NewHuge__, Error);
+                    }
+                    continue;
                 }
                 uint64_t* __Pt__ = (uint64_t*)PhysToVirt(__Pde__ & ~0xFFFULL);
 
                 for (uint64_t l1 = 0; l1 < 512; l1++)
                 {
                     uint64_t __Leaf__ = __Pt__[l1];
+                    uint64_t __Va__   = ((l4 << 39) | (l3 << 30) | (l2 << 21) | (l1 << 12));
+                    if (!(__Leaf__ & PTEPRESENT) && (__Leaf__ & PTELAZY))
+                    {
+                        ReserveUserRange(Child->Space,
+                                         __Va__,
+                                         PageSize,
+                                         __Leaf__ & (PTEWRITABLE | PTEUSER | PTENOEXECUTE |
+                                                     PTESEQUENTIAL | PTEGROWSDOWN));
+                        continue;
+                    }
                     if (!(__Leaf__ & PTEPRESENT) || !(__Leaf__ & PTEUSER))
                     {
                         continue;
                     }
 
-                    uint64_t __Va__ = ((l4 << 39) | (l3 << 30) | (l2 << 21) | (l1 << 12));
                     if (!__IsUserVa__(__Va__))
                     {
                         continue;
                     }
 
                     uint64_t __SrcPhys__ = __Leaf__ & 0x000FFFFFFFFFF000ULL;
+
+                    /* Borrowed file pages are shared as is, a private write still COWs */
+                    if (__Leaf__ & PTEBORROWED)
+                    {
+                        VirtMapPage(Child->Space,
+                                    __Va__,
+                                    __SrcPhys__,
+                                    __Leaf__ & (PTEWRITABLE | PTEUSER | PTEPRESENT | PTENOEXECUTE |
+                                                PTEBORROWED | PTECOW | PTESHARED));
+                        continue;
+                    }
+
                     uint64_t __NewPhys__ = AllocPage();
                     if (__NewPhys__ == 0)
                     {
@@ -483,40 +557,47 @@ PosixExit(PosixProc* __Proc__, int __Status__)
 
     __UpdateTimesOnExit__(__Proc__);
 
-    AcquireSpinLock(&ThreadListLock, Error);
-
     /* clear per-CPU current thread references */
     for (uint32_t CpuIndex = 0; CpuIndex < MaxCPUs; CpuIndex++)
     {
-        Thread* Ct = CurrentThreads[CpuIndex];
+        Thread* Ct = CpuDataArray[CpuIndex].CurrentThread;
         if (Ct && (long)Ct->ProcessId == __Proc__->Pid)
         {
-            CurrentThreads[CpuIndex] = NULL;
+            CpuDataArray[CpuIndex].CurrentThread = NULL;
         }
     }
 
     __DetachThread__(__Proc__);
 
-    Thread* ThreadPtr = ThreadList;
-    while (ThreadPtr)
+    /* DestroyThread takes ThreadListLock itself, so find one, drop the lock, destroy, repeat */
+    for (;;)
     {
-        Thread* NextThread = ThreadPtr->Next;
-        if ((long)ThreadPtr->ProcessId == __Proc__->Pid)
+        AcquireSpinLock(&ThreadListLock, Error);
+        Thread* ThreadPtr = ThreadList;
+        while (ThreadPtr && (long)ThreadPtr->ProcessId != __Proc__->Pid)
         {
-            ThreadPtr->State = ThreadStateTerminated;
-            DestroyThread(ThreadPtr, Error);
-            PSuccess("Destroyed ThreadId=%u of Pid=%u\n", ThreadPtr->ThreadId, __Proc__->Pid);
+            ThreadPtr = ThreadPtr->ListNext;
         }
-        ThreadPtr = NextThread;
-    }
+        ReleaseSpinLock(&ThreadListLock, Error);
 
-    ReleaseSpinLock(&ThreadListLock, Error);
+        if (!ThreadPtr)
+        {
+            break;
+        }
 
+        PSuccess("Destroying ThreadId=%u of Pid=%ld\n", ThreadPtr->ThreadId, __Proc__->Pid);
+        ThreadPtr->State = ThreadStateTerminated;
+        DestroyThread(ThreadPtr, Error);
+    }
+
+    /* The parent may be reaped under us, it is only touched inside the read section */
+    uint64_t   Flags      = RcuReadLock();
     PosixProc* ParentProc = PosixFind(__Proc__->Ppid);
-    if (ParentProc)
+    if (!Probe_IF_Error(ParentProc) && ParentProc)
     {
         __WakeParent__(ParentProc, __Proc__, Error);
     }
+    RcuReadUnlock(Flags);
 
     PSuccess("Exited with Pid=%ld Status=%d\n", __Proc__->Pid, __Status__);
     return SysOkay;
@@ -538,44 +619,50 @@ PosixWait4(PosixProc*   __Parent__,
 
     for (;;)
     {
-        for (long I = 1; I <= MaxProcs; I++)
+        /* One pass over the live table, a matching zombie is taken out once the lock is dropped */
+        PosixProc* P = NULL;
+        SysErr     err;
+        SysErr*    Error = &err;
+
+        AcquireSpinLock(&PosixProcs.Lock, Error);
+        for (long I = 0; I < PosixProcs.Count; I++)
         {
-            PosixProc* P = PosixFind(I);
-            if (Probe_IF_Error(P) || !P || P->Ppid != __Parent__->Pid)
+            P = PosixProcs.Items[I];
+            if (!P || P->Ppid != __Parent__->Pid || (TargetPid > 0 && P->Pid != TargetPid))
             {
                 continue;
             }
-            if (TargetPid > 0 && P->Pid != TargetPid)
+            if (P->Zombie)
             {
-                continue;
+                break;
             }
+            P = NULL;
+        }
+        ReleaseSpinLock(&PosixProcs.Lock, Error);
 
-            if (P->Zombie)
+        if (P)
+        {
+            if (__OutStatus__)
             {
-                if (__OutStatus__)
-                {
-                    *__OutStatus__ = P->ExitCode;
-                }
-                if (__OutUsage__)
-                {
-                    __OutUsage__->UtimeUsec       = P->Times.UserUsec;
-                    __OutUsage__->StimeUsec       = P->Times.SysUsec;
-                    __OutUsage__->MaxRss          = RlimitMaxRss;
-                    __OutUsage__->MinorFaults     = 0;
-                    __OutUsage__->MajorFaults     = 0;
-                    __OutUsage__->VoluntaryCtxt   = 0;
-                    __OutUsage__->InvoluntaryCtxt = 0;
-                }
-
-                long ReapedId = P->Pid;
-                ProcFsNotifyProcRemoved(P);
-                __TableRemove__(P);
-                SysErr  err;
-                SysErr* Error = &err;
-                __FreeProc__(P, Error);
-                PSuccess("Reaped=%ld\n", ReapedId);
-                return ReapedId;
+                *__OutStatus__ = P->ExitCode;
+            }
+            if (__OutUsage__)
+            {
+                __OutUsage__->UtimeUsec       = P->Times.UserUsec;
+                __OutUsage__->StimeUsec       = P->Times.SysUsec;
+                __OutUsage__->MaxRss          = RlimitMaxRss;
+                __OutUsage__->MinorFaults     = 0;
+                __OutUsage__->MajorFaults     = 0;
+                __OutUsage__->VoluntaryCtxt   = P->Sched.VoluntaryCtxt;
+                __OutUsage__->InvoluntaryCtxt = P->Sched.InvoluntaryCtxt;
             }
+
+            long ReapedId = P->Pid;
+            ProcFsNotifyProcRemoved(P);
+            __TableRemove__(P);
+            __FreeProc__(P, Error);
+            PSuccess("Reaped=%ld\n", ReapedId);
+            return ReapedId;
         }
 
         if (__Options__ & WNOHANG)
@@ -588,8 +675,6 @@ PosixWait4(PosixProc*   __Parent__,
             __Parent__->MainThread->State      = ThreadStateBlocked;
             __Parent__->MainThread->WaitReason = WaitReasonChild;
         }
-        SysErr  err;
-        SysErr* Error = &err;
         ThreadYield(Error);
     }
 }
@@ -708,26 +793,33 @@ PosixGetTty(PosixProc* __Proc__, char* __Out__, long __Len__)
 int
 PosixKill(long __Pid__, int __Sig__)
 {
-    PosixProc* P = PosixFind(__Pid__);
-    if (Probe_IF_Error(P) || !P)
+    /* Posted inside the read section, the process cannot be freed under us */
+    uint64_t   Flags = RcuReadLock();
+    PosixProc* P     = __PidLookup__(__Pid__);
+    if (P)
     {
-        return -NoSuch;
+        __atomic_fetch_or(&P->SigPending, 1ULL << (__Sig__ & 63), __ATOMIC_RELEASE);
     }
-    /* Enqueue signal bit */
-    P->SigPending |= (1ULL << (__Sig__ & 63));
-    return SysOkay;
+    RcuReadUnlock(Flags);
+
+    return P ? SysOkay : -NoSuch;
 }
 
 int
 PosixTkill(long __Tid__, int __Sig__)
 {
-    /* Map TID to thread->ProcessId then call kill */
-    Thread* Th = FindThreadById((uint32_t)__Tid__);
+    /* Map TID to thread->ProcessId then call kill, the thread may be freed once we unlock */
+    uint64_t Flags = RcuReadLock();
+    Thread*  Th    = FindThreadById((uint32_t)__Tid__);
     if (Probe_IF_Error(Th) || !Th)
     {
+        RcuReadUnlock(Flags);
         return -BadEntity;
     }
-    return PosixKill((long)Th->ProcessId, __Sig__);
+    long Pid = (long)Th->ProcessId;
+    RcuReadUnlock(Flags);
+
+    return PosixKill(Pid, __Sig__);
 }
 
 int
@@ -832,18 +924,37 @@ PosixSigqueue(long __Pid__, int __Sig__, int __Value__)
 int
 PosixDeliverSignals(void)
 {
-    for (long I = 1; I <= MaxProcs; I++)
+    /* Removals wait for this section to end, so every entry seen stays valid */
+    uint64_t Flags = RcuReadLock();
+    for (long I = 0; I < __atomic_load_n(&PosixProcs.Count, __ATOMIC_ACQUIRE); I++)
     {
-        PosixProc* P = PosixFind(I);
-        if (Probe_IF_Error(P) || !P)
+        PosixProc* P = __atomic_load_n(&PosixProcs.Items[I], __ATOMIC_ACQUIRE);
+        if (P)
         {
-            continue;
+            __DeliverPendingSignals__(P);
         }
-        __DeliverPendingSignals__(P);
     }
+    RcuReadUnlock(Flags);
     return SysOkay;
 }
 
+/* Caller is inside RcuReadLock */
+static PosixProc*
+__PidLookup__(long __Pid__)
+{
+    PosixProc* P =
+        __atomic_load_n(&PosixProcs.Hash[__Pid__ & (PosixPidBuckets - 1)], __ATOMIC_ACQUIRE);
+    while (P && P->Pid != __Pid__)
+    {
+        P = __atomic_load_n(&P->HashNext, __ATOMIC_ACQUIRE);
+    }
+    return P;
+}
+
+/*
+    Lock free. Caller is inside RcuReadLock and done with the process before it
+    unlocks, unless it looks up its own process, which outlives its threads.
+*/
 PosixProc*
 PosixFind(long __Pid__)
 {
@@ -851,15 +962,226 @@ PosixFind(long __Pid__)
     {
         return Error_TO_Pointer(-BadArgs);
     }
-    for (long I = 0; I < PosixProcs.Count; I++)
+
+    PosixProc* P = __PidLookup__(__Pid__);
+
+    return P ? P : Error_TO_Pointer(-NoSuch);
+}
+
+/* Summed over the live threads under ThreadListLock */
+static int
+__SumSchedStat__(PosixProc* __Proc__, PosixSchedStat* __Out__)
+{
+    SysErr  err;
+    SysErr* Error = &err;
+
+    memset(__Out__, 0, sizeof(*__Out__));
+    AcquireSpinLock(&ThreadListLock, Error);
+
+    for (Thread* ThreadPtr = ThreadList; ThreadPtr; ThreadPtr = ThreadPtr->ListNext)
     {
-        PosixProc* P = PosixProcs.Items[I];
-        if (P && P->Pid == __Pid__)
+        if ((long)ThreadPtr->ProcessId != __Proc__->Pid)
         {
-            return P;
+            continue;
         }
+        __Out__->RunNs += ThreadPtr->RunNs;
+        __Out__->RunDelayNs += ThreadPtr->RunDelayNs;
+        __Out__->RunCount += ThreadPtr->ContextSwitches;
+        __Out__->VoluntaryCtxt += ThreadPtr->Voluntary;
+        __Out__->InvoluntaryCtxt += ThreadPtr->Involuntary;
     }
-    return Error_TO_Pointer(-NoSuch);
+
+    ReleaseSpinLock(&ThreadListLock, Error);
+    return SysOkay;
+}
+
+/* A zombie keeps what its threads had at exit */
+int
+PosixGetSchedStat(PosixProc* __Proc__, PosixSchedStat* __Out__)
+{
+    if (Probe_IF_Error(__Proc__) || !__Proc__ || Probe_IF_Error(__Out__) || !__Out__)
+    {
+        return -BadArgs;
+    }
+
+    if (__Proc__->Zombie)
+    {
+        *__Out__ = __Proc__->Sched;
+        return SysOkay;
+    }
+    return __SumSchedStat__(__Proc__, __Out__);
+}
+
+int
+PosixMapRecAdd(PosixProc* __Proc__,
+               uint64_t   __Va__,
+               uint64_t   __Len__,
+               long       __Off__,
+               Vnode*     __Node__)
+{
+    if (Probe_IF_Error(__Proc__) || !__Proc__ || Probe_IF_Error(__Node__) || !__Node__ ||
+        __Len__ == 0)
+    {
+        return -BadArgs;
+    }
+
+    SysErr  err;
+    SysErr* Error = &err;
+    AcquireSpinLock(&__Proc__->Lock, Error);
+
+    for (long I = 0; I < PosixMaxMapRecs; I++)
+    {
+        PosixMapRec* R = &__Proc__->MapRecs[I];
+        if (R->Node)
+        {
+            continue;
+        }
+        R->Va   = __Va__;
+        R->Len  = __Len__;
+        R->Off  = __Off__;
+        R->Node = __Node__;
+        ReleaseSpinLock(&__Proc__->Lock, Error);
+        return SysOkay;
+    }
+
+    ReleaseSpinLock(&__Proc__->Lock, Error);
+    return -TooMany;
+}
+
+static void
+__MapRecRelease__(PosixMapRec* __Rec__, uint64_t __Len__)
+{
+    /* Addr is NULL: the fs only needs to know how many pages came back */
+    if (__Rec__->Node->Ops && __Rec__->Node->Ops->Unmap)
+    {
+        __Rec__->Node->Ops->Unmap(__Rec__->Node, NULL, (long)__Len__);
+    }
+}
+
+int
+PosixMapRecDrop(PosixProc* __Proc__, uint64_t __Va__, uint64_t __Len__)
+{
+    if (Probe_IF_Error(__Proc__) || !__Proc__)
+    {
+        return -BadArgs;
+    }
+
+    SysErr  err;
+    SysErr* Error = &err;
+    AcquireSpinLock(&__Proc__->Lock, Error);
+
+    uint64_t End   = (__Va__ + __Len__ < __Va__) ? ~0ULL : (__Va__ + __Len__);
+    long     Spare = -1;
+
+    for (long I = 0; I < PosixMaxMapRecs; I++)
+    {
+        if (!__Proc__->MapRecs[I].Node && Spare < 0)
+        {
+            Spare = I;
+        }
+    }
+
+    /* Punching a hole keeps both halves, which needs a free record up front */
+    for (long I = 0; I < PosixMaxMapRecs; I++)
+    {
+        PosixMapRec* R = &__Proc__->MapRecs[I];
+        if (R->Node && R->Va < __Va__ && R->Va + R->Len > End && Spare < 0)
+        {
+            ReleaseSpinLock(&__Proc__->Lock, Error);
+            return -TooMany;
+        }
+    }
+
+    for (long I = 0; I < PosixMaxMapRecs; I++)
+    {
+        PosixMapRec* R = &__Proc__->MapRecs[I];
+        if (!R->Node)
+        {
+            continue;
+        }
+
+        uint64_t REnd = R->Va + R->Len;
+        uint64_t Lo   = (R->Va > __Va__) ? R->Va : __Va__;
+        uint64_t Hi   = (REnd < End) ? REnd : End;
+        if (Lo >= Hi)
+        {
+            continue;
+        }
+
+        __MapRecRelease__(R, Hi - Lo);
+
+        if (Lo > R->Va && Hi < REnd)
+        {
+            PosixMapRec* Up = &__Proc__->MapRecs[Spare];
+            Up->Va          = Hi;
+            Up->Len         = REnd - Hi;
+            Up->Off         = R->Off + (long)(Hi - R->Va);
+            Up->Node        = R->Node;
+            R->Len          = Lo - R->Va;
+        }
+        else if (Lo > R->Va)
+        {
+            R->Len = Lo - R->Va;
+        }
+        else if (Hi < REnd)
+        {
+            R->Off += (long)(Hi - R->Va);
+            R->Len = REnd - Hi;
+            R->Va  = Hi;
+        }
+        else
+        {
+            memset(R, 0, sizeof(*R));
+        }
+    }
+
+    ReleaseSpinLock(&__Proc__->Lock, Error);
+    return SysOkay;
+}
+
+/* mremap carries whole records along; a record only partly inside the range cannot follow */
+int
+PosixMapRecMove(PosixProc* __Proc__, uint64_t __Va__, uint64_t __Len__, uint64_t __NewVa__)
+{
+    if (Probe_IF_Error(__Proc__) || !__Proc__)
+    {
+        return -BadArgs;
+    }
+
+    SysErr  err;
+    SysErr* Error = &err;
+    AcquireSpinLock(&__Proc__->Lock, Error);
+
+    uint64_t End = __Va__ + __Len__;
+
+    for (long I = 0; I < PosixMaxMapRecs; I++)
+    {
+        PosixMapRec* R = &__Proc__->MapRecs[I];
+        if (R->Node && R->Va < End && R->Va + R->Len > __Va__ &&
+            (R->Va < __Va__ || R->Va + R->Len > End))
+        {
+            ReleaseSpinLock(&__Proc__->Lock, Error);
+            return -BadArgs;
+        }
+    }
+
+    for (long I = 0; I < PosixMaxMapRecs; I++)
+    {
+        PosixMapRec* R = &__Proc__->MapRecs[I];
+        if (R->Node && R->Va >= __Va__ && R->Va + R->Len <= End)
+        {
+            R->Va = __NewVa__ + (R->Va - __Va__);
+        }
+    }
+
+    ReleaseSpinLock(&__Proc__->Lock, Error);
+    return SysOkay;
+}
+
+int
+PosixMapRecFree(PosixProc* __Proc__)
+{
+    return PosixMapRecDrop(__Proc__, 0, ~0ULL);
 }
 
 static int
@@ -906,7 +1228,14 @@ __TableInsert__(PosixProc* __Proc__)
         ReleaseSpinLock(&PosixProcs.Lock, Error);
         return -TooMany;
     }
+    __Proc__->TableIdx                   = PosixProcs.Count;
     PosixProcs.Items[PosixProcs.Count++] = __Proc__;
+
+    /* Fully built by now, lock free readers may find it at once */
+    PosixProc** Bucket = &PosixProcs.Hash[__Proc__->Pid & (PosixPidBuckets - 1)];
+    __Proc__->HashNext = *Bucket;
+    __atomic_store_n(Bucket, __Proc__, __ATOMIC_RELEASE);
+
     ReleaseSpinLock(&PosixProcs.Lock, Error);
     return SysOkay;
 }
@@ -917,22 +1246,33 @@ __TableRemove__(PosixProc* __Proc__)
     SysErr  err;
     SysErr* Error = &err;
     AcquireSpinLock(&PosixProcs.Lock, Error);
-    long idx = -1;
-    for (long I = 0; I < PosixProcs.Count; I++)
-    {
-        if (PosixProcs.Items[I] == __Proc__)
-        {
-            idx = I;
-            break;
-        }
-    }
-    if (idx >= 0)
+
+    long Idx = __Proc__->TableIdx;
+    if (Idx >= 0 && Idx < PosixProcs.Count && PosixProcs.Items[Idx] == __Proc__)
     {
-        PosixProcs.Items[idx]                  = PosixProcs.Items[PosixProcs.Count - 1];
+        PosixProc* Last                        = PosixProcs.Items[PosixProcs.Count - 1];
+        Last->TableIdx                         = Idx;
+        PosixProcs.Items[Idx]                  = Last;
         PosixProcs.Items[PosixProcs.Count - 1] = NULL;
         PosixProcs.Count--;
+        __Proc__->TableIdx = -1;
+    }
+
+    /* Readers already on it keep walking through its HashNext, still intact */
+    PosixProc** Link = &PosixProcs.Hash[__Proc__->Pid & (PosixPidBuckets - 1)];
+    while (*Link && *Link != __Proc__)
+    {
+        Link = &(*Link)->HashNext;
     }
+    if (*Link)
+    {
+        __atomic_store_n(Link, __Proc__->HashNext, __ATOMIC_RELEASE);
+    }
+
     ReleaseSpinLock(&PosixProcs.Lock, Error);
+
+    /* Once lookups that might have found it drain, the caller may free it */
+    SynchronizeRcu();
     return SysOkay;
 }
 
@@ -1010,6 +1350,8 @@ __FreeProc__(PosixProc* __Proc__, SysErr* __Err__)
         __Proc__->EnvironBuf = NULL;
     }
 
+    PosixMapRecFree(__Proc__);
+
     if (__Proc__->Space)
     {
         DestroyVirtualSpace(__Proc__->Space, __Err__);
@@ -1027,6 +1369,7 @@ __AttachThread__(PosixProc* __Proc__, Thread* __Th__)
     }
     __Proc__->MainThread = __Th__;
     __Th__->ProcessId    = (uint32_t)__Proc__->Pid;
+    __Th__->Proc         = __Proc__;
     __Th__->State        = ThreadStateReady;
     return SysOkay;
 }
@@ -1049,6 +1392,37 @@ __DetachThread__(PosixProc* __Proc__)
     return SysOkay;
 }
 
+static int
+__ForkCopyMapRecs__(PosixProc* __Parent__, PosixProc* __Child__)
+{
+    /* The child maps the same lent frames, so it takes its own reference on each page */
+    for (long I = 0; I < PosixMaxMapRecs; I++)
+    {
+        PosixMapRec* R = &__Parent__->MapRecs[I];
+        if (!R->Node || !R->Node->Ops || !R->Node->Ops->Map)
+        {
+            continue;
+        }
+
+        for (uint64_t Done = 0; Done < R->Len; Done += PageSize)
+        {
+            void* Out = NULL;
+            int   Rc  = R->Node->Ops->Map(R->Node, &Out, R->Off + (long)Done, PageSize);
+            if (Rc != SysOkay)
+            {
+                /* This record's references go back, earlier ones leave with the child */
+                if (Done)
+                {
+                    __MapRecRelease__(R, Done);
+                }
+                return Rc;
+            }
+        }
+        __Child__->MapRecs[I] = *R;
+    }
+    return SysOkay;
+}
+
 static int
 __ForkCopyFds__(PosixProc* __Parent__, PosixProc* __Child__)
 {
@@ -1298,7 +1672,9 @@ __UpdateTimesOnExit__(PosixProc* __Proc__)
     uint64_t now = GetSystemTicks();
     uint64_t dur = (now > __Proc__->Times.StartTick) ? (now - __Proc__->Times.StartTick) : 0;
     __Proc__->Times.SysUsec += dur * 1000; /* pretend 1 tick = 1ms */
-    return SysOkay;
+
+    /* The threads are destroyed next, keep their counters for wait4 and /proc */
+    return __SumSchedStat__(__Proc__, &__Proc__->Sched);
 }
 
 static int
@@ -5,6 +5,7 @@
 #include <POSIXFd.h>
 #include <String.h>
 #include <Sync.h>
+#include <SysABI.h>
 #include <VFS.h>
 
 /*Most of all POSIX Shimming live here,
@@ -127,21 +128,61 @@ PosixOpen(PosixFdTable* __Tab__, const char* __Path__, long __Flags__, long __Mo
     }
     SysErr  err;
     SysErr* Error = &err;
-    AcquireSpinLock(&__Tab__->Lock, Error);
-    int NewFd = __FindFreeFd__(__Tab__, 0);
-    if (NewFd < 0)
+
+    /*O_CREAT/O_EXCL are settled against the filesystem before taking a slot*/
+    if (__Flags__ & OpenCreate)
     {
-        ReleaseSpinLock(&__Tab__->Lock, Error);
-        return -TooLess;
+        int Exists = (VfsExists(__Path__) == SysOkay);
+        if (Exists && (__Flags__ & OpenExcl))
+        {
+            return -Redefined;
+        }
+        if (!Exists)
+        {
+            VfsPerm P;
+            P.Mode = __Mode__;
+            P.Uid  = 0;
+            P.Gid  = 0;
+            int Rc = VfsCreate(__Path__, __Flags__, P);
+            if (Rc != SysOkay && Rc != -Redefined)
+            {
+                return Rc;
+            }
+        }
     }
 
     File* F = VfsOpen(__Path__, __Flags__);
     if (Probe_IF_Error(F) || !F)
     {
-        ReleaseSpinLock(&__Tab__->Lock, Error);
         return -BadEntity;
     }
 
+    int NewFd = PosixFdInstall(__Tab__, F, __Flags__);
+    if (NewFd < 0)
+    {
+        VfsClose(F);
+    }
+    return NewFd;
+}
+
+int
+PosixFdInstall(PosixFdTable* __Tab__, File* __File__, long __Flags__)
+{
+    if (Probe_IF_Error(__Tab__) || !__Tab__ || Probe_IF_Error(__File__) || !__File__)
+    {
+        return -BadArgs;
+    }
+    SysErr  err;
+    SysErr* Error = &err;
+    AcquireSpinLock(&__Tab__->Lock, Error);
+    int NewFd = __FindFreeFd__(__Tab__, 0);
+    if (NewFd < 0)
+    {
+        ReleaseSpinLock(&__Tab__->Lock, Error);
+        return -TooLess;
+    }
+
+    File*    F = __File__;
     PosixFd* E = &__Tab__->Entries[NewFd];
     E->Fd      = NewFd;
     E->Flags   = __Flags__;
@@ -468,6 +509,23 @@ PosixFstat(PosixFdTable* __Tab__, int __Fd__, VfsStat* __Out__)
     return R;
 }
 
+File*
+PosixFdFile(PosixFdTable* __Tab__, int __Fd__)
+{
+    SysErr  err;
+    SysErr* Error = &err;
+    AcquireSpinLock(&__Tab__->Lock, Error);
+    PosixFd* E = __GetEntry__(__Tab__, __Fd__);
+    if (Probe_IF_Error(E) || !E || E->Fd < 0 || Probe_IF_Error(E->IsFile) || !E->IsFile)
+    {
+        ReleaseSpinLock(&__Tab__->Lock, Error);
+        return Error_TO_Pointer(-BadEntry);
+    }
+    File* F = (File*)E->Obj;
+    ReleaseSpinLock(&__Tab__->Lock, Error);
+    return F;
+}
+
 int
 PosixMkdir(const char* __Path__, long __Mode__)
 {
@@ -53,7 +53,11 @@ __CurrentProc__(void)
 {
     uint32_t CPU = GetCurrentCpuId();
     Thread*  Th  = GetCurrentThread(CPU);
-    return Th ? PosixFind((long)Th->ProcessId) : Error_TO_Pointer(-NoSuch);
+    if (!Th)
+    {
+        return Error_TO_Pointer(-NoSuch);
+    }
+    return Th->Proc ? Th->Proc : PosixFind((long)Th->ProcessId);
 }
 
 int
@@ -222,6 +226,27 @@ ProcRead(File* __File__, void* __Buf__, long __Len__)
             return (long)StringLength(Buf);
         }
 
+        if (strcmp(Nm, "meminfo") == 0)
+        {
+            return ProcFsMakeMeminfo(Buf, Cap);
+        }
+
+        if (strcmp(Nm, "schedlat") == 0)
+        {
+            return ProcFsMakeSchedlat(Buf, Cap);
+        }
+
+        /* /proc/schedstat has no owner, /proc/<pid>/schedstat carries its proc */
+        if (strcmp(Nm, "schedstat") == 0)
+        {
+            PosixProc* Pr = (PosixProc*)Pn->Priv;
+            if (Probe_IF_Error(Pr) || !Pr)
+            {
+                return ProcFsMakeSchedstat(Buf, Cap);
+            }
+            return ProcFsMakeProcSchedstat(Pr, Buf, Cap);
+        }
+
         if (strcmp(Nm, "stat") == 0)
         {
             PosixProc* Pr = (PosixProc*)Pn->Priv;
@@ -509,7 +534,34 @@ ProcReaddir(Vnode* __Node__, void* __Buf__, long __Len__)
             return sizeof(VfsDirEnt);
         }
 
-        long ListIdx = Base - 2;
+        if (Base == 2)
+        {
+            strcpy(Ent->Name, "meminfo", 256);
+            Ent->Type = VNodeFILE;
+            Ent->Ino  = Pn->Ino + 3;
+            __AdvanceCursor__(Cur);
+            return sizeof(VfsDirEnt);
+        }
+
+        if (Base == 3)
+        {
+            strcpy(Ent->Name, "schedstat", 256);
+            Ent->Type = VNodeFILE;
+            Ent->Ino  = Pn->Ino + 4;
+            __AdvanceCursor__(Cur);
+            return sizeof(VfsDirEnt);
+        }
+
+        if (Base == 4)
+        {
+            strcpy(Ent->Name, "schedlat", 256);
+            Ent->Type = VNodeFILE;
+            Ent->Ino  = Pn->Ino + 5;
+            __AdvanceCursor__(Cur);
+            return sizeof(VfsDirEnt);
+        }
+
+        long ListIdx = Base - 5;
         long Seen    = 0;
 
         for (long pid = 1; pid < ProcMaxPIDS; pid++)
@@ -648,12 +700,51 @@ ProcReaddir(Vnode* __Node__, void* __Buf__, long __Len__)
             __AdvanceCursor__(Cur);
             return sizeof(VfsDirEnt);
         }
+        if (LocalIdx == 10)
+        {
+            strcpy(Ent->Name, "schedstat", 256);
+            Ent->Type = VNodeFILE;
+            Ent->Ino  = Pn->Ino + 11;
+            __AdvanceCursor__(Cur);
+            return sizeof(VfsDirEnt);
+        }
 
         __ResetCursor__(Cur);
         return Nothing;
     }
 }
 
+static Vnode*
+__NewRootFile__(ProcFsNode* __Root__, const char* __Name__, long __InoOff__)
+{
+    ProcFsNode* F = (ProcFsNode*)KMalloc(sizeof(ProcFsNode));
+    if (Probe_IF_Error(F) || !F)
+    {
+        return Error_TO_Pointer(-BadAlloc);
+    }
+    memset(F, 0, sizeof(*F));
+    F->Kind      = ProcFsNodeFile;
+    F->Name      = (char*)__Name__;
+    F->Ino       = __Root__->Ino + __InoOff__;
+    F->Perm.Mode = VModeRUSR | VModeRGRP | VModeROTH;
+
+    Vnode* N = (Vnode*)KMalloc(sizeof(Vnode));
+    if (Probe_IF_Error(N) || !N)
+    {
+        SysErr  err;
+        SysErr* Error = &err;
+        KFree(F, Error);
+        return Error_TO_Pointer(-BadAlloc);
+    }
+    memset(N, 0, sizeof(*N));
+    N->Type   = VNodeFILE;
+    N->Ops    = &__ProcFsOps__;
+    N->Sb     = ProcSuper;
+    N->Priv   = F;
+    N->Refcnt = 1;
+    return N;
+}
+
 Vnode*
 ProcLookup(Vnode* __Dir__, const char* __Name__)
 {
@@ -726,6 +817,21 @@ ProcLookup(Vnode* __Dir__, const char* __Name__)
             return N;
         }
 
+        if (strcmp(__Name__, "meminfo") == 0)
+        {
+            return __NewRootFile__(Pn, "meminfo", 3);
+        }
+
+        if (strcmp(__Name__, "schedstat") == 0)
+        {
+            return __NewRootFile__(Pn, "schedstat", 4);
+        }
+
+        if (strcmp(__Name__, "schedlat") == 0)
+        {
+            return __NewRootFile__(Pn, "schedlat", 5);
+        }
+
         long pid = atol(__Name__);
         if (pid > 0 && pid < ProcMaxPIDS)
         {
@@ -816,8 +922,9 @@ ProcLookup(Vnode* __Dir__, const char* __Name__)
                             "cwd",
                             "root",
                             "cmdline",
-                            "environ"};
-        for (long KIdx = 0; KIdx < 10; KIdx++)
+                            "environ",
+                            "schedstat"};
+        for (long KIdx = 0; KIdx < 11; KIdx++)
         {
             if (strcmp(__Name__, Fn[KIdx]) == 0)
             {
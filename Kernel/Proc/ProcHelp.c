@@ -1,10 +1,15 @@
 #include <AllTypes.h>
+#include <AxeSchd.h>
 #include <KHeap.h>
 #include <KrnPrintf.h>
 #include <POSIXFd.h>
 #include <POSIXProc.h>
 #include <POSIXSignals.h>
+#include <SMP.h>
+#include <ShmFs.h>
 #include <String.h>
+#include <Timer.h>
+#include <VMM.h>
 
 static inline long
 __AppendStr__(char* __Buf__, long __Cap__, long* __Off__, const char* __Str__)
@@ -199,6 +204,14 @@ ProcFsMakeStatus(PosixProc* __Proc__, char* __Buff__, long __Caps__)
     __AppendChar__(__Buff__, __Caps__, &N, '\n');
     PDebug("Status SigCgt N=%ld", N);
 
+    /* Committed part of the 8MB stack reservation */
+    uint64_t StkPages = CountUserRange(__Proc__->Space, UserStackLow, UserStackReserve);
+    uint64_t StkKb    = (StkPages * PageSize) >> 10;
+    __AppendStr__(__Buff__, __Caps__, &N, "VmStk:\t");
+    __AppendU64Dec__(__Buff__, __Caps__, &N, StkKb);
+    __AppendStr__(__Buff__, __Caps__, &N, " kB\n");
+    PDebug("Status VmStk N=%ld", N);
+
     __AppendStr__(__Buff__, __Caps__, &N, "Utime(us):\t");
     __AppendU64Dec__(__Buff__, __Caps__, &N, __Proc__->Times.UserUsec);
     __AppendChar__(__Buff__, __Caps__, &N, '\n');
@@ -209,6 +222,19 @@ ProcFsMakeStatus(PosixProc* __Proc__, char* __Buff__, long __Caps__)
     __AppendChar__(__Buff__, __Caps__, &N, '\n');
     PDebug("Status Stime N=%ld", N);
 
+    PosixSchedStat Ss;
+    if (PosixGetSchedStat(__Proc__, &Ss) == SysOkay)
+    {
+        __AppendStr__(__Buff__, __Caps__, &N, "voluntary_ctxt_switches:\t");
+        __AppendU64Dec__(__Buff__, __Caps__, &N, Ss.VoluntaryCtxt);
+        __AppendChar__(__Buff__, __Caps__, &N, '\n');
+
+        __AppendStr__(__Buff__, __Caps__, &N, "nonvoluntary_ctxt_switches:\t");
+        __AppendU64Dec__(__Buff__, __Caps__, &N, Ss.InvoluntaryCtxt);
+        __AppendChar__(__Buff__, __Caps__, &N, '\n');
+        PDebug("Status ctxt N=%ld", N);
+    }
+
     __AppendStr__(__Buff__, __Caps__, &N, "StartTick:\t");
     __AppendU64Dec__(__Buff__, __Caps__, &N, __Proc__->Times.StartTick);
     __AppendChar__(__Buff__, __Caps__, &N, '\n');
@@ -438,4 +464,228 @@ ProcFsWriteSignal(PosixProc* __Proc__, const char* __Buf__, long __Len__)
         return PosixKill(__Proc__->Pid, SigCont) == SysOkay ? __Len__ : -ErrReturn;
     }
     return -BadEntry;
-}
\ No newline at end of file
+}
+
+static inline void
+__AppendMemLine__(char*       __Buf__,
+                  long        __Cap__,
+                  long*       __Off__,
+                  const char* __Key__,
+                  uint64_t    __V__,
+                  const char* __Unit__)
+{
+    __AppendStr__(__Buf__, __Cap__, __Off__, __Key__);
+    __AppendChar__(__Buf__, __Cap__, __Off__, '\t');
+    __AppendU64Dec__(__Buf__, __Cap__, __Off__, __V__);
+    __AppendStr__(__Buf__, __Cap__, __Off__, __Unit__);
+    __AppendChar__(__Buf__, __Cap__, __Off__, '\n');
+}
+
+long
+ProcFsMakeMeminfo(char* __Buf__, long __Cap__)
+{
+    if (Probe_IF_Error(__Buf__) || !__Buf__ || __Cap__ <= 0)
+    {
+        return -BadArgs;
+    }
+
+    long N = 0;
+
+    uint64_t TotalKb = (Pmm.Stats.TotalPages * PageSize) >> 10;
+    uint64_t FreeKb  = (Pmm.Stats.FreePages * PageSize) >> 10;
+    uint64_t UsedKb  = (Pmm.Stats.UsedPages * PageSize) >> 10;
+    uint64_t HugeKb  = (VmmHuge.Mapped * HugePageSize) >> 10;
+
+    __AppendMemLine__(__Buf__, __Cap__, &N, "MemTotal:", TotalKb, " kB");
+    __AppendMemLine__(__Buf__, __Cap__, &N, "MemFree:", FreeKb, " kB");
+    __AppendMemLine__(__Buf__, __Cap__, &N, "MemUsed:", UsedKb, " kB");
+    __AppendMemLine__(__Buf__, __Cap__, &N, "AnonHugePages:", HugeKb, " kB");
+    __AppendMemLine__(__Buf__, __Cap__, &N, "HugePagesHit:", VmmHuge.Hits, "");
+    __AppendMemLine__(__Buf__, __Cap__, &N, "HugePagesFallback:", VmmHuge.Fallbacks, "");
+    __AppendMemLine__(__Buf__, __Cap__, &N, "HugePagesSplit:", VmmHuge.Splits, "");
+    __AppendMemLine__(__Buf__, __Cap__, &N, "Hugepagesize:", HugePageSize >> 10, " kB");
+    __AppendMemLine__(__Buf__, __Cap__, &N, "HugePagesCollapsed:", VmmLazy.Collapsed, "");
+    __AppendMemLine__(__Buf__, __Cap__, &N, "LazyFaults:", VmmLazy.Faults, "");
+    __AppendMemLine__(__Buf__, __Cap__, &N, "LazyFaultAround:", VmmLazy.Around, "");
+    __AppendMemLine__(__Buf__, __Cap__, &N, "LazyPopulated:", VmmLazy.Populated, "");
+    __AppendMemLine__(__Buf__, __Cap__, &N, "MadvDropped:", VmmLazy.Dropped, "");
+    __AppendMemLine__(__Buf__, __Cap__, &N, "Shmem:", (ShmStats.Pages * PageSize) >> 10, " kB");
+    __AppendMemLine__(__Buf__, __Cap__, &N, "ShmemObjects:", ShmStats.Objects, "");
+    __AppendMemLine__(__Buf__, __Cap__, &N, "StackGrown:", VmmStack.Grown, "");
+    __AppendMemLine__(__Buf__, __Cap__, &N, "StackGuardHits:", VmmStack.GuardHits, "");
+    __AppendMemLine__(
+        __Buf__, __Cap__, &N, "KernelStack:", (VmmKStack.Mapped * KStackSize) >> 10, " kB");
+    __AppendMemLine__(__Buf__, __Cap__, &N, "KStackCacheHits:", VmmKStack.CacheHits, "");
+    __AppendMemLine__(__Buf__, __Cap__, &N, "KStackPoolHits:", VmmKStack.PoolHits, "");
+    __AppendMemLine__(__Buf__, __Cap__, &N, "KStackGuardHits:", VmmKStack.GuardHits, "");
+    __AppendMemLine__(__Buf__, __Cap__, &N, "IoRemap:", (VmmIo.Pages * PageSize) >> 10, " kB");
+    __AppendMemLine__(__Buf__, __Cap__, &N, "IoRemapRegions:", VmmIo.Regions, "");
+    __AppendMemLine__(__Buf__, __Cap__, &N, "ReapPending:", VmmReap.Pending, "");
+    __AppendMemLine__(__Buf__, __Cap__, &N, "ReapQueued:", VmmReap.Queued, "");
+    __AppendMemLine__(__Buf__, __Cap__, &N, "ReapInline:", VmmReap.Inline, "");
+    __AppendMemLine__(__Buf__, __Cap__, &N, "ReapFreed:", (VmmReap.Frames * PageSize) >> 10, " kB");
+
+    if ((__Cap__ - N) >= 1)
+    {
+        __Buf__[N] = '\0';
+    }
+    return N;
+}
+
+/* Space then a decimal, the separator for the schedstat lines */
+static inline void
+__AppendField64__(char* __Buf__, long __Cap__, long* __Off__, uint64_t __V__)
+{
+    __AppendChar__(__Buf__, __Cap__, __Off__, ' ');
+    __AppendU64Dec__(__Buf__, __Cap__, __Off__, __V__);
+}
+
+/*
+    Same layout as version 15 of the Linux file, so existing readers parse it:
+    cpuN yields 0 schedules idle-picks wakeups local-wakeups run-ns delay-ns picks
+*/
+long
+ProcFsMakeSchedstat(char* __Buf__, long __Cap__)
+{
+    if (Probe_IF_Error(__Buf__) || !__Buf__ || __Cap__ <= 0)
+    {
+        return -BadArgs;
+    }
+
+    long N = 0;
+
+    __AppendStr__(__Buf__, __Cap__, &N, "version 15\ntimestamp ");
+    __AppendU64Dec__(__Buf__, __Cap__, &N, GetSystemTicks());
+    __AppendChar__(__Buf__, __Cap__, &N, '\n');
+
+    for (uint32_t CpuIndex = 0; CpuIndex < Smp.CpuCount; CpuIndex++)
+    {
+        CpuScheduler* Sched = &CpuSchedulers[CpuIndex];
+
+        __AppendStr__(__Buf__, __Cap__, &N, "cpu");
+        __AppendU64Dec__(__Buf__, __Cap__, &N, CpuIndex);
+        __AppendField64__(__Buf__, __Cap__, &N, Sched->Yields);
+        __AppendField64__(__Buf__, __Cap__, &N, 0);
+        __AppendField64__(__Buf__, __Cap__, &N, Sched->ScheduleTicks + Sched->Voluntary);
+        __AppendField64__(__Buf__, __Cap__, &N, Sched->IdlePicks);
+        __AppendField64__(__Buf__, __Cap__, &N, Sched->Wakeups);
+        __AppendField64__(__Buf__, __Cap__, &N, Sched->WakeupsLocal);
+        __AppendField64__(__Buf__, __Cap__, &N, Sched->RunNs);
+        __AppendField64__(__Buf__, __Cap__, &N, Sched->RunDelayNs);
+        __AppendField64__(__Buf__, __Cap__, &N, Sched->ContextSwitches);
+        __AppendChar__(__Buf__, __Cap__, &N, '\n');
+    }
+
+    if ((__Cap__ - N) >= 1)
+    {
+        __Buf__[N] = '\0';
+    }
+    return N;
+}
+
+/* Queue length, idle time, balancing and tick cost per CPU, then the wakeup latency histogram */
+long
+ProcFsMakeSchedlat(char* __Buf__, long __Cap__)
+{
+    if (Probe_IF_Error(__Buf__) || !__Buf__ || __Cap__ <= 0)
+    {
+        return -BadArgs;
+    }
+
+    long     N = 0;
+    uint64_t Hist[SchedLatBuckets];
+
+    for (uint32_t Bucket = 0; Bucket < SchedLatBuckets; Bucket++)
+    {
+        Hist[Bucket] = 0;
+    }
+
+    for (uint32_t CpuIndex = 0; CpuIndex < Smp.CpuCount; CpuIndex++)
+    {
+        CpuScheduler* Sched = &CpuSchedulers[CpuIndex];
+
+        /*Average in hundredths, printed as a fixed point*/
+        uint64_t Ticks = Sched->QueueTicks;
+        uint64_t Avg   = Ticks ? Sched->QueueSum * 100 / Ticks : 0;
+
+        __AppendStr__(__Buf__, __Cap__, &N, "cpu");
+        __AppendU64Dec__(__Buf__, __Cap__, &N, CpuIndex);
+        __AppendStr__(__Buf__, __Cap__, &N, " queue_avg ");
+        __AppendU64Dec__(__Buf__, __Cap__, &N, Avg / 100);
+        __AppendChar__(__Buf__, __Cap__, &N, '.');
+        __AppendChar__(__Buf__, __Cap__, &N, (char)('0' + Avg % 100 / 10));
+        __AppendChar__(__Buf__, __Cap__, &N, (char)('0' + Avg % 10));
+        __AppendStr__(__Buf__, __Cap__, &N, " queue_max");
+        __AppendField64__(__Buf__, __Cap__, &N, Sched->QueueMax);
+        __AppendStr__(__Buf__, __Cap__, &N, " idle_ms");
+        __AppendField64__(__Buf__, __Cap__, &N, Sched->IdleTicks);
+        __AppendStr__(__Buf__, __Cap__, &N, " migrations");
+        __AppendField64__(__Buf__, __Cap__, &N, Sched->Migrations);
+        __AppendStr__(__Buf__, __Cap__, &N, " steals");
+        __AppendField64__(__Buf__, __Cap__, &N, Sched->Steals);
+        __AppendStr__(__Buf__, __Cap__, &N, " rt_throttles");
+        __AppendField64__(__Buf__, __Cap__, &N, Sched->RtThrottles);
+        __AppendStr__(__Buf__, __Cap__, &N, " reaped");
+        __AppendField64__(__Buf__, __Cap__, &N, Sched->Reaped);
+        __AppendStr__(__Buf__, __Cap__, &N, " tick_max_ns");
+        __AppendField64__(__Buf__, __Cap__, &N, Sched->TickMaxNs);
+        __AppendChar__(__Buf__, __Cap__, &N, '\n');
+
+        for (uint32_t Bucket = 0; Bucket < SchedLatBuckets; Bucket++)
+        {
+            Hist[Bucket] += Sched->WakeLat[Bucket];
+        }
+    }
+
+    __AppendStr__(__Buf__, __Cap__, &N, "wakeup_us\tcount\n");
+    for (uint32_t Bucket = 0; Bucket < SchedLatBuckets; Bucket++)
+    {
+        uint64_t Low = Bucket ? 1ULL << Bucket : 0;
+
+        __AppendU64Dec__(__Buf__, __Cap__, &N, Low);
+        __AppendChar__(__Buf__, __Cap__, &N, '-');
+        if (Bucket + 1 < SchedLatBuckets)
+        {
+            __AppendU64Dec__(__Buf__, __Cap__, &N, (2ULL << Bucket) - 1);
+        }
+        __AppendChar__(__Buf__, __Cap__, &N, '\t');
+        __AppendU64Dec__(__Buf__, __Cap__, &N, Hist[Bucket]);
+        __AppendChar__(__Buf__, __Cap__, &N, '\n');
+    }
+
+    if ((__Cap__ - N) >= 1)
+    {
+        __Buf__[N] = '\0';
+    }
+    return N;
+}
+
+/* Linux layout: run-ns delay-ns picks */
+long
+ProcFsMakeProcSchedstat(PosixProc* __Proc__, char* __Buf__, long __Cap__)
+{
+    if (Probe_IF_Error(__Proc__) || !__Proc__ || Probe_IF_Error(__Buf__) || !__Buf__ ||
+        __Cap__ <= 0)
+    {
+        return -BadArgs;
+    }
+
+    PosixSchedStat Ss;
+    int            Rc = PosixGetSchedStat(__Proc__, &Ss);
+    if (Rc != SysOkay)
+    {
+        return Rc;
+    }
+
+    long N = 0;
+    __AppendU64Dec__(__Buf__, __Cap__, &N, Ss.RunNs);
+    __AppendField64__(__Buf__, __Cap__, &N, Ss.RunDelayNs);
+    __AppendField64__(__Buf__, __Cap__, &N, Ss.RunCount);
+    __AppendChar__(__Buf__, __Cap__, &N, '\n');
+
+    if ((__Cap__ - N) >= 1)
+    {
+        __Buf__[N] = '\0';
+    }
+    return N;
+}
@@ -7,8 +7,8 @@
 #include <VMM.h>
 #include <VirtBin.h>
 
-#define __STACK_BASE__ 0x0000000001000000ULL
-#define __STACK_SIZE__ 0x0000000000010000ULL
+#define __STACK_BASE__ (UserStackTop - UserStackCommit) /* lowest page pushed to at exec */
+#define __ARG_SIZE__   0x0000000000010000ULL
 #define __ARG_AREA__   0x0000000000F00000ULL
 
 static inline uint64_t
@@ -145,25 +145,27 @@ VirtSetupStack(VirtualMemorySpace* __Space__,
         __StackFlags__ |= PTENOEXECUTE;
     }
 
-    PDebug("Mapping stack base=0x%llx size=0x%llx flags=0x%llx nx=%d\n",
-           (unsigned long long)__STACK_BASE__,
-           (unsigned long long)__STACK_SIZE__,
+    PDebug("Reserving stack low=0x%llx top=0x%llx flags=0x%llx nx=%d\n",
+           (unsigned long long)UserStackLow,
+           (unsigned long long)UserStackTop,
            (unsigned long long)__StackFlags__,
            __Nx__);
 
-    int m0 = VirtMapRangeZeroed(__Space__, __STACK_BASE__, __STACK_SIZE__, __StackFlags__);
-    if (m0 != SysOkay)
+    /* The whole reservation is lazy, only the pages the exec frame lands in are backed now */
+    int m0 =
+        ReserveUserRange(__Space__, UserStackLow, UserStackReserve, __StackFlags__ | PTEGROWSDOWN);
+    if (m0 != SysOkay || PopulateUserRange(__Space__, __STACK_BASE__, UserStackCommit) != SysOkay)
     {
         return Nothing;
     }
-    PDebug("VirtSetupStack: stack mapped OK\n");
+    PDebug("VirtSetupStack: stack reserved OK\n");
 
     PDebug("VirtSetupStack: mapping arg area base=0x%llx size=0x%llx flags=0x%llx\n",
            (unsigned long long)__ARG_AREA__,
-           (unsigned long long)__STACK_SIZE__,
+           (unsigned long long)__ARG_SIZE__,
            (unsigned long long)__StackFlags__);
 
-    int m1 = VirtMapRangeZeroed(__Space__, __ARG_AREA__, __STACK_SIZE__, __StackFlags__);
+    int m1 = VirtMapRangeZeroed(__Space__, __ARG_AREA__, __ARG_SIZE__, __StackFlags__);
     if (m1 != SysOkay)
     {
         return Nothing;
@@ -173,9 +175,9 @@ VirtSetupStack(VirtualMemorySpace* __Space__,
     uint64_t __EnvPtrs__[128] = {0};
 
     uint64_t __ArgCount__ =
-        __PushStrings__(__Space__, __Argv__, __ARG_AREA__, __STACK_SIZE__, __ArgPtrs__, 128);
+        __PushStrings__(__Space__, __Argv__, __ARG_AREA__, __ARG_SIZE__, __ArgPtrs__, 128);
     uint64_t __EnvCount__ =
-        __PushStrings__(__Space__, __Envp__, __ARG_AREA__, __STACK_SIZE__, __EnvPtrs__, 128);
+        __PushStrings__(__Space__, __Envp__, __ARG_AREA__, __ARG_SIZE__, __EnvPtrs__, 128);
 
     enum
     {
@@ -190,10 +192,10 @@ VirtSetupStack(VirtualMemorySpace* __Space__,
                                1 /*envp NULL*/ + (2 * __AuxPairs__) /*aux pairs*/ +
                                2 /*AT_NULL pair*/;
 
-    uint64_t __Rsp__ = (__STACK_BASE__ + __STACK_SIZE__) & ~0xFULL;
+    uint64_t __Rsp__ = UserStackTop & ~0xFULL;
     PDebug("Initial RSP aligned=0x%llx (top=0x%llx)\n",
            (unsigned long long)__Rsp__,
-           (unsigned long long)(__STACK_BASE__ + __STACK_SIZE__));
+           (unsigned long long)UserStackTop);
 
     /* if parity requires it */
     int __NeedShim__ = (((__TotalQwords__ & 1ULL) == 0) ? true : false);
@@ -1,6 +1,7 @@
 #include <APICTimer.h>
 #include <AxeSchd.h>
 #include <AxeThreads.h>
+#include <Fpu.h>
 #include <SymAP.h>
 #include <Syscall.h>
 #include <Timer.h>
@@ -22,6 +23,9 @@ ApEntryPoint(struct limine_smp_info* __CpuInfo__)
     SysErr  err;
     SysErr* Error = &err;
 
+    /* Before the first spinlock, they find the CPU id through GS */
+    InitializePerCpuData(CpuNumber, Error);
+
     Smp.Cpus[CpuNumber].Status  = CPU_STATUS_ONLINE;
     Smp.Cpus[CpuNumber].Started = 1; /* Boolean flag indicating startup completion */
 
@@ -56,6 +60,7 @@ ApEntryPoint(struct limine_smp_info* __CpuInfo__)
     Cr0 &= ~(1UL << 2); /* EM = 0 */
     Cr0 |= (1UL << 1);  /* MP = 1 */
     Cr0 &= ~(1UL << 3); /* TS = 0 */
+    Cr0 |= (1UL << 16); /* WP = 1, kernel writes to COW pages must fault */
     __asm__ volatile("mov %0, %%cr0" ::"r"(Cr0) : "memory");
 
     /* CR4: set OSFXSR (bit 9) and OSXMMEXCPT (bit 10) for SSE */
@@ -64,6 +69,10 @@ ApEntryPoint(struct limine_smp_info* __CpuInfo__)
 
     /* Initialize x87/SSE state */
     __asm__ volatile("fninit");
+    InitializeFpu(Error);
+
+    /* Same PAT layout as the BSP, memory types must agree on every CPU */
+    InitializePat(Error);
 
     SetupApicTimerForThisCpu(Error);
 
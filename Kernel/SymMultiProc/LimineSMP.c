@@ -1,5 +1,6 @@
 #include <LimineSMP.h>
 #include <LimineServices.h>
+#include <PerCPUData.h>
 #include <SMP.h>
 #include <Timer.h>
 #include <VMM.h>
@@ -8,24 +9,11 @@ SmpManager        Smp;
 SpinLock          SMPLock;
 volatile uint32_t CpuStartupCount = 0;
 
+/* One gs-relative load, GS_BASE is this CPU's PerCpuData while in the kernel */
 uint32_t
 GetCurrentCpuId(void)
 {
-    uint64_t ApicBaseMsr  = ReadMsr(0x1B);            /* IA32_APIC_BASE Model-Specific Register */
-    uint64_t ApicPhysBase = ApicBaseMsr & 0xFFFFF000; /* Extract 4KB-aligned base address */
-
-    volatile uint32_t* ApicIdReg = (volatile uint32_t*)(PhysToVirt(ApicPhysBase) + 0x20);
-    uint32_t           ApicId    = (*ApicIdReg >> 24) & 0xFF;
-
-    for (uint32_t Index = 0; Index < Smp.CpuCount; Index++)
-    {
-        if (Smp.Cpus[Index].ApicId == ApicId)
-        {
-            return Index;
-        }
-    }
-
-    return ApicId;
+    return ThisCpuId();
 }
 
 void
@@ -42,6 +30,7 @@ InitializeSmp(SysErr* __Err__)
         Smp.Cpus[0].CpuNumber = 0;
         Smp.Cpus[0].Status    = CPU_STATUS_ONLINE;
         Smp.Cpus[0].Started   = 1;
+        InitializeTopology(__Err__);
         return;
     }
 
@@ -75,10 +64,22 @@ InitializeSmp(SysErr* __Err__)
         {
             Smp.Cpus[Index].Status  = CPU_STATUS_ONLINE;
             Smp.Cpus[Index].Started = 1;
+
+            /* Booted as CPU 0, take the slot Limine gave us; the .percpu image stays ours */
+            CpuDataArray[Index].PerCpuOffset = 0;
+            InitializePerCpuData(Index, __Err__);
             PDebug("BSP CPU %u (LAPIC ID %u)\n", Index, CpuInfo->lapic_id);
         }
         else
         {
+            /* Its per-CPU variables must exist before its first spinlock */
+            if (AllocatePerCpuArea(Index) != SysOkay)
+            {
+                Smp.Cpus[Index].Status = CPU_STATUS_FAILED;
+                PError("No per-CPU area for AP %u, not starting it\n", Index);
+                continue;
+            }
+
             Smp.Cpus[Index].Status = CPU_STATUS_STARTING;
             CpuInfo->goto_address  = ApEntryPoint; /* Set AP entry point */
             StartedAps++;
@@ -108,4 +109,6 @@ InitializeSmp(SysErr* __Err__)
             PSuccess("%u out of %u APs started successfully\n", CpuStartupCount, StartedAps);
         }
     }
+
+    InitializeTopology(__Err__);
 }
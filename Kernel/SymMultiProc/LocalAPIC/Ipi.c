@@ -0,0 +1,277 @@
+#include <APICTimer.h>
+#include <Ipi.h>
+#include <PerCPUData.h>
+#include <SMP.h>
+#include <Timer.h>
+
+/* Calls waiting for one CPU, a ring of pointers to their callers' IpiCallData */
+typedef struct
+{
+    SpinLock     Lock;
+    IpiCallData* Ring[IpiCallDepth];
+    uint32_t     Head;
+    uint32_t     Tail;
+
+} IpiQueue;
+
+IpiCpuStats       IpiStats[MaxCPUs];
+volatile uint32_t IpiStopping = 0;
+static IpiQueue   IpiQueues[MaxCPUs];
+static int        IpiReady = 0;
+
+void
+InitializeIpi(SysErr* __Err__)
+{
+    if (Timer.ActiveTimer != TIMER_TYPE_APIC || !Timer.ApicBase)
+    {
+        SlotError(__Err__, -NotInit);
+        return;
+    }
+
+    for (uint32_t CpuIndex = 0; CpuIndex < MaxCPUs; CpuIndex++)
+    {
+        InitializeSpinLock(&IpiQueues[CpuIndex].Lock, "IpiCalls", __Err__);
+        IpiQueues[CpuIndex].Head = 0;
+        IpiQueues[CpuIndex].Tail = 0;
+    }
+
+    IpiReady = 1;
+
+    PSuccess("IPIs on vectors 0x%x (reschedule) and 0x%x (call)\n",
+             IpiVectorResched,
+             IpiVectorCall);
+}
+
+/* Every CPU maps its APIC at the same address, so this hits the local ICR. Interrupts off */
+static void
+__IcrWrite__(uint32_t __ApicId__, uint32_t __Low__)
+{
+    volatile uint32_t* IcrLow  = (volatile uint32_t*)(Timer.ApicBase + IpiRegIcrLow);
+    volatile uint32_t* IcrHigh = (volatile uint32_t*)(Timer.ApicBase + IpiRegIcrHigh);
+
+    /*The last IPI sent from here has to be accepted before the ICR is reused*/
+    while (*IcrLow & IpiDeliveryPending)
+    {
+        __asm__ volatile("pause");
+    }
+
+    *IcrHigh = __ApicId__ << 24;
+    *IcrLow  = __Low__;
+}
+
+int
+IpiSend(uint32_t __CpuId__, uint32_t __Vector__)
+{
+    if (!IpiReady)
+    {
+        return -NotInit;
+    }
+    if (__CpuId__ >= Smp.CpuCount || __CpuId__ >= MaxCPUs ||
+        Smp.Cpus[__CpuId__].Status != CPU_STATUS_ONLINE)
+    {
+        return -BadArgs;
+    }
+
+    uint64_t Flags;
+    __asm__ volatile("pushfq; popq %0; cli" : "=r"(Flags)::"memory");
+
+    /*Read with interrupts off, a migration in between would aim the self IPI at the wrong CPU*/
+    if (__CpuId__ == ThisCpuId())
+    {
+        __IcrWrite__(0, __Vector__ | IpiDeliveryFixed | IpiLevelAssert | IpiToSelf);
+    }
+    else
+    {
+        __IcrWrite__(Smp.Cpus[__CpuId__].ApicId, __Vector__ | IpiDeliveryFixed | IpiLevelAssert);
+    }
+
+    __asm__ volatile("pushq %0; popfq" ::"r"(Flags) : "memory");
+    return SysOkay;
+}
+
+static inline int
+__InterruptsOn__(void)
+{
+    uint64_t Flags;
+    __asm__ volatile("pushfq; popq %0" : "=r"(Flags));
+    return (Flags >> RflagsInterruptFlag) & 1;
+}
+
+/* Runs and retires whatever is queued for __CpuId__, called with interrupts off */
+static void
+__RunCalls__(uint32_t __CpuId__)
+{
+    SysErr  err;
+    SysErr* Error = &err;
+
+    IpiQueue*    Queue = &IpiQueues[__CpuId__];
+    IpiCallData* Calls[IpiCallDepth];
+    uint32_t     Count = 0;
+
+    AcquireSpinLock(&Queue->Lock, Error);
+    while (Queue->Head != Queue->Tail)
+    {
+        Calls[Count++] = Queue->Ring[Queue->Head % IpiCallDepth];
+        Queue->Head++;
+    }
+    ReleaseSpinLock(&Queue->Lock, Error);
+
+    for (uint32_t Index = 0; Index < Count; Index++)
+    {
+        /*The caller's frame may be gone as soon as Remaining drops*/
+        IpiFunc Func = Calls[Index]->Func;
+        void*   Arg  = Calls[Index]->Arg;
+        Func(Arg);
+        IpiStats[__CpuId__].Calls++;
+        __atomic_fetch_sub(&Calls[Index]->Remaining, 1, __ATOMIC_RELEASE);
+    }
+}
+
+/*
+    One spin of a sender's wait. With interrupts on the call vector serves us,
+    with them off two CPUs calling each other would wait forever, so the
+    waiter runs its own queue by hand. The vector still arrives later and
+    finds the ring empty.
+*/
+static inline void
+__WaitSpin__(void)
+{
+    if (!__InterruptsOn__())
+    {
+        __RunCalls__(ThisCpuId());
+    }
+    __asm__ volatile("pause");
+}
+
+/* Waits for room in a full ring, calls aimed at us keep being served meanwhile */
+static int
+__QueueCall__(uint32_t __CpuId__, IpiCallData* __Data__)
+{
+    SysErr  err;
+    SysErr* Error = &err;
+
+    IpiQueue* Queue = &IpiQueues[__CpuId__];
+
+    for (;;)
+    {
+        AcquireSpinLock(&Queue->Lock, Error);
+        if (Queue->Tail - Queue->Head < IpiCallDepth)
+        {
+            Queue->Ring[Queue->Tail % IpiCallDepth] = __Data__;
+            Queue->Tail++;
+            ReleaseSpinLock(&Queue->Lock, Error);
+            return IpiSend(__CpuId__, IpiVectorCall);
+        }
+        ReleaseSpinLock(&Queue->Lock, Error);
+        __WaitSpin__();
+    }
+}
+
+/* Runs __Func__ on __CpuId__ with interrupts off and waits for it to return */
+int
+IpiCallCpu(uint32_t __CpuId__, IpiFunc __Func__, void* __Arg__)
+{
+    if (!__Func__ || __CpuId__ >= Smp.CpuCount || __CpuId__ >= MaxCPUs)
+    {
+        return -BadArgs;
+    }
+    if (!IpiReady)
+    {
+        return -NotInit;
+    }
+
+    uint64_t Flags;
+    __asm__ volatile("pushfq; popq %0; cli" : "=r"(Flags)::"memory");
+    if (__CpuId__ == ThisCpuId())
+    {
+        __Func__(__Arg__);
+        __asm__ volatile("pushq %0; popfq" ::"r"(Flags) : "memory");
+        return SysOkay;
+    }
+    __asm__ volatile("pushq %0; popfq" ::"r"(Flags) : "memory");
+
+    IpiCallData Data = {__Func__, __Arg__, 1};
+
+    int Status = __QueueCall__(__CpuId__, &Data);
+    if (Status != SysOkay)
+    {
+        return Status;
+    }
+
+    while (__atomic_load_n(&Data.Remaining, __ATOMIC_ACQUIRE))
+    {
+        __WaitSpin__();
+    }
+    return SysOkay;
+}
+
+/* Runs __Func__ on every other online CPU and waits for all of them */
+int
+IpiCallOthers(IpiFunc __Func__, void* __Arg__)
+{
+    if (!__Func__)
+    {
+        return -BadArgs;
+    }
+    if (!IpiReady)
+    {
+        return -NotInit;
+    }
+
+    /*Others as of now, a call that follows us to another CPU is served there by a self IPI*/
+    uint32_t Self    = GetCurrentCpuId();
+    uint32_t Targets = 0;
+    for (uint32_t CpuIndex = 0; CpuIndex < Smp.CpuCount && CpuIndex < MaxCPUs; CpuIndex++)
+    {
+        Targets += CpuIndex != Self && Smp.Cpus[CpuIndex].Status == CPU_STATUS_ONLINE;
+    }
+    if (!Targets)
+    {
+        return SysOkay;
+    }
+
+    IpiCallData Data = {__Func__, __Arg__, Targets};
+
+    for (uint32_t CpuIndex = 0; CpuIndex < Smp.CpuCount && CpuIndex < MaxCPUs; CpuIndex++)
+    {
+        if (CpuIndex != Self && Smp.Cpus[CpuIndex].Status == CPU_STATUS_ONLINE)
+        {
+            __QueueCall__(CpuIndex, &Data);
+        }
+    }
+
+    while (__atomic_load_n(&Data.Remaining, __ATOMIC_ACQUIRE))
+    {
+        __WaitSpin__();
+    }
+    return SysOkay;
+}
+
+/* IpiVectorCall, runs whatever is queued for this CPU */
+void
+IpiCallHandler(void)
+{
+    __RunCalls__(GetCurrentCpuId());
+}
+
+/* Parks every other CPU for a fatal exception report, they halt in IsrHandler's NMI path */
+void
+IpiStopOthers(void)
+{
+    if (!IpiReady || Smp.CpuCount < 2 || __atomic_exchange_n(&IpiStopping, 1, __ATOMIC_SEQ_CST))
+    {
+        return;
+    }
+
+    uint64_t Flags;
+    __asm__ volatile("pushfq; popq %0; cli" : "=r"(Flags)::"memory");
+    __IcrWrite__(0, IpiDeliveryNmi | IpiLevelAssert | IpiToAllButSelf);
+    __asm__ volatile("pushq %0; popfq" ::"r"(Flags) : "memory");
+}
+
+void
+IpiEoi(void)
+{
+    volatile uint32_t* EoiReg = (volatile uint32_t*)(Timer.ApicBase + TimerApicRegEoi);
+    *EoiReg                   = 0;
+}
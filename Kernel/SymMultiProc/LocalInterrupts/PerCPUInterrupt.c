@@ -1,12 +1,60 @@
 #include <GDT.h>
+#include <PMM.h>
 #include <PerCPUData.h>
 #include <SMP.h>
+#include <String.h>
 #include <SymAP.h>
 #include <Timer.h>
 #include <VMM.h>
 
 PerCpuData CpuDataArray[MaxCPUs];
 
+/* Point GS_BASE at this CPU's data, again after anything reloads the GS selector */
+void
+InitializePerCpuData(uint32_t __CpuId__, SysErr* __Err__)
+{
+    if (__CpuId__ >= MaxCPUs)
+    {
+        SlotError(__Err__, -BadArgs);
+        return;
+    }
+
+    PerCpuData* CpuData = &CpuDataArray[__CpuId__];
+    CpuData->Self       = CpuData;
+    CpuData->CpuId      = __CpuId__;
+
+    WriteMsr(MsrGsBase, (uint64_t)CpuData);
+    WriteMsr(MsrKernelGsBase, 0);
+}
+
+/* Private copy of .percpu for an AP, made by the BSP before the AP starts taking locks */
+int
+AllocatePerCpuArea(uint32_t __CpuId__)
+{
+    if (__CpuId__ >= MaxCPUs)
+    {
+        return -BadArgs;
+    }
+
+    uint64_t Size = (uint64_t)(__PerCpuEnd - __PerCpuStart);
+    if (!Size)
+    {
+        CpuDataArray[__CpuId__].PerCpuOffset = 0;
+        return SysOkay;
+    }
+
+    uint64_t AreaPhys = AllocPages((Size + 0xFFF) / 0x1000);
+    if (Probe_IF_Error(AreaPhys) || !AreaPhys)
+    {
+        return -BadAlloc;
+    }
+
+    uint8_t* Area = (uint8_t*)PhysToVirt(AreaPhys);
+    memcpy(Area, __PerCpuStart, Size);
+    CpuDataArray[__CpuId__].PerCpuOffset = (uint64_t)Area - (uint64_t)__PerCpuStart;
+    return SysOkay;
+}
+
 void
 PerCpuInterruptInit(uint32_t __CpuNumber__, uint64_t __StackTop__, SysErr* __Err__)
 {
@@ -99,6 +147,12 @@ PerCpuInterruptInit(uint32_t __CpuNumber__, uint64_t __StackTop__, SysErr* __Err
 
     __asm__ volatile("ltr %0" : : "r"((uint16_t)TssSelector) : "memory");
 
+    /* Reloading GS above cleared its base */
+    InitializePerCpuData(__CpuNumber__, __Err__);
+
+    /* Guarded #DF stack, so a kernel stack overflow here still gets reported */
+    SetFaultStack(&CpuData->Tss, CpuData->Idt, __Err__);
+
     GdtPointer VerifyGdt;
     IdtPointer VerifyIdt;
     uint16_t   VerifyTr;
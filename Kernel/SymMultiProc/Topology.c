@@ -0,0 +1,236 @@
+#include <SMP.h>
+
+/*
+    Every level of the topology is a contiguous field of the APIC id, CPUID
+    gives the width of each field once and the same widths hold on every
+    CPU. Limine already walked the MADT for the APIC ids, so the split needs
+    no CPUID on the APs themselves.
+*/
+
+static inline void
+__TopoCpuid__(uint32_t __Leaf__, uint32_t __Sub__, uint32_t* __Regs__)
+{
+    __asm__ volatile("cpuid"
+                     : "=a"(__Regs__[0]), "=b"(__Regs__[1]), "=c"(__Regs__[2]), "=d"(__Regs__[3])
+                     : "a"(__Leaf__), "c"(__Sub__));
+}
+
+/* Bits needed to number __Count__ ids */
+static inline uint32_t
+__TopoBits__(uint32_t __Count__)
+{
+    return __Count__ > 1 ? 32 - __builtin_clz(__Count__ - 1) : 0;
+}
+
+/* Leaf 0x1F or 0xB: SMT is level type 1, the last valid level's shift reaches the package */
+static int
+__TopoExtended__(uint32_t __Leaf__, CpuTopology* __Topo__)
+{
+    uint32_t Regs[4];
+
+    __TopoCpuid__(__Leaf__, 0, Regs);
+    if (!Regs[1])
+    {
+        return 0;
+    }
+
+    for (uint32_t Sub = 0; Sub < 8; Sub++)
+    {
+        __TopoCpuid__(__Leaf__, Sub, Regs);
+
+        uint32_t Type = (Regs[2] >> 8) & 0xFF;
+        if (!Type)
+        {
+            break;
+        }
+
+        uint32_t Shift = Regs[0] & 0x1F;
+        if (Type == 1)
+        {
+            __Topo__->SmtShift = Shift;
+        }
+        __Topo__->PackageShift = Shift;
+    }
+
+    __Topo__->Source = __Leaf__;
+    return 1;
+}
+
+/* Pre-0xB parts: logical count from leaf 1, cores per package from leaf 4 */
+static void
+__TopoLegacy__(CpuTopology* __Topo__)
+{
+    uint32_t Regs[4];
+
+    __TopoCpuid__(1, 0, Regs);
+    uint32_t Logical = (Regs[3] & (1U << 28)) ? (Regs[1] >> 16) & 0xFF : 1;
+
+    uint32_t Cores = 1;
+    __TopoCpuid__(0, 0, Regs);
+    if (Regs[0] >= 4)
+    {
+        __TopoCpuid__(4, 0, Regs);
+        if (Regs[0] & 0x1F)
+        {
+            Cores = ((Regs[0] >> 26) & 0x3F) + 1;
+        }
+    }
+
+    __Topo__->PackageShift = __TopoBits__(Logical ? Logical : 1);
+    __Topo__->SmtShift     = __TopoBits__(Logical > Cores ? Logical / Cores : 1);
+    __Topo__->Source       = 1;
+}
+
+/* Widest sharing of the deepest cache, from leaf 4 (Intel) or 0x8000001D (AMD) */
+static uint32_t
+__TopoLlcShift__(uint32_t __PackageShift__)
+{
+    uint32_t Regs[4];
+    uint32_t Leaf = 0;
+
+    __TopoCpuid__(0, 0, Regs);
+    if (Regs[0] >= 4)
+    {
+        __TopoCpuid__(4, 0, Regs);
+        Leaf = (Regs[0] & 0x1F) ? 4 : 0;
+    }
+    if (!Leaf)
+    {
+        __TopoCpuid__(0x80000000, 0, Regs);
+        Leaf = Regs[0] >= 0x8000001D ? 0x8000001D : 0;
+    }
+    if (!Leaf)
+    {
+        return __PackageShift__;
+    }
+
+    uint32_t Level = 0;
+    uint32_t Share = 1;
+    for (uint32_t Sub = 0; Sub < 16; Sub++)
+    {
+        __TopoCpuid__(Leaf, Sub, Regs);
+        if (!(Regs[0] & 0x1F))
+        {
+            break;
+        }
+
+        uint32_t CacheLevel = (Regs[0] >> 5) & 0x7;
+        if (CacheLevel >= Level)
+        {
+            Level = CacheLevel;
+            Share = ((Regs[0] >> 14) & 0xFFF) + 1;
+        }
+    }
+
+    uint32_t Shift = __TopoBits__(Share);
+    return Shift < __PackageShift__ ? Shift : __PackageShift__;
+}
+
+/* On the BSP once every APIC id is known, before the scheduler places anything */
+void
+InitializeTopology(SysErr* __Err__ _unused)
+{
+    CpuTopology* Topo = &Smp.Topology;
+    uint32_t     Regs[4];
+
+    Topo->SmtShift     = 0;
+    Topo->PackageShift = 0;
+
+    __TopoCpuid__(0, 0, Regs);
+    uint32_t MaxLeaf = Regs[0];
+    if (!(MaxLeaf >= 0x1F && __TopoExtended__(0x1F, Topo)) &&
+        !(MaxLeaf >= 0xB && __TopoExtended__(0xB, Topo)))
+    {
+        __TopoLegacy__(Topo);
+    }
+    Topo->LlcShift = __TopoLlcShift__(Topo->PackageShift);
+
+    for (uint32_t CpuIndex = 0; CpuIndex < Smp.CpuCount; CpuIndex++)
+    {
+        CpuInfo* Cpu = &Smp.Cpus[CpuIndex];
+
+        Cpu->PackageId = Cpu->ApicId >> Topo->PackageShift;
+        Cpu->CoreId    = Cpu->ApicId >> Topo->SmtShift;
+        Cpu->LlcId     = Cpu->ApicId >> Topo->LlcShift;
+        CpuMaskZero(&Cpu->SmtMask);
+        CpuMaskZero(&Cpu->LlcMask);
+        CpuMaskZero(&Cpu->PackageMask);
+    }
+
+    Topo->Packages = 0;
+    Topo->Cores    = 0;
+    Topo->Llcs     = 0;
+
+    for (uint32_t CpuIndex = 0; CpuIndex < Smp.CpuCount; CpuIndex++)
+    {
+        CpuInfo* Cpu        = &Smp.Cpus[CpuIndex];
+        int      NewCore    = 1;
+        int      NewLlc     = 1;
+        int      NewPackage = 1;
+
+        for (uint32_t Other = 0; Other < Smp.CpuCount; Other++)
+        {
+            CpuInfo* Peer = &Smp.Cpus[Other];
+
+            if (Peer->CoreId == Cpu->CoreId)
+            {
+                CpuMaskSet(&Cpu->SmtMask, Other);
+                NewCore &= Other >= CpuIndex;
+            }
+            if (Peer->LlcId == Cpu->LlcId)
+            {
+                CpuMaskSet(&Cpu->LlcMask, Other);
+                NewLlc &= Other >= CpuIndex;
+            }
+            if (Peer->PackageId == Cpu->PackageId)
+            {
+                CpuMaskSet(&Cpu->PackageMask, Other);
+                NewPackage &= Other >= CpuIndex;
+            }
+        }
+
+        /*Counted at the lowest CPU index of each group*/
+        Topo->Cores += NewCore;
+        Topo->Llcs += NewLlc;
+        Topo->Packages += NewPackage;
+    }
+
+    PInfo("Topology (CPUID 0x%x): %u package(s), %u LLC(s), %u core(s), %u CPU(s)\n",
+          Topo->Source,
+          Topo->Packages,
+          Topo->Llcs,
+          Topo->Cores,
+          Smp.CpuCount);
+    PDebug("APIC id split: SMT >> %u, LLC >> %u, package >> %u\n",
+           Topo->SmtShift,
+           Topo->LlcShift,
+           Topo->PackageShift);
+}
+
+uint32_t
+CpuDistance(uint32_t __CpuA__, uint32_t __CpuB__)
+{
+    if (__CpuA__ == __CpuB__)
+    {
+        return CpuDistSelf;
+    }
+    if (__CpuA__ >= Smp.CpuCount || __CpuB__ >= Smp.CpuCount)
+    {
+        return CpuDistRemote;
+    }
+
+    CpuInfo* Cpu = &Smp.Cpus[__CpuA__];
+    if (CpuMaskTest(&Cpu->SmtMask, __CpuB__))
+    {
+        return CpuDistSmt;
+    }
+    if (CpuMaskTest(&Cpu->LlcMask, __CpuB__))
+    {
+        return CpuDistLlc;
+    }
+    if (CpuMaskTest(&Cpu->PackageMask, __CpuB__))
+    {
+        return CpuDistPackage;
+    }
+    return CpuDistRemote;
+}
@@ -1,51 +1,149 @@
+#include <AxeSchd.h>
+#include <AxeThreads.h>
 #include <Errnos.h>
 #include <SMP.h>
 #include <Sync.h>
 
+/*Lock word: free, held, held with sleepers queued*/
+#define MutexFree      0
+#define MutexHeld      1
+#define MutexContended 2
+
+int MutexBlocking = 1;
+
+/* The thread that may sleep here, NULL before the scheduler runs or on the idle thread */
+static Thread*
+__MutexSelf__(uint32_t* __CpuId__)
+{
+    uint64_t Flags;
+    __asm__ volatile("pushfq; popq %0; cli" : "=r"(Flags)::"memory");
+
+    uint32_t CpuId = ThisCpuId();
+    Thread*  Self  = ThisThread();
+    Self           = (Self == CpuSchedulers[CpuId].IdleThread) ? NULL : Self;
+
+    __asm__ volatile("pushq %0; popfq" ::"r"(Flags) : "memory");
+
+    *__CpuId__ = CpuId;
+    return Self;
+}
+
+static bool
+__MutexMine__(Mutex* __Mutex__, Thread* __Self__, uint32_t __CpuId__)
+{
+    if (__atomic_load_n(&__Mutex__->Lock, __ATOMIC_ACQUIRE) == MutexFree)
+    {
+        return false;
+    }
+    if (__Self__)
+    {
+        return __Mutex__->Holder == __Self__;
+    }
+    return !__Mutex__->Holder && __Mutex__->Owner == __CpuId__;
+}
+
+/* Worth spinning on: the holder is on a CPU (or CPU owned) and should let go soon */
+static bool
+__HolderRunning__(Mutex* __Mutex__)
+{
+    Thread* Holder = __atomic_load_n(&__Mutex__->Holder, __ATOMIC_ACQUIRE);
+    return !Holder || __atomic_load_n(&Holder->State, __ATOMIC_RELAXED) == ThreadStateRunning;
+}
+
+static bool
+__MutexTake__(Mutex* __Mutex__, Thread* __Self__, uint32_t __CpuId__)
+{
+    uint32_t Expected = MutexFree;
+    if (!__atomic_compare_exchange_n(
+            &__Mutex__->Lock, &Expected, MutexHeld, false, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED))
+    {
+        return false;
+    }
+
+    __Mutex__->Holder         = __Self__;
+    __Mutex__->Owner          = __CpuId__;
+    __Mutex__->RecursionCount = 1;
+    return true;
+}
+
 void
 InitializeMutex(Mutex* __Mutex__, const char* __Name__, SysErr* __Err__)
 {
-    __Mutex__->Lock           = 0;          /* Initially unlocked */
+    __Mutex__->Lock           = MutexFree;  /* Initially unlocked */
     __Mutex__->Owner          = 0xFFFFFFFF; /* No owner (kernel value) */
     __Mutex__->RecursionCount = 0;          /* No recursive locks */
     __Mutex__->Name           = __Name__;   /* Assign name for debugging */
+    __Mutex__->Holder         = NULL;
+    __Mutex__->Sleeps         = 0;
+    InitializeWaitQueue(&__Mutex__->Waiters, "MutexWaiters", __Err__);
 }
 
 void
 AcquireMutex(Mutex* __Mutex__, SysErr* __Err__)
 {
-    uint32_t CpuId = GetCurrentCpuId();
+    uint32_t CpuId;
+    Thread*  Self = __MutexSelf__(&CpuId);
 
-    if (__Mutex__->Owner == CpuId)
+    if (__MutexMine__(__Mutex__, Self, CpuId))
     {
         __Mutex__->RecursionCount++;
         SlotError(__Err__, -Recursion);
         return;
     }
 
+    uint32_t Spins = 0;
     while (1)
     {
-        uint32_t Expected = 0; /* Expect the lock to be free (0) */
-        if (__atomic_compare_exchange_n(
-                &__Mutex__->Lock, &Expected, 1, false, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED))
+        if (__MutexTake__(__Mutex__, Self, CpuId))
         {
-            /* Successfully acquired the lock */
-            __Mutex__->Owner          = CpuId;
-            __Mutex__->RecursionCount = 1;
-            break;
+            return;
+        }
+
+        /* Adaptive: spin while the holder runs, nothing to sleep as before the scheduler */
+        if (!Self || !MutexBlocking || (Spins < MutexSpinMax && __HolderRunning__(__Mutex__)))
+        {
+            Spins++;
+            __asm__ volatile("pause");
+            continue;
+        }
+
+        AcquireSpinLock(&__Mutex__->Waiters.Lock, __Err__);
+
+        /* Flag the sleeper so release takes the slow path, unless it was let go meanwhile */
+        uint32_t Seen = MutexHeld;
+        if (!__atomic_compare_exchange_n(&__Mutex__->Lock,
+                                         &Seen,
+                                         MutexContended,
+                                         false,
+                                         __ATOMIC_ACQ_REL,
+                                         __ATOMIC_ACQUIRE) &&
+            Seen == MutexFree)
+        {
+            ReleaseSpinLock(&__Mutex__->Waiters.Lock, __Err__);
+            continue;
         }
 
-        /* Lock is held by another CPU, spin with pause for efficiency */
-        __asm__ volatile("pause");
+        __Mutex__->Sleeps++;
+        WaitQueueBlock(&__Mutex__->Waiters, WaitReasonMutex, __Mutex__, __Err__);
+
+        /* FIFO handoff: the releaser made us the holder before waking us */
+        if (__atomic_load_n(&__Mutex__->Holder, __ATOMIC_ACQUIRE) == Self)
+        {
+            __Mutex__->Owner          = GetCurrentCpuId();
+            __Mutex__->RecursionCount = 1;
+            return;
+        }
+        Spins = 0;
     }
 }
 
 void
 ReleaseMutex(Mutex* __Mutex__, SysErr* __Err__)
 {
-    uint32_t CpuId = GetCurrentCpuId();
+    uint32_t CpuId;
+    Thread*  Self = __MutexSelf__(&CpuId);
 
-    if (__Mutex__->Owner != CpuId)
+    if (!__MutexMine__(__Mutex__, Self, CpuId))
     {
         SlotError(__Err__, -BadEntity);
         return;
@@ -53,34 +151,59 @@ ReleaseMutex(Mutex* __Mutex__, SysErr* __Err__)
 
     __Mutex__->RecursionCount--;
 
-    if (__Mutex__->RecursionCount == 0)
+    if (__Mutex__->RecursionCount != 0)
     {
-        __Mutex__->Owner = 0xFFFFFFFF;                           /* Reset owner to kernel/none */
-        __atomic_store_n(&__Mutex__->Lock, 0, __ATOMIC_RELEASE); /* Unlock atomically */
+        return;
+    }
+
+    __Mutex__->Owner  = 0xFFFFFFFF; /* Reset owner to kernel/none */
+    __Mutex__->Holder = NULL;
+
+    /* Nobody asleep on it, plain unlock */
+    uint32_t Expected = MutexHeld;
+    if (__atomic_compare_exchange_n(
+            &__Mutex__->Lock, &Expected, MutexFree, false, __ATOMIC_RELEASE, __ATOMIC_RELAXED))
+    {
+        return;
+    }
+
+    AcquireSpinLock(&__Mutex__->Waiters.Lock, __Err__);
+
+    Thread* Next = WaitQueuePop(&__Mutex__->Waiters);
+    if (Next)
+    {
+        /* Hand it straight to the oldest waiter, the lock word never reads free */
+        Next->WaitingOn = NULL;
+        __atomic_store_n(&__Mutex__->Holder, Next, __ATOMIC_RELEASE);
+        __atomic_store_n(&__Mutex__->Lock,
+                         __Mutex__->Waiters.Count ? MutexContended : MutexHeld,
+                         __ATOMIC_RELEASE);
+    }
+    else
+    {
+        __atomic_store_n(&__Mutex__->Lock, MutexFree, __ATOMIC_RELEASE);
+    }
+
+    ReleaseSpinLock(&__Mutex__->Waiters.Lock, __Err__);
+
+    if (Next)
+    {
+        ThreadUnblock(Next, __Err__);
     }
 }
 
 bool
 TryAcquireMutex(Mutex* __Mutex__)
 {
-    uint32_t CpuId = GetCurrentCpuId();
+    uint32_t CpuId;
+    Thread*  Self = __MutexSelf__(&CpuId);
 
-    if (__Mutex__->Owner == CpuId)
+    if (__MutexMine__(__Mutex__, Self, CpuId))
     {
         __Mutex__->RecursionCount++;
         return true;
     }
 
-    uint32_t Expected = 0;
-    if (__atomic_compare_exchange_n(
-            &__Mutex__->Lock, &Expected, 1, false, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED))
-    {
-        /* Successfully acquired */
-        __Mutex__->Owner          = CpuId;
-        __Mutex__->RecursionCount = 1;
-        return true;
-    }
-
-    /* Failed to acquire */
-    return false;
+    /* Successfully acquired, or failed to */
+    return __MutexTake__(__Mutex__, Self, CpuId);
 }
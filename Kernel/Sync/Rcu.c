@@ -0,0 +1,68 @@
+#include <Errnos.h>
+#include <PerCPUData.h>
+#include <SMP.h>
+#include <Sync.h>
+
+/*One line per CPU, readers only ever write their own*/
+typedef struct
+{
+    uint64_t Seq;   /*Odd while a reader is inside*/
+    uint32_t Depth; /*Nested read sections, only the outermost moves Seq*/
+
+} __attribute__((aligned(64))) RcuCpu;
+
+static RcuCpu RcuCpus[MaxCPUs];
+
+uint64_t
+RcuReadLock(void)
+{
+    uint64_t Flags;
+    __asm__ volatile("pushfq; popq %0; cli" : "=r"(Flags)::"memory");
+
+    RcuCpu* Cpu = &RcuCpus[ThisCpuId()];
+    if (!Cpu->Depth++)
+    {
+        /*Locked add, the list loads that follow cannot pass it*/
+        __atomic_fetch_add(&Cpu->Seq, 1, __ATOMIC_SEQ_CST);
+    }
+    return Flags;
+}
+
+void
+RcuReadUnlock(uint64_t __Flags__)
+{
+    RcuCpu* Cpu = &RcuCpus[ThisCpuId()];
+    if (!--Cpu->Depth)
+    {
+        __atomic_fetch_add(&Cpu->Seq, 1, __ATOMIC_RELEASE);
+    }
+
+    __asm__ volatile("pushq %0; popfq" ::"r"(__Flags__) : "memory");
+}
+
+void
+SynchronizeRcu(void)
+{
+    /*Orders the caller's unlink before the sequence loads below*/
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+
+    uint32_t Self = ThisCpuId();
+    for (uint32_t CpuId = 0; CpuId < Smp.CpuCount && CpuId < MaxCPUs; CpuId++)
+    {
+        if (CpuId == Self)
+        {
+            continue;
+        }
+
+        /*Only a reader that was already inside can still see the old pointer*/
+        uint64_t Seq = __atomic_load_n(&RcuCpus[CpuId].Seq, __ATOMIC_ACQUIRE);
+        if (!(Seq & 1))
+        {
+            continue;
+        }
+        while (__atomic_load_n(&RcuCpus[CpuId].Seq, __ATOMIC_ACQUIRE) == Seq)
+        {
+            __asm__ volatile("pause");
+        }
+    }
+}
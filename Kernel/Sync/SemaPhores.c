@@ -1,3 +1,5 @@
+#include <AxeSchd.h>
+#include <AxeThreads.h>
 #include <Errnos.h>
 #include <SMP.h>
 #include <Sync.h>
@@ -8,11 +10,9 @@ InitializeSemaphore(Semaphore*  __Semaphore__,
                     const char* __Name__,
                     SysErr*     __Err__)
 {
-    __Semaphore__->Count     = __InitialCount__; /* Set initial count */
-    __Semaphore__->WaitQueue = 0;                /* No waiting threads initially */
-    InitializeSpinLock(
-        &__Semaphore__->QueueLock, "SemaphoreQueue", __Err__); /* Initialize queue lock */
-    __Semaphore__->Name = __Name__;                            /* Assign name for debugging */
+    __Semaphore__->Count = __InitialCount__; /* Set initial count */
+    __Semaphore__->Name  = __Name__;         /* Assign name for debugging */
+    InitializeWaitQueue(&__Semaphore__->Waiters, "SemaphoreQueue", __Err__);
 }
 
 void
@@ -20,30 +20,63 @@ AcquireSemaphore(Semaphore* __Semaphore__, SysErr* __Err__ _unused)
 {
     while (1)
     {
-        int32_t CurrentCount = __atomic_load_n(&__Semaphore__->Count, __ATOMIC_ACQUIRE);
+        if (TryAcquireSemaphore(__Semaphore__))
+        {
+            break; /* Successfully acquired */
+        }
+
+        AcquireSpinLock(&__Semaphore__->Waiters.Lock, __Err__);
+
+        /* Releases count up under this lock, so a retry here cannot miss one */
+        if (TryAcquireSemaphore(__Semaphore__))
+        {
+            ReleaseSpinLock(&__Semaphore__->Waiters.Lock, __Err__);
+            break;
+        }
+
+        uint32_t CpuId = GetCurrentCpuId();
+        Thread*  Self  = CpuSchedulers[CpuId].CurrentThread;
+
+        /* No thread to put to sleep yet, spin as before */
+        if (!Self || Self == CpuSchedulers[CpuId].IdleThread)
+        {
+            ReleaseSpinLock(&__Semaphore__->Waiters.Lock, __Err__);
+            __asm__ volatile("pause");
+            continue;
+        }
 
-        if (CurrentCount > 0)
+        WaitQueueBlock(&__Semaphore__->Waiters, WaitReasonSemaphore, __Semaphore__, __Err__);
+
+        /* The releaser passed its count straight to us */
+        if (!__atomic_load_n(&Self->WaitingOn, __ATOMIC_ACQUIRE))
         {
-            if (__atomic_compare_exchange_n(&__Semaphore__->Count,
-                                            &CurrentCount,
-                                            CurrentCount - 1,
-                                            false,
-                                            __ATOMIC_ACQUIRE,
-                                            __ATOMIC_RELAXED))
-            {
-                break; /* Successfully acquired */
-            }
-            /* Compare-exchange failed, retry */
+            break;
         }
-        /* Spin */
-        __asm__ volatile("pause");
     }
 }
 
 void
 ReleaseSemaphore(Semaphore* __Semaphore__, SysErr* __Err__ _unused)
 {
-    __atomic_fetch_add(&__Semaphore__->Count, 1, __ATOMIC_RELEASE);
+    AcquireSpinLock(&__Semaphore__->Waiters.Lock, __Err__);
+
+    /* Oldest waiter gets the count, it never becomes visible to a barging TryAcquire */
+    Thread* Next = WaitQueuePop(&__Semaphore__->Waiters);
+    if (Next)
+    {
+        __atomic_store_n(&Next->WaitingOn, NULL, __ATOMIC_RELEASE);
+    }
+    else
+    {
+        __atomic_fetch_add(&__Semaphore__->Count, 1, __ATOMIC_RELEASE);
+    }
+
+    ReleaseSpinLock(&__Semaphore__->Waiters.Lock, __Err__);
+
+    if (Next)
+    {
+        ThreadUnblock(Next, __Err__);
+    }
 }
 
 bool
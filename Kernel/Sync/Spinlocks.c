@@ -1,9 +1,25 @@
 #include <Errnos.h>
+#include <PerCPUData.h>
 #include <SMP.h>
 #include <Sync.h>
 
-SpinLock        ConsoleLock;
-static uint64_t SavedFlags[MaxCPUs];
+SpinLock ConsoleLock;
+
+/*Interrupt flag from before the outermost acquire on this CPU, and how many are held*/
+static PerCpu(uint64_t, SavedFlags);
+static PerCpu(uint32_t, HeldLocks);
+
+/*Called with interrupts off, only the first lock taken keeps the flags it found*/
+static inline void
+__LockHeld__(uint64_t __Flags__)
+{
+    uint32_t Held = ThisCpuRead(HeldLocks);
+    if (!Held)
+    {
+        ThisCpuWrite(SavedFlags, __Flags__);
+    }
+    ThisCpuWrite(HeldLocks, Held + 1);
+}
 
 void
 InitializeSpinLock(SpinLock* __Lock__, const char* __Name__, SysErr* __Err__ _unused)
@@ -16,11 +32,12 @@ InitializeSpinLock(SpinLock* __Lock__, const char* __Name__, SysErr* __Err__ _un
 void
 AcquireSpinLock(SpinLock* __Lock__, SysErr* __Err__ _unused)
 {
-    uint32_t CpuId = GetCurrentCpuId();
-
     uint64_t Flags;
     __asm__ volatile("pushfq; popq %0; cli" : "=r"(Flags)::"memory");
 
+    /*Read with interrupts off, we cannot migrate between here and the release*/
+    uint32_t CpuId = ThisCpuId();
+
     while (1)
     {
         uint32_t Expected = 0; /* Expect the lock to be free (0) */
@@ -28,8 +45,8 @@ AcquireSpinLock(SpinLock* __Lock__, SysErr* __Err__ _unused)
                 &__Lock__->Lock, &Expected, 1, false, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED))
         {
             /* Successfully acquired the lock */
-            __Lock__->CpuId   = CpuId;
-            SavedFlags[CpuId] = Flags; /* Save flags for this CPU */
+            __Lock__->CpuId = CpuId;
+            __LockHeld__(Flags);
             break;
         }
         /* Lock is held by another CPU, spin with pause for efficiency */
@@ -40,26 +57,36 @@ AcquireSpinLock(SpinLock* __Lock__, SysErr* __Err__ _unused)
 void
 ReleaseSpinLock(SpinLock* __Lock__, SysErr* __Err__ _unused)
 {
-    uint32_t CpuId = GetCurrentCpuId();
-
-    uint64_t Flags = SavedFlags[CpuId];
+    uint64_t Flags = ThisCpuRead(SavedFlags);
+    uint32_t Held  = ThisCpuRead(HeldLocks) - 1;
+    ThisCpuWrite(HeldLocks, Held);
 
     __Lock__->CpuId = 0xFFFFFFFF;                           /* Reset owner to none */
     __atomic_store_n(&__Lock__->Lock, 0, __ATOMIC_RELEASE); /* Unlock */
 
-    __asm__ volatile("pushq %0; popfq" ::"r"(Flags) : "memory");
+    /*An inner release leaves interrupts off, the outer lock is still held*/
+    if (!Held)
+    {
+        __asm__ volatile("pushq %0; popfq" ::"r"(Flags) : "memory");
+    }
 }
 
+/*Pairs with ReleaseSpinLock like AcquireSpinLock does*/
 bool
 TryAcquireSpinLock(SpinLock* __Lock__)
 {
+    uint64_t Flags;
+    __asm__ volatile("pushfq; popq %0; cli" : "=r"(Flags)::"memory");
+
     uint32_t Expected = 0;
     if (__atomic_compare_exchange_n(
             &__Lock__->Lock, &Expected, 1, false, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED))
     {
-        __Lock__->CpuId = GetCurrentCpuId();
+        __Lock__->CpuId = ThisCpuId();
+        __LockHeld__(Flags);
         return true;
     }
 
+    __asm__ volatile("pushq %0; popfq" ::"r"(Flags) : "memory");
     return false;
 }
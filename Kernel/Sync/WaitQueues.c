@@ -0,0 +1,89 @@
+#include <AxeSchd.h>
+#include <AxeThreads.h>
+#include <Errnos.h>
+#include <SMP.h>
+#include <Sync.h>
+
+void
+InitializeWaitQueue(WaitQueue* __Queue__, const char* __Name__, SysErr* __Err__)
+{
+    __Queue__->Head  = NULL;
+    __Queue__->Tail  = NULL;
+    __Queue__->Count = 0;
+    InitializeSpinLock(&__Queue__->Lock, __Name__, __Err__);
+}
+
+/* Caller holds the queue lock, it is dropped once the thread is queued and marked blocked */
+void
+WaitQueueBlock(WaitQueue* __Queue__, uint32_t __Reason__, void* __On__, SysErr* __Err__)
+{
+    Thread* Current = ThisThread();
+    if (Probe_IF_Error(Current) || !Current)
+    {
+        ReleaseSpinLock(&__Queue__->Lock, __Err__);
+        SlotError(__Err__, -NoOperations);
+        return;
+    }
+
+    Current->WaitNext = NULL;
+    if (__Queue__->Tail)
+    {
+        __Queue__->Tail->WaitNext = Current;
+    }
+    else
+    {
+        __Queue__->Head = Current;
+    }
+    __Queue__->Tail = Current;
+    __Queue__->Count++;
+
+    ThreadBlock(&__Queue__->Lock, __Reason__, __On__, __Err__);
+}
+
+/* Oldest waiter. Caller holds the queue lock and unblocks it after dropping the lock */
+Thread*
+WaitQueuePop(WaitQueue* __Queue__)
+{
+    Thread* Waiter = __Queue__->Head;
+    if (!Waiter)
+    {
+        return NULL;
+    }
+
+    __Queue__->Head = Waiter->WaitNext;
+    if (!__Queue__->Head)
+    {
+        __Queue__->Tail = NULL;
+    }
+    __Queue__->Count--;
+    Waiter->WaitNext = NULL;
+
+    return Waiter;
+}
+
+uint32_t
+WaitQueueWakeAll(WaitQueue* __Queue__, SysErr* __Err__)
+{
+    AcquireSpinLock(&__Queue__->Lock, __Err__);
+
+    Thread* Waiter   = __Queue__->Head;
+    __Queue__->Head  = NULL;
+    __Queue__->Tail  = NULL;
+    __Queue__->Count = 0;
+
+    ReleaseSpinLock(&__Queue__->Lock, __Err__);
+
+    uint32_t Woken = 0;
+    while (Waiter)
+    {
+        /*Read the link first, once unblocked it may queue itself somewhere else*/
+        Thread* Next      = Waiter->WaitNext;
+        Waiter->WaitNext  = NULL;
+        Waiter->WaitingOn = NULL;
+        ThreadUnblock(Waiter, __Err__);
+        Woken++;
+        Waiter = Next;
+    }
+
+    return Woken;
+}
@@ -21,8 +21,11 @@
 #include <POSIXSignals.h>
 #include <SMP.h>
 #include <Serial.h>
+#include <ShmFs.h>
+#include <String.h>
 #include <SymAP.h>
 #include <Sync.h>
+#include <SysABI.h>
 #include <Syscall.h>
 #include <Timer.h>
 #include <VFS.h>
@@ -36,7 +39,12 @@ __GetCurrentProc__(void)
 {
     uint32_t CpuId = GetCurrentCpuId();
     Thread*  Thrd  = GetCurrentThread(CpuId);
-    return Thrd ? PosixFind((long)Thrd->ProcessId) : NULL;
+    if (!Thrd)
+    {
+        return NULL;
+    }
+    /*Every syscall lands here, user threads carry their process so no lookup is paid*/
+    return Thrd->Proc ? Thrd->Proc : PosixFind((long)Thrd->ProcessId);
 }
 
 int64_t
@@ -373,6 +381,288 @@ __Handle__SchedYield(uint64_t __U1__,
     return SysOkay;
 }
 
+/* Linux sched_param is a single int, a pid of 0 names the caller. Caller is inside RcuReadLock */
+static Thread*
+__SchedTarget__(uint64_t __Pid__)
+{
+    if (!__Pid__)
+    {
+        return GetCurrentThread(GetCurrentCpuId());
+    }
+
+    PosixProc* Proc = PosixFind((long)__Pid__);
+    if (Probe_IF_Error(Proc) || !Proc)
+    {
+        return NULL;
+    }
+    return Proc->MainThread;
+}
+
+int64_t
+__Handle__SchedSetscheduler(uint64_t __Pid__,
+                            uint64_t __Policy__,
+                            uint64_t __ParamPtr__,
+                            uint64_t __U4__,
+                            uint64_t __U5__,
+                            uint64_t __U6__)
+{
+    if (Probe_IF_Error(__ParamPtr__) || !__ParamPtr__ || !UserRangeValid(__ParamPtr__, sizeof(int)))
+    {
+        return -BadArgs;
+    }
+
+    /*User memory stays outside the read section, which runs with interrupts off*/
+    int Priority = *(int*)__ParamPtr__;
+    if (Priority < 0)
+    {
+        return -BadArgs;
+    }
+
+    uint64_t Flags  = RcuReadLock();
+    Thread*  Target = __SchedTarget__(__Pid__);
+    if (Probe_IF_Error(Target) || !Target)
+    {
+        RcuReadUnlock(Flags);
+        return -NoSuch;
+    }
+
+    int Status = SetThreadPolicy(Target, (uint32_t)__Policy__, (uint32_t)Priority);
+    RcuReadUnlock(Flags);
+    return Status;
+}
+
+int64_t
+__Handle__SchedGetscheduler(uint64_t __Pid__,
+                            uint64_t __U2__,
+                            uint64_t __U3__,
+                            uint64_t __U4__,
+                            uint64_t __U5__,
+                            uint64_t __U6__)
+{
+    uint64_t Flags  = RcuReadLock();
+    Thread*  Target = __SchedTarget__(__Pid__);
+    if (Probe_IF_Error(Target) || !Target)
+    {
+        RcuReadUnlock(Flags);
+        return -NoSuch;
+    }
+
+    int64_t Policy = (int64_t)Target->Policy;
+    RcuReadUnlock(Flags);
+    return Policy;
+}
+
+int64_t
+__Handle__SchedSetparam(uint64_t __Pid__,
+                        uint64_t __ParamPtr__,
+                        uint64_t __U3__,
+                        uint64_t __U4__,
+                        uint64_t __U5__,
+                        uint64_t __U6__)
+{
+    if (Probe_IF_Error(__ParamPtr__) || !__ParamPtr__ || !UserRangeValid(__ParamPtr__, sizeof(int)))
+    {
+        return -BadArgs;
+    }
+
+    int Priority = *(int*)__ParamPtr__;
+    if (Priority < 0)
+    {
+        return -BadArgs;
+    }
+
+    uint64_t Flags  = RcuReadLock();
+    Thread*  Target = __SchedTarget__(__Pid__);
+    if (Probe_IF_Error(Target) || !Target)
+    {
+        RcuReadUnlock(Flags);
+        return -NoSuch;
+    }
+
+    int Status = SetThreadPolicy(Target, Target->Policy, (uint32_t)Priority);
+    RcuReadUnlock(Flags);
+    return Status;
+}
+
+int64_t
+__Handle__SchedGetparam(uint64_t __Pid__,
+                        uint64_t __ParamPtr__,
+                        uint64_t __U3__,
+                        uint64_t __U4__,
+                        uint64_t __U5__,
+                        uint64_t __U6__)
+{
+    if (Probe_IF_Error(__ParamPtr__) || !__ParamPtr__ || !UserRangeValid(__ParamPtr__, sizeof(int)))
+    {
+        return -BadArgs;
+    }
+
+    uint64_t Flags  = RcuReadLock();
+    Thread*  Target = __SchedTarget__(__Pid__);
+    if (Probe_IF_Error(Target) || !Target)
+    {
+        RcuReadUnlock(Flags);
+        return -NoSuch;
+    }
+
+    int Priority = (int)Target->RtPriority;
+    RcuReadUnlock(Flags);
+
+    *(int*)__ParamPtr__ = Priority;
+    return SysOkay;
+}
+
+int64_t
+__Handle__SchedGetPriorityMax(uint64_t __Policy__,
+                              uint64_t __U2__,
+                              uint64_t __U3__,
+                              uint64_t __U4__,
+                              uint64_t __U5__,
+                              uint64_t __U6__)
+{
+    switch (__Policy__)
+    {
+        case ThreadPolicyNormal:
+            return 0;
+        case ThreadPolicyFifo:
+        case ThreadPolicyRr:
+            return ThreadRtPriorityMax;
+        default:
+            return -BadArgs;
+    }
+}
+
+int64_t
+__Handle__SchedGetPriorityMin(uint64_t __Policy__,
+                              uint64_t __U2__,
+                              uint64_t __U3__,
+                              uint64_t __U4__,
+                              uint64_t __U5__,
+                              uint64_t __U6__)
+{
+    switch (__Policy__)
+    {
+        case ThreadPolicyNormal:
+            return 0;
+        case ThreadPolicyFifo:
+        case ThreadPolicyRr:
+            return 1;
+        default:
+            return -BadArgs;
+    }
+}
+
+int64_t
+__Handle__SchedRrGetInterval(uint64_t __Pid__,
+                             uint64_t __TsPtr__,
+                             uint64_t __U3__,
+                             uint64_t __U4__,
+                             uint64_t __U5__,
+                             uint64_t __U6__)
+{
+    if (Probe_IF_Error(__TsPtr__) || !__TsPtr__ || !UserRangeValid(__TsPtr__, 2 * sizeof(long)))
+    {
+        return -BadArgs;
+    }
+
+    uint64_t Flags  = RcuReadLock();
+    Thread*  Target = __SchedTarget__(__Pid__);
+    if (Probe_IF_Error(Target) || !Target)
+    {
+        RcuReadUnlock(Flags);
+        return -NoSuch;
+    }
+
+    /*Only Rr has a fixed turn, 0 means none*/
+    uint64_t Slice = Target->Policy == ThreadPolicyRr ? SchedRrSliceNs : 0;
+    RcuReadUnlock(Flags);
+
+    struct
+    {
+        long Sec;
+        long Nsec;
+    }* ts = (void*)__TsPtr__;
+
+    ts->Sec  = (long)(Slice / 1000000000ULL);
+    ts->Nsec = (long)(Slice % 1000000000ULL);
+    return SysOkay;
+}
+
+/* Linux layout, bit N of the byte array is CPU N. Bits past our mask width are ignored */
+int64_t
+__Handle__SchedSetaffinity(uint64_t __Pid__,
+                           uint64_t __Len__,
+                           uint64_t __MaskPtr__,
+                           uint64_t __U4__,
+                           uint64_t __U5__,
+                           uint64_t __U6__)
+{
+    if (Probe_IF_Error(__MaskPtr__) || !__MaskPtr__ || !__Len__)
+    {
+        return -BadArgs;
+    }
+
+    CpuMask  Mask;
+    uint64_t Bytes = __Len__ < CpuMaskBytes ? __Len__ : CpuMaskBytes;
+    if (!UserRangeValid(__MaskPtr__, Bytes))
+    {
+        return -BadArgs;
+    }
+
+    CpuMaskZero(&Mask);
+    memcpy(&Mask, (const void*)__MaskPtr__, Bytes);
+
+    if (!CpuMaskWeight(&Mask, Smp.CpuCount))
+    {
+        return -BadArgs;
+    }
+
+    uint64_t Flags  = RcuReadLock();
+    Thread*  Target = __SchedTarget__(__Pid__);
+    if (Probe_IF_Error(Target) || !Target)
+    {
+        RcuReadUnlock(Flags);
+        return -NoSuch;
+    }
+
+    SysErr  err;
+    SysErr* Error = &err;
+    SetThreadAffinity(Target, &Mask, Error);
+    RcuReadUnlock(Flags);
+    return SysOkay;
+}
+
+/* Returns the bytes written, like Linux */
+int64_t
+__Handle__SchedGetaffinity(uint64_t __Pid__,
+                           uint64_t __Len__,
+                           uint64_t __MaskPtr__,
+                           uint64_t __U4__,
+                           uint64_t __U5__,
+                           uint64_t __U6__)
+{
+    uint64_t Bytes = __Len__ < CpuMaskBytes ? __Len__ : CpuMaskBytes;
+    if (Probe_IF_Error(__MaskPtr__) || !__MaskPtr__ || (__Len__ & 7) ||
+        __Len__ * 8 < Smp.CpuCount || !UserRangeValid(__MaskPtr__, Bytes))
+    {
+        return -BadArgs;
+    }
+
+    uint64_t Flags  = RcuReadLock();
+    Thread*  Target = __SchedTarget__(__Pid__);
+    if (Probe_IF_Error(Target) || !Target)
+    {
+        RcuReadUnlock(Flags);
+        return -NoSuch;
+    }
+
+    CpuMask Mask = Target->CpuAffinity;
+    RcuReadUnlock(Flags);
+
+    memcpy((void*)__MaskPtr__, &Mask, Bytes);
+    return (int64_t)Bytes;
+}
+
 int64_t
 __Handle__Nanosleep(uint64_t __ReqPtr__,
                     uint64_t __RemPtr__,
@@ -710,6 +1000,133 @@ __BrkLookup__(long __Pid__)
     return Enter;
 }
 
+/*
+    Map Len bytes of F starting at Off. Pages the fs can hand out in place are
+    borrowed (no copy) and recorded so the fs gets them back on munmap/exit;
+    everything else, including the tail past EOF, is read into fresh pages.
+*/
+static int64_t
+__MmapFile__(PosixProc* __Proc__,
+             uint64_t   __Va__,
+             uint64_t   __Len__,
+             uint64_t   __PteFlags__,
+             int        __Shared__,
+             File*      __F__,
+             uint64_t   __Off__)
+{
+    VfsStat St;
+    if (VfsFstats(__F__, &St) != SysOkay || St.Type != VNodeFILE)
+    {
+        return -BadEntry;
+    }
+
+    VirtualMemorySpace* Space = __Proc__->Space;
+
+    uint64_t Size  = (St.Size > 0) ? (uint64_t)St.Size : 0;
+    uint64_t Avail = (__Off__ < Size) ? (Size - __Off__) : 0;
+    uint64_t Whole = __AlignUp__((Avail < __Len__) ? Avail : __Len__, PageSize);
+    uint64_t Done  = 0;
+
+    /* Private writable borrowed pages start read only and COW on first write */
+    uint64_t BorrowFlags = __PteFlags__ | PTEBORROWED;
+    if (__Shared__)
+    {
+        BorrowFlags |= PTESHARED;
+    }
+    else if (__PteFlags__ & PTEWRITABLE)
+    {
+        BorrowFlags = (__PteFlags__ & ~PTEWRITABLE) | PTEBORROWED | PTECOW;
+    }
+
+    /* Borrow page by page for as long as the fs agrees, the rest is copied */
+    for (; Done < Whole; Done += PageSize)
+    {
+        void* Src = NULL;
+        if (VfsMap(__F__, &Src, (long)(__Off__ + Done), PageSize) != SysOkay || !Src)
+        {
+            break;
+        }
+        if (((uint64_t)Src % PageSize) != 0 || (uint64_t)Src < Pmm.HhdmOffset)
+        {
+            VfsUnmap(__F__, Src, PageSize);
+            break;
+        }
+
+        if (MapPage(Space, __Va__ + Done, VirtToPhys(Src), BorrowFlags) != SysOkay)
+        {
+            VfsUnmap(__F__, Src, PageSize);
+            if (Done)
+            {
+                UnmapUserRange(Space, __Va__, Done);
+                __F__->Node->Ops->Unmap(__F__->Node, NULL, (long)Done);
+            }
+            return -ErrReturn;
+        }
+    }
+
+    if (Done && PosixMapRecAdd(__Proc__, __Va__, Done, (long)__Off__, __F__->Node) != SysOkay)
+    {
+        UnmapUserRange(Space, __Va__, Done);
+        __F__->Node->Ops->Unmap(__F__->Node, NULL, (long)Done);
+        return -TooMany;
+    }
+
+    if (Done >= __Len__)
+    {
+        return SysOkay;
+    }
+
+    SysErr  err;
+    SysErr* Error = &err;
+
+    uint64_t Lent = Done;
+
+    for (; Done < __Len__; Done += PageSize)
+    {
+        uint64_t Phys = AllocPage();
+        if (!Phys)
+        {
+            break;
+        }
+
+        uint8_t* Page = (uint8_t*)PhysToVirt(Phys);
+        memset(Page, 0, PageSize);
+
+        uint64_t At = __Off__ + Done;
+        if (At < Size)
+        {
+            /* Positional, a thread sharing the fd never sees its offset move */
+            long Want = (long)(((Size - At) < PageSize) ? (Size - At) : PageSize);
+            VfsPread(__F__, Page, Want, (long)At);
+        }
+
+        if (MapPage(Space, __Va__ + Done, Phys, __PteFlags__) != SysOkay)
+        {
+            FreePage(Phys, Error);
+            break;
+        }
+    }
+
+    if (Done < __Len__)
+    {
+        UnmapUserRange(Space, __Va__, Done);
+        if (Lent)
+        {
+            PosixMapRecDrop(__Proc__, __Va__, Lent);
+        }
+        return -BadAlloc;
+    }
+
+    return SysOkay;
+}
+
+/* The gap under the stack reservation has to stay empty to catch overflows */
+static inline int
+__InStackGap__(uint64_t __Va__, uint64_t __Len__)
+{
+    return __Va__ < UserStackLow && __Va__ + __Len__ > UserStackLow - UserStackGuard;
+}
+
 int64_t
 __Handle__Mmap(uint64_t __Addr__,
                uint64_t __Len__,
@@ -724,13 +1141,31 @@ __Handle__Mmap(uint64_t __Addr__,
         return -BadSystemcall;
     }
 
-    uint64_t VaBase = (__Addr__ == 0) ? __AlignUp__(UserVirtualBase + 0x01000000ULL, PageSize)
-                                      : __AlignDown__(__Addr__, PageSize);
     uint64_t MapLen = __AlignUp__(__Len__, PageSize);
+    uint64_t VaBase;
+
+    if (__Addr__ == 0)
+    {
+        /* Anything 2MB or larger starts 2MB aligned so it can take huge pages */
+        uint64_t Align = (MapLen >= HugePageSize) ? HugePageSize : PageSize;
+        uint64_t Next  = Proc->MmapNext ? Proc->MmapNext : UserMmapBase;
+
+        VaBase         = __AlignUp__(Next, Align);
+        Proc->MmapNext = VaBase + MapLen;
+    }
+    else
+    {
+        VaBase = __AlignDown__(__Addr__, PageSize);
+
+        if (!UserRangeValid(VaBase, MapLen) || __InStackGap__(VaBase, MapLen))
+        {
+            return -BadArgs;
+        }
+    }
 
     /* default NX; clear NX if PROT_EXEC (0x4) present */
     uint64_t PteFlags = PTEPRESENT | PTEUSER | PTEWRITABLE;
-    if (__Prot__ & 0x4)
+    if (__Prot__ & ProtExec)
     {
         PteFlags &= ~PTENOEXECUTE;
     }
@@ -739,12 +1174,74 @@ __Handle__Mmap(uint64_t __Addr__,
         PteFlags |= PTENOEXECUTE;
     }
 
-    (void)__Fd__;
-    (void)__Off__;
-    int RIdx = VirtMapRangeZeroed(Proc->Space, VaBase, MapLen, PteFlags);
+    if (!(__Flags__ & MapAnonymous))
+    {
+        if (!Proc->Fds || (__Off__ % PageSize) != 0)
+        {
+            return -BadArgs;
+        }
+
+        File* F = PosixFdFile(Proc->Fds, (int)__Fd__);
+        if (Probe_IF_Error(F) || !F)
+        {
+            return -BadEntry;
+        }
+
+        /* Shared stores have to land in the file, read only mounts cannot take them */
+        if ((__Flags__ & MapShared) && (__Prot__ & ProtWrite) && F->Node && F->Node->Sb &&
+            F->Node->Sb->Flags == VMFlgRDONLY)
+        {
+            return -NoWrite;
+        }
+
+        return (__MmapFile__(Proc,
+                             VaBase,
+                             MapLen,
+                             (__Prot__ & ProtWrite) ? PteFlags : (PteFlags & ~PTEWRITABLE),
+                             (__Flags__ & MapShared) != 0,
+                             F,
+                             __Off__) == SysOkay)
+                   ? (int64_t)VaBase
+                   : -BadSystemcall;
+    }
+
+    /* Anonymous shared memory is an unnamed memfd that only lives in its mappings */
+    if (__Flags__ & MapShared)
+    {
+        File* F = ShmMemfdOpen("anon", 0);
+        if (Probe_IF_Error(F) || !F)
+        {
+            return -BadAlloc;
+        }
+
+        int64_t Rc = VfsFtruncate(F, (long)MapLen);
+        if (Rc == SysOkay)
+        {
+            Rc = __MmapFile__(Proc, VaBase, MapLen, PteFlags, 1, F, 0);
+        }
+        VfsClose(F);
+
+        return (Rc == SysOkay) ? (int64_t)VaBase : -BadSystemcall;
+    }
+
+    /* Anonymous memory is only reserved, first touch backs it, unless asked to prefault */
+    int RIdx;
+    if (__Flags__ & MapPopulate)
+    {
+        RIdx = MapUserRange(Proc->Space, VaBase, MapLen, PteFlags);
+    }
+    else
+    {
+        /* Nothing is committed, so only refuse what could never fit (MAP_NORESERVE skips it) */
+        if (!(__Flags__ & MapNoreserve) && (MapLen / PageSize) > Pmm.Stats.FreePages)
+        {
+            return -BadAlloc;
+        }
+        RIdx = ReserveUserRange(Proc->Space, VaBase, MapLen, PteFlags);
+    }
     if (RIdx != 0)
     {
-        PError("mmap: VirtMapRangeZeroed failed base=0x%llx len=0x%llx\n",
+        PError("mmap: MapUserRange failed base=0x%llx len=0x%llx\n",
                (unsigned long long)VaBase,
                (unsigned long long)MapLen);
         return -BadSystemcall;
@@ -772,19 +1269,330 @@ __Handle__Munmap(uint64_t __Addr__,
         return -BadSystemcall;
     }
 
+    /* Kernel frames and page tables are shared by every space, never reachable from here */
+    if (!UserRangeValid(__Addr__, __Len__))
+    {
+        return -BadArgs;
+    }
+
     uint64_t Va  = __AlignDown__(__Addr__, PageSize);
     uint64_t End = __AlignUp__(__Addr__ + __Len__, PageSize);
 
-    for (; Va < End; Va += PageSize)
+    if (UnmapUserRange(Proc->Space, Va, End - Va) != SysOkay)
+    {
+        return -BadSystemcall;
+    }
+
+    /* Lent frames go back to their fs only once no PTE points at them */
+    PosixMapRecDrop(Proc, Va, End - Va);
+    SysErr  err;
+    SysErr* Error = &err;
+    FlushAllTlb(Error);
+    return SysOkay;
+}
+
+int64_t
+__Handle__Mprotect(uint64_t __Addr__,
+                   uint64_t __Len__,
+                   uint64_t __Prot__,
+                   uint64_t __U4__,
+                   uint64_t __U5__,
+                   uint64_t __U6__)
+{
+    (void)__U4__;
+    (void)__U5__;
+    (void)__U6__;
+
+    PosixProc* Proc = __GetCurrentProc__();
+    if (Probe_IF_Error(Proc) || !Proc || !Proc->Space || (__Addr__ % PageSize) != 0 ||
+        !UserRangeValid(__Addr__, __Len__))
+    {
+        return -BadSystemcall;
+    }
+
+    /* PROT_NONE keeps the frame but makes it supervisor only */
+    uint64_t PteFlags = 0;
+    if (__Prot__ & 0x7)
     {
-        (void)UnmapPage(Proc->Space, Va);
+        PteFlags |= PTEUSER;
     }
+    if (__Prot__ & 0x2)
+    {
+        PteFlags |= PTEWRITABLE;
+    }
+    if (!(__Prot__ & 0x4))
+    {
+        PteFlags |= PTENOEXECUTE;
+    }
+
+    if (ProtectUserRange(Proc->Space, __Addr__, __AlignUp__(__Len__, PageSize), PteFlags) !=
+        SysOkay)
+    {
+        return -BadSystemcall;
+    }
+    return SysOkay;
+}
+
+int64_t
+__Handle__Madvise(uint64_t __Addr__,
+                  uint64_t __Len__,
+                  uint64_t __Advice__,
+                  uint64_t __U4__,
+                  uint64_t __U5__,
+                  uint64_t __U6__)
+{
+    (void)__U4__;
+    (void)__U5__;
+    (void)__U6__;
+
+    PosixProc* Proc = __GetCurrentProc__();
+    if (Probe_IF_Error(Proc) || !Proc || !Proc->Space || (__Addr__ % PageSize) != 0 ||
+        !UserRangeValid(__Addr__, __Len__))
+    {
+        return -BadArgs;
+    }
+
+    VmmAdvice Advice;
+    switch (__Advice__)
+    {
+        case MadvNormal:
+        case MadvRandom:
+        case MadvNohugepage:
+            return SysOkay; /* already the default behaviour */
+        case MadvSequential:
+            Advice = VmmAdviseSequential;
+            break;
+        case MadvWillneed:
+            Advice = VmmAdviseWillNeed;
+            break;
+        case MadvDontneed:
+            Advice = VmmAdviseDontNeed;
+            break;
+        case MadvFree:
+            Advice = VmmAdviseFree;
+            break;
+        case MadvHugepage:
+            Advice = VmmAdviseHuge;
+            break;
+        default:
+            return -BadArgs;
+    }
+
+    if (AdviseUserRange(Proc->Space, __Addr__, __AlignUp__(__Len__, PageSize), Advice) !=
+        SysOkay)
+    {
+        return -BadAlloc;
+    }
+
     SysErr  err;
     SysErr* Error = &err;
     FlushAllTlb(Error);
     return SysOkay;
 }
 
+int64_t
+__Handle__Mremap(uint64_t __Addr__,
+                 uint64_t __OldLen__,
+                 uint64_t __NewLen__,
+                 uint64_t __Flags__,
+                 uint64_t __NewAddr__,
+                 uint64_t __U6__)
+{
+    (void)__U6__;
+
+    PosixProc* Proc = __GetCurrentProc__();
+    if (Probe_IF_Error(Proc) || !Proc || !Proc->Space)
+    {
+        return -BadSystemcall;
+    }
+
+    if ((__Addr__ % PageSize) != 0 || !__OldLen__ || !__NewLen__ ||
+        (__Flags__ & ~(uint64_t)(MremapMaymove | MremapFixed)) ||
+        ((__Flags__ & MremapFixed) && !(__Flags__ & MremapMaymove)))
+    {
+        return -BadArgs;
+    }
+
+    /* Both lengths bounded first, so neither the rounding nor any end below can wrap */
+    if (!UserRangeValid(__Addr__, __OldLen__) || __NewLen__ > VirtualAddressSpace)
+    {
+        return -BadArgs;
+    }
+
+    SysErr  err;
+    SysErr* Error = &err;
+
+    uint64_t OldLen = __AlignUp__(__OldLen__, PageSize);
+    uint64_t NewLen = __AlignUp__(__NewLen__, PageSize);
+    uint64_t Kind   = UserRangeFlags(Proc->Space, __Addr__);
+    uint64_t Prot   = Kind & (PTEWRITABLE | PTEUSER | PTENOEXECUTE);
+
+    /* The stack grows on its own; everything else has to be mapped to be remapped */
+    if (!(Kind & (PTEPRESENT | PTELAZY)) || (Kind & PTEGROWSDOWN))
+    {
+        return -BadArgs;
+    }
+
+    /* Lent file or shared pages only move, new pages past them would have no backing */
+    int Lent = ((Kind | UserRangeFlags(Proc->Space, __Addr__ + OldLen - PageSize)) &
+                (PTEBORROWED | PTESHARED)) != 0;
+
+    uint64_t Target = __Addr__;
+    if (__Flags__ & MremapFixed)
+    {
+        Target = __NewAddr__;
+        int Overlap = Target < __Addr__ + OldLen && Target + NewLen > __Addr__;
+        if ((Target % PageSize) != 0 || !UserRangeValid(Target, NewLen) || Overlap ||
+            __InStackGap__(Target, NewLen))
+        {
+            return -BadArgs;
+        }
+
+        /* Like MAP_FIXED, whatever sat at the target is gone */
+        UnmapUserRange(Proc->Space, Target, NewLen);
+        PosixMapRecDrop(Proc, Target, NewLen);
+        FlushAllTlb(Error);
+    }
+
+    /* Shrinking, or the tail is shrunk before the rest moves */
+    if (NewLen < OldLen)
+    {
+        UnmapUserRange(Proc->Space, __Addr__ + NewLen, OldLen - NewLen);
+        PosixMapRecDrop(Proc, __Addr__ + NewLen, OldLen - NewLen);
+        FlushAllTlb(Error);
+        OldLen = NewLen;
+
+        if (Target == __Addr__)
+        {
+            return (int64_t)__Addr__;
+        }
+    }
+
+    /* Grow in place when the pages right after are free, the new part is lazy like mmap */
+    uint64_t Tail = __Addr__ + OldLen;
+    if (Target == __Addr__ && NewLen == OldLen)
+    {
+        return (int64_t)__Addr__;
+    }
+    if (Target == __Addr__ && !Lent && UserRangeValid(__Addr__, NewLen) &&
+        !__InStackGap__(Tail, NewLen - OldLen) &&
+        UserRangeIsFree(Proc->Space, Tail, NewLen - OldLen))
+    {
+        if (ReserveUserRange(Proc->Space, Tail, NewLen - OldLen, Prot) != SysOkay)
+        {
+            return -BadAlloc;
+        }
+        if (Proc->MmapNext && Proc->MmapNext < __Addr__ + NewLen && Proc->MmapNext > __Addr__)
+        {
+            Proc->MmapNext = __Addr__ + NewLen;
+        }
+        return (int64_t)__Addr__;
+    }
+
+    if (!(__Flags__ & MremapMaymove) || (Lent && NewLen > OldLen))
+    {
+        return -BadAlloc;
+    }
+
+    /* Same offset into a 2MB page as the old range, so 2MB entries move whole */
+    if (!(__Flags__ & MremapFixed))
+    {
+        uint64_t Next = Proc->MmapNext ? Proc->MmapNext : UserMmapBase;
+        Target        = __AlignUp__(Next, HugePageSize) + (__Addr__ & HugePageMask);
+        if (!UserRangeIsFree(Proc->Space, Target, NewLen))
+        {
+            return -BadAlloc;
+        }
+        Proc->MmapNext = Target + NewLen;
+    }
+
+    /* The grown tail is reserved first, once the move is made nothing may fail */
+    uint64_t Grow = NewLen - OldLen;
+    if (Grow && ReserveUserRange(Proc->Space, Target + OldLen, Grow, Prot) != SysOkay)
+    {
+        UnmapUserRange(Proc->Space, Target + OldLen, Grow);
+        return -BadAlloc;
+    }
+
+    if (PosixMapRecMove(Proc, __Addr__, OldLen, Target) != SysOkay)
+    {
+        UnmapUserRange(Proc->Space, Target + OldLen, Grow);
+        return -BadArgs;
+    }
+
+    /* Page table entries change hands, not a byte of the data is copied */
+    if (MoveUserRange(Proc->Space, __Addr__, Target, OldLen) != SysOkay)
+    {
+        PosixMapRecMove(Proc, Target, OldLen, __Addr__);
+        UnmapUserRange(Proc->Space, Target + OldLen, Grow);
+        return -BadAlloc;
+    }
+
+    return (int64_t)Target;
+}
+
+int64_t
+__Handle__Ftruncate(uint64_t __Fd__,
+                    uint64_t __Len__,
+                    uint64_t __U3__,
+                    uint64_t __U4__,
+                    uint64_t __U5__,
+                    uint64_t __U6__)
+{
+    (void)__U3__;
+    (void)__U4__;
+    (void)__U5__;
+    (void)__U6__;
+
+    PosixProc* Proc = __GetCurrentProc__();
+    if (Probe_IF_Error(Proc) || !Proc || !Proc->Fds)
+    {
+        return -BadSystemcall;
+    }
+
+    File* F = PosixFdFile(Proc->Fds, (int)__Fd__);
+    if (Probe_IF_Error(F) || !F)
+    {
+        return -BadEntry;
+    }
+
+    return VfsFtruncate(F, (long)__Len__);
+}
+
+int64_t
+__Handle__MemfdCreate(uint64_t __Name__,
+                      uint64_t __Flags__,
+                      uint64_t __U3__,
+                      uint64_t __U4__,
+                      uint64_t __U5__,
+                      uint64_t __U6__)
+{
+    (void)__Flags__;
+    (void)__U3__;
+    (void)__U4__;
+    (void)__U5__;
+    (void)__U6__;
+
+    PosixProc* Proc = __GetCurrentProc__();
+    if (Probe_IF_Error(Proc) || !Proc || !Proc->Fds || !__Name__)
+    {
+        return -BadSystemcall;
+    }
+
+    File* F = ShmMemfdOpen((const char*)__Name__, VFlgRDWR);
+    if (Probe_IF_Error(F) || !F)
+    {
+        return -BadAlloc;
+    }
+
+    int Fd = PosixFdInstall(Proc->Fds, F, VFlgRDWR);
+    if (Fd < 0)
+    {
+        VfsClose(F);
+    }
+    return Fd;
+}
+
 int64_t
 __Handle__Brk(uint64_t __NewBrk__,
               uint64_t __U2__,
@@ -831,7 +1639,7 @@ __Handle__Brk(uint64_t __NewBrk__,
     {
         uint64_t GrowLen  = Want - Br->BrkCur;
         uint64_t PteFlags = PTEPRESENT | PTEUSER | PTEWRITABLE | PTENOEXECUTE;
-        int      RIdx     = VirtMapRangeZeroed(Proc->Space, Br->BrkCur, GrowLen, PteFlags);
+        int      RIdx     = MapUserRange(Proc->Space, Br->BrkCur, GrowLen, PteFlags);
         if (RIdx != 0)
         {
             return -BadSystemcall;
@@ -841,11 +1649,7 @@ __Handle__Brk(uint64_t __NewBrk__,
     }
     else
     {
-        uint64_t Va = Want;
-        for (; Va < Br->BrkCur; Va += PageSize)
-        {
-            (void)UnmapPage(Proc->Space, Va);
-        }
+        (void)UnmapUserRange(Proc->Space, Want, Br->BrkCur - Want);
         SysErr  err;
         SysErr* Error = &err;
         FlushAllTlb(Error);
@@ -22,6 +22,10 @@ SyscallHandler(uint64_t __SyscallNo__,
 
 __asm__(".global SysEntASM\n"
         "SysEntASM:\n"
+        " testb $3, 8(%rsp) # From ring 3, switch to the kernel GS base\n"
+        " jz 1f\n"
+        " swapgs\n"
+        "1:\n"
         " pushq %rbx\n"
         " pushq %rcx\n"
         " pushq %rdx\n"
@@ -76,6 +80,10 @@ __asm__(".global SysEntASM\n"
         " popq %rcx\n"
         " popq %rbx\n"
         " \n"
+        " testb $3, 8(%rsp) # Back to ring 3, restore the user GS base\n"
+        " jz 2f\n"
+        " swapgs\n"
+        "2:\n"
         " iretq\n");
 
 void
@@ -115,6 +123,33 @@ InitSyscall(void)
     SysTbl[SysSchedYield].Handler = __Handle__SchedYield;
     SysTbl[SysSchedYield].SysName = "sched_yield";
 
+    SysTbl[SysSchedSetparam].Handler = __Handle__SchedSetparam;
+    SysTbl[SysSchedSetparam].SysName = "sched_setparam";
+
+    SysTbl[SysSchedGetparam].Handler = __Handle__SchedGetparam;
+    SysTbl[SysSchedGetparam].SysName = "sched_getparam";
+
+    SysTbl[SysSchedSetscheduler].Handler = __Handle__SchedSetscheduler;
+    SysTbl[SysSchedSetscheduler].SysName = "sched_setscheduler";
+
+    SysTbl[SysSchedGetscheduler].Handler = __Handle__SchedGetscheduler;
+    SysTbl[SysSchedGetscheduler].SysName = "sched_getscheduler";
+
+    SysTbl[SysSchedGetPriorityMax].Handler = __Handle__SchedGetPriorityMax;
+    SysTbl[SysSchedGetPriorityMax].SysName = "sched_get_priority_max";
+
+    SysTbl[SysSchedGetPriorityMin].Handler = __Handle__SchedGetPriorityMin;
+    SysTbl[SysSchedGetPriorityMin].SysName = "sched_get_priority_min";
+
+    SysTbl[SysSchedRrGetInterval].Handler = __Handle__SchedRrGetInterval;
+    SysTbl[SysSchedRrGetInterval].SysName = "sched_rr_get_interval";
+
+    SysTbl[SysSchedSetaffinity].Handler = __Handle__SchedSetaffinity;
+    SysTbl[SysSchedSetaffinity].SysName = "sched_setaffinity";
+
+    SysTbl[SysSchedGetaffinity].Handler = __Handle__SchedGetaffinity;
+    SysTbl[SysSchedGetaffinity].SysName = "sched_getaffinity";
+
     SysTbl[SysMkdir].Handler = __Handle__Mkdir;
     SysTbl[SysMkdir].SysName = "mkdir";
 
@@ -184,6 +219,21 @@ InitSyscall(void)
     SysTbl[SysMunmap].Handler = __Handle__Munmap;
     SysTbl[SysMunmap].SysName = "munmap";
 
+    SysTbl[SysMprotect].Handler = __Handle__Mprotect;
+    SysTbl[SysMprotect].SysName = "mprotect";
+
+    SysTbl[SysMadvise].Handler = __Handle__Madvise;
+    SysTbl[SysMadvise].SysName = "madvise";
+
+    SysTbl[SysMremap].Handler = __Handle__Mremap;
+    SysTbl[SysMremap].SysName = "mremap";
+
+    SysTbl[SysFtruncate].Handler = __Handle__Ftruncate;
+    SysTbl[SysFtruncate].SysName = "ftruncate";
+
+    SysTbl[SysMemfdCreate].Handler = __Handle__MemfdCreate;
+    SysTbl[SysMemfdCreate].SysName = "memfd_create";
+
     SysTbl[SysBrk].Handler = __Handle__Brk;
     SysTbl[SysBrk].SysName = "brk";
 
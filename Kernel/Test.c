@@ -63,4 +63,2107 @@ __TEST__DriverManager(void)
     {
         PError("TestDriver load failed: %d\n", Result);
     }
-}
\ No newline at end of file
+}
+
+/*Console redraw and MMIO timings per memory type*/
+#define __IoBenchOps__ 4096
+
+static uint64_t
+__IoBenchTsc__(void)
+{
+    uint32_t Low, High;
+    __asm__ volatile("lfence; rdtsc" : "=a"(Low), "=d"(High)::"memory");
+    return ((uint64_t)High << 32) | Low;
+}
+
+static uint64_t
+__IoBenchRedraw__(uint32_t* __FrameBuffer__)
+{
+    SysErr  err;
+    SysErr* Error = &err;
+
+    AcquireSpinLock(&ConsoleLock, Error);
+    uint64_t T0 = __IoBenchTsc__();
+
+    for (uint32_t I = 0; I < Console.FrameBufferW * Console.FrameBufferH; I++)
+    {
+        __FrameBuffer__[I] = Console.BGColor;
+    }
+    for (uint32_t Row = 0; Row < Console.ConsoleRow; Row++)
+    {
+        for (uint32_t Col = 0; Col < Console.ConsoleCol; Col++)
+        {
+            DisplayChar(__FrameBuffer__,
+                        Console.FrameBufferW,
+                        Col * FontW,
+                        Row * FontH,
+                        (char)('A' + (Row + Col) % 26),
+                        Console.TXColor);
+        }
+    }
+    __asm__ volatile("sfence" ::: "memory");
+
+    uint64_t T1 = __IoBenchTsc__();
+    ReleaseSpinLock(&ConsoleLock, Error);
+    return T1 - T0;
+}
+
+static uint64_t
+__IoBenchStores__(volatile uint32_t* __Base__, uint32_t __Stride__)
+{
+    uint64_t T0 = __IoBenchTsc__();
+    for (uint32_t I = 0; I < __IoBenchOps__; I++)
+    {
+        __Base__[(I * __Stride__) % (__IoBenchOps__ * 16)] = I;
+    }
+    __asm__ volatile("sfence" ::: "memory");
+    return (__IoBenchTsc__() - T0) / __IoBenchOps__;
+}
+
+static uint64_t
+__IoBenchLoads__(volatile uint32_t* __Base__, uint32_t __Count__)
+{
+    uint32_t Sum = 0;
+    uint64_t T0  = __IoBenchTsc__();
+    for (uint32_t I = 0; I < __IoBenchOps__; I++)
+    {
+        Sum += __Base__[I % __Count__];
+    }
+    (void)Sum;
+    return (__IoBenchTsc__() - T0) / __IoBenchOps__;
+}
+
+void
+__TEST__IoRemap(void)
+{
+    if (!EarlyLimineFrambuffer.response || !EarlyLimineFrambuffer.response->framebuffer_count ||
+        !Console.FrameBuffer)
+    {
+        PWarn("IoRemap bench: no framebuffer\n");
+        return;
+    }
+
+    struct limine_framebuffer* FrameBuffer = EarlyLimineFrambuffer.response->framebuffers[0];
+    uint64_t                   FbPhys      = VirtToPhys(FrameBuffer->address);
+    uint64_t                   FbSize      = FrameBuffer->pitch * FrameBuffer->height;
+
+    /*Both aliases are uncached types, so holding them next to the WC console is harmless*/
+    if (FbSize < __IoBenchOps__ * 64)
+    {
+        PWarn("IoRemap bench: framebuffer too small\n");
+        return;
+    }
+
+    uint32_t* FbUC    = (uint32_t*)IoRemap(FbPhys, FbSize, VmmCacheUC);
+    uint32_t* LapicUC = (uint32_t*)IoRemap(VirtToPhys((void*)Timer.ApicBase), PageSize, VmmCacheUC);
+    if (Probe_IF_Error(FbUC) || !FbUC || Probe_IF_Error(LapicUC) || !LapicUC)
+    {
+        PError("IoRemap bench: remap failed\n");
+        return;
+    }
+
+    uint64_t RedrawWC = __IoBenchRedraw__(Console.FrameBuffer);
+    uint64_t RedrawUC = __IoBenchRedraw__(FbUC);
+
+    /*Sequential and cache line strided pixel stores, then reads back through each type*/
+    uint64_t SeqWC    = __IoBenchStores__(Console.FrameBuffer, 1);
+    uint64_t SeqUC    = __IoBenchStores__(FbUC, 1);
+    uint64_t StrideWC = __IoBenchStores__(Console.FrameBuffer, 16);
+    uint64_t StrideUC = __IoBenchStores__(FbUC, 16);
+    uint64_t LoadWC   = __IoBenchLoads__(Console.FrameBuffer, __IoBenchOps__);
+    uint64_t LoadUC   = __IoBenchLoads__(FbUC, __IoBenchOps__);
+
+    /*A real register: LAPIC version (0x30), every read goes out to the device*/
+    uint64_t LoadReg = __IoBenchLoads__(LapicUC + (0x30 / 4), 1);
+
+    IoUnmap(LapicUC);
+    IoUnmap(FbUC);
+    ClearConsole();
+
+    PInfo("Redraw %ux%u: WC %lu cycles, UC %lu cycles\n",
+          Console.FrameBufferW,
+          Console.FrameBufferH,
+          RedrawWC,
+          RedrawUC);
+    PInfo("Store seq: WC %lu, UC %lu cycles/op\n", SeqWC, SeqUC);
+    PInfo("Store stride 64B: WC %lu, UC %lu cycles/op\n", StrideWC, StrideUC);
+    PInfo("Load fb: WC %lu, UC %lu cycles/op, LAPIC reg UC %lu cycles/op\n",
+          LoadWC,
+          LoadUC,
+          LoadReg);
+}
+
+/*Run queue latency*/
+#define __SchdBenchOps__   4096
+#define __SchdBenchWalks__ 64
+
+static const uint32_t SchdBenchSizes[] = {10, 100, 1000, 10000};
+
+/*What the old single list paid per enqueue: a walk from the head to the tail*/
+static uint64_t
+__SchdBenchWalk__(CpuScheduler* __Sched__)
+{
+    uint64_t Hops = 0;
+    uint64_t T0   = __IoBenchTsc__();
+    for (uint32_t Pass = 0; Pass < __SchdBenchWalks__; Pass++)
+    {
+        for (uint32_t Level = 0; Level < SchedPriorities; Level++)
+        {
+            for (Thread* Walk = __Sched__->Active->Head[Level]; Walk; Walk = Walk->Next)
+            {
+                Hops++;
+            }
+        }
+    }
+    __asm__ volatile("" ::"r"(Hops));
+    return (__IoBenchTsc__() - T0) / __SchdBenchWalks__;
+}
+
+void
+__TEST__SchedQueues(void)
+{
+    SysErr  err;
+    SysErr* Error = &err;
+
+    /*A CPU slot nobody schedules on, so the timer never touches these queues*/
+    uint32_t Scratch = MaxCPUs - 1;
+    if (Smp.CpuCount >= MaxCPUs)
+    {
+        PWarn("Sched bench: no spare scheduler slot\n");
+        return;
+    }
+
+    for (uint32_t Size = 0; Size < sizeof(SchdBenchSizes) / sizeof(SchdBenchSizes[0]); Size++)
+    {
+        uint32_t Count   = SchdBenchSizes[Size];
+        Thread** Threads = (Thread**)KMalloc(Count * sizeof(Thread*));
+        if (Probe_IF_Error(Threads) || !Threads)
+        {
+            PError("Sched bench: out of memory at %u\n", Count);
+            return;
+        }
+
+        InitializeCpuScheduler(Scratch, Error);
+
+        uint32_t Made = 0;
+        for (; Made < Count; Made++)
+        {
+            Thread* Dummy = (Thread*)KMalloc(sizeof(Thread));
+            if (Probe_IF_Error(Dummy) || !Dummy)
+            {
+                break;
+            }
+            memset(Dummy, 0, sizeof(Thread));
+            Dummy->ThreadId = Made;
+            Dummy->Priority = (ThreadPriority)(Made % SchedPriorities);
+            Threads[Made]   = Dummy;
+            AddThreadToReadyQueue(Scratch, Dummy, Error);
+        }
+
+        uint64_t Walk = __SchdBenchWalk__(&CpuSchedulers[Scratch]);
+
+        /*Pick next then requeue, the pair Schedule() does on every tick*/
+        uint64_t T0 = __IoBenchTsc__();
+        for (uint32_t Op = 0; Op < __SchdBenchOps__; Op++)
+        {
+            Thread* Next = RemoveThreadFromReadyQueue(Scratch);
+            if (Probe_IF_Error(Next))
+            {
+                break;
+            }
+            AddThreadToReadyQueue(Scratch, Next, Error);
+        }
+        uint64_t Pick = (__IoBenchTsc__() - T0) / __SchdBenchOps__;
+
+        PInfo("Sched %5u runnable: pick+requeue %lu cycles, list walk %lu cycles\n",
+              Made,
+              Pick,
+              Walk);
+
+        for (uint32_t Index = 0; Index < Made; Index++)
+        {
+            KFree(Threads[Index], Error);
+        }
+        KFree(Threads, Error);
+    }
+
+    InitializeCpuScheduler(Scratch, Error);
+}
+
+/*Imbalanced spawn*/
+#define __SchdBalThreads__ 16
+#define __SchdBalRunMs__   2000
+
+static Thread*           SchdBalThreads[__SchdBalThreads__];
+static volatile uint64_t SchdBalWork[__SchdBalThreads__];
+static volatile int      SchdBalStop;
+
+static void
+__SchdBalSpin__(void* __Arg__)
+{
+    uint64_t Slot = (uint64_t)__Arg__;
+    while (!SchdBalStop)
+    {
+        SchdBalWork[Slot]++;
+    }
+
+    /*Next tick hands us to the zombie queue*/
+    SchdBalThreads[Slot]->State = ThreadStateTerminated;
+    for (;;)
+    {
+        __asm__ volatile("int $0x20");
+    }
+}
+
+static void
+__SchdBalRun__(int __Steal__)
+{
+    SysErr  err;
+    SysErr* Error = &err;
+
+    uint64_t Idle[MaxCPUs], Steals[MaxCPUs];
+    uint32_t Cpus    = Smp.CpuCount;
+    uint32_t Spawned = 0;
+
+    SchedIdleSteal = __Steal__;
+    SchdBalStop    = 0;
+
+    /*Every thread lands on CPU 0, as a burst does before the load counts catch up*/
+    for (uint32_t Slot = 0; Slot < __SchdBalThreads__; Slot++)
+    {
+        SchdBalWork[Slot]    = 0;
+        SchdBalThreads[Slot] = CreateThread(
+            ThreadTypeKernel, __SchdBalSpin__, (void*)(uint64_t)Slot, ThreadPriorityNormal);
+        if (Probe_IF_Error(SchdBalThreads[Slot]) || !SchdBalThreads[Slot])
+        {
+            break;
+        }
+        Spawned++;
+    }
+
+    for (uint32_t Cpu = 0; Cpu < Cpus; Cpu++)
+    {
+        Idle[Cpu]   = CpuSchedulers[Cpu].IdleTicks;
+        Steals[Cpu] = CpuSchedulers[Cpu].Steals;
+    }
+    uint64_t Start = GetSystemTicks();
+
+    for (uint32_t Slot = 0; Slot < Spawned; Slot++)
+    {
+        AddThreadToReadyQueue(0, SchdBalThreads[Slot], Error);
+    }
+
+    ThreadSleep(__SchdBalRunMs__, Error);
+
+    uint64_t Ticks = GetSystemTicks() - Start;
+    uint64_t Work  = 0;
+    for (uint32_t Slot = 0; Slot < Spawned; Slot++)
+    {
+        Work += SchdBalWork[Slot];
+    }
+
+    PInfo("Balance %s: %u threads, %lu Kloops/s\n",
+          __Steal__ ? "steal" : "static",
+          Spawned,
+          Work / __SchdBalRunMs__);
+
+    for (uint32_t Cpu = 0; Cpu < Cpus; Cpu++)
+    {
+        uint64_t Idled = CpuSchedulers[Cpu].IdleTicks - Idle[Cpu];
+        Idled          = Idled > Ticks ? Ticks : Idled;
+        PInfo("  CPU %u: busy %lu%%, steals %lu\n",
+              Cpu,
+              Ticks ? ((Ticks - Idled) * 100) / Ticks : 0,
+              CpuSchedulers[Cpu].Steals - Steals[Cpu]);
+    }
+
+    SchdBalStop = 1;
+    ThreadSleep(100, Error);
+    SchedIdleSteal = 1;
+}
+
+void
+__TEST__SchedBalance(void)
+{
+    if (Smp.CpuCount < 2)
+    {
+        PWarn("Balance bench: needs more than one CPU (-smp 4)\n");
+        return;
+    }
+
+    __SchdBalRun__(0);
+    __SchdBalRun__(1);
+}
+
+/*Tickless idle*/
+#define __IdleBenchMs__ 1000
+
+void
+__TEST__TicklessIdle(void)
+{
+    SysErr  err;
+    SysErr* Error = &err;
+
+    uint32_t Irqs[MaxCPUs];
+    uint64_t Idle[MaxCPUs];
+    uint32_t Cpus = Smp.CpuCount;
+
+    for (uint32_t Cpu = 0; Cpu < Cpus; Cpu++)
+    {
+        Irqs[Cpu] = GetPerCpuData(Cpu)->LocalInterrupts;
+        Idle[Cpu] = CpuSchedulers[Cpu].IdleTicks;
+    }
+    uint64_t Start = GetSystemTicks();
+
+    /*Only this thread is runnable, so every CPU should drop to one-shot*/
+    ThreadSleep(__IdleBenchMs__, Error);
+
+    uint64_t Ticks = GetSystemTicks() - Start;
+    PInfo("Tickless %s, %lu ticks elapsed\n", Timer.TscPerTick ? "on" : "off", Ticks);
+
+    for (uint32_t Cpu = 0; Cpu < Cpus; Cpu++)
+    {
+        uint64_t Count = GetPerCpuData(Cpu)->LocalInterrupts - Irqs[Cpu];
+        PInfo("  CPU %u: %lu timer irq/s, idle %lu%%\n",
+              Cpu,
+              Ticks ? (Count * 1000) / Ticks : 0,
+              Ticks ? ((CpuSchedulers[Cpu].IdleTicks - Idle[Cpu]) * 100) / Ticks : 0);
+    }
+}
+
+/*Timer wheel*/
+#define __WheelBenchTimers__ 10000
+#define __WheelBenchSpread__ 10000 /*Deadlines 1..10s out, like mixed sleep timeouts*/
+#define __WheelBenchWalks__  1000
+
+static volatile uint64_t WheelBenchFired;
+
+static void
+__WheelBenchFire__(void* __Arg__ _unused)
+{
+    WheelBenchFired++;
+}
+
+void
+__TEST__TimerWheel(void)
+{
+    SysErr  err;
+    SysErr* Error = &err;
+
+    /*A wheel nobody ticks, so the bench drives its clock by hand*/
+    uint32_t Scratch = MaxCPUs - 1;
+    if (Smp.CpuCount >= MaxCPUs)
+    {
+        PWarn("Wheel bench: no spare wheel\n");
+        return;
+    }
+
+    KTimer* Timers = (KTimer*)KMalloc(__WheelBenchTimers__ * sizeof(KTimer));
+    if (Probe_IF_Error(Timers) || !Timers)
+    {
+        PError("Wheel bench: out of memory\n");
+        return;
+    }
+
+    InitializeTimerWheel(Scratch, Error);
+    uint64_t Base   = TimerWheels[Scratch].Clock;
+    WheelBenchFired = 0;
+
+    uint64_t T0 = __IoBenchTsc__();
+    for (uint32_t Index = 0; Index < __WheelBenchTimers__; Index++)
+    {
+        TimerInit(&Timers[Index], __WheelBenchFire__, NULL);
+        TimerArmAt(&Timers[Index], Scratch, Base + 1 + (Index * 7919U) % __WheelBenchSpread__);
+    }
+    uint64_t Arm = (__IoBenchTsc__() - T0) / __WheelBenchTimers__;
+
+    /*What the old sleeping list paid every tick: compare every sleeper's deadline*/
+    uint64_t Due = 0;
+    T0           = __IoBenchTsc__();
+    for (uint32_t Tick = 1; Tick <= __WheelBenchWalks__; Tick++)
+    {
+        for (uint32_t Index = 0; Index < __WheelBenchTimers__; Index++)
+        {
+            Due += (Timers[Index].Expires <= Base + Tick);
+        }
+    }
+    __asm__ volatile("" ::"r"(Due));
+    uint64_t Walk = (__IoBenchTsc__() - T0) / __WheelBenchWalks__;
+
+    /*One run per tick across the whole spread, cascades included*/
+    uint64_t Total = 0, Worst = 0;
+    for (uint64_t Tick = 1; Tick <= __WheelBenchSpread__; Tick++)
+    {
+        T0 = __IoBenchTsc__();
+        TimerWheelRun(Scratch, Base + Tick);
+        uint64_t Cost = __IoBenchTsc__() - T0;
+        Total += Cost;
+        Worst  = Cost > Worst ? Cost : Worst;
+    }
+
+    /*Arm again and cancel all, the path a signalled sleeper takes*/
+    for (uint32_t Index = 0; Index < __WheelBenchTimers__; Index++)
+    {
+        TimerArmAt(&Timers[Index], Scratch, Base + __WheelBenchSpread__ + 1 + Index);
+    }
+    T0 = __IoBenchTsc__();
+    for (uint32_t Index = 0; Index < __WheelBenchTimers__; Index++)
+    {
+        TimerCancel(&Timers[Index]);
+    }
+    uint64_t Cancel = (__IoBenchTsc__() - T0) / __WheelBenchTimers__;
+
+    PInfo("Wheel %u timers: %lu fired, arm %lu cycles, cancel %lu cycles\n",
+          __WheelBenchTimers__,
+          WheelBenchFired,
+          Arm,
+          Cancel);
+    PInfo("  tick: wheel avg %lu worst %lu cycles, list walk %lu cycles\n",
+          Total / __WheelBenchSpread__,
+          Worst,
+          Walk);
+
+    InitializeTimerWheel(Scratch, Error);
+    KFree(Timers, Error);
+}
+
+/*Mutex contention*/
+#define __MutexBenchThreads__ 8
+#define __MutexBenchRunMs__   2000
+
+static Thread*           MutexBenchThreads[__MutexBenchThreads__];
+static volatile uint64_t MutexBenchOps[__MutexBenchThreads__];
+static volatile int      MutexBenchStop;
+
+/*Every VFS call serializes on VfsLock, a procfs read holds it while the text is built*/
+static void
+__MutexBenchWork__(void* __Arg__)
+{
+    uint64_t Slot = (uint64_t)__Arg__;
+    char     Buf[512];
+
+    while (!MutexBenchStop)
+    {
+        File* Handle = VfsOpen("/proc/meminfo", VFlgRDONLY);
+        if (!Probe_IF_Error(Handle) && Handle)
+        {
+            VfsRead(Handle, Buf, sizeof(Buf));
+            VfsClose(Handle);
+        }
+        MutexBenchOps[Slot]++;
+    }
+
+    /*Next tick hands us to the zombie queue*/
+    MutexBenchThreads[Slot]->State = ThreadStateTerminated;
+    for (;;)
+    {
+        __asm__ volatile("int $0x20");
+    }
+}
+
+static void
+__MutexBenchRun__(int __Blocking__)
+{
+    SysErr  err;
+    SysErr* Error = &err;
+
+    uint64_t Idle[MaxCPUs];
+    uint32_t Cpus    = Smp.CpuCount;
+    uint32_t Spawned = 0;
+
+    MutexBlocking  = __Blocking__;
+    MutexBenchStop = 0;
+
+    for (uint32_t Slot = 0; Slot < __MutexBenchThreads__; Slot++)
+    {
+        MutexBenchOps[Slot]     = 0;
+        MutexBenchThreads[Slot] = CreateThread(
+            ThreadTypeKernel, __MutexBenchWork__, (void*)(uint64_t)Slot, ThreadPriorityNormal);
+        if (Probe_IF_Error(MutexBenchThreads[Slot]) || !MutexBenchThreads[Slot])
+        {
+            break;
+        }
+        Spawned++;
+    }
+
+    for (uint32_t Cpu = 0; Cpu < Cpus; Cpu++)
+    {
+        Idle[Cpu] = CpuSchedulers[Cpu].IdleTicks;
+    }
+    uint64_t Start = GetSystemTicks();
+
+    ThreadExecuteMultiple(MutexBenchThreads, Spawned, Error);
+    ThreadSleep(__MutexBenchRunMs__, Error);
+
+    uint64_t Ticks = GetSystemTicks() - Start;
+    uint64_t Ops   = 0;
+    uint64_t Used  = 0;
+    for (uint32_t Slot = 0; Slot < Spawned; Slot++)
+    {
+        Ops += MutexBenchOps[Slot];
+        Used += MutexBenchThreads[Slot]->CpuTime;
+    }
+
+    uint64_t Idled = 0;
+    for (uint32_t Cpu = 0; Cpu < Cpus; Cpu++)
+    {
+        Idled += CpuSchedulers[Cpu].IdleTicks - Idle[Cpu];
+    }
+    uint64_t Capacity = Ticks * Cpus;
+    Idled             = Idled > Capacity ? Capacity : Idled;
+
+    /*With one lock only one thread makes progress, the rest of the busy time is waiting*/
+    PInfo("Mutex %s: %u threads, %lu ops/s, worker cpu %lu ms, cpu per 1k ops %lu ms\n",
+          __Blocking__ ? "block" : "spin",
+          Spawned,
+          Ticks ? (Ops * 1000) / Ticks : 0,
+          Used,
+          Ops ? (Used * 1000) / Ops : 0);
+    PInfo("  machine busy %lu%% of %u cpus\n",
+          Capacity ? ((Capacity - Idled) * 100) / Capacity : 0,
+          Cpus);
+
+    MutexBenchStop = 1;
+    ThreadSleep(100, Error);
+    MutexBlocking = 1;
+}
+
+void
+__TEST__MutexContention(void)
+{
+    __MutexBenchRun__(0);
+    __MutexBenchRun__(1);
+}
+
+/*Per-CPU lookups*/
+#define __PerCpuBenchOps__ 4096
+
+static uint64_t PerCpuBenchFlags[MaxCPUs];
+
+/*What GetCurrentCpuId did before GS: APIC base MSR, LAPIC ID over MMIO, then a scan*/
+static uint32_t
+__PerCpuBenchLegacyId__(void)
+{
+    uint64_t           ApicPhysBase = ReadMsr(0x1B) & 0xFFFFF000;
+    volatile uint32_t* ApicIdReg    = (volatile uint32_t*)(PhysToVirt(ApicPhysBase) + 0x20);
+    uint32_t           ApicId       = (*ApicIdReg >> 24) & 0xFF;
+
+    for (uint32_t Index = 0; Index < Smp.CpuCount; Index++)
+    {
+        if (Smp.Cpus[Index].ApicId == ApicId)
+        {
+            return Index;
+        }
+    }
+    return ApicId;
+}
+
+/*The old acquire/release pair, one id lookup on each side*/
+static void
+__PerCpuBenchLegacyPair__(SpinLock* __Lock__)
+{
+    uint64_t Flags;
+    __asm__ volatile("pushfq; popq %0; cli" : "=r"(Flags)::"memory");
+
+    uint32_t CpuId    = __PerCpuBenchLegacyId__();
+    uint32_t Expected = 0;
+    while (!__atomic_compare_exchange_n(
+        &__Lock__->Lock, &Expected, 1, false, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED))
+    {
+        Expected = 0;
+        __asm__ volatile("pause");
+    }
+    __Lock__->CpuId         = CpuId;
+    PerCpuBenchFlags[CpuId] = Flags;
+
+    Flags           = PerCpuBenchFlags[__PerCpuBenchLegacyId__()];
+    __Lock__->CpuId = 0xFFFFFFFF;
+    __atomic_store_n(&__Lock__->Lock, 0, __ATOMIC_RELEASE);
+    __asm__ volatile("pushq %0; popfq" ::"r"(Flags) : "memory");
+}
+
+void
+__TEST__PerCpu(void)
+{
+    SysErr   err;
+    SysErr*  Error = &err;
+    SpinLock Lock;
+    uint32_t Sink = 0;
+
+    InitializeSpinLock(&Lock, "PerCpuBench", Error);
+
+    uint64_t T0 = __IoBenchTsc__();
+    for (uint32_t I = 0; I < __PerCpuBenchOps__; I++)
+    {
+        Sink += __PerCpuBenchLegacyId__();
+    }
+    uint64_t IdLegacy = (__IoBenchTsc__() - T0) / __PerCpuBenchOps__;
+
+    T0 = __IoBenchTsc__();
+    for (uint32_t I = 0; I < __PerCpuBenchOps__; I++)
+    {
+        Sink += GetCurrentCpuId();
+    }
+    uint64_t IdGs = (__IoBenchTsc__() - T0) / __PerCpuBenchOps__;
+
+    T0 = __IoBenchTsc__();
+    for (uint32_t I = 0; I < __PerCpuBenchOps__; I++)
+    {
+        Sink += (ThisThread() != NULL);
+    }
+    uint64_t ThreadGs = (__IoBenchTsc__() - T0) / __PerCpuBenchOps__;
+
+    T0 = __IoBenchTsc__();
+    for (uint32_t I = 0; I < __PerCpuBenchOps__; I++)
+    {
+        __PerCpuBenchLegacyPair__(&Lock);
+    }
+    uint64_t LockLegacy = (__IoBenchTsc__() - T0) / __PerCpuBenchOps__;
+
+    T0 = __IoBenchTsc__();
+    for (uint32_t I = 0; I < __PerCpuBenchOps__; I++)
+    {
+        AcquireSpinLock(&Lock, Error);
+        ReleaseSpinLock(&Lock, Error);
+    }
+    uint64_t LockGs = (__IoBenchTsc__() - T0) / __PerCpuBenchOps__;
+
+    /*gettid is all entry, exit and current thread lookup. From ring 0, so no swapgs here*/
+    T0 = __IoBenchTsc__();
+    for (uint32_t I = 0; I < __PerCpuBenchOps__; I++)
+    {
+        uint64_t Tid;
+        __asm__ volatile("int $0x80" : "=a"(Tid) : "a"((uint64_t)SysGettid) : "memory");
+        Sink += (uint32_t)Tid;
+    }
+    uint64_t Syscall = (__IoBenchTsc__() - T0) / __PerCpuBenchOps__;
+    (void)Sink;
+
+    PInfo("Cpu id: legacy %lu, gs %lu cycles, current thread gs %lu cycles\n",
+          IdLegacy,
+          IdGs,
+          ThreadGs);
+    PInfo("Spinlock pair: legacy %lu, gs %lu cycles\n", LockLegacy, LockGs);
+    PInfo("gettid via int 0x80: %lu cycles round trip\n", Syscall);
+}
+
+/*Lazy FPU*/
+#define __FpuBenchYields__ 20000
+#define __FpuBenchWaitMs__ 10000
+
+static Thread*           FpuBenchThreads[2];
+static volatile uint64_t FpuBenchCycles[2];
+static volatile uint32_t FpuBenchDone;
+static int               FpuBenchUsesFp[2];
+
+static void
+__FpuBenchWork__(void* __Arg__)
+{
+    uint64_t Slot = (uint64_t)__Arg__;
+    uint64_t T0   = __IoBenchTsc__();
+
+    for (uint32_t I = 0; I < __FpuBenchYields__; I++)
+    {
+        if (FpuBenchUsesFp[Slot])
+        {
+            /*Dirty the SSE state between every switch, like a numeric loop would*/
+            __asm__ volatile("addpd %xmm0, %xmm1\n\t"
+                             "mulpd %xmm1, %xmm2");
+        }
+        __asm__ volatile("int $0x20");
+    }
+
+    FpuBenchCycles[Slot] = __IoBenchTsc__() - T0;
+    __atomic_fetch_add(&FpuBenchDone, 1, __ATOMIC_SEQ_CST);
+
+    /*Next tick hands us to the zombie queue*/
+    FpuBenchThreads[Slot]->State = ThreadStateTerminated;
+    for (;;)
+    {
+        __asm__ volatile("int $0x20");
+    }
+}
+
+static void
+__FpuBenchRun__(int __Lazy__, int __Fp0__, int __Fp1__)
+{
+    SysErr  err;
+    SysErr* Error = &err;
+
+    FpuLazy           = __Lazy__;
+    SchedIdleSteal    = 0;
+    FpuBenchDone      = 0;
+    FpuBenchUsesFp[0] = __Fp0__;
+    FpuBenchUsesFp[1] = __Fp1__;
+    FpuCounters       = (FpuStats){0, 0, 0, 0};
+
+    /*Both on CPU 0 so every yield is a real switch between the two*/
+    for (uint64_t Slot = 0; Slot < 2; Slot++)
+    {
+        FpuBenchCycles[Slot]  = 0;
+        FpuBenchThreads[Slot] = CreateThread(
+            ThreadTypeKernel, __FpuBenchWork__, (void*)Slot, ThreadPriorityNormal);
+        if (Probe_IF_Error(FpuBenchThreads[Slot]) || !FpuBenchThreads[Slot])
+        {
+            PError("Fpu bench: thread create failed\n");
+            SchedIdleSteal = 1;
+            return;
+        }
+    }
+    AddThreadToReadyQueue(0, FpuBenchThreads[0], Error);
+    AddThreadToReadyQueue(0, FpuBenchThreads[1], Error);
+
+    for (uint32_t Waited = 0; FpuBenchDone < 2 && Waited < __FpuBenchWaitMs__; Waited += 10)
+    {
+        ThreadSleep(10, Error);
+    }
+
+    uint64_t Yields = 2ULL * __FpuBenchYields__;
+    PInfo("Fpu %s, %s/%s: %lu cycles/yield, saves %lu restores %lu traps %lu reuses %lu\n",
+          __Lazy__ ? "lazy " : "eager",
+          __Fp0__ ? "fp " : "int",
+          __Fp1__ ? "fp " : "int",
+          (FpuBenchCycles[0] + FpuBenchCycles[1]) / Yields,
+          FpuCounters.Saves,
+          FpuCounters.Restores,
+          FpuCounters.Traps,
+          FpuCounters.Reuses);
+
+    ThreadSleep(100, Error);
+    SchedIdleSteal = 1;
+    FpuLazy        = 1;
+}
+
+void
+__TEST__FpuSwitch(void)
+{
+    for (int Lazy = 0; Lazy < 2; Lazy++)
+    {
+        __FpuBenchRun__(Lazy, 0, 0);
+        __FpuBenchRun__(Lazy, 1, 0);
+        __FpuBenchRun__(Lazy, 1, 1);
+    }
+}
+
+/*Direct switch*/
+#define __SwitchBenchRounds__ 20000
+#define __SwitchBenchWaitMs__ 10000
+
+enum
+{
+    SwitchBenchYield,
+    SwitchBenchPipe,
+    SwitchBenchSem,
+};
+
+static Thread*           SwitchBenchThreads[2];
+static volatile uint64_t SwitchBenchCycles[2];
+static volatile uint32_t SwitchBenchDone;
+static int               SwitchBenchKind;
+static int               SwitchBenchDirect;
+static PosixFdTable      SwitchBenchFds;
+static int               SwitchBenchPipes[2][2]; /*[0] carries 0 -> 1, [1] carries 1 -> 0*/
+static Semaphore         SwitchBenchSems[2];
+
+static void
+__SwitchBenchYield__(SysErr* __Err__)
+{
+    if (SwitchBenchDirect)
+    {
+        ThreadYield(__Err__);
+    }
+    else
+    {
+        __asm__ volatile("int $0x20");
+    }
+}
+
+/* The pipe never blocks a reader, an empty read gives the CPU to the writer */
+static void
+__SwitchBenchPipeRead__(int __Fd__, SysErr* __Err__)
+{
+    char Byte;
+    while (PosixRead(&SwitchBenchFds, __Fd__, &Byte, 1) != 1)
+    {
+        __SwitchBenchYield__(__Err__);
+    }
+}
+
+static void
+__SwitchBenchWork__(void* __Arg__)
+{
+    SysErr   err;
+    SysErr*  Error = &err;
+    uint64_t Slot  = (uint64_t)__Arg__;
+    uint64_t Peer  = Slot ^ 1;
+    char     Byte  = 'p';
+    uint64_t T0    = __IoBenchTsc__();
+
+    for (uint32_t I = 0; I < __SwitchBenchRounds__; I++)
+    {
+        switch (SwitchBenchKind)
+        {
+            case SwitchBenchYield:
+                __SwitchBenchYield__(Error);
+                break;
+
+            case SwitchBenchPipe:
+                if (Slot == 0)
+                {
+                    PosixWrite(&SwitchBenchFds, SwitchBenchPipes[0][1], &Byte, 1);
+                    __SwitchBenchPipeRead__(SwitchBenchPipes[1][0], Error);
+                }
+                else
+                {
+                    __SwitchBenchPipeRead__(SwitchBenchPipes[0][0], Error);
+                    PosixWrite(&SwitchBenchFds, SwitchBenchPipes[1][1], &Byte, 1);
+                }
+                break;
+
+            case SwitchBenchSem:
+                /*Slot 0 serves first, each side sleeps on its own semaphore until the other posts*/
+                AcquireSemaphore(&SwitchBenchSems[Slot], Error);
+                ReleaseSemaphore(&SwitchBenchSems[Peer], Error);
+                break;
+        }
+    }
+
+    SwitchBenchCycles[Slot] = __IoBenchTsc__() - T0;
+    __atomic_fetch_add(&SwitchBenchDone, 1, __ATOMIC_SEQ_CST);
+
+    /*Next tick hands us to the zombie queue*/
+    SwitchBenchThreads[Slot]->State = ThreadStateTerminated;
+    for (;;)
+    {
+        __asm__ volatile("int $0x20");
+    }
+}
+
+static void
+__SwitchBenchRun__(int __Kind__, int __Direct__)
+{
+    static const char* Names[] = {"yield", "pipe ", "sem  "};
+
+    SysErr  err;
+    SysErr* Error = &err;
+
+    SwitchBenchKind   = __Kind__;
+    SwitchBenchDirect = __Direct__;
+    SwitchBenchDone   = 0;
+    SchedIdleSteal    = 0;
+
+    InitializeSemaphore(&SwitchBenchSems[0], 1, "SwitchBench0", Error);
+    InitializeSemaphore(&SwitchBenchSems[1], 0, "SwitchBench1", Error);
+
+    uint64_t Voluntary = __atomic_load_n(&CpuSchedulers[0].Voluntary, __ATOMIC_SEQ_CST);
+    uint64_t Switches  = __atomic_load_n(&CpuSchedulers[0].ContextSwitches, __ATOMIC_SEQ_CST);
+
+    /*Both on CPU 0 so every round trip is two real switches*/
+    for (uint64_t Slot = 0; Slot < 2; Slot++)
+    {
+        SwitchBenchCycles[Slot]  = 0;
+        SwitchBenchThreads[Slot] = CreateThread(
+            ThreadTypeKernel, __SwitchBenchWork__, (void*)Slot, ThreadPriorityNormal);
+        if (Probe_IF_Error(SwitchBenchThreads[Slot]) || !SwitchBenchThreads[Slot])
+        {
+            PError("Switch bench: thread create failed\n");
+            SchedIdleSteal = 1;
+            return;
+        }
+    }
+    AddThreadToReadyQueue(0, SwitchBenchThreads[0], Error);
+    AddThreadToReadyQueue(0, SwitchBenchThreads[1], Error);
+
+    for (uint32_t Waited = 0; SwitchBenchDone < 2 && Waited < __SwitchBenchWaitMs__; Waited += 10)
+    {
+        ThreadSleep(10, Error);
+    }
+
+    Voluntary = __atomic_load_n(&CpuSchedulers[0].Voluntary, __ATOMIC_SEQ_CST) - Voluntary;
+    Switches  = __atomic_load_n(&CpuSchedulers[0].ContextSwitches, __ATOMIC_SEQ_CST) - Switches;
+
+    PInfo("Switch %s %s: %lu cycles/round, %lu switches, %lu voluntary\n",
+          Names[__Kind__],
+          __Direct__ ? "direct" : "int   ",
+          (SwitchBenchCycles[0] + SwitchBenchCycles[1]) / (2ULL * __SwitchBenchRounds__),
+          Switches,
+          Voluntary);
+
+    ThreadSleep(100, Error);
+    SchedIdleSteal = 1;
+}
+
+void
+__TEST__SwitchPingPong(void)
+{
+    if (PosixFdInit(&SwitchBenchFds, 8) != SysOkay ||
+        PosixPipe(&SwitchBenchFds, SwitchBenchPipes[0]) != SysOkay ||
+        PosixPipe(&SwitchBenchFds, SwitchBenchPipes[1]) != SysOkay)
+    {
+        PError("Switch bench: pipe setup failed\n");
+        return;
+    }
+
+    for (int Direct = 0; Direct < 2; Direct++)
+    {
+        __SwitchBenchRun__(SwitchBenchYield, Direct);
+        __SwitchBenchRun__(SwitchBenchPipe, Direct);
+    }
+
+    /*Semaphores always block through ThreadBlock, so only the direct path exists*/
+    __SwitchBenchRun__(SwitchBenchSem, 1);
+}
+
+/*Fair class*/
+#define __FairBenchHogs__     4
+#define __FairBenchSleepers__ 2
+#define __FairBenchRunMs__    2000
+#define __FairBenchNapMs__    3
+
+static Thread*           FairBenchThreads[__FairBenchHogs__ + __FairBenchSleepers__];
+static volatile uint64_t FairBenchWork[__FairBenchHogs__];
+static volatile uint64_t FairBenchLate[__FairBenchSleepers__];    /*Summed ns past the deadline*/
+static volatile uint64_t FairBenchLateMax[__FairBenchSleepers__]; /*Worst ns past the deadline*/
+static volatile uint64_t FairBenchWakes[__FairBenchSleepers__];
+static volatile int      FairBenchStop;
+
+static uint64_t
+__FairBenchSqrt__(uint64_t __Value__)
+{
+    uint64_t Root = 0;
+    for (uint64_t Bit = 1ULL << 62; Bit; Bit >>= 2)
+    {
+        if (__Value__ >= Root + Bit)
+        {
+            __Value__ -= Root + Bit;
+            Root = (Root >> 1) + Bit;
+        }
+        else
+        {
+            Root >>= 1;
+        }
+    }
+    return Root;
+}
+
+static void
+__FairBenchHog__(void* __Arg__)
+{
+    uint64_t Slot = (uint64_t)__Arg__;
+    while (!FairBenchStop)
+    {
+        FairBenchWork[Slot]++;
+    }
+
+    /*Next tick hands us to the zombie queue*/
+    FairBenchThreads[Slot]->State = ThreadStateTerminated;
+    for (;;)
+    {
+        __asm__ volatile("int $0x20");
+    }
+}
+
+/* Sleeps a few ticks at a time and records how late each wakeup got the CPU */
+static void
+__FairBenchSleeper__(void* __Arg__)
+{
+    SysErr   err;
+    SysErr*  Error = &err;
+    uint64_t Slot  = (uint64_t)__Arg__;
+
+    while (!FairBenchStop)
+    {
+        uint64_t Due = GetSystemNanos() + __FairBenchNapMs__ * 1000000ULL;
+        ThreadSleep(__FairBenchNapMs__, Error);
+
+        uint64_t Now  = GetSystemNanos();
+        uint64_t Late = Now > Due ? Now - Due : 0;
+        FairBenchLate[Slot] += Late;
+        FairBenchWakes[Slot]++;
+        if (Late > FairBenchLateMax[Slot])
+        {
+            FairBenchLateMax[Slot] = Late;
+        }
+    }
+
+    FairBenchThreads[__FairBenchHogs__ + Slot]->State = ThreadStateTerminated;
+    for (;;)
+    {
+        __asm__ volatile("int $0x20");
+    }
+}
+
+static void
+__FairBenchRun__(int __Fair__)
+{
+    SysErr  err;
+    SysErr* Error = &err;
+
+    /*Mixed priorities among the hogs would skew the spread by design, keep them equal*/
+    const uint32_t Total = __FairBenchHogs__ + __FairBenchSleepers__;
+
+    SchedFair      = __Fair__;
+    SchedIdleSteal = 0;
+    FairBenchStop  = 0;
+
+    for (uint64_t Slot = 0; Slot < Total; Slot++)
+    {
+        int   Hog   = Slot < __FairBenchHogs__;
+        void* Entry = Hog ? (void*)__FairBenchHog__ : (void*)__FairBenchSleeper__;
+        void* Arg   = (void*)(Hog ? Slot : Slot - __FairBenchHogs__);
+
+        FairBenchThreads[Slot] = CreateThread(ThreadTypeKernel, Entry, Arg, ThreadPriorityNormal);
+        if (Probe_IF_Error(FairBenchThreads[Slot]) || !FairBenchThreads[Slot])
+        {
+            PError("Fair bench: thread create failed\n");
+            FairBenchStop  = 1;
+            SchedIdleSteal = 1;
+            SchedFair      = 1;
+            return;
+        }
+    }
+    for (uint32_t Slot = 0; Slot < __FairBenchHogs__; Slot++)
+    {
+        FairBenchWork[Slot] = 0;
+    }
+    for (uint32_t Slot = 0; Slot < __FairBenchSleepers__; Slot++)
+    {
+        FairBenchLate[Slot]    = 0;
+        FairBenchLateMax[Slot] = 0;
+        FairBenchWakes[Slot]   = 0;
+    }
+
+    /*All on CPU 0, so the policy alone decides who runs*/
+    for (uint32_t Slot = 0; Slot < Total; Slot++)
+    {
+        AddThreadToReadyQueue(0, FairBenchThreads[Slot], Error);
+    }
+
+    ThreadSleep(__FairBenchRunMs__, Error);
+    FairBenchStop = 1;
+
+    /*Share spread as stddev over mean, in permille*/
+    uint64_t Mean = 0;
+    for (uint32_t Slot = 0; Slot < __FairBenchHogs__; Slot++)
+    {
+        Mean += FairBenchWork[Slot];
+    }
+    Mean /= __FairBenchHogs__;
+
+    uint64_t Var = 0;
+    for (uint32_t Slot = 0; Slot < __FairBenchHogs__; Slot++)
+    {
+        int64_t Diff = (int64_t)(FairBenchWork[Slot] - Mean) / 1024;
+        Var += (uint64_t)(Diff * Diff);
+    }
+    Var /= __FairBenchHogs__;
+    uint64_t Spread = Mean ? (__FairBenchSqrt__(Var) * 1024 * 1000) / Mean : 0;
+
+    uint64_t Wakes = 0, Late = 0, LateMax = 0;
+    for (uint32_t Slot = 0; Slot < __FairBenchSleepers__; Slot++)
+    {
+        Wakes += FairBenchWakes[Slot];
+        Late += FairBenchLate[Slot];
+        if (FairBenchLateMax[Slot] > LateMax)
+        {
+            LateMax = FairBenchLateMax[Slot];
+        }
+    }
+
+    PInfo("Sched %s: %u hogs, share spread %lu permille, mean %lu Kloops/s\n",
+          __Fair__ ? "fair    " : "priority",
+          __FairBenchHogs__,
+          Spread,
+          Mean / __FairBenchRunMs__);
+    PInfo("  %u sleepers: %lu wakeups, late avg %lu us, max %lu us\n",
+          __FairBenchSleepers__,
+          Wakes,
+          Wakes ? Late / Wakes / 1000 : 0,
+          LateMax / 1000);
+
+    ThreadSleep(100, Error);
+    SchedIdleSteal = 1;
+    SchedFair      = 1;
+}
+
+void
+__TEST__SchedFair(void)
+{
+    __FairBenchRun__(0);
+    __FairBenchRun__(1);
+}
+
+/*RT classes*/
+#define __RtBenchHogs__  4
+#define __RtBenchRunMs__ 2000
+#define __RtBenchNapMs__ 2
+#define __RtBenchPrio__  50
+
+static Thread*           RtBenchThreads[__RtBenchHogs__ + 1];
+static volatile uint64_t RtBenchWork[__RtBenchHogs__ + 1];
+static volatile uint64_t RtBenchLate;    /*Summed ns past the deadline*/
+static volatile uint64_t RtBenchLateMax; /*Worst ns past the deadline*/
+static volatile uint64_t RtBenchWakes;
+static volatile int      RtBenchStop;
+
+static void
+__RtBenchHog__(void* __Arg__)
+{
+    uint64_t Slot = (uint64_t)__Arg__;
+    while (!RtBenchStop)
+    {
+        RtBenchWork[Slot]++;
+    }
+
+    RtBenchThreads[Slot]->State = ThreadStateTerminated;
+    for (;;)
+    {
+        __asm__ volatile("int $0x20");
+    }
+}
+
+static void
+__RtBenchSleeper__(void* __Arg__)
+{
+    SysErr   err;
+    SysErr*  Error = &err;
+    uint64_t Slot  = (uint64_t)__Arg__;
+
+    while (!RtBenchStop)
+    {
+        uint64_t Due = GetSystemNanos() + __RtBenchNapMs__ * 1000000ULL;
+        ThreadSleep(__RtBenchNapMs__, Error);
+
+        uint64_t Now  = GetSystemNanos();
+        uint64_t Late = Now > Due ? Now - Due : 0;
+        RtBenchLate += Late;
+        RtBenchWakes++;
+        if (Late > RtBenchLateMax)
+        {
+            RtBenchLateMax = Late;
+        }
+    }
+
+    RtBenchThreads[Slot]->State = ThreadStateTerminated;
+    for (;;)
+    {
+        __asm__ volatile("int $0x20");
+    }
+}
+
+/* __RtBenchHogs__ normal hogs on CPU 0, the last slot is a sleeper or a spinner under __Policy__ */
+static void
+__RtBenchRun__(uint32_t __Policy__, int __Spin__)
+{
+    SysErr  err;
+    SysErr* Error = &err;
+
+    const uint32_t Total    = __RtBenchHogs__ + 1;
+    const uint32_t Hogs     = __Spin__ ? 1 : __RtBenchHogs__;
+    uint64_t       Throttle = CpuSchedulers[0].RtThrottles;
+
+    SchedIdleSteal = 0;
+    RtBenchStop    = 0;
+    RtBenchLate    = 0;
+    RtBenchLateMax = 0;
+    RtBenchWakes   = 0;
+
+    for (uint64_t Slot = 0; Slot < Total; Slot++)
+    {
+        int   Last  = Slot == Total - 1;
+        void* Entry = Last && !__Spin__ ? (void*)__RtBenchSleeper__ : (void*)__RtBenchHog__;
+
+        RtBenchWork[Slot]    = 0;
+        RtBenchThreads[Slot] = NULL;
+        if (!Last && Slot >= Hogs)
+        {
+            continue;
+        }
+
+        RtBenchThreads[Slot] =
+            CreateThread(ThreadTypeKernel, Entry, (void*)Slot, ThreadPriorityNormal);
+        if (Probe_IF_Error(RtBenchThreads[Slot]) || !RtBenchThreads[Slot])
+        {
+            PError("RT bench: thread create failed\n");
+            RtBenchStop    = 1;
+            SchedIdleSteal = 1;
+            return;
+        }
+    }
+
+    if (__Policy__ != ThreadPolicyNormal)
+    {
+        SetThreadPolicy(RtBenchThreads[Total - 1], __Policy__, __RtBenchPrio__);
+    }
+
+    for (uint32_t Slot = 0; Slot < Total; Slot++)
+    {
+        if (RtBenchThreads[Slot])
+        {
+            AddThreadToReadyQueue(0, RtBenchThreads[Slot], Error);
+        }
+    }
+
+    ThreadSleep(__RtBenchRunMs__, Error);
+    RtBenchStop = 1;
+
+    const char* Class = __Policy__ == ThreadPolicyFifo ? "fifo  " : "normal";
+    if (__Spin__)
+    {
+        /*A runaway RT spinner still leaves the normal hog the throttled remainder*/
+        uint64_t Sum = RtBenchWork[0] + RtBenchWork[Total - 1];
+        PInfo("RT %s spinner vs normal hog: hog share %lu permille, %lu throttled periods\n",
+              Class,
+              Sum ? RtBenchWork[0] * 1000 / Sum : 0,
+              CpuSchedulers[0].RtThrottles - Throttle);
+    }
+    else
+    {
+        PInfo("RT %s sleeper vs %u hogs: %lu wakeups, late avg %lu us, max %lu us\n",
+              Class,
+              __RtBenchHogs__,
+              RtBenchWakes,
+              RtBenchWakes ? RtBenchLate / RtBenchWakes / 1000 : 0,
+              RtBenchLateMax / 1000);
+    }
+
+    ThreadSleep(100, Error);
+    SchedIdleSteal = 1;
+}
+
+void
+__TEST__SchedRt(void)
+{
+    __RtBenchRun__(ThreadPolicyNormal, 0);
+    __RtBenchRun__(ThreadPolicyFifo, 0);
+    __RtBenchRun__(ThreadPolicyFifo, 1);
+}
+
+/*Topology aware placement*/
+static Thread*           TopoBenchThreads[MaxCPUs];
+static uint32_t          TopoBenchPlaced[MaxCPUs];
+static volatile int      TopoBenchStop;
+static volatile uint32_t TopoBenchLive;
+
+static void
+__TopoBenchSpin__(void* __Arg__)
+{
+    uint64_t Slot = (uint64_t)__Arg__;
+    while (!TopoBenchStop)
+    {
+        __asm__ volatile("pause");
+    }
+
+    TopoBenchThreads[Slot]->State = ThreadStateTerminated;
+    __atomic_fetch_sub(&TopoBenchLive, 1, __ATOMIC_SEQ_CST);
+    for (;;)
+    {
+        __asm__ volatile("int $0x20");
+    }
+}
+
+/* Where the first __Count__ spinners landed: stacked CPUs, shared cores, per package spread */
+static void
+__TopoBenchReport__(uint32_t __Count__)
+{
+    uint32_t CpuHits[MaxCPUs]  = {0};
+    uint32_t CoreHits[MaxCPUs] = {0};
+    uint32_t PkgHits[MaxCPUs]  = {0};
+
+    for (uint32_t Slot = 0; Slot < __Count__; Slot++)
+    {
+        uint32_t Cpu = TopoBenchPlaced[Slot];
+        if (Cpu >= Smp.CpuCount)
+        {
+            continue;
+        }
+
+        /*Each group is counted at its lowest CPU index*/
+        CpuHits[Cpu]++;
+        CoreHits[CpuMaskNext(&Smp.Cpus[Cpu].SmtMask, 0, Smp.CpuCount)]++;
+        PkgHits[CpuMaskNext(&Smp.Cpus[Cpu].PackageMask, 0, Smp.CpuCount)]++;
+    }
+
+    uint32_t Stacked = 0, Shared = 0, PkgMin = 0xFFFFFFFF, PkgMax = 0;
+    for (uint32_t Cpu = 0; Cpu < Smp.CpuCount; Cpu++)
+    {
+        Stacked += CpuHits[Cpu] > 1;
+        Shared += CoreHits[Cpu] > 1;
+
+        if (CpuMaskNext(&Smp.Cpus[Cpu].PackageMask, 0, Smp.CpuCount) == Cpu)
+        {
+            PkgMin = PkgHits[Cpu] < PkgMin ? PkgHits[Cpu] : PkgMin;
+            PkgMax = PkgHits[Cpu] > PkgMax ? PkgHits[Cpu] : PkgMax;
+        }
+    }
+
+    PInfo("  %u spinners: %u CPU(s) doubled up, %u core(s) with busy siblings, package %u..%u\n",
+          __Count__,
+          Stacked,
+          Shared,
+          PkgMin,
+          PkgMax);
+}
+
+void
+__TEST__CpuTopology(void)
+{
+    SysErr  err;
+    SysErr* Error = &err;
+
+    CpuTopology* Topo  = &Smp.Topology;
+    uint32_t     Cores = Topo->Cores < Smp.CpuCount ? Topo->Cores : Smp.CpuCount;
+
+    PInfo("Topology: %u package(s), %u LLC(s), %u core(s), %u CPU(s), from CPUID 0x%x\n",
+          Topo->Packages,
+          Topo->Llcs,
+          Topo->Cores,
+          Smp.CpuCount,
+          Topo->Source);
+
+    /*The calling thread keeps one CPU busy, leave it out of the count*/
+    TopoBenchStop = 0;
+    TopoBenchLive = 0;
+    uint32_t Made = 0;
+    for (uint32_t Phase = 0; Phase < 2; Phase++)
+    {
+        uint32_t Want = Phase ? Smp.CpuCount - 1 : Cores - 1;
+        for (; Made < Want; Made++)
+        {
+            Thread* Spinner = CreateThread(ThreadTypeKernel,
+                                           (void*)__TopoBenchSpin__,
+                                           (void*)(uint64_t)Made,
+                                           ThreadPriorityNormal);
+            if (Probe_IF_Error(Spinner) || !Spinner)
+            {
+                PError("Topology bench: thread create failed\n");
+                break;
+            }
+
+            TopoBenchThreads[Made] = Spinner;
+            __atomic_fetch_add(&TopoBenchLive, 1, __ATOMIC_SEQ_CST);
+            ThreadExecute(Spinner, Error);
+            TopoBenchPlaced[Made] = Spinner->LastCpu;
+
+            /*Let it get onto its CPU so the next placement sees it running*/
+            ThreadSleep(2, Error);
+        }
+
+        PInfo("Placement with one spinner per %s:\n", Phase ? "CPU" : "core");
+        __TopoBenchReport__(Made);
+    }
+
+    TopoBenchStop = 1;
+    while (__atomic_load_n(&TopoBenchLive, __ATOMIC_SEQ_CST))
+    {
+        ThreadSleep(10, Error);
+    }
+}
+
+/*Scheduler statistics*/
+#define __StatBenchHogs__  3
+#define __StatBenchRunMs__ 1000
+#define __StatBenchNapMs__ 3
+
+static Thread*      StatBenchThreads[__StatBenchHogs__ + 1];
+static volatile int StatBenchStop;
+static char         StatBenchBuf[4096];
+
+static void
+__StatBenchWorker__(void* __Arg__)
+{
+    SysErr   err;
+    SysErr*  Error = &err;
+    uint64_t Slot  = (uint64_t)__Arg__;
+
+    while (!StatBenchStop)
+    {
+        if (Slot == __StatBenchHogs__)
+        {
+            ThreadSleep(__StatBenchNapMs__, Error);
+        }
+    }
+
+    StatBenchThreads[Slot]->State = ThreadStateTerminated;
+    for (;;)
+    {
+        __asm__ volatile("int $0x20");
+    }
+}
+
+/* Hogs and one sleeper sharing CPU 0, per-thread counters, then the /proc views */
+void
+__TEST__SchedStat(void)
+{
+    SysErr  err;
+    SysErr* Error = &err;
+
+    /*The only new cost on the switch path is one TSC read per enqueue*/
+    uint64_t Start = GetSystemNanos();
+    for (uint32_t Round = 0; Round < 1000; Round++)
+    {
+        (void)GetSystemNanos();
+    }
+    PInfo("Schedstat: enqueue stamp costs %llu ns\n", (GetSystemNanos() - Start) / 1000);
+
+    SchedIdleSteal = 0;
+    StatBenchStop  = 0;
+
+    for (uint64_t Slot = 0; Slot <= __StatBenchHogs__; Slot++)
+    {
+        StatBenchThreads[Slot] = CreateThread(
+            ThreadTypeKernel, (void*)__StatBenchWorker__, (void*)Slot, ThreadPriorityNormal);
+        if (Probe_IF_Error(StatBenchThreads[Slot]) || !StatBenchThreads[Slot])
+        {
+            PError("Schedstat bench: thread create failed\n");
+            StatBenchStop  = 1;
+            SchedIdleSteal = 1;
+            return;
+        }
+    }
+    for (uint32_t Slot = 0; Slot <= __StatBenchHogs__; Slot++)
+    {
+        AddThreadToReadyQueue(0, StatBenchThreads[Slot], Error);
+    }
+
+    ThreadSleep(__StatBenchRunMs__, Error);
+
+    /*Read while they still run, a terminated thread is freed by the zombie sweep*/
+    for (uint32_t Slot = 0; Slot <= __StatBenchHogs__; Slot++)
+    {
+        Thread* T = StatBenchThreads[Slot];
+        PInfo("  %s %u: run %llu ms, queued %llu ms, %llu picks, %llu vol, %llu invol, %llu migr\n",
+              Slot == __StatBenchHogs__ ? "sleeper" : "hog",
+              T->ThreadId,
+              T->RunNs / 1000000,
+              T->RunDelayNs / 1000000,
+              T->ContextSwitches,
+              T->Voluntary,
+              T->Involuntary,
+              T->Migrations);
+    }
+
+    StatBenchStop  = 1;
+    SchedIdleSteal = 1;
+
+    if (ProcFsMakeSchedstat(StatBenchBuf, sizeof(StatBenchBuf)) > 0)
+    {
+        PInfo("/proc/schedstat:\n%s", StatBenchBuf);
+    }
+    if (ProcFsMakeSchedlat(StatBenchBuf, sizeof(StatBenchBuf)) > 0)
+    {
+        PInfo("/proc/schedlat:\n%s", StatBenchBuf);
+    }
+}
+
+/*Zombie reaping under an exit storm*/
+#define __StormThreads__ 10000
+#define __StormWave__    256 /*Created before waiting for the backlog to drain*/
+
+static void
+__StormExit__(void* __Arg__ _unused)
+{
+    ThisThread()->State = ThreadStateTerminated;
+    for (;;)
+    {
+        __asm__ volatile("int $0x20");
+    }
+}
+
+static uint64_t
+__StormReaped__(void)
+{
+    uint64_t Sum = 0;
+    for (uint32_t Cpu = 0; Cpu < Smp.CpuCount; Cpu++)
+    {
+        Sum += __atomic_load_n(&CpuSchedulers[Cpu].Reaped, __ATOMIC_SEQ_CST);
+    }
+    return Sum;
+}
+
+/* Worst timer Schedule() while __StormThreads__ threads come and go, in tick then deferred */
+void
+__TEST__ZombieStorm(void)
+{
+    SysErr  err;
+    SysErr* Error = &err;
+
+    for (int Deferred = 0; Deferred < 2; Deferred++)
+    {
+        SchedReapDeferred = Deferred;
+        for (uint32_t Cpu = 0; Cpu < Smp.CpuCount; Cpu++)
+        {
+            CpuSchedulers[Cpu].TickMaxNs = 0;
+        }
+
+        uint64_t Base    = __StormReaped__();
+        uint64_t Start   = GetSystemNanos();
+        uint32_t Created = 0;
+
+        while (Created < __StormThreads__)
+        {
+            for (uint32_t Slot = 0; Slot < __StormWave__ && Created < __StormThreads__; Slot++)
+            {
+                Thread* T = CreateThread(
+                    ThreadTypeKernel, (void*)__StormExit__, NULL, ThreadPriorityNormal);
+                if (Probe_IF_Error(T) || !T)
+                {
+                    break;
+                }
+                ThreadExecute(T, Error);
+                Created++;
+            }
+
+            /*Keep at most one wave in flight so the heap is not the bottleneck*/
+            while (__StormReaped__() - Base + __StormWave__ < Created)
+            {
+                ThreadSleep(1, Error);
+            }
+        }
+        while (__StormReaped__() - Base < Created)
+        {
+            ThreadSleep(1, Error);
+        }
+
+        uint64_t Worst = 0;
+        for (uint32_t Cpu = 0; Cpu < Smp.CpuCount; Cpu++)
+        {
+            if (CpuSchedulers[Cpu].TickMaxNs > Worst)
+            {
+                Worst = CpuSchedulers[Cpu].TickMaxNs;
+            }
+        }
+
+        PInfo("Zombie storm (%s): %u threads in %llu ms, worst tick %llu us\n",
+              Deferred ? "reaper" : "in tick",
+              Created,
+              (GetSystemNanos() - Start) / 1000000,
+              Worst / 1000);
+    }
+
+    SchedReapDeferred = 1;
+}
+
+#define __KStackBenchRounds__ 4096
+#define __KStackBenchBatch__  16 /*Created before any is destroyed, still inside the CPU cache*/
+
+/* ns per create/destroy pair, __KStackBenchBatch__ threads at a time */
+static uint64_t
+__KStackChurn__(void)
+{
+    SysErr  err;
+    SysErr* Error = &err;
+
+    Thread*  Batch[__KStackBenchBatch__];
+    uint64_t Start = GetSystemNanos();
+
+    for (uint32_t Round = 0; Round < __KStackBenchRounds__; Round += __KStackBenchBatch__)
+    {
+        uint32_t Made = 0;
+        for (; Made < __KStackBenchBatch__; Made++)
+        {
+            Batch[Made] = CreateThread(ThreadTypeKernel, NULL, NULL, ThreadPriorityNormal);
+            if (Probe_IF_Error(Batch[Made]) || !Batch[Made])
+            {
+                break;
+            }
+        }
+        for (uint32_t Index = 0; Index < Made; Index++)
+        {
+            DestroyThread(Batch[Index], Error);
+        }
+    }
+
+    return (GetSystemNanos() - Start) / __KStackBenchRounds__;
+}
+
+/* Thread create/destroy against the old heap stacks, then with and without the stack cache */
+void
+__TEST__KStacks(void)
+{
+    SysErr  err;
+    SysErr* Error = &err;
+
+    uint64_t Start = GetSystemNanos();
+    for (uint32_t Round = 0; Round < __KStackBenchRounds__; Round++)
+    {
+        void* Stack = KMalloc(KStackSize);
+        if (Probe_IF_Error(Stack) || !Stack)
+        {
+            break;
+        }
+        KFree(Stack, Error);
+    }
+    uint64_t HeapNs = (GetSystemNanos() - Start) / __KStackBenchRounds__;
+
+    KStackCaching     = 0;
+    uint64_t Retired  = VmmKStack.Retired;
+    uint64_t FreshNs  = __KStackChurn__();
+    uint64_t Unmapped = VmmKStack.Retired - Retired;
+
+    KStackCaching    = 1;
+    uint64_t Hits    = VmmKStack.CacheHits + VmmKStack.PoolHits;
+    uint64_t CacheNs = __KStackChurn__();
+    Hits             = VmmKStack.CacheHits + VmmKStack.PoolHits - Hits;
+
+    PInfo("KStacks: KMalloc/KFree %llu ns, create+destroy fresh %llu ns (%llu unmapped), "
+          "cached %llu ns (%llu/%u reused)\n",
+          HeapNs,
+          FreshNs,
+          Unmapped,
+          CacheNs,
+          Hits,
+          __KStackBenchRounds__);
+    PInfo("KStacks: %llu mapped, %llu retired\n", VmmKStack.Mapped, VmmKStack.Retired);
+}
+
+static volatile uint64_t __KStackDepthLimit__ = ~0ULL;
+
+static uint64_t
+__KStackRecurse__(uint64_t __Depth__)
+{
+    volatile uint8_t Pad[256];
+    Pad[0] = (uint8_t)__Depth__;
+    if (__Depth__ >= __KStackDepthLimit__)
+    {
+        return Pad[0];
+    }
+    return __KStackRecurse__(__Depth__ + 1) + Pad[0];
+}
+
+static void
+__KStackRunaway__(void* __Arg__ _unused)
+{
+    PInfo("KStacks: recursing until the guard page, expect a stack overflow report\n");
+    __KStackRecurse__(0);
+}
+
+/* Does not come back, the thread runs off its stack and the fault report halts the machine */
+void
+__TEST__KStackOverflow(void)
+{
+    SysErr  err;
+    SysErr* Error = &err;
+
+    Thread* T =
+        CreateThread(ThreadTypeKernel, (void*)__KStackRunaway__, NULL, ThreadPriorityNormal);
+    if (Probe_IF_Error(T) || !T)
+    {
+        PError("KStacks: no thread for the overflow test\n");
+        return;
+    }
+    ThreadExecute(T, Error);
+
+    for (;;)
+    {
+        ThreadSleep(1000, Error);
+    }
+}
+
+#define __PidBenchProcs__  10000
+#define __PidBenchRounds__ 100000
+
+static PosixProc* __PidBenchProc__[__PidBenchProcs__];
+static PosixProc  __PidBenchParent__; /*Pid 0, the Ppid every new process starts with*/
+
+/* The old PosixFind, a walk over the whole table */
+static PosixProc*
+__PidBenchScan__(long __Pid__)
+{
+    for (long I = 0; I < PosixProcs.Count; I++)
+    {
+        PosixProc* P = PosixProcs.Items[I];
+        if (P && P->Pid == __Pid__)
+        {
+            return P;
+        }
+    }
+    return NULL;
+}
+
+/* getpid and kill with __PidBenchProcs__ live processes, table scan against the PID hash */
+void
+__TEST__PidLookup(void)
+{
+    uint32_t Live = 0;
+    while (Live < __PidBenchProcs__)
+    {
+        PosixProc* P = PosixProcCreate();
+        if (Probe_IF_Error(P) || !P)
+        {
+            break;
+        }
+        __PidBenchProc__[Live++] = P;
+    }
+    if (!Live)
+    {
+        PError("PidLookup: no processes\n");
+        return;
+    }
+
+    Thread*    Self      = ThisThread();
+    PosixProc* SavedProc = Self->Proc;
+    uint32_t   SavedPid  = Self->ProcessId;
+    uint64_t   Sink      = 0;
+
+    /*getpid: what __GetCurrentProc__ paid before, then the Thread->Proc it uses now*/
+    Self->ProcessId = (uint32_t)__PidBenchProc__[Live - 1]->Pid;
+    uint64_t Start  = GetSystemNanos();
+    for (uint32_t Round = 0; Round < __PidBenchRounds__; Round++)
+    {
+        Sink += PosixGetPid(__PidBenchScan__((long)Self->ProcessId));
+    }
+    uint64_t ScanNs = (GetSystemNanos() - Start) * 1000 / __PidBenchRounds__;
+
+    Start = GetSystemNanos();
+    for (uint32_t Round = 0; Round < __PidBenchRounds__; Round++)
+    {
+        Sink += PosixGetPid(PosixFind((long)Self->ProcessId));
+    }
+    uint64_t HashNs = (GetSystemNanos() - Start) * 1000 / __PidBenchRounds__;
+
+    Self->Proc = __PidBenchProc__[Live - 1];
+    Start      = GetSystemNanos();
+    for (uint32_t Round = 0; Round < __PidBenchRounds__; Round++)
+    {
+        PosixProc* P = Self->Proc ? Self->Proc : PosixFind((long)Self->ProcessId);
+        Sink += PosixGetPid(P);
+    }
+    uint64_t DirectNs = (GetSystemNanos() - Start) * 1000 / __PidBenchRounds__;
+
+    PInfo("PidLookup: getpid with %u procs: scan %llu ps, hash %llu ps, Thread->Proc %llu ps\n",
+          Live,
+          ScanNs,
+          HashNs,
+          DirectNs);
+
+    /*kill: spread over the whole table so no chain stays warm*/
+    Start = GetSystemNanos();
+    for (uint32_t Round = 0; Round < __PidBenchRounds__ / 10; Round++)
+    {
+        PosixProc* P = __PidBenchScan__(__PidBenchProc__[(Round * 7919) % Live]->Pid);
+        __atomic_fetch_or(&P->SigPending, 1ULL << (SigCont & 63), __ATOMIC_RELEASE);
+    }
+    uint64_t KillScanNs = (GetSystemNanos() - Start) * 10 / __PidBenchRounds__;
+
+    Start = GetSystemNanos();
+    for (uint32_t Round = 0; Round < __PidBenchRounds__; Round++)
+    {
+        Sink += PosixKill(__PidBenchProc__[(Round * 7919) % Live]->Pid, SigCont);
+    }
+    uint64_t KillHashNs = (GetSystemNanos() - Start) / __PidBenchRounds__;
+
+    PInfo("PidLookup: kill with %u procs: scan %llu ns, hash %llu ns (%llu)\n",
+          Live,
+          KillScanNs,
+          KillHashNs,
+          Sink & 1);
+
+    Self->Proc      = SavedProc;
+    Self->ProcessId = SavedPid;
+
+    for (uint32_t Index = 0; Index < Live; Index++)
+    {
+        PosixProc* P  = __PidBenchProc__[Index];
+        long       Id = P->Pid;
+        P->SigPending = 0;
+        PosixExit(P, 0);
+        PosixWait4(&__PidBenchParent__, Id, NULL, WNOHANG, NULL);
+    }
+}
+
+/*Workqueue enqueue-to-execution latency and throughput*/
+#define __WorkBenchRounds__   2000
+#define __WorkBenchBatch__    256
+#define __WorkBenchBatches__  40
+#define __WorkBenchSleepers__ 8 /*Items blocking 10 ms each, the pool grows to overlap them*/
+
+static Work     __WorkBenchItem__[__WorkBenchBatch__];
+static uint64_t __WorkBenchStamp__;
+static uint64_t __WorkBenchLatSum__;
+static uint64_t __WorkBenchLatMax__;
+static uint32_t __WorkBenchDone__;
+
+static void
+__WorkBenchLatency__(Work* __Work__ _unused)
+{
+    uint64_t Latency = GetSystemNanos() - __WorkBenchStamp__;
+    __WorkBenchLatSum__ += Latency;
+    if (Latency > __WorkBenchLatMax__)
+    {
+        __WorkBenchLatMax__ = Latency;
+    }
+}
+
+static void
+__WorkBenchCount__(Work* __Work__ _unused)
+{
+    __atomic_fetch_add(&__WorkBenchDone__, 1, __ATOMIC_RELAXED);
+}
+
+static void
+__WorkBenchSleep__(Work* __Work__ _unused)
+{
+    SysErr  err;
+    SysErr* Error = &err;
+
+    ThreadSleep(10, Error);
+    __atomic_fetch_add(&__WorkBenchDone__, 1, __ATOMIC_RELAXED);
+}
+
+static void
+__WorkBenchOneLatency__(const char* __Label__, Workqueue* __Queue__, uint32_t __CpuId__)
+{
+    Work* Item = &__WorkBenchItem__[0];
+    InitWork(Item, __WorkBenchLatency__, NULL);
+
+    __WorkBenchLatSum__ = 0;
+    __WorkBenchLatMax__ = 0;
+    for (uint32_t Round = 0; Round < __WorkBenchRounds__; Round++)
+    {
+        __WorkBenchStamp__ = GetSystemNanos();
+        QueueWorkOn(__CpuId__, __Queue__, Item);
+        FlushWork(Item);
+    }
+
+    PInfo("WorkQueue: %s latency avg %llu ns, max %llu ns\n",
+          __Label__,
+          __WorkBenchLatSum__ / __WorkBenchRounds__,
+          __WorkBenchLatMax__);
+}
+
+/* Items per second through __Queue__, bound batches are spread round robin over the CPUs */
+static void
+__WorkBenchThroughput__(const char* __Label__, Workqueue* __Queue__)
+{
+    for (uint32_t Index = 0; Index < __WorkBenchBatch__; Index++)
+    {
+        InitWork(&__WorkBenchItem__[Index], __WorkBenchCount__, NULL);
+    }
+
+    __WorkBenchDone__ = 0;
+    uint64_t Start    = GetSystemNanos();
+    for (uint32_t Batch = 0; Batch < __WorkBenchBatches__; Batch++)
+    {
+        for (uint32_t Index = 0; Index < __WorkBenchBatch__; Index++)
+        {
+            QueueWorkOn(Index % Smp.CpuCount, __Queue__, &__WorkBenchItem__[Index]);
+        }
+        for (uint32_t Index = 0; Index < __WorkBenchBatch__; Index++)
+        {
+            FlushWork(&__WorkBenchItem__[Index]);
+        }
+    }
+    uint64_t Ns = GetSystemNanos() - Start;
+
+    PInfo("WorkQueue: %s throughput %llu items/s (%u items in %llu us)\n",
+          __Label__,
+          (uint64_t)__WorkBenchDone__ * 1000000000ULL / (Ns ? Ns : 1),
+          __WorkBenchDone__,
+          Ns / 1000);
+}
+
+/* Latency and throughput on bound and unbound queues, then pool growth and shrink */
+void
+__TEST__WorkQueue(void)
+{
+    SysErr  err;
+    SysErr* Error = &err;
+
+    uint32_t Cpu = GetCurrentCpuId();
+    PInfo("WorkQueue: %u CPUs\n", Smp.CpuCount);
+
+    __WorkBenchOneLatency__("bound local", &SystemWq, Cpu);
+    if (Smp.CpuCount > 1)
+    {
+        __WorkBenchOneLatency__("bound remote", &SystemWq, (Cpu + 1) % Smp.CpuCount);
+    }
+    __WorkBenchOneLatency__("unbound", &SystemUnboundWq, Cpu);
+
+    __WorkBenchThroughput__("bound", &SystemWq);
+    __WorkBenchThroughput__("unbound", &SystemUnboundWq);
+
+    /*Blocking items: one worker would take them back to back, growth overlaps them*/
+    WorkPool* Pool    = &WorkPools[Cpu];
+    uint64_t  Created = Pool->Created;
+    for (uint32_t Index = 0; Index < __WorkBenchSleepers__; Index++)
+    {
+        InitWork(&__WorkBenchItem__[Index], __WorkBenchSleep__, NULL);
+    }
+
+    __WorkBenchDone__ = 0;
+    uint64_t Start    = GetSystemNanos();
+    for (uint32_t Index = 0; Index < __WorkBenchSleepers__; Index++)
+    {
+        QueueWorkOn(Cpu, &SystemWq, &__WorkBenchItem__[Index]);
+    }
+    for (uint32_t Index = 0; Index < __WorkBenchSleepers__; Index++)
+    {
+        FlushWork(&__WorkBenchItem__[Index]);
+    }
+
+    PInfo("WorkQueue: %u blocking items in %llu ms, %llu workers started, %u in pool\n",
+          __WorkBenchSleepers__,
+          (GetSystemNanos() - Start) / 1000000,
+          Pool->Created - Created,
+          Pool->Count);
+
+    ThreadSleep(WorkIdleMs * (__WorkBenchSleepers__ + 1), Error);
+    PInfo("WorkQueue: %u workers left after idling, %llu retired\n", Pool->Count, Pool->Retired);
+
+    /*Delayed item against its deadline*/
+    DelayedWork Delayed;
+    InitDelayedWork(&Delayed, __WorkBenchLatency__, NULL);
+    __WorkBenchLatMax__ = 0;
+    __WorkBenchStamp__  = GetSystemNanos();
+    QueueDelayedWork(&SystemWq, &Delayed, 20);
+    FlushWork(&Delayed.Work);
+    PInfo("WorkQueue: 20 ms delayed item ran after %llu us\n", __WorkBenchLatMax__ / 1000);
+}
+
+/*Cross-CPU wakeups*/
+#define __IpiBenchRounds__ 2000
+#define __IpiBenchWaitMs__ 30000
+#define __IpiBenchCalls__  1000
+
+static Thread*           IpiBenchThreads[2];
+static Semaphore         IpiBenchSems[2];
+static uint64_t          IpiBenchNs;
+static volatile uint32_t IpiBenchDone;
+static volatile uint32_t IpiBenchHits;
+
+static void
+__IpiBenchWork__(void* __Arg__)
+{
+    SysErr   err;
+    SysErr*  Error = &err;
+    uint64_t Slot  = (uint64_t)__Arg__;
+    uint64_t Start = GetSystemNanos();
+
+    /*Slot 0 serves first, every release wakes a thread parked on the other CPU*/
+    for (uint32_t I = 0; I < __IpiBenchRounds__; I++)
+    {
+        AcquireSemaphore(&IpiBenchSems[Slot], Error);
+        ReleaseSemaphore(&IpiBenchSems[Slot ^ 1], Error);
+    }
+
+    if (Slot == 0)
+    {
+        IpiBenchNs = GetSystemNanos() - Start;
+    }
+    __atomic_fetch_add(&IpiBenchDone, 1, __ATOMIC_SEQ_CST);
+
+    IpiBenchThreads[Slot]->State = ThreadStateTerminated;
+    for (;;)
+    {
+        __asm__ volatile("int $0x20");
+    }
+}
+
+static void
+__IpiBenchRun__(int __Ipi__)
+{
+    SysErr  err;
+    SysErr* Error = &err;
+
+    SchedWakeIpi = __Ipi__;
+    IpiBenchDone = 0;
+    IpiBenchNs   = 0;
+
+    InitializeSemaphore(&IpiBenchSems[0], 1, "IpiBench0", Error);
+    InitializeSemaphore(&IpiBenchSems[1], 0, "IpiBench1", Error);
+
+    uint64_t Ipis[2], Stale[2];
+    for (uint32_t Cpu = 0; Cpu < 2; Cpu++)
+    {
+        Ipis[Cpu]  = __atomic_load_n(&CpuSchedulers[Cpu].ReschedIpis, __ATOMIC_SEQ_CST);
+        Stale[Cpu] = __atomic_load_n(&IpiStats[Cpu].ReschedStale, __ATOMIC_SEQ_CST);
+    }
+
+    /*One pinned to each of CPU 0 and 1, neither wakeup can be served by a local switch*/
+    for (uint64_t Slot = 0; Slot < 2; Slot++)
+    {
+        IpiBenchThreads[Slot] = CreateThread(
+            ThreadTypeKernel, __IpiBenchWork__, (void*)Slot, ThreadPriorityNormal);
+        if (Probe_IF_Error(IpiBenchThreads[Slot]) || !IpiBenchThreads[Slot])
+        {
+            PError("IPI bench: thread create failed\n");
+            SchedWakeIpi = 1;
+            return;
+        }
+
+        CpuMask Mask;
+        CpuMaskZero(&Mask);
+        CpuMaskSet(&Mask, (uint32_t)Slot);
+        SetThreadAffinity(IpiBenchThreads[Slot], &Mask, Error);
+        IpiBenchThreads[Slot]->Flags |= ThreadFlagPinned;
+    }
+    AddThreadToReadyQueue(0, IpiBenchThreads[0], Error);
+    AddThreadToReadyQueue(1, IpiBenchThreads[1], Error);
+
+    for (uint32_t Waited = 0; IpiBenchDone < 2 && Waited < __IpiBenchWaitMs__; Waited += 10)
+    {
+        ThreadSleep(10, Error);
+    }
+
+    uint64_t Sent = 0, Late = 0;
+    for (uint32_t Cpu = 0; Cpu < 2; Cpu++)
+    {
+        Sent += __atomic_load_n(&CpuSchedulers[Cpu].ReschedIpis, __ATOMIC_SEQ_CST) - Ipis[Cpu];
+        Late += __atomic_load_n(&IpiStats[Cpu].ReschedStale, __ATOMIC_SEQ_CST) - Stale[Cpu];
+    }
+
+    if (IpiBenchDone < 2)
+    {
+        PError("IPI bench: %s run did not finish\n", __Ipi__ ? "ipi " : "tick");
+    }
+    else
+    {
+        PInfo("IPI bench %s: %llu us/round, %llu us/wakeup, %llu IPIs, %llu stale\n",
+              __Ipi__ ? "ipi " : "tick",
+              IpiBenchNs / 1000 / __IpiBenchRounds__,
+              IpiBenchNs / 1000 / (2ULL * __IpiBenchRounds__),
+              Sent,
+              Late);
+    }
+
+    ThreadSleep(100, Error);
+    SchedWakeIpi = 1;
+}
+
+static void
+__IpiBenchHit__(void* __Arg__)
+{
+    (void)__Arg__;
+    __atomic_fetch_add(&IpiBenchHits, 1, __ATOMIC_RELAXED);
+}
+
+/* Semaphore ping-pong across two CPUs, woken at the tick and then by reschedule IPIs */
+void
+__TEST__IpiPingPong(void)
+{
+    if (Smp.CpuCount < 2)
+    {
+        PWarn("IPI bench: needs at least 2 CPUs\n");
+        return;
+    }
+
+    __IpiBenchRun__(0);
+    __IpiBenchRun__(1);
+
+    /*Synchronous call round trip, sender to the other CPU and back*/
+    uint32_t Target = GetCurrentCpuId() ? 0 : 1;
+    IpiBenchHits    = 0;
+    uint64_t Start  = GetSystemNanos();
+    for (uint32_t I = 0; I < __IpiBenchCalls__; I++)
+    {
+        IpiCallCpu(Target, __IpiBenchHit__, NULL);
+    }
+    uint64_t Ns = GetSystemNanos() - Start;
+
+    PInfo("IPI bench call: %llu ns/round trip to CPU %u, %u of %u ran\n",
+          Ns / __IpiBenchCalls__,
+          Target,
+          IpiBenchHits,
+          __IpiBenchCalls__);
+}
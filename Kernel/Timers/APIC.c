@@ -98,6 +98,7 @@ InitializeApicTimer(void)
 
     *TimerInitCount     = 0xFFFFFFFF;
     uint32_t StartCount = *TimerCurrCount;
+    uint64_t StartTsc   = ReadTsc();
 
     for (uint32_t I = 0; I < 10000; I++)
     {
@@ -105,12 +106,18 @@ InitializeApicTimer(void)
     }
 
     uint32_t EndCount    = *TimerCurrCount;
+    uint64_t EndTsc      = ReadTsc();
     uint32_t TicksIn10ms = StartCount - EndCount;
     Timer.TimerFrequency = TicksIn10ms * 100;
 
+    /*Same window, so TSC ticks run at the rate the periodic interrupt did*/
+    Timer.TscPerTick = (EndTsc - StartTsc) * 100 / TimerTargetFrequency;
+    Timer.TscBase    = EndTsc;
+
     if (Timer.TimerFrequency < 1000000)
     {
         Timer.TimerFrequency = 100000000; /* Default APIC frequency */
+        Timer.TscPerTick     = 0;         /* calibration is off, keep counting interrupts */
     }
 
     uint32_t InitialCount = Timer.TimerFrequency / TimerTargetFrequency;
@@ -18,3 +18,13 @@ WriteMsr(uint32_t __Msr__, uint64_t __Value__)
 
     __asm__ volatile("wrmsr" : : "a"(Low), "d"(High), "c"(__Msr__));
 }
+
+uint64_t
+ReadTsc(void)
+{
+    uint32_t Low, High;
+
+    __asm__ volatile("rdtsc" : "=a"(Low), "=d"(High));
+
+    return ((uint64_t)High << 32) | Low;
+}
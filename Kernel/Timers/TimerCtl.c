@@ -50,31 +50,123 @@ InitializeTimer(SysErr* __Err__)
     __asm__ volatile("sti");
 }
 
+/*
+    Periodic while something waits for this CPU, else one-shot to the next sleeper
+    (capped at TimerIdleMaxTicks). Covers both an idle CPU and one running a single thread.
+*/
+static void
+__ProgramNextTick__(uint32_t __CpuId__, PerCpuData* __CpuData__)
+{
+    if (Timer.ActiveTimer != TIMER_TYPE_APIC || !Timer.TscPerTick)
+    {
+        return;
+    }
+
+    CpuScheduler*      Scheduler = &CpuSchedulers[__CpuId__];
+    uint64_t           ApicBase  = __CpuData__->ApicBase;
+    volatile uint32_t* LvtTimer  = (volatile uint32_t*)(ApicBase + TimerApicRegLvtTimer);
+    volatile uint32_t* InitCount = (volatile uint32_t*)(ApicBase + TimerApicRegTimerInitCount);
+
+    uint32_t TickCount = Timer.TimerFrequency / TimerTargetFrequency;
+    Thread*  Current   = Scheduler->CurrentThread;
+    uint32_t Runnable  = __atomic_load_n(&Scheduler->ReadyCount, __ATOMIC_SEQ_CST);
+    if (Current && Current != Scheduler->IdleThread)
+    {
+        Runnable++;
+    }
+
+    if (Runnable > 1)
+    {
+        if (__CpuData__->TimerOneShot)
+        {
+            *LvtTimer                 = TimerVector | TimerApicTimerPeriodic;
+            *InitCount                = TickCount ? TickCount : 1;
+            __CpuData__->TimerOneShot = 0;
+        }
+        return;
+    }
+
+    uint64_t Now   = GetSystemTicks();
+    uint64_t Next  = TimerNextExpiry(__CpuId__);
+    uint64_t Delta = TimerIdleMaxTicks;
+    if (Next <= Now)
+    {
+        Delta = 1;
+    }
+    else if (Next - Now < Delta)
+    {
+        Delta = Next - Now;
+    }
+
+    uint64_t Count = Delta * TickCount;
+    if (!Count || Count > 0xFFFFFFFFULL)
+    {
+        Count = Count ? 0xFFFFFFFFULL : 1;
+    }
+
+    *LvtTimer                 = TimerVector | TimerApicTimerOneShot;
+    *InitCount                = (uint32_t)Count;
+    __CpuData__->TimerOneShot = 1;
+}
+
 void
 TimerHandler(InterruptFrame* __Frame__, SysErr* __Err__)
 {
     uint32_t    CpuId   = GetCurrentCpuId();
-    PerCpuData* CpuData = GetPerCpuData(CpuId);
+    PerCpuData* CpuData = ThisCpuData();
 
     __atomic_fetch_add(&CpuData->LocalInterrupts, 1, __ATOMIC_SEQ_CST);
     __atomic_fetch_add(&CpuData->LocalTicks, 1, __ATOMIC_SEQ_CST);
 
     __atomic_fetch_add(&TimerInterruptCount, 1, __ATOMIC_SEQ_CST);
-    __atomic_fetch_add(&Timer.SystemTicks, 1, __ATOMIC_SEQ_CST);
+    if (!Timer.TscPerTick)
+    {
+        __atomic_fetch_add(&Timer.SystemTicks, 1, __ATOMIC_SEQ_CST);
+    }
 
     WakeupSleepingThreads(CpuId, __Err__);
     Schedule(CpuId, __Frame__, __Err__);
+    __ProgramNextTick__(CpuId, CpuData);
 
     volatile uint32_t* EoiReg = (volatile uint32_t*)(CpuData->ApicBase + TimerApicRegEoi);
     *EoiReg                   = 0;
 }
 
+/* Switches that bypass the timer vector still have to leave the next tick right, interrupts off */
+void
+TimerReprogram(void)
+{
+    __ProgramNextTick__(ThisCpuId(), ThisCpuData());
+}
+
 uint64_t
 GetSystemTicks(void)
 {
+    /*Skipped ticks must not stop the clock, so read it off the TSC when calibrated*/
+    if (Timer.TscPerTick)
+    {
+        return (ReadTsc() - Timer.TscBase) / Timer.TscPerTick;
+    }
     return Timer.SystemTicks;
 }
 
+/* Sub-tick clock for runtime accounting, tick resolution until the TSC is calibrated */
+uint64_t
+GetSystemNanos(void)
+{
+    const uint64_t NsPerTick = 1000000000ULL / TimerTargetFrequency;
+
+    if (Timer.TscPerTick)
+    {
+        /*Split so the multiply cannot overflow however long we have been up*/
+        uint64_t Cycles = ReadTsc() - Timer.TscBase;
+        uint64_t Ticks  = Cycles / Timer.TscPerTick;
+        uint64_t Rest   = Cycles % Timer.TscPerTick;
+        return Ticks * NsPerTick + (Rest * NsPerTick) / Timer.TscPerTick;
+    }
+    return Timer.SystemTicks * NsPerTick;
+}
+
 void
 Sleep(uint32_t __Milliseconds__, SysErr* __Err__)
 {
@@ -84,10 +176,10 @@ Sleep(uint32_t __Milliseconds__, SysErr* __Err__)
         return;
     }
 
-    uint64_t StartTicks = Timer.SystemTicks;
+    uint64_t StartTicks = GetSystemTicks();
     uint64_t EndTicks   = StartTicks + __Milliseconds__;
 
-    while (Timer.SystemTicks < EndTicks)
+    while (GetSystemTicks() < EndTicks)
     {
         __asm__ volatile("hlt");
     }
@@ -0,0 +1,320 @@
+#include <Timer.h>
+#include <TimerWheel.h>
+
+TimerWheel      TimerWheels[MaxCPUs];
+TimerWheelStats TimerStats = {0};
+
+void
+InitializeTimerWheel(uint32_t __CpuId__, SysErr* __Err__)
+{
+    if (__CpuId__ >= MaxCPUs)
+    {
+        SlotError(__Err__, -BadArgs);
+        return;
+    }
+
+    TimerWheel* Wheel = &TimerWheels[__CpuId__];
+
+    for (uint32_t Level = 0; Level < WheelLevels; Level++)
+    {
+        for (uint32_t Slot = 0; Slot < WheelSlots; Slot++)
+        {
+            Wheel->Slots[Level][Slot] = NULL;
+        }
+        Wheel->Pending[Level] = 0;
+    }
+
+    Wheel->Clock = GetSystemTicks();
+    Wheel->Count = 0;
+    InitializeSpinLock(&Wheel->Lock, "TimerWheel", __Err__);
+}
+
+void
+TimerInit(KTimer* __Timer__, TimerCallback __Callback__, void* __Arg__)
+{
+    __Timer__->Expires  = 0;
+    __Timer__->Callback = __Callback__;
+    __Timer__->Arg      = __Arg__;
+    __Timer__->Cpu      = 0;
+    __Timer__->Armed    = 0;
+    __Timer__->Bucket   = 0;
+    __Timer__->Next     = NULL;
+    __Timer__->Prev     = NULL;
+}
+
+/* Lowest level whose span holds the deadline. Caller holds the wheel lock */
+static void
+__WheelInsert__(TimerWheel* __Wheel__, KTimer* __Timer__)
+{
+    uint64_t Expires = __Timer__->Expires;
+
+    /*Overdue runs on the next tick, too far out parks at the end and is re-filed on cascade*/
+    if (Expires < __Wheel__->Clock)
+    {
+        Expires = __Wheel__->Clock;
+    }
+    if (Expires - __Wheel__->Clock >= WheelSpan)
+    {
+        Expires = __Wheel__->Clock + WheelSpan - 1;
+    }
+
+    uint64_t Delta = Expires - __Wheel__->Clock;
+    uint32_t Level = 0;
+    while (Level < WheelLevels - 1 && Delta >= (1ULL << ((Level + 1) * WheelBits)))
+    {
+        Level++;
+    }
+
+    uint32_t Slot = (uint32_t)(Expires >> (Level * WheelBits)) & WheelMask;
+    KTimer** Head = &__Wheel__->Slots[Level][Slot];
+
+    __Timer__->Bucket = Level * WheelSlots + Slot;
+    __Timer__->Prev   = NULL;
+    __Timer__->Next   = *Head;
+    if (*Head)
+    {
+        (*Head)->Prev = __Timer__;
+    }
+    *Head = __Timer__;
+
+    __Wheel__->Pending[Level] |= 1ULL << Slot;
+}
+
+static void
+__WheelUnlink__(TimerWheel* __Wheel__, KTimer* __Timer__)
+{
+    uint32_t Level = __Timer__->Bucket / WheelSlots;
+    uint32_t Slot  = __Timer__->Bucket % WheelSlots;
+
+    if (__Timer__->Prev)
+    {
+        __Timer__->Prev->Next = __Timer__->Next;
+    }
+    else
+    {
+        __Wheel__->Slots[Level][Slot] = __Timer__->Next;
+    }
+
+    if (__Timer__->Next)
+    {
+        __Timer__->Next->Prev = __Timer__->Prev;
+    }
+
+    if (!__Wheel__->Slots[Level][Slot])
+    {
+        __Wheel__->Pending[Level] &= ~(1ULL << Slot);
+    }
+
+    __Timer__->Next = NULL;
+    __Timer__->Prev = NULL;
+}
+
+/* Re-file one slot of a higher level, its deadlines are now within reach of the level below */
+static void
+__WheelCascade__(TimerWheel* __Wheel__, uint32_t __Level__, uint32_t __Slot__)
+{
+    KTimer* Timer = __Wheel__->Slots[__Level__][__Slot__];
+
+    __Wheel__->Slots[__Level__][__Slot__] = NULL;
+    __Wheel__->Pending[__Level__] &= ~(1ULL << __Slot__);
+
+    while (Timer)
+    {
+        KTimer* Next = Timer->Next;
+        __WheelInsert__(__Wheel__, Timer);
+        __atomic_fetch_add(&TimerStats.Cascaded, 1, __ATOMIC_RELAXED);
+        Timer = Next;
+    }
+}
+
+int
+TimerArmAt(KTimer* __Timer__, uint32_t __CpuId__, uint64_t __Expires__)
+{
+    if (Probe_IF_Error(__Timer__) || !__Timer__ || !__Timer__->Callback || __CpuId__ >= MaxCPUs)
+    {
+        return -BadArgs;
+    }
+
+    /*Re-arming moves the timer, possibly to another CPU's wheel*/
+    TimerCancel(__Timer__);
+
+    TimerWheel* Wheel = &TimerWheels[__CpuId__];
+
+    SysErr  err;
+    SysErr* Error = &err;
+    AcquireSpinLock(&Wheel->Lock, Error);
+
+    __Timer__->Expires = __Expires__;
+    __Timer__->Cpu     = __CpuId__;
+    __Timer__->Armed   = 1;
+    __WheelInsert__(Wheel, __Timer__);
+    Wheel->Count++;
+
+    ReleaseSpinLock(&Wheel->Lock, Error);
+
+    __atomic_fetch_add(&TimerStats.Armed, 1, __ATOMIC_RELAXED);
+    return SysOkay;
+}
+
+int
+TimerArm(KTimer* __Timer__, uint64_t __Ticks__)
+{
+    return TimerArmAt(__Timer__, GetCurrentCpuId(), GetSystemTicks() + __Ticks__);
+}
+
+/* 1 if it was pending, 0 if it already fired (its callback may still be running) or never armed */
+int
+TimerCancel(KTimer* __Timer__)
+{
+    if (Probe_IF_Error(__Timer__) || !__Timer__)
+    {
+        return -BadArgs;
+    }
+    if (!__atomic_load_n(&__Timer__->Armed, __ATOMIC_SEQ_CST))
+    {
+        return 0;
+    }
+
+    TimerWheel* Wheel = &TimerWheels[__Timer__->Cpu];
+
+    SysErr  err;
+    SysErr* Error = &err;
+    AcquireSpinLock(&Wheel->Lock, Error);
+
+    if (!__Timer__->Armed)
+    {
+        ReleaseSpinLock(&Wheel->Lock, Error);
+        return 0;
+    }
+
+    __WheelUnlink__(Wheel, __Timer__);
+    __Timer__->Armed = 0;
+    Wheel->Count--;
+
+    ReleaseSpinLock(&Wheel->Lock, Error);
+
+    __atomic_fetch_add(&TimerStats.Cancelled, 1, __ATOMIC_RELAXED);
+    return 1;
+}
+
+void
+TimerWheelRun(uint32_t __CpuId__, uint64_t __Now__)
+{
+    if (__CpuId__ >= MaxCPUs)
+    {
+        return;
+    }
+
+    TimerWheel* Wheel = &TimerWheels[__CpuId__];
+    KTimer*     Head  = NULL;
+    KTimer*     Tail  = NULL;
+
+    SysErr  err;
+    SysErr* Error = &err;
+    AcquireSpinLock(&Wheel->Lock, Error);
+
+    while (Wheel->Clock <= __Now__)
+    {
+        uint32_t Index = (uint32_t)Wheel->Clock & WheelMask;
+
+        /*Level 0 wrapped: pull the next slot of each level down until one did not wrap*/
+        if (!Index)
+        {
+            for (uint32_t Level = 1; Level < WheelLevels; Level++)
+            {
+                uint32_t Slot = (uint32_t)(Wheel->Clock >> (Level * WheelBits)) & WheelMask;
+                __WheelCascade__(Wheel, Level, Slot);
+                if (Slot)
+                {
+                    break;
+                }
+            }
+        }
+
+        /*Everything in this slot is due, collect it and run it unlocked*/
+        KTimer* Timer          = Wheel->Slots[0][Index];
+        Wheel->Slots[0][Index] = NULL;
+        Wheel->Pending[0]     &= ~(1ULL << Index);
+
+        while (Timer)
+        {
+            KTimer* Next = Timer->Next;
+            Timer->Armed = 0;
+            Timer->Next  = NULL;
+            Timer->Prev  = Tail;
+            if (Tail)
+            {
+                Tail->Next = Timer;
+            }
+            else
+            {
+                Head = Timer;
+            }
+            Tail = Timer;
+            Wheel->Count--;
+            Timer = Next;
+        }
+
+        Wheel->Clock++;
+
+        /*Nothing due on level 0, jump to the next cascade point (tickless gaps)*/
+        if (!Wheel->Pending[0] && (Wheel->Clock & WheelMask))
+        {
+            uint64_t Boundary = (Wheel->Clock | WheelMask) + 1;
+            Wheel->Clock      = (Boundary <= __Now__) ? Boundary : __Now__ + 1;
+        }
+    }
+
+    ReleaseSpinLock(&Wheel->Lock, Error);
+
+    while (Head)
+    {
+        KTimer* Next = Head->Next;
+        Head->Next   = NULL;
+        Head->Prev   = NULL;
+
+        /*The callback may re-arm its own timer*/
+        Head->Callback(Head->Arg);
+        __atomic_fetch_add(&TimerStats.Fired, 1, __ATOMIC_RELAXED);
+        Head = Next;
+    }
+}
+
+uint64_t
+TimerNextExpiry(uint32_t __CpuId__)
+{
+    if (__CpuId__ >= MaxCPUs)
+    {
+        return ~0ULL;
+    }
+
+    TimerWheel* Wheel = &TimerWheels[__CpuId__];
+    uint64_t    Next  = ~0ULL;
+
+    SysErr  err;
+    SysErr* Error = &err;
+    AcquireSpinLock(&Wheel->Lock, Error);
+
+    /*Level 0 is exact: rotate so bit 0 is the slot for Clock and take the first set bit*/
+    uint64_t Pending = Wheel->Pending[0];
+    if (Pending)
+    {
+        uint32_t Index   = (uint32_t)Wheel->Clock & WheelMask;
+        uint64_t Rotated = Index ? (Pending >> Index) | (Pending << (WheelSlots - Index)) : Pending;
+        Next             = Wheel->Clock + (uint64_t)__builtin_ctzll(Rotated);
+    }
+
+    /*Higher levels only say something is coming, wake at the next cascade to re-file it*/
+    for (uint32_t Level = 1; Level < WheelLevels; Level++)
+    {
+        if (Wheel->Pending[Level])
+        {
+            uint64_t Boundary = (Wheel->Clock + WheelMask) & ~(uint64_t)WheelMask;
+            Next              = (Boundary < Next) ? Boundary : Next;
+            break;
+        }
+    }
+
+    ReleaseSpinLock(&Wheel->Lock, Error);
+    return Next;
+}
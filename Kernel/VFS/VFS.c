@@ -165,6 +165,52 @@ __find_mount__(const char* __Path__)
     return Best >= Nothing ? &__Mounts__[Best] : Nothing;
 }
 
+/*Split Path into its parent (resolved through mounts) and the final component*/
+static Dentry*
+__resolve_parent__(const char* __Path__, char* __Name__, long __Len__)
+{
+    char Dir[1024];
+    long Pl = (long)strlen(__Path__);
+    while (Pl > 1 && __is_sep__(__Path__[Pl - 1]))
+    {
+        Pl--;
+    }
+    if (Pl <= 0 || Pl >= (long)sizeof(Dir))
+    {
+        return Error_TO_Pointer(-Limits);
+    }
+
+    long Cut = Pl;
+    while (Cut > 0 && !__is_sep__(__Path__[Cut - 1]))
+    {
+        Cut--;
+    }
+    if (Pl - Cut <= 0 || Pl - Cut >= __Len__)
+    {
+        return Error_TO_Pointer(-BadArgs);
+    }
+    memcpy(__Name__, __Path__ + Cut, (size_t)(Pl - Cut));
+    __Name__[Pl - Cut] = '\0';
+
+    long Dl = Cut;
+    while (Dl > 1 && __is_sep__(__Path__[Dl - 1]))
+    {
+        Dl--;
+    }
+    if (Dl <= 0)
+    {
+        Dir[0] = '/';
+        Dl     = 1;
+    }
+    else
+    {
+        memcpy(Dir, __Path__, (size_t)Dl);
+    }
+    Dir[Dl] = '\0';
+
+    return VfsResolve(Dir);
+}
+
 int
 VfsInit(void)
 {
@@ -578,6 +624,7 @@ VfsResolve(const char* __Path__)
 
     if (strcmp(__Path__, "/") == 0)
     {
+        ReleaseMutex(&VfsLock, Error);
         return __RootDe__;
     }
 
@@ -587,6 +634,7 @@ VfsResolve(const char* __Path__)
     if (Probe_IF_Error(M) || !M)
     {
         /*Walk from the global root for non-mounted prefixes*/
+        ReleaseMutex(&VfsLock, Error);
         return __walk__(__RootNode__, __RootDe__, __Path__);
     }
 
@@ -599,6 +647,7 @@ VfsResolve(const char* __Path__)
     {
         /*Construct a dentry anchored at mount root*/
         Dentry* De = __alloc_dentry__(Mp, __RootDe__, M->Sb->Root);
+        ReleaseMutex(&VfsLock, Error);
         return De ? De : Error_TO_Pointer(-NoSuch);
     }
 
@@ -614,6 +663,7 @@ VfsResolve(const char* __Path__)
     if (!*Tail)
     {
         Dentry* De = __alloc_dentry__(Mp, __RootDe__, M->Sb->Root);
+        ReleaseMutex(&VfsLock, Error);
         return De ? De : Error_TO_Pointer(-BadAlloc);
     }
 
@@ -902,6 +952,41 @@ VfsRead(File* __File__, void* __Buf__, long __Len__)
     return Got;
 }
 
+/* Reads at __Off__ without moving the shared offset, every other user of it holds VfsLock */
+long
+VfsPread(File* __File__, void* __Buf__, long __Len__, long __Off__)
+{
+    SysErr  err;
+    SysErr* Error = &err;
+    AcquireMutex(&VfsLock, Error);
+    if (Probe_IF_Error(__File__) || !__File__ || Probe_IF_Error(__Buf__) || !__Buf__ ||
+        __Len__ <= 0 || __Off__ < 0)
+    {
+        ReleaseMutex(&VfsLock, Error);
+        return -BadArgs;
+    }
+
+    if (Probe_IF_Error(__File__->Node) || !__File__->Node || Probe_IF_Error(__File__->Node->Ops) ||
+        !__File__->Node->Ops || !__File__->Node->Ops->Read || !__File__->Node->Ops->Lseek)
+    {
+        ReleaseMutex(&VfsLock, Error);
+        return -NoOperations;
+    }
+
+    /* Fs keep their own cursor behind Offset, so it is moved through Lseek and put back */
+    long Saved = __File__->Offset;
+    long Got   = -BadArgs;
+    if (__File__->Node->Ops->Lseek(__File__, __Off__, VSeekSET) >= 0)
+    {
+        Got = __File__->Node->Ops->Read(__File__, __Buf__, __Len__);
+    }
+    __File__->Node->Ops->Lseek(__File__, Saved, VSeekSET);
+    __File__->Offset = Saved;
+
+    ReleaseMutex(&VfsLock, Error);
+    return Got;
+}
+
 long
 VfsWrite(File* __File__, const void* __Buf__, long __Len__)
 {
@@ -1007,6 +1092,30 @@ VfsFsync(File* __File__)
     return __File__->Node->Ops->Sync(__File__->Node);
 }
 
+int
+VfsFtruncate(File* __File__, long __Len__)
+{
+    SysErr  err;
+    SysErr* Error = &err;
+    AcquireMutex(&VfsLock, Error);
+    if (Probe_IF_Error(__File__) || !__File__ || __Len__ < 0)
+    {
+        ReleaseMutex(&VfsLock, Error);
+        return -BadArgs;
+    }
+
+    if (Probe_IF_Error(__File__->Node) || !__File__->Node || Probe_IF_Error(__File__->Node->Ops) ||
+        !__File__->Node->Ops || Probe_IF_Error(__File__->Node->Ops->Truncate) ||
+        !__File__->Node->Ops->Truncate)
+    {
+        ReleaseMutex(&VfsLock, Error);
+        return -NoOperations;
+    }
+
+    ReleaseMutex(&VfsLock, Error);
+    return __File__->Node->Ops->Truncate(__File__->Node, __Len__);
+}
+
 int
 VfsFstats(File* __File__, VfsStat* __Buf__)
 {
@@ -1031,6 +1140,58 @@ VfsFstats(File* __File__, VfsStat* __Buf__)
     return __File__->Node->Ops->Stat(__File__->Node, __Buf__);
 }
 
+int
+VfsMap(File* __File__, void** __Out__, long __Off__, long __Len__)
+{
+    SysErr  err;
+    SysErr* Error = &err;
+    AcquireMutex(&VfsLock, Error);
+    if (Probe_IF_Error(__File__) || !__File__ || Probe_IF_Error(__Out__) || !__Out__ ||
+        __Off__ < 0 || __Len__ <= 0)
+    {
+        ReleaseMutex(&VfsLock, Error);
+        return -BadArgs;
+    }
+
+    if (Probe_IF_Error(__File__->Node) || !__File__->Node || Probe_IF_Error(__File__->Node->Ops) ||
+        !__File__->Node->Ops || Probe_IF_Error(__File__->Node->Ops->Map) ||
+        !__File__->Node->Ops->Map)
+    {
+        ReleaseMutex(&VfsLock, Error);
+        return -NoOperations;
+    }
+
+    int Res = __File__->Node->Ops->Map(__File__->Node, __Out__, __Off__, __Len__);
+    ReleaseMutex(&VfsLock, Error);
+    return Res;
+}
+
+int
+VfsUnmap(File* __File__, void* __Addr__, long __Len__)
+{
+    SysErr  err;
+    SysErr* Error = &err;
+    AcquireMutex(&VfsLock, Error);
+    if (Probe_IF_Error(__File__) || !__File__ || Probe_IF_Error(__Addr__) || !__Addr__ ||
+        __Len__ <= 0)
+    {
+        ReleaseMutex(&VfsLock, Error);
+        return -BadArgs;
+    }
+
+    if (Probe_IF_Error(__File__->Node) || !__File__->Node || Probe_IF_Error(__File__->Node->Ops) ||
+        !__File__->Node->Ops || Probe_IF_Error(__File__->Node->Ops->Unmap) ||
+        !__File__->Node->Ops->Unmap)
+    {
+        ReleaseMutex(&VfsLock, Error);
+        return -NoOperations;
+    }
+
+    int Res = __File__->Node->Ops->Unmap(__File__->Node, __Addr__, __Len__);
+    ReleaseMutex(&VfsLock, Error);
+    return Res;
+}
+
 int
 VfsStats(const char* __Path__, VfsStat* __Buf__)
 {
@@ -1131,6 +1292,25 @@ VfsCreate(const char* __Path__, long __Flags__, VfsPerm __Perm__)
         ReleaseMutex(&VfsLock, Error);
         return -NotCanonical;
     }
+    /*Paths under another filesystem's mount resolve their parent through it*/
+    __MountEntry__* M = __find_mount__(__Path__);
+    if (M && M->Sb && M->Sb->Root != __RootNode__)
+    {
+        Dentry* Dir = __resolve_parent__(__Path__, Name, sizeof(Name));
+        if (Probe_IF_Error(Dir) || !Dir || Probe_IF_Error(Dir->Node) || !Dir->Node)
+        {
+            ReleaseMutex(&VfsLock, Error);
+            return -CannotLookup;
+        }
+        if (Probe_IF_Error(Dir->Node->Ops) || !Dir->Node->Ops ||
+            Probe_IF_Error(Dir->Node->Ops->Create) || !Dir->Node->Ops->Create)
+        {
+            ReleaseMutex(&VfsLock, Error);
+            return -NoOperations;
+        }
+        ReleaseMutex(&VfsLock, Error);
+        return Dir->Node->Ops->Create(Dir->Node, Name, __Flags__, __Perm__);
+    }
     const char* __Path = __Path__;
     if (__is_sep__(*__Path))
     {
@@ -1206,6 +1386,25 @@ VfsUnlink(const char* __Path__)
         ReleaseMutex(&VfsLock, Error);
         return -NotCanonical;
     }
+    /*Paths under another filesystem's mount resolve their parent through it*/
+    __MountEntry__* M = __find_mount__(__Path__);
+    if (M && M->Sb && M->Sb->Root != __RootNode__)
+    {
+        Dentry* Dir = __resolve_parent__(__Path__, Name, sizeof(Name));
+        if (Probe_IF_Error(Dir) || !Dir || Probe_IF_Error(Dir->Node) || !Dir->Node)
+        {
+            ReleaseMutex(&VfsLock, Error);
+            return -CannotLookup;
+        }
+        if (Probe_IF_Error(Dir->Node->Ops) || !Dir->Node->Ops ||
+            Probe_IF_Error(Dir->Node->Ops->Unlink) || !Dir->Node->Ops->Unlink)
+        {
+            ReleaseMutex(&VfsLock, Error);
+            return -NoOperations;
+        }
+        ReleaseMutex(&VfsLock, Error);
+        return Dir->Node->Ops->Unlink(Dir->Node, Name);
+    }
     const char* __Path = __Path__;
     if (__is_sep__(*__Path))
     {
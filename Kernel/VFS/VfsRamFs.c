@@ -26,8 +26,8 @@ const VnodeOps __RamVfsOps__ = {
     .Chown    = RamVfsChown,    /**< Change ownership (no-op) */
     .Truncate = RamVfsTruncate, /**< Truncate file (not implemented) */
     .Sync     = RamVfsSync,     /**< Synchronize file (no-op) */
-    .Map      = RamVfsMap,      /**< Memory map file (not implemented) */
-    .Unmap    = RamVfsUnmap     /**< Unmap memory (not implemented) */
+    .Map      = RamVfsMap,      /**< Expose initrd-backed file data for mmap */
+    .Unmap    = RamVfsUnmap     /**< Release a Map (no-op, nothing pinned) */
 };
 
 const SuperOps __RamVfsSuperOps__ = {
@@ -92,7 +92,7 @@ RamFsMountImpl(const char* __Dev__ _unused, const char* __Opts__ _unused)
 
     Sb->Type  = 0;
     Sb->Dev   = 0;
-    Sb->Flags = 0;
+    Sb->Flags = VMFlgRDONLY; /* initrd backed, writes never reach a mapping */
     Sb->Root  = Root;
     Sb->Ops   = &__RamVfsSuperOps__;
     Sb->Priv  = 0;
@@ -523,18 +523,40 @@ RamVfsSync(Vnode* __Node__ _unused)
 }
 
 int
-RamVfsMap(Vnode* __Node__ _unused,
-          void** __Out__  _unused,
-          long __Off__    _unused,
-          long __Len__    _unused)
+RamVfsMap(Vnode* __Node__, void** __Out__, long __Off__, long __Len__)
 {
-    return -Impilict;
+    if (Probe_IF_Error(__Node__) || !__Node__ || Probe_IF_Error(__Out__) || !__Out__ ||
+        __Off__ < 0 || __Len__ <= 0)
+    {
+        return -BadArgs;
+    }
+
+    RamVfsPrivNode* PN = (RamVfsPrivNode*)__Node__->Priv;
+    if (Probe_IF_Error(PN) || !PN || Probe_IF_Error(PN->Node) || !PN->Node)
+    {
+        return -NotCanonical;
+    }
+
+    if (PN->Node->Type != RamFSNode_File || !PN->Node->Data)
+    {
+        return -NoSuch;
+    }
+
+    if ((uint64_t)__Off__ + (uint64_t)__Len__ > (uint64_t)PN->Node->Size)
+    {
+        return -TooBig;
+    }
+
+    /* Initrd data is immutable and lives for the whole boot, so hand it out directly */
+    *__Out__ = (void*)(PN->Node->Data + __Off__);
+    return SysOkay;
 }
 
 int
 RamVfsUnmap(Vnode* __Node__ _unused, void* __Addr__ _unused, long __Len__ _unused)
 {
-    return -Impilict;
+    /* Nothing is pinned on Map, nothing to release */
+    return SysOkay;
 }
 
 int
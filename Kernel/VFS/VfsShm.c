@@ -0,0 +1,737 @@
+#include <KrnPrintf.h>
+#include <ShmFs.h>
+#include <String.h>
+
+/*shm/memfd objects, mounted at /dev/shm*/
+
+ShmFsStats ShmStats = {0};
+
+static ShmObject*  __ShmTbl__[ShmMaxObjects];
+static SpinLock    ShmLock;
+static Superblock* ShmSuper;
+static long        ShmNextIno = 2;
+
+const VnodeOps __ShmFsOps__ = {
+    .Open     = ShmOpen,     /**< Pin the object for the lifetime of the file */
+    .Close    = ShmClose,    /**< Drop the pin, free once unlinked and unmapped */
+    .Read     = ShmRead,     /**< Copy out of the backing frames */
+    .Write    = ShmWrite,    /**< Copy into the backing frames, growing the object */
+    .Lseek    = ShmLseek,    /**< Seek within the object */
+    .Stat     = ShmStat,     /**< Size and type */
+    .Readdir  = ShmReaddir,  /**< List named objects */
+    .Lookup   = ShmLookup,   /**< Find a named object */
+    .Create   = ShmCreate,   /**< shm_open(O_CREAT) */
+    .Unlink   = ShmUnlink,   /**< shm_unlink, frames stay until the last user is gone */
+    .Truncate = ShmTruncate, /**< ftruncate, sizes the object */
+    .Map      = ShmMap,      /**< Hand out one backing frame */
+    .Unmap    = ShmUnmap     /**< Give a frame back */
+};
+
+static int
+__ShmIsRoot__(Vnode* __Node__)
+{
+    return ShmSuper && __Node__ == ShmSuper->Root;
+}
+
+static ShmObject*
+__ShmOf__(Vnode* __Node__)
+{
+    if (Probe_IF_Error(__Node__) || !__Node__ || __ShmIsRoot__(__Node__))
+    {
+        return NULL;
+    }
+    return (ShmObject*)__Node__->Priv;
+}
+
+/* Zeroed frames for [__From__, __To__) in a new array of __To__ entries, ShmLock not held */
+static uint64_t*
+__ShmAllocFrames__(uint64_t __From__, uint64_t __To__)
+{
+    SysErr  err;
+    SysErr* Error = &err;
+
+    uint64_t* Frames = (uint64_t*)KMalloc(sizeof(uint64_t) * __To__);
+    if (Probe_IF_Error(Frames) || !Frames)
+    {
+        return NULL;
+    }
+
+    for (uint64_t Index = __From__; Index < __To__; Index++)
+    {
+        uint64_t Phys = AllocPage();
+        if (!Phys)
+        {
+            for (uint64_t Undo = __From__; Undo < Index; Undo++)
+            {
+                FreePage(Frames[Undo], Error);
+            }
+            KFree(Frames, Error);
+            return NULL;
+        }
+        memset(PhysToVirt(Phys), 0, PageSize);
+        Frames[Index] = Phys;
+    }
+    return Frames;
+}
+
+/*
+    Takes ShmLock itself. Growing allocates with the lock dropped and starts
+    over if the object was resized meanwhile. __GrowOnly__ leaves a larger
+    object as it is, a write never cuts what a racing write just added.
+*/
+static int
+__ShmResize__(ShmObject* __Obj__, long __Size__, int __GrowOnly__)
+{
+    SysErr  err;
+    SysErr* Error = &err;
+
+    if (__Size__ < 0)
+    {
+        return -BadArgs;
+    }
+
+    uint64_t Pages = ((uint64_t)__Size__ + PageSize - 1) / PageSize;
+    if (Pages > ShmMaxPages)
+    {
+        return -TooBig;
+    }
+
+    AcquireSpinLock(&ShmLock, Error);
+    if (__GrowOnly__ && __Size__ <= __Obj__->Size)
+    {
+        ReleaseSpinLock(&ShmLock, Error);
+        return SysOkay;
+    }
+
+    while (Pages > __Obj__->Pages)
+    {
+        uint64_t Have = __Obj__->Pages;
+        ReleaseSpinLock(&ShmLock, Error);
+
+        uint64_t* Frames = __ShmAllocFrames__(Have, Pages);
+        if (!Frames)
+        {
+            return -BadAlloc;
+        }
+
+        AcquireSpinLock(&ShmLock, Error);
+        uint64_t* Old = NULL;
+        if (__Obj__->Pages == Have)
+        {
+            for (uint64_t Index = 0; Index < Have; Index++)
+            {
+                Frames[Index] = __Obj__->Frames[Index];
+            }
+            Old = __Obj__->Frames;
+            ShmStats.Pages += Pages - Have;
+            __Obj__->Frames = Frames;
+            __Obj__->Pages  = Pages;
+            Frames          = NULL;
+        }
+        ReleaseSpinLock(&ShmLock, Error);
+
+        if (Old)
+        {
+            KFree(Old, Error);
+        }
+
+        /* Lost a race with another resize, ours go back and the sizes are looked at again */
+        if (Frames)
+        {
+            for (uint64_t Index = Have; Index < Pages; Index++)
+            {
+                FreePage(Frames[Index], Error);
+            }
+            KFree(Frames, Error);
+        }
+
+        AcquireSpinLock(&ShmLock, Error);
+    }
+
+    if (__GrowOnly__ && __Size__ <= __Obj__->Size)
+    {
+        ReleaseSpinLock(&ShmLock, Error);
+        return SysOkay;
+    }
+
+    if (Pages < __Obj__->Pages)
+    {
+        /* Some space may still point at the tail, or a read or write is copying it */
+        if (__Obj__->Maps || __Obj__->Io)
+        {
+            ReleaseSpinLock(&ShmLock, Error);
+            return __Obj__->Maps ? -Dangling : -Busy;
+        }
+
+        for (uint64_t Index = Pages; Index < __Obj__->Pages; Index++)
+        {
+            FreePage(__Obj__->Frames[Index], Error);
+            __Obj__->Frames[Index] = 0;
+        }
+        ShmStats.Pages -= __Obj__->Pages - Pages;
+        __Obj__->Pages = Pages;
+    }
+
+    /* Bytes past the new end read back as zero if the object grows again */
+    if (__Size__ < __Obj__->Size && (__Size__ % PageSize) != 0)
+    {
+        uint8_t* Tail = (uint8_t*)PhysToVirt(__Obj__->Frames[__Size__ / PageSize]);
+        memset(Tail + (__Size__ % PageSize), 0, PageSize - (__Size__ % PageSize));
+    }
+
+    __Obj__->Size = __Size__;
+    ReleaseSpinLock(&ShmLock, Error);
+    return SysOkay;
+}
+
+/*
+    Frame under byte __At__, 0 past the end. Only looked up under ShmLock, the
+    copy itself runs without it while Io keeps the frame from being cut off.
+*/
+static uint64_t
+__ShmFrameAt__(ShmObject* __Obj__, long __At__, long* __Room__)
+{
+    SysErr  err;
+    SysErr* Error = &err;
+    AcquireSpinLock(&ShmLock, Error);
+
+    uint64_t Phys = 0;
+    if (__At__ < __Obj__->Size && (uint64_t)__At__ / PageSize < __Obj__->Pages)
+    {
+        Phys      = __Obj__->Frames[__At__ / PageSize];
+        *__Room__ = __Obj__->Size - __At__;
+    }
+
+    ReleaseSpinLock(&ShmLock, Error);
+    return Phys;
+}
+
+static void
+__ShmIo__(ShmObject* __Obj__, long __Delta__)
+{
+    SysErr  err;
+    SysErr* Error = &err;
+    AcquireSpinLock(&ShmLock, Error);
+    __Obj__->Io += __Delta__;
+    ReleaseSpinLock(&ShmLock, Error);
+}
+
+/* Called with ShmLock held */
+static void
+__ShmPut__(ShmObject* __Obj__)
+{
+    if (__Obj__->Linked || __Obj__->Opens > 0 || __Obj__->Maps > 0)
+    {
+        return;
+    }
+
+    SysErr  err;
+    SysErr* Error = &err;
+
+    for (long Slot = 0; Slot < ShmMaxObjects; Slot++)
+    {
+        if (__ShmTbl__[Slot] == __Obj__)
+        {
+            __ShmTbl__[Slot] = NULL;
+            break;
+        }
+    }
+
+    for (uint64_t Index = 0; Index < __Obj__->Pages; Index++)
+    {
+        FreePage(__Obj__->Frames[Index], Error);
+    }
+    ShmStats.Pages -= __Obj__->Pages;
+    ShmStats.Objects--;
+
+    if (__Obj__->Frames)
+    {
+        KFree(__Obj__->Frames, Error);
+    }
+    KFree(__Obj__, Error);
+}
+
+/* Called with ShmLock held */
+static ShmObject*
+__ShmNew__(const char* __Name__, int __Linked__)
+{
+    long Slot = 0;
+    while (Slot < ShmMaxObjects && __ShmTbl__[Slot])
+    {
+        Slot++;
+    }
+    if (Slot >= ShmMaxObjects)
+    {
+        return Error_TO_Pointer(-TooMany);
+    }
+
+    ShmObject* Obj = (ShmObject*)KMalloc(sizeof(ShmObject));
+    if (Probe_IF_Error(Obj) || !Obj)
+    {
+        return Error_TO_Pointer(-BadAlloc);
+    }
+    memset(Obj, 0, sizeof(*Obj));
+
+    strcpy(Obj->Name, __Name__ ? __Name__ : "", ShmMaxName);
+    Obj->Ino    = ShmNextIno++;
+    Obj->Linked = __Linked__;
+
+    Obj->Node.Type   = VNodeFILE;
+    Obj->Node.Ops    = &__ShmFsOps__;
+    Obj->Node.Sb     = ShmSuper;
+    Obj->Node.Priv   = Obj;
+    Obj->Node.Refcnt = 1;
+
+    __ShmTbl__[Slot] = Obj;
+    ShmStats.Objects++;
+    return Obj;
+}
+
+/* Called with ShmLock held */
+static ShmObject*
+__ShmFind__(const char* __Name__)
+{
+    for (long Slot = 0; Slot < ShmMaxObjects; Slot++)
+    {
+        ShmObject* Obj = __ShmTbl__[Slot];
+        if (Obj && Obj->Linked && strcmp(Obj->Name, __Name__) == 0)
+        {
+            return Obj;
+        }
+    }
+    return NULL;
+}
+
+int
+ShmOpen(Vnode* __Node__, File* __File__)
+{
+    if (Probe_IF_Error(__Node__) || !__Node__ || Probe_IF_Error(__File__) || !__File__)
+    {
+        return -BadArgs;
+    }
+
+    __File__->Offset = 0;
+    __File__->Priv   = NULL;
+
+    ShmObject* Obj = __ShmOf__(__Node__);
+    if (!Obj)
+    {
+        return SysOkay; /* the /dev/shm directory itself */
+    }
+
+    SysErr  err;
+    SysErr* Error = &err;
+    AcquireSpinLock(&ShmLock, Error);
+    Obj->Opens++;
+    ReleaseSpinLock(&ShmLock, Error);
+
+    __File__->Priv = Obj;
+    return SysOkay;
+}
+
+int
+ShmClose(File* __File__)
+{
+    if (Probe_IF_Error(__File__) || !__File__)
+    {
+        return -BadArgs;
+    }
+
+    ShmObject* Obj = (ShmObject*)__File__->Priv;
+    if (!Obj)
+    {
+        return SysOkay;
+    }
+
+    SysErr  err;
+    SysErr* Error = &err;
+    AcquireSpinLock(&ShmLock, Error);
+    Obj->Opens--;
+    __ShmPut__(Obj);
+    ReleaseSpinLock(&ShmLock, Error);
+
+    __File__->Priv = NULL;
+    return SysOkay;
+}
+
+/* VfsRead moves the file offset by what we return, so it is only read here */
+long
+ShmRead(File* __File__, void* __Buf__, long __Len__)
+{
+    if (Probe_IF_Error(__File__) || !__File__ || Probe_IF_Error(__Buf__) || !__Buf__ ||
+        __Len__ <= 0)
+    {
+        return -BadArgs;
+    }
+
+    ShmObject* Obj = (ShmObject*)__File__->Priv;
+    if (!Obj)
+    {
+        return -BadEntry;
+    }
+
+    /* The user buffer may fault, so nothing is copied under ShmLock */
+    __ShmIo__(Obj, 1);
+
+    long Done = 0;
+    while (Done < __Len__)
+    {
+        long     At    = __File__->Offset + Done;
+        long     Room  = 0;
+        uint64_t Phys  = __ShmFrameAt__(Obj, At, &Room);
+        long     InPg  = At % PageSize;
+        long     Chunk = PageSize - InPg;
+        if (!Phys)
+        {
+            break;
+        }
+        if (Chunk > __Len__ - Done)
+        {
+            Chunk = __Len__ - Done;
+        }
+        if (Chunk > Room)
+        {
+            Chunk = Room;
+        }
+
+        memcpy((uint8_t*)__Buf__ + Done, (uint8_t*)PhysToVirt(Phys) + InPg, (size_t)Chunk);
+        Done += Chunk;
+    }
+
+    __ShmIo__(Obj, -1);
+    return Done;
+}
+
+long
+ShmWrite(File* __File__, const void* __Buf__, long __Len__)
+{
+    if (Probe_IF_Error(__File__) || !__File__ || Probe_IF_Error(__Buf__) || !__Buf__ ||
+        __Len__ <= 0)
+    {
+        return -BadArgs;
+    }
+
+    ShmObject* Obj = (ShmObject*)__File__->Priv;
+    if (!Obj)
+    {
+        return -BadEntry;
+    }
+
+    __ShmIo__(Obj, 1);
+
+    int Rc = __ShmResize__(Obj, __File__->Offset + __Len__, 1);
+    if (Rc != SysOkay)
+    {
+        __ShmIo__(Obj, -1);
+        return Rc;
+    }
+
+    long Done = 0;
+    while (Done < __Len__)
+    {
+        long     At    = __File__->Offset + Done;
+        long     Room  = 0;
+        uint64_t Phys  = __ShmFrameAt__(Obj, At, &Room);
+        long     InPg  = At % PageSize;
+        long     Chunk = PageSize - InPg;
+        if (!Phys)
+        {
+            break;
+        }
+        if (Chunk > __Len__ - Done)
+        {
+            Chunk = __Len__ - Done;
+        }
+        if (Chunk > Room)
+        {
+            Chunk = Room;
+        }
+
+        memcpy((uint8_t*)PhysToVirt(Phys) + InPg, (const uint8_t*)__Buf__ + Done, (size_t)Chunk);
+        Done += Chunk;
+    }
+
+    __ShmIo__(Obj, -1);
+    return Done;
+}
+
+long
+ShmLseek(File* __File__, long __Off__, int __Whence__)
+{
+    if (Probe_IF_Error(__File__) || !__File__)
+    {
+        return -BadArgs;
+    }
+
+    ShmObject* Obj  = (ShmObject*)__File__->Priv;
+    long       Base = 0;
+
+    if (__Whence__ == VSeekCUR)
+    {
+        Base = __File__->Offset;
+    }
+    else if (__Whence__ == VSeekEND)
+    {
+        Base = Obj ? Obj->Size : 0;
+    }
+
+    if (Base + __Off__ < 0)
+    {
+        return -BadArgs;
+    }
+
+    __File__->Offset = Base + __Off__;
+    return __File__->Offset;
+}
+
+int
+ShmStat(Vnode* __Node__, VfsStat* __Out__)
+{
+    if (Probe_IF_Error(__Node__) || !__Node__ || Probe_IF_Error(__Out__) || !__Out__)
+    {
+        return -BadArgs;
+    }
+
+    memset(__Out__, 0, sizeof(*__Out__));
+
+    ShmObject* Obj = __ShmOf__(__Node__);
+    __Out__->Type    = __Node__->Type;
+    __Out__->Nlink   = 1;
+    __Out__->BlkSize = PageSize;
+    __Out__->Ino     = Obj ? Obj->Ino : 1;
+    __Out__->Size    = Obj ? Obj->Size : 0;
+    __Out__->Blocks  = Obj ? (long)Obj->Pages : 0;
+    return SysOkay;
+}
+
+long
+ShmReaddir(Vnode* __Dir__, void* __Buf__, long __BufLen__)
+{
+    if (!__ShmIsRoot__(__Dir__) || Probe_IF_Error(__Buf__) || !__Buf__ || __BufLen__ <= 0)
+    {
+        return -BadArgs;
+    }
+
+    SysErr  err;
+    SysErr* Error = &err;
+    AcquireSpinLock(&ShmLock, Error);
+
+    long       Wrote = 0;
+    VfsDirEnt* DE    = (VfsDirEnt*)__Buf__;
+
+    for (long Slot = 0; Slot < ShmMaxObjects && Wrote < __BufLen__; Slot++)
+    {
+        ShmObject* Obj = __ShmTbl__[Slot];
+        if (!Obj || !Obj->Linked)
+        {
+            continue;
+        }
+        strcpy(DE[Wrote].Name, Obj->Name, 256);
+        DE[Wrote].Type = VNodeFILE;
+        DE[Wrote].Ino  = Obj->Ino;
+        Wrote++;
+    }
+
+    ReleaseSpinLock(&ShmLock, Error);
+    return Wrote; /* return count of entries */
+}
+
+Vnode*
+ShmLookup(Vnode* __Dir__, const char* __Name__)
+{
+    if (!__ShmIsRoot__(__Dir__) || Probe_IF_Error(__Name__) || !__Name__)
+    {
+        return Error_TO_Pointer(-BadArgs);
+    }
+
+    SysErr  err;
+    SysErr* Error = &err;
+    AcquireSpinLock(&ShmLock, Error);
+    ShmObject* Obj = __ShmFind__(__Name__);
+    ReleaseSpinLock(&ShmLock, Error);
+
+    return Obj ? &Obj->Node : Error_TO_Pointer(-NoSuch);
+}
+
+int
+ShmCreate(Vnode* __Dir__, const char* __Name__, long __Flags__ _unused, VfsPerm __Perm__ _unused)
+{
+    if (!__ShmIsRoot__(__Dir__) || Probe_IF_Error(__Name__) || !__Name__ || !*__Name__ ||
+        strlen(__Name__) >= ShmMaxName)
+    {
+        return -BadArgs;
+    }
+
+    SysErr  err;
+    SysErr* Error = &err;
+    AcquireSpinLock(&ShmLock, Error);
+
+    if (__ShmFind__(__Name__))
+    {
+        ReleaseSpinLock(&ShmLock, Error);
+        return -Redefined;
+    }
+
+    ShmObject* Obj = __ShmNew__(__Name__, 1);
+    ReleaseSpinLock(&ShmLock, Error);
+
+    return Probe_IF_Error(Obj) ? (int)(intptr_t)Obj : SysOkay;
+}
+
+int
+ShmUnlink(Vnode* __Dir__, const char* __Name__)
+{
+    if (!__ShmIsRoot__(__Dir__) || Probe_IF_Error(__Name__) || !__Name__)
+    {
+        return -BadArgs;
+    }
+
+    SysErr  err;
+    SysErr* Error = &err;
+    AcquireSpinLock(&ShmLock, Error);
+
+    ShmObject* Obj = __ShmFind__(__Name__);
+    if (!Obj)
+    {
+        ReleaseSpinLock(&ShmLock, Error);
+        return -NoSuch;
+    }
+
+    Obj->Linked = 0;
+    __ShmPut__(Obj);
+
+    ReleaseSpinLock(&ShmLock, Error);
+    return SysOkay;
+}
+
+int
+ShmTruncate(Vnode* __Node__, long __Len__)
+{
+    ShmObject* Obj = __ShmOf__(__Node__);
+    if (!Obj)
+    {
+        return -BadEntry;
+    }
+
+    return __ShmResize__(Obj, __Len__, 0);
+}
+
+int
+ShmMap(Vnode* __Node__, void** __Out__, long __Off__, long __Len__)
+{
+    ShmObject* Obj = __ShmOf__(__Node__);
+    if (!Obj || Probe_IF_Error(__Out__) || !__Out__ || __Off__ < 0 || (__Off__ % PageSize) != 0 ||
+        __Len__ <= 0 || __Len__ > PageSize)
+    {
+        return -BadArgs;
+    }
+
+    SysErr  err;
+    SysErr* Error = &err;
+    AcquireSpinLock(&ShmLock, Error);
+
+    uint64_t Index = (uint64_t)__Off__ / PageSize;
+    if (Index >= Obj->Pages)
+    {
+        ReleaseSpinLock(&ShmLock, Error);
+        return -TooBig;
+    }
+
+    /* Frames are not contiguous, so Map hands out a single page at a time */
+    *__Out__ = PhysToVirt(Obj->Frames[Index]);
+    Obj->Maps++;
+
+    ReleaseSpinLock(&ShmLock, Error);
+    return SysOkay;
+}
+
+int
+ShmUnmap(Vnode* __Node__, void* __Addr__ _unused, long __Len__)
+{
+    ShmObject* Obj = __ShmOf__(__Node__);
+    if (!Obj || __Len__ <= 0)
+    {
+        return -BadArgs;
+    }
+
+    SysErr  err;
+    SysErr* Error = &err;
+    AcquireSpinLock(&ShmLock, Error);
+
+    long Pages = (__Len__ + PageSize - 1) / PageSize;
+    Obj->Maps  = (Obj->Maps > Pages) ? (Obj->Maps - Pages) : 0;
+    __ShmPut__(Obj);
+
+    ReleaseSpinLock(&ShmLock, Error);
+    return SysOkay;
+}
+
+File*
+ShmMemfdOpen(const char* __Name__, long __Flags__)
+{
+    SysErr  err;
+    SysErr* Error = &err;
+
+    File* F = (File*)KMalloc(sizeof(File));
+    if (Probe_IF_Error(F) || !F)
+    {
+        return Error_TO_Pointer(-BadAlloc);
+    }
+
+    AcquireSpinLock(&ShmLock, Error);
+    ShmObject* Obj = __ShmNew__(__Name__, 0);
+    if (Probe_IF_Error(Obj))
+    {
+        ReleaseSpinLock(&ShmLock, Error);
+        KFree(F, Error);
+        return (File*)Obj;
+    }
+    ReleaseSpinLock(&ShmLock, Error);
+
+    F->Node   = &Obj->Node;
+    F->Flags  = __Flags__;
+    F->Refcnt = 1;
+    ShmOpen(&Obj->Node, F);
+    return F;
+}
+
+int
+ShmFsInit(void)
+{
+    SysErr  err;
+    SysErr* Error = &err;
+
+    InitializeSpinLock(&ShmLock, "shmfs", Error);
+    memset(__ShmTbl__, 0, sizeof(__ShmTbl__));
+
+    ShmSuper = (Superblock*)KMalloc(sizeof(Superblock));
+    if (Probe_IF_Error(ShmSuper) || !ShmSuper)
+    {
+        return -BadAlloc;
+    }
+    memset(ShmSuper, 0, sizeof(*ShmSuper));
+
+    Vnode* Root = (Vnode*)KMalloc(sizeof(Vnode));
+    if (Probe_IF_Error(Root) || !Root)
+    {
+        KFree(ShmSuper, Error);
+        return -BadAlloc;
+    }
+    memset(Root, 0, sizeof(*Root));
+
+    Root->Type   = VNodeDIR;
+    Root->Ops    = &__ShmFsOps__;
+    Root->Sb     = ShmSuper;
+    Root->Priv   = NULL;
+    Root->Refcnt = 1;
+
+    ShmSuper->Root = Root;
+
+    if (VfsRegisterPseudoFs("/dev/shm", ShmSuper) != SysOkay)
+    {
+        return -NotRooted;
+    }
+
+    PSuccess("shmfs mounted at /dev/shm\n");
+    return SysOkay;
+}
@@ -0,0 +1,99 @@
+#include <VMM.h>
+
+VmmHugeStats VmmHuge = {0};
+
+int
+MapHugePage(VirtualMemorySpace* __Space__,
+            uint64_t            __VirtAddr__,
+            uint64_t            __PhysAddr__,
+            uint64_t            __Flags__)
+{
+    if (Probe_IF_Error(__Space__) || !__Space__ || (__VirtAddr__ & HugePageMask) != 0 ||
+        (__PhysAddr__ & HugePageMask) != 0)
+    {
+        return -BadArgs;
+    }
+
+    if (__PhysAddr__ > 0x000FFFFFFFE00000ULL)
+    {
+        return -NotCanonical;
+    }
+
+    uint64_t* Pd = GetPageTable(__Space__->Pml4, __VirtAddr__, 2, 1);
+    if (Probe_IF_Error(Pd) || !Pd)
+    {
+        return -NotCanonical;
+    }
+
+    uint64_t PdIndex = (__VirtAddr__ >> 21) & 0x1FF;
+
+    if (Pd[PdIndex] & PTEPRESENT)
+    {
+        /* Either already a 2MB leaf or a 4KB table lives here */
+        return (Pd[PdIndex] & PTEHUGEPAGE) ? -Redefined : -Dangling;
+    }
+
+    Pd[PdIndex] = (__PhysAddr__ & 0x000FFFFFFFE00000ULL) | __Flags__ | PTEHUGEPAGE | PTEPRESENT;
+    VmmHuge.Mapped++;
+
+    SysErr  err;
+    SysErr* Error = &err;
+    FlushTlb(__VirtAddr__, Error);
+
+    PDebug("Mapped huge 0x%016lx -> 0x%016lx (flags=0x%lx)\n",
+           __VirtAddr__,
+           __PhysAddr__,
+           __Flags__);
+    return SysOkay;
+}
+
+int
+SplitHugePage(VirtualMemorySpace* __Space__, uint64_t __VirtAddr__)
+{
+    if (Probe_IF_Error(__Space__) || !__Space__)
+    {
+        return -BadArgs;
+    }
+
+    uint64_t* Pd = GetPageTable(__Space__->Pml4, __VirtAddr__, 2, 0);
+    if (Probe_IF_Error(Pd) || !Pd)
+    {
+        return -NotCanonical;
+    }
+
+    uint64_t PdIndex = (__VirtAddr__ >> 21) & 0x1FF;
+    uint64_t Pde     = Pd[PdIndex];
+
+    if (!(Pde & PTEPRESENT) || !(Pde & PTEHUGEPAGE))
+    {
+        return -NoSuch;
+    }
+
+    uint64_t PtPhys = AllocPage();
+    if (!PtPhys)
+    {
+        return -BadAlloc;
+    }
+
+    uint64_t* Pt   = (uint64_t*)PhysToVirt(PtPhys);
+    uint64_t  Base = Pde & 0x000FFFFFFFE00000ULL;
+
+    /* Keep the permission bits, drop PS and the PDE-only PAT bit (12) */
+    uint64_t Flags = Pde & ~(0x000FFFFFFFFFF000ULL | PTEHUGEPAGE);
+
+    for (uint32_t Index = 0; Index < PageTableEntries; Index++)
+    {
+        Pt[Index] = (Base + ((uint64_t)Index * PageSize)) | Flags;
+    }
+
+    Pd[PdIndex] = PtPhys | PTEPRESENT | PTEWRITABLE | PTEUSER;
+    VmmHuge.Mapped--;
+    VmmHuge.Splits++;
+
+    SysErr  err;
+    SysErr* Error = &err;
+    FlushTlb(__VirtAddr__ & ~HugePageMask, Error);
+
+    PDebug("Split huge page at 0x%016lx\n", __VirtAddr__ & ~HugePageMask);
+    return SysOkay;
+}
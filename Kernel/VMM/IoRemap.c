@@ -0,0 +1,295 @@
+#include <Sync.h>
+#include <Timer.h>
+#include <VMM.h>
+
+typedef struct
+{
+    uint64_t Virt;  /* page aligned start of the region */
+    uint64_t Span;  /* 4KB pages of window reserved, guard page not included */
+    uint64_t Pages; /* 4KB pages mapped, at most Span */
+    int      Used;
+
+} IoRegion;
+
+VmmIoStats      VmmIo = {0};
+static IoRegion IoRegions[IoRemapMaxRegions];
+static uint64_t IoNext = IoRemapBase;
+static SpinLock IoLock;
+static int      PatReady = 0;
+
+static uint64_t
+__CacheBits__(VmmCacheType __Type__, int __Huge__)
+{
+    /*Without PAT the low four entries are still WB WT UC- UC, WC degrades to UC*/
+    switch (__Type__)
+    {
+        case VmmCacheWT:
+            return PTEWRITETHROUGH;
+
+        case VmmCacheUC:
+            return PTECACHEDISABLE | PTEWRITETHROUGH;
+
+        case VmmCacheWC:
+            if (!PatReady)
+            {
+                return PTECACHEDISABLE | PTEWRITETHROUGH;
+            }
+            return (__Huge__ ? PTEPATHUGE : PTEPAT) | PTEWRITETHROUGH; /* PAT5 */
+
+        case VmmCacheWB:
+        default:
+            return 0;
+    }
+}
+
+void
+InitializePat(SysErr* __Err__)
+{
+    uint32_t Eax = 1, Ebx, Ecx, Edx;
+    __asm__ volatile("cpuid" : "+a"(Eax), "=b"(Ebx), "=c"(Ecx), "=d"(Edx));
+    if (!(Edx & (1U << 16)))
+    {
+        SlotError(__Err__, -NotInit);
+        return;
+    }
+
+    /*SDM order: caches off and flushed, PAT written, flushed again, caches back on*/
+    unsigned long Cr0;
+    __asm__ volatile("mov %%cr0, %0" : "=r"(Cr0));
+    __asm__ volatile("mov %0, %%cr0" ::"r"(Cr0 | (1UL << 30)) : "memory"); /* CD = 1 */
+    __asm__ volatile("wbinvd" ::: "memory");
+    FlushAllTlb(__Err__);
+
+    WriteMsr(PatMsr, PatLayout);
+
+    __asm__ volatile("wbinvd" ::: "memory");
+    FlushAllTlb(__Err__);
+    __asm__ volatile("mov %0, %%cr0" ::"r"(Cr0) : "memory");
+
+    PatReady = 1;
+}
+
+void
+InitializeIoRemap(SysErr* __Err__)
+{
+    uint64_t  Slot = (IoRemapBase >> 39) & 0x1FF;
+    uint64_t* Pml4 = Vmm.KernelSpace->Pml4;
+
+    if (Pml4[Slot] & PTEPRESENT)
+    {
+        SlotError(__Err__, -Redefined);
+        return;
+    }
+
+    /*Every space copies the kernel half of the PML4 when created, so the slot must exist now*/
+    uint64_t* Pdpt = GetPageTable(Pml4, IoRemapBase, 3, 1);
+    if (Probe_IF_Error(Pdpt) || !Pdpt)
+    {
+        SlotError(__Err__, -BadAlloc);
+        return;
+    }
+    Pml4[Slot] &= ~PTEUSER;
+
+    InitializeSpinLock(&IoLock, "IoRemap", __Err__);
+
+    PSuccess("IoRemap window at 0x%016lx (PAT %s)\n", IoRemapBase, PatReady ? "on" : "off");
+}
+
+/* First fit over released regions, else bump. Caller holds IoLock */
+static IoRegion*
+__ReserveRegion__(uint64_t __Pages__, uint64_t __PhysAddr__)
+{
+    IoRegion* Slot = NULL;
+
+    for (uint32_t Index = 0; Index < IoRemapMaxRegions; Index++)
+    {
+        IoRegion* Region = &IoRegions[Index];
+        if (!Region->Used && Region->Span >= __Pages__ && __Pages__ < PageTableEntries)
+        {
+            Region->Pages = __Pages__;
+            Region->Used  = 1;
+            return Region;
+        }
+        if (!Region->Used && !Region->Span && !Slot)
+        {
+            Slot = Region;
+        }
+    }
+
+    if (!Slot)
+    {
+        return NULL;
+    }
+
+    /*Large runs start at the same offset into a 2MB page as the frames do*/
+    uint64_t Virt = IoNext;
+    if (__Pages__ >= PageTableEntries)
+    {
+        Virt = ((Virt + HugePageMask) & ~HugePageMask) + (__PhysAddr__ & HugePageMask);
+    }
+
+    if (Virt + (__Pages__ + 1) * PageSize > IoRemapBase + IoRemapSize)
+    {
+        return NULL;
+    }
+
+    IoNext      = Virt + (__Pages__ + 1) * PageSize; /* one unmapped guard page after */
+    Slot->Virt  = Virt;
+    Slot->Span  = __Pages__;
+    Slot->Pages = __Pages__;
+    Slot->Used  = 1;
+    return Slot;
+}
+
+static void
+__ClearRange__(uint64_t __Virt__, uint64_t __Pages__)
+{
+    SysErr  err;
+    SysErr* Error = &err;
+
+    uint64_t* Pml4 = Vmm.KernelSpace->Pml4;
+    uint64_t  Virt = __Virt__;
+    uint64_t  End  = __Virt__ + __Pages__ * PageSize;
+
+    while (Virt < End)
+    {
+        uint64_t* Pd = GetPageTable(Pml4, Virt, 2, 0);
+        if (Probe_IF_Error(Pd) || !Pd)
+        {
+            Virt += PageSize;
+            continue;
+        }
+
+        uint64_t PdIndex = (Virt >> 21) & 0x1FF;
+        if ((Pd[PdIndex] & PTEPRESENT) && (Pd[PdIndex] & PTEHUGEPAGE))
+        {
+            Pd[PdIndex] = 0;
+            FlushTlb(Virt, Error);
+            VmmIo.Huge--;
+            Virt += HugePageSize;
+            continue;
+        }
+
+        uint64_t* Pt = GetPageTable(Pml4, Virt, 1, 0);
+        if (!Probe_IF_Error(Pt) && Pt)
+        {
+            Pt[(Virt >> 12) & 0x1FF] = 0;
+            FlushTlb(Virt, Error);
+        }
+        Virt += PageSize;
+    }
+}
+
+void*
+IoRemap(uint64_t __PhysAddr__, uint64_t __Size__, VmmCacheType __Type__)
+{
+    if (!__Size__ || !Vmm.KernelSpace || __PhysAddr__ + __Size__ < __PhysAddr__ ||
+        __PhysAddr__ + __Size__ > 0x0010000000000000ULL)
+    {
+        return Error_TO_Pointer(-BadArgs);
+    }
+
+    SysErr  err;
+    SysErr* Error = &err;
+
+    uint64_t Phys   = __PhysAddr__ & ~(uint64_t)(PageSize - 1);
+    uint64_t Offset = __PhysAddr__ - Phys;
+    uint64_t Pages  = (Offset + __Size__ + PageSize - 1) / PageSize;
+
+    AcquireSpinLock(&IoLock, Error);
+
+    IoRegion* Region = __ReserveRegion__(Pages, Phys);
+    if (!Region)
+    {
+        ReleaseSpinLock(&IoLock, Error);
+        return Error_TO_Pointer(-TooMany);
+    }
+
+    uint64_t* Pml4  = Vmm.KernelSpace->Pml4;
+    uint64_t  Flags = PTEPRESENT | PTEWRITABLE | PTENOEXECUTE;
+    uint64_t  Page  = 0;
+
+    while (Page < Pages)
+    {
+        uint64_t Virt  = Region->Virt + Page * PageSize;
+        uint64_t Frame = Phys + Page * PageSize;
+
+        /*Whole aligned 2MB runs take one TLB entry, handy for big framebuffers and BARs*/
+        if (!(Virt & HugePageMask) && !(Frame & HugePageMask) &&
+            Pages - Page >= PageTableEntries)
+        {
+            uint64_t* Pd = GetPageTable(Pml4, Virt, 2, 1);
+            if (!Probe_IF_Error(Pd) && Pd && !(Pd[(Virt >> 21) & 0x1FF] & PTEPRESENT))
+            {
+                Pd[(Virt >> 21) & 0x1FF] =
+                    Frame | Flags | PTEHUGEPAGE | __CacheBits__(__Type__, 1);
+                FlushTlb(Virt, Error);
+                VmmIo.Huge++;
+                Page += PageTableEntries;
+                continue;
+            }
+        }
+
+        uint64_t* Pt = GetPageTable(Pml4, Virt, 1, 1);
+        if (Probe_IF_Error(Pt) || !Pt)
+        {
+            __ClearRange__(Region->Virt, Page);
+            Region->Used = 0;
+            ReleaseSpinLock(&IoLock, Error);
+            return Error_TO_Pointer(-BadAlloc);
+        }
+
+        Pt[(Virt >> 12) & 0x1FF] = Frame | Flags | __CacheBits__(__Type__, 0);
+        FlushTlb(Virt, Error);
+        Page++;
+    }
+
+    VmmIo.Regions++;
+    VmmIo.Pages += Pages;
+
+    uint64_t Virt = Region->Virt;
+    ReleaseSpinLock(&IoLock, Error);
+
+    PDebug("IoRemap 0x%016lx (+0x%lx) -> 0x%016lx type %d\n",
+           __PhysAddr__,
+           __Size__,
+           Virt + Offset,
+           (int)__Type__);
+    return (void*)(Virt + Offset);
+}
+
+int
+IoUnmap(void* __VirtAddr__)
+{
+    uint64_t Virt = (uint64_t)__VirtAddr__ & ~(uint64_t)(PageSize - 1);
+    if (Virt < IoRemapBase || Virt >= IoRemapBase + IoRemapSize)
+    {
+        return -BadArgs;
+    }
+
+    SysErr  err;
+    SysErr* Error = &err;
+
+    AcquireSpinLock(&IoLock, Error);
+
+    for (uint32_t Index = 0; Index < IoRemapMaxRegions; Index++)
+    {
+        IoRegion* Region = &IoRegions[Index];
+        if (!Region->Used || Region->Virt != Virt)
+        {
+            continue;
+        }
+
+        /*Only this CPU's TLB is flushed, callers quiesce users on other CPUs first*/
+        __ClearRange__(Region->Virt, Region->Pages);
+        Region->Used = 0;
+        VmmIo.Regions--;
+        VmmIo.Pages -= Region->Pages;
+
+        ReleaseSpinLock(&IoLock, Error);
+        return SysOkay;
+    }
+
+    ReleaseSpinLock(&IoLock, Error);
+    return -NoSuch;
+}
@@ -0,0 +1,211 @@
+#include <PerCPUData.h>
+#include <Sync.h>
+#include <VMM.h>
+
+/* Freed stacks kept mapped by one CPU, only touched by it with interrupts off */
+typedef struct
+{
+    void*    Stacks[KStackCacheMax];
+    uint32_t Count;
+
+} KStackCache;
+
+VmmKStackStats     VmmKStack     = {0};
+int                KStackCaching = 1;
+static KStackCache KStackCaches[MaxCPUs];
+static SpinLock    KStackLock;
+static void*       KStackPool   = NULL; /* linked through the first word of each stack */
+static uint32_t    KStackPooled = 0;
+static uint64_t    KStackNext   = KStackBase;
+
+void
+InitializeKernelStacks(SysErr* __Err__)
+{
+    uint64_t  Slot = (KStackBase >> 39) & 0x1FF;
+    uint64_t* Pml4 = Vmm.KernelSpace->Pml4;
+
+    if (Pml4[Slot] & PTEPRESENT)
+    {
+        SlotError(__Err__, -Redefined);
+        return;
+    }
+
+    /*Same as IoRemap, spaces copy the kernel half of the PML4 so the slot must exist now*/
+    uint64_t* Pdpt = GetPageTable(Pml4, KStackBase, 3, 1);
+    if (Probe_IF_Error(Pdpt) || !Pdpt)
+    {
+        SlotError(__Err__, -BadAlloc);
+        return;
+    }
+    Pml4[Slot] &= ~PTEUSER;
+
+    InitializeSpinLock(&KStackLock, "KStacks", __Err__);
+
+    PSuccess("Kernel stacks at 0x%016lx (%u KB + guard page)\n", KStackBase, KStackSize / 1024);
+}
+
+/* Unmaps the pages of a stack, frees their frames and leaves its window dead */
+static void
+__RetireStack__(uint64_t __Base__)
+{
+    SysErr  err;
+    SysErr* Error = &err;
+
+    uint64_t* Pml4 = Vmm.KernelSpace->Pml4;
+
+    for (uint64_t Virt = __Base__; Virt < __Base__ + KStackSize; Virt += PageSize)
+    {
+        uint64_t* Pt = GetPageTable(Pml4, Virt, 1, 0);
+        if (Probe_IF_Error(Pt) || !Pt)
+        {
+            continue;
+        }
+
+        uint64_t Entry = Pt[(Virt >> 12) & 0x1FF];
+        Pt[(Virt >> 12) & 0x1FF] = 0;
+        FlushTlb(Virt, Error);
+        if (Entry & PTEPRESENT)
+        {
+            FreePage(Entry & 0x000FFFFFFFFFF000ULL, Error);
+        }
+    }
+}
+
+/* A fresh slot off the window, its guard page is simply never mapped. Caller holds KStackLock */
+static void*
+__MapStack__(void)
+{
+    if (KStackNext + KStackSlot > KStackBase + KStackWindow)
+    {
+        return Error_TO_Pointer(-TooMany);
+    }
+
+    uint64_t  Base  = KStackNext + PageSize;
+    uint64_t* Pml4  = Vmm.KernelSpace->Pml4;
+    uint64_t  Flags = PTEPRESENT | PTEWRITABLE | PTENOEXECUTE;
+
+    SysErr  err;
+    SysErr* Error = &err;
+
+    for (uint64_t Virt = Base; Virt < Base + KStackSize; Virt += PageSize)
+    {
+        uint64_t* Pt    = GetPageTable(Pml4, Virt, 1, 1);
+        uint64_t  Frame = AllocPage();
+        if (Probe_IF_Error(Pt) || !Pt || Probe_IF_Error(Frame) || !Frame)
+        {
+            if (!Probe_IF_Error(Frame) && Frame)
+            {
+                FreePage(Frame, Error);
+            }
+            __RetireStack__(Base);
+            KStackNext += KStackSlot;
+            VmmKStack.Retired++;
+            return Error_TO_Pointer(-BadAlloc);
+        }
+
+        Pt[(Virt >> 12) & 0x1FF] = Frame | Flags;
+        FlushTlb(Virt, Error);
+    }
+
+    KStackNext += KStackSlot;
+    VmmKStack.Mapped++;
+    return (void*)Base;
+}
+
+void*
+AllocKernelStack(void)
+{
+    uint64_t Flags;
+    __asm__ volatile("pushfq; popq %0; cli" : "=r"(Flags)::"memory");
+
+    VmmKStack.Allocs++;
+
+    if (KStackCaching)
+    {
+        KStackCache* Cache = &KStackCaches[ThisCpuId()];
+        if (Cache->Count)
+        {
+            void* Stack = Cache->Stacks[--Cache->Count];
+            VmmKStack.CacheHits++;
+            __asm__ volatile("pushq %0; popfq" ::"r"(Flags) : "memory");
+            return Stack;
+        }
+    }
+    __asm__ volatile("pushq %0; popfq" ::"r"(Flags) : "memory");
+
+    SysErr  err;
+    SysErr* Error = &err;
+    void*   Stack;
+
+    AcquireSpinLock(&KStackLock, Error);
+
+    if (KStackPool)
+    {
+        Stack      = KStackPool;
+        KStackPool = *(void**)Stack;
+        KStackPooled--;
+        VmmKStack.PoolHits++;
+    }
+    else
+    {
+        Stack = __MapStack__();
+    }
+
+    ReleaseSpinLock(&KStackLock, Error);
+    return Stack;
+}
+
+void
+FreeKernelStack(void* __Stack__)
+{
+    uint64_t Base = (uint64_t)__Stack__;
+    if (!__Stack__ || Base < KStackBase || Base >= KStackBase + KStackWindow ||
+        (Base - KStackBase) % KStackSlot != PageSize)
+    {
+        return;
+    }
+
+    uint64_t Flags;
+    __asm__ volatile("pushfq; popq %0; cli" : "=r"(Flags)::"memory");
+
+    /*Still warm in this CPU's cache, the next thread created here takes it straight back*/
+    if (KStackCaching)
+    {
+        KStackCache* Cache = &KStackCaches[ThisCpuId()];
+        if (Cache->Count < KStackCacheMax)
+        {
+            Cache->Stacks[Cache->Count++] = __Stack__;
+            __asm__ volatile("pushq %0; popfq" ::"r"(Flags) : "memory");
+            return;
+        }
+    }
+    __asm__ volatile("pushq %0; popfq" ::"r"(Flags) : "memory");
+
+    SysErr  err;
+    SysErr* Error = &err;
+
+    AcquireSpinLock(&KStackLock, Error);
+
+    if (KStackCaching && KStackPooled < KStackPoolMax)
+    {
+        *(void**)__Stack__ = KStackPool;
+        KStackPool         = __Stack__;
+        KStackPooled++;
+        ReleaseSpinLock(&KStackLock, Error);
+        return;
+    }
+
+    /*Only this CPU's TLB is flushed, so the window is never handed out again*/
+    __RetireStack__(Base);
+    VmmKStack.Mapped--;
+    VmmKStack.Retired++;
+
+    ReleaseSpinLock(&KStackLock, Error);
+}
+
+int
+KernelStackGuard(uint64_t __Addr__)
+{
+    return __Addr__ >= KStackBase && __Addr__ < KStackNext &&
+           (__Addr__ - KStackBase) % KStackSlot < PageSize;
+}
@@ -0,0 +1,227 @@
+#include <String.h>
+#include <VMM.h>
+
+VmmLazyStats  VmmLazy  = {0};
+VmmStackStats VmmStack = {0};
+
+static int
+__ResolveCow__(uint64_t* __Pml4__, uint64_t __Va__)
+{
+    uint64_t* Pt = GetPageTable(__Pml4__, __Va__, 1, 0);
+    if (Probe_IF_Error(Pt) || !Pt)
+    {
+        return -NoSuch;
+    }
+
+    SysErr  err;
+    SysErr* Error = &err;
+
+    uint64_t PtIndex = (__Va__ >> 12) & 0x1FF;
+    uint64_t Pte     = __atomic_load_n(&Pt[PtIndex], __ATOMIC_ACQUIRE);
+
+    /* Another thread of the space resolved it first, only our TLB entry was stale */
+    if ((Pte & PTEPRESENT) && (Pte & PTEWRITABLE) && !(Pte & PTECOW))
+    {
+        FlushTlb(__Va__, Error);
+        return SysOkay;
+    }
+
+    if (!(Pte & PTEPRESENT) || !(Pte & PTECOW))
+    {
+        return -NoSuch;
+    }
+
+    uint64_t NewPhys = AllocPage();
+    if (!NewPhys)
+    {
+        return -BadAlloc;
+    }
+
+    memcpy(PhysToVirt(NewPhys), PhysToVirt(Pte & 0x000FFFFFFFFFF000ULL), PageSize);
+
+    /* The copy is ours now: drop COW/BORROWED and grant write. A racing fault keeps one copy */
+    uint64_t New = NewPhys | (Pte & ~(0x000FFFFFFFFFF000ULL | PTECOW | PTEBORROWED)) | PTEWRITABLE;
+    if (!__atomic_compare_exchange_n(
+            &Pt[PtIndex], &Pte, New, false, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE))
+    {
+        FreePage(NewPhys, Error);
+        FlushTlb(__Va__, Error);
+        return SysOkay;
+    }
+
+    FlushTlb(__Va__, Error);
+
+    PDebug("COW copy at 0x%016lx -> 0x%016lx\n", __Va__, NewPhys);
+    return SysOkay;
+}
+
+/* Back one lazy 4KB entry with a zeroed frame, keeping the flags it was reserved with */
+static int
+__FillLazyPte__(uint64_t* __Pt__, uint64_t __Index__, uint64_t __Va__)
+{
+    uint64_t Pte  = __Pt__[__Index__];
+    uint64_t Phys = AllocPage();
+    if (!Phys)
+    {
+        return -BadAlloc;
+    }
+
+    memset(PhysToVirt(Phys), 0, PageSize);
+    __Pt__[__Index__] = Phys | (Pte & ~(PTELAZY | PTESEQUENTIAL)) | PTEPRESENT;
+
+    SysErr  err;
+    SysErr* Error = &err;
+    FlushTlb(__Va__, Error);
+    return SysOkay;
+}
+
+/* Returns the number of 4KB pages now backed, or an error if Va was not lazy */
+static int
+__ResolveLazy__(uint64_t* __Pml4__, uint64_t __Va__)
+{
+    uint64_t* Pd = GetPageTable(__Pml4__, __Va__, 2, 0);
+    if (Probe_IF_Error(Pd) || !Pd)
+    {
+        return -NoSuch;
+    }
+
+    uint64_t PdIndex = (__Va__ >> 21) & 0x1FF;
+    uint64_t Pde     = Pd[PdIndex];
+    int      LazyPde = !(Pde & PTEPRESENT) && (Pde & PTELAZY);
+
+    /* Stacks only ever want the next page down, a 2MB fill would commit it all at once */
+    if (LazyPde && !(Pde & PTEGROWSDOWN))
+    {
+        uint64_t Phys = AllocHugePage();
+        if (Phys)
+        {
+            memset(PhysToVirt(Phys), 0, HugePageSize);
+            Pd[PdIndex] = Phys | (Pde & ~(PTELAZY | PTESEQUENTIAL)) | PTEPRESENT;
+            VmmHuge.Mapped++;
+            VmmHuge.Hits++;
+
+            SysErr  err;
+            SysErr* Error = &err;
+            FlushTlb(__Va__ & ~HugePageMask, Error);
+            return PageTableEntries;
+        }
+
+        /* No 2MB frame: GetPageTable seeds a table of lazy 4KB entries from the PDE */
+        VmmHuge.Fallbacks++;
+    }
+
+    uint64_t* Pt = GetPageTable(__Pml4__, __Va__, 1, LazyPde);
+    if (Probe_IF_Error(Pt) || !Pt)
+    {
+        return -NoSuch;
+    }
+
+    uint64_t PtIndex = (__Va__ >> 12) & 0x1FF;
+    uint64_t Pte     = Pt[PtIndex];
+    if ((Pte & PTEPRESENT) || !(Pte & PTELAZY))
+    {
+        return -NoSuch;
+    }
+
+    int Rc = __FillLazyPte__(Pt, PtIndex, __Va__);
+    if (Rc != SysOkay)
+    {
+        return Rc;
+    }
+
+    /* Sequential runs fill ahead within this table so the next touches do not trap */
+    int Filled = 1;
+    if (Pte & PTESEQUENTIAL)
+    {
+        for (uint64_t Next = PtIndex + 1;
+             Next < PageTableEntries && Next <= PtIndex + FaultAroundPages;
+             Next++)
+        {
+            if ((Pt[Next] & PTEPRESENT) || !(Pt[Next] & PTELAZY) ||
+                __FillLazyPte__(Pt, Next, (__Va__ & ~HugePageMask) + Next * PageSize) != SysOkay)
+            {
+                break;
+            }
+            VmmLazy.Around++;
+            Filled++;
+        }
+    }
+
+    return Filled;
+}
+
+int
+PopulateUserRange(VirtualMemorySpace* __Space__, uint64_t __VirtAddr__, uint64_t __Len__)
+{
+    if (Probe_IF_Error(__Space__) || !__Space__ || (__VirtAddr__ % PageSize) != 0 ||
+        !UserRangeValid(__VirtAddr__, __Len__))
+    {
+        return -BadArgs;
+    }
+
+    uint64_t Va  = __VirtAddr__;
+    uint64_t End = __VirtAddr__ + ((__Len__ + PageSize - 1) & ~((uint64_t)PageSize - 1));
+
+    while (Va < End)
+    {
+        int Rc = __ResolveLazy__(__Space__->Pml4, Va);
+        if (Rc == -BadAlloc)
+        {
+            return Rc;
+        }
+        if (Rc > 0)
+        {
+            VmmLazy.Populated += (uint64_t)Rc;
+        }
+
+        /* A 2MB fill covers the rest of its run */
+        Va = (Rc == PageTableEntries) ? ((Va & ~HugePageMask) + HugePageSize) : (Va + PageSize);
+    }
+
+    return SysOkay;
+}
+
+int
+HandlePageFault(uint64_t __FaultAddr__, uint64_t __ErrCode__)
+{
+    /* Only user half faults are ever recoverable */
+    if (__FaultAddr__ >= VirtualAddressSpace)
+    {
+        return -NotCanonical;
+    }
+
+    uint64_t Cr3;
+    __asm__ volatile("mov %%cr3, %0" : "=r"(Cr3));
+
+    uint64_t* Pml4 = (uint64_t*)PhysToVirt(Cr3 & 0x000FFFFFFFFFF000ULL);
+    uint64_t  Va   = __FaultAddr__ & ~((uint64_t)PageSize - 1);
+
+    if ((__ErrCode__ & PfPresent) && (__ErrCode__ & PfWrite))
+    {
+        return __ResolveCow__(Pml4, Va);
+    }
+
+    if (!(__ErrCode__ & PfPresent))
+    {
+        int Rc = __ResolveLazy__(Pml4, Va);
+        if (Rc > 0)
+        {
+            VmmLazy.Faults++;
+            if (Va >= UserStackLow && Va < UserStackTop)
+            {
+                VmmStack.Grown++;
+            }
+            return SysOkay;
+        }
+
+        /* Ran off the bottom of the reservation, never grow into the gap */
+        if (Va >= UserStackLow - UserStackGuard && Va < UserStackLow)
+        {
+            VmmStack.GuardHits++;
+            PWarn("Stack guard hit at 0x%016lx\n", __FaultAddr__);
+        }
+        return Rc;
+    }
+
+    return -NoSuch;
+}
@@ -1,3 +1,4 @@
+#include <Ipi.h>
 #include <VMM.h>
 
 uint64_t*
@@ -26,9 +27,16 @@ GetPageTable(uint64_t* __Pml4__, uint64_t __VirtAddr__, int __Level__, int __Cre
 
             uint64_t* NewTable = (uint64_t*)PhysToVirt(NewTablePhys);
 
+            /* A lazy 2MB entry turns into 512 lazy 4KB entries, the rest start empty */
+            uint64_t Seed = 0;
+            if (CurrentTable[CurrentIndex] & PTELAZY)
+            {
+                Seed = CurrentTable[CurrentIndex] & ~PTEHUGEPAGE;
+            }
+
             for (uint32_t Index = 0; Index < PageTableEntries; Index++)
             {
-                NewTable[Index] = 0;
+                NewTable[Index] = Seed;
             }
 
             CurrentTable[CurrentIndex] = NewTablePhys | PTEPRESENT | PTEWRITABLE | PTEUSER;
@@ -36,6 +44,12 @@ GetPageTable(uint64_t* __Pml4__, uint64_t __VirtAddr__, int __Level__, int __Cre
             PDebug("Created page table at level %d: 0x%016lx\n", Level - 1, NewTablePhys);
         }
 
+        /* A PS entry maps memory, there is no lower table to descend into */
+        if (Level < 4 && (CurrentTable[CurrentIndex] & PTEHUGEPAGE))
+        {
+            return Error_TO_Pointer(-Dangling);
+        }
+
         uint64_t NextTablePhys = CurrentTable[CurrentIndex] & 0xFFFFFFFFFFFFF000ULL;
 
         CurrentTable = (uint64_t*)PhysToVirt(NextTablePhys);
@@ -73,3 +87,22 @@ FlushAllTlb(SysErr* __Err__ __attribute((unused)))
 
     __asm__ volatile("mov %0, %%cr3" ::"r"(Cr3) : "memory");
 }
+
+static void
+__FlushAllOn__(void* __Arg__ __attribute((unused)))
+{
+    FlushAllTlb(NULL);
+}
+
+/*
+    FlushAllTlb on every CPU, for when a user mapping goes away and its frame
+    is about to be reused. Another CPU running a thread of the same space may
+    still cache the old translation, so the frame is only freed after this.
+    No spinlock may be held, a CPU spinning on it would never take the call.
+*/
+void
+ShootdownTlb(SysErr* __Err__)
+{
+    FlushAllTlb(__Err__);
+    IpiCallOthers(__FlushAllOn__, NULL);
+}
@@ -0,0 +1,168 @@
+#include <AxeSchd.h>
+#include <AxeThreads.h>
+#include <String.h>
+#include <VMM.h>
+
+typedef struct
+{
+    SpinLock            Lock;
+    VirtualMemorySpace* Head;
+    VirtualMemorySpace* Tail;
+    uint32_t            Pending;
+    Thread*             Worker;
+
+} SpaceReaper;
+
+VmmReapStats       VmmReap = {0};
+static SpaceReaper Reapers[MaxCPUs];
+
+static VirtualMemorySpace*
+__PopSpace__(SpaceReaper* __Reaper__)
+{
+    SysErr  err;
+    SysErr* Error = &err;
+
+    AcquireSpinLock(&__Reaper__->Lock, Error);
+
+    VirtualMemorySpace* Space = __Reaper__->Head;
+    if (Space)
+    {
+        __Reaper__->Head = Space->ReapNext;
+        if (!__Reaper__->Head)
+        {
+            __Reaper__->Tail = NULL;
+        }
+        Space->ReapNext = NULL;
+    }
+
+    ReleaseSpinLock(&__Reaper__->Lock, Error);
+    return Space;
+}
+
+static void
+__ReaperThread__(void* __Argument__)
+{
+    SysErr  err;
+    SysErr* Error = &err;
+
+    SpaceReaper* Reaper = (SpaceReaper*)__Argument__;
+
+    for (;;)
+    {
+        AcquireSpinLock(&Reaper->Lock, Error);
+        if (!Reaper->Head)
+        {
+            /*A space queued from here on finds the queue empty and unblocks us*/
+            ThreadBlock(&Reaper->Lock, WaitReasonSpace, Reaper, Error);
+            continue;
+        }
+        ReleaseSpinLock(&Reaper->Lock, Error);
+
+        VirtualMemorySpace* Space = __PopSpace__(Reaper);
+
+        /*Free in slices so a huge space never holds the CPU for a whole teardown*/
+        uint64_t Freed = 0;
+        while (!ReapVirtualSpace(Space, ReaperBatch, &Freed))
+        {
+            __atomic_fetch_add(&VmmReap.Frames, Freed, __ATOMIC_RELAXED);
+            ThreadYield(Error);
+        }
+        __atomic_fetch_add(&VmmReap.Frames, Freed, __ATOMIC_RELAXED);
+
+        AcquireSpinLock(&Reaper->Lock, Error);
+        Reaper->Pending--;
+        ReleaseSpinLock(&Reaper->Lock, Error);
+        __atomic_fetch_sub(&VmmReap.Pending, 1, __ATOMIC_RELAXED);
+    }
+}
+
+void
+InitializeSpaceReapers(SysErr* __Err__)
+{
+    for (uint32_t CpuIndex = 0; CpuIndex < Smp.CpuCount && CpuIndex < MaxCPUs; CpuIndex++)
+    {
+        SpaceReaper* Reaper = &Reapers[CpuIndex];
+
+        InitializeSpinLock(&Reaper->Lock, "SpaceReaper", __Err__);
+        Reaper->Head    = NULL;
+        Reaper->Tail    = NULL;
+        Reaper->Pending = 0;
+
+        Thread* Worker =
+            CreateThread(ThreadTypeKernel, __ReaperThread__, Reaper, ThreadPriorityLow);
+        if (Probe_IF_Error(Worker) || !Worker)
+        {
+            SlotError(__Err__, -BadAlloc);
+            continue;
+        }
+
+        /* Pinned, and always on the kernel PML4 so no dying space is ever live under us */
+        strcpy(Worker->Name, "SpaceReaper", sizeof(Worker->Name));
+        Worker->PageDirectory = Vmm.KernelPml4Physical;
+        CpuMaskZero(&Worker->CpuAffinity);
+        CpuMaskSet(&Worker->CpuAffinity, CpuIndex);
+        Worker->Flags |= ThreadFlagSystem | ThreadFlagPinned;
+
+        Reaper->Worker = Worker;
+        AddThreadToReadyQueue(CpuIndex, Worker, __Err__);
+    }
+
+    PSuccess("Space reapers started on %u CPUs\n", Smp.CpuCount);
+}
+
+int
+QueueSpaceReap(VirtualMemorySpace* __Space__)
+{
+    if (Probe_IF_Error(__Space__) || !__Space__)
+    {
+        return -BadArgs;
+    }
+
+    uint32_t CpuId = GetCurrentCpuId();
+    if (CpuId >= MaxCPUs || !Reapers[CpuId].Worker)
+    {
+        return -NotInit;
+    }
+
+    /*Backpressure: memory is tight or this CPU is behind, let the caller free inline*/
+    if (Pmm.Stats.FreePages < ReaperLowWater)
+    {
+        return -TooMany;
+    }
+
+    SysErr  err;
+    SysErr* Error = &err;
+
+    SpaceReaper* Reaper = &Reapers[CpuId];
+    AcquireSpinLock(&Reaper->Lock, Error);
+
+    if (Reaper->Pending >= ReaperMaxPending)
+    {
+        ReleaseSpinLock(&Reaper->Lock, Error);
+        return -TooMany;
+    }
+
+    int WakeWorker      = !Reaper->Head;
+    __Space__->ReapNext = NULL;
+    if (Reaper->Tail)
+    {
+        Reaper->Tail->ReapNext = __Space__;
+    }
+    else
+    {
+        Reaper->Head = __Space__;
+    }
+    Reaper->Tail = __Space__;
+    Reaper->Pending++;
+
+    ReleaseSpinLock(&Reaper->Lock, Error);
+
+    if (WakeWorker)
+    {
+        ThreadUnblock(Reaper->Worker, Error);
+    }
+
+    __atomic_fetch_add(&VmmReap.Queued, 1, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&VmmReap.Pending, 1, __ATOMIC_RELAXED);
+    return SysOkay;
+}
@@ -0,0 +1,906 @@
+#include <String.h>
+#include <VMM.h>
+
+#define __UserProtMask__ (PTEWRITABLE | PTEUSER | PTENOEXECUTE)
+
+static inline uint64_t
+__NextHugeBoundary__(uint64_t __Va__)
+{
+    return (__Va__ & ~HugePageMask) + HugePageSize;
+}
+
+static inline int
+__LazyEntry__(uint64_t __Entry__)
+{
+    return !(__Entry__ & PTEPRESENT) && (__Entry__ & PTELAZY);
+}
+
+/* Break a lazy 2MB entry into 512 lazy 4KB entries (GetPageTable seeds them) */
+static int
+__SplitLazy__(VirtualMemorySpace* __Space__, uint64_t __Va__)
+{
+    uint64_t* Pt = GetPageTable(__Space__->Pml4, __Va__, 1, 1);
+    return (Probe_IF_Error(Pt) || !Pt) ? -BadAlloc : SysOkay;
+}
+
+/* The range, rounded up to whole pages, sits in the user half and does not wrap */
+int
+UserRangeValid(uint64_t __VirtAddr__, uint64_t __Len__)
+{
+    if (__VirtAddr__ >= VirtualAddressSpace || __Len__ > VirtualAddressSpace)
+    {
+        return 0;
+    }
+
+    return __VirtAddr__ + ((__Len__ + PageSize - 1) & ~((uint64_t)PageSize - 1)) <=
+           VirtualAddressSpace;
+}
+
+int
+MapUserRange(VirtualMemorySpace* __Space__,
+             uint64_t            __VirtAddr__,
+             uint64_t            __Len__,
+             uint64_t            __Flags__)
+{
+    if (Probe_IF_Error(__Space__) || !__Space__ || (__VirtAddr__ % PageSize) != 0 ||
+        !UserRangeValid(__VirtAddr__, __Len__))
+    {
+        return -BadArgs;
+    }
+
+    SysErr  err;
+    SysErr* Error = &err;
+
+    uint64_t Va  = __VirtAddr__;
+    uint64_t End = __VirtAddr__ + ((__Len__ + PageSize - 1) & ~((uint64_t)PageSize - 1));
+
+    while (Va < End)
+    {
+        /* Any 2MB aligned run fully inside the range is a huge candidate */
+        if ((Va & HugePageMask) == 0 && (End - Va) >= HugePageSize)
+        {
+            uint64_t Phys = AllocHugePage();
+            if (Phys)
+            {
+                memset(PhysToVirt(Phys), 0, HugePageSize);
+
+                int Rc = MapHugePage(__Space__, Va, Phys, __Flags__);
+                if (Rc == SysOkay)
+                {
+                    VmmHuge.Hits++;
+                    Va += HugePageSize;
+                    continue;
+                }
+
+                FreeHugePage(Phys, Error);
+                if (Rc == -Redefined)
+                {
+                    Va += HugePageSize;
+                    continue;
+                }
+            }
+
+            VmmHuge.Fallbacks++;
+        }
+
+        /* A failure takes back what was mapped so far, the caller records none of it */
+        uint64_t Phys = AllocPage();
+        if (!Phys)
+        {
+            UnmapUserRange(__Space__, __VirtAddr__, Va - __VirtAddr__);
+            return -BadAlloc;
+        }
+
+        memset(PhysToVirt(Phys), 0, PageSize);
+
+        if (MapPage(__Space__, Va, Phys, __Flags__) != SysOkay)
+        {
+            FreePage(Phys, Error);
+            UnmapUserRange(__Space__, __VirtAddr__, Va - __VirtAddr__);
+            return -ErrReturn;
+        }
+
+        Va += PageSize;
+    }
+
+    return SysOkay;
+}
+
+int
+UnmapUserRange(VirtualMemorySpace* __Space__, uint64_t __VirtAddr__, uint64_t __Len__)
+{
+    if (Probe_IF_Error(__Space__) || !__Space__ || (__VirtAddr__ % PageSize) != 0 ||
+        !UserRangeValid(__VirtAddr__, __Len__))
+    {
+        return -BadArgs;
+    }
+
+    SysErr  err;
+    SysErr* Error = &err;
+
+    uint64_t Va  = __VirtAddr__;
+    uint64_t End = __VirtAddr__ + ((__Len__ + PageSize - 1) & ~((uint64_t)PageSize - 1));
+
+    while (Va < End)
+    {
+        uint64_t* Pd = GetPageTable(__Space__->Pml4, Va, 2, 0);
+        if (Probe_IF_Error(Pd) || !Pd)
+        {
+            Va = __NextHugeBoundary__(Va);
+            continue;
+        }
+
+        uint64_t PdIndex = (Va >> 21) & 0x1FF;
+        uint64_t Pde     = Pd[PdIndex];
+
+        if ((Pde & PTEPRESENT) && (Pde & PTEHUGEPAGE))
+        {
+            /* Whole 2MB covered: drop the leaf, otherwise split and go 4KB */
+            if ((Va & HugePageMask) == 0 && (End - Va) >= HugePageSize)
+            {
+                Pd[PdIndex] = 0;
+                FlushTlb(Va, Error);
+                FreeHugePage(Pde & 0x000FFFFFFFE00000ULL, Error);
+                VmmHuge.Mapped--;
+                Va += HugePageSize;
+                continue;
+            }
+
+            if (SplitHugePage(__Space__, Va) != SysOkay)
+            {
+                return -BadAlloc;
+            }
+        }
+        else if (__LazyEntry__(Pde))
+        {
+            if ((Va & HugePageMask) == 0 && (End - Va) >= HugePageSize)
+            {
+                Pd[PdIndex] = 0;
+                Va += HugePageSize;
+                continue;
+            }
+
+            if (__SplitLazy__(__Space__, Va) != SysOkay)
+            {
+                return -BadAlloc;
+            }
+        }
+
+        uint64_t* Pt = GetPageTable(__Space__->Pml4, Va, 1, 0);
+        if (Probe_IF_Error(Pt) || !Pt)
+        {
+            Va = __NextHugeBoundary__(Va);
+            continue;
+        }
+
+        uint64_t PtIndex = (Va >> 12) & 0x1FF;
+        uint64_t Pte     = Pt[PtIndex];
+
+        if (Pte & PTEPRESENT)
+        {
+            Pt[PtIndex] = 0;
+            FlushTlb(Va, Error);
+            if (!(Pte & PTEBORROWED))
+            {
+                FreePage(Pte & 0x000FFFFFFFFFF000ULL, Error);
+            }
+        }
+        else if (Pte & PTELAZY)
+        {
+            Pt[PtIndex] = 0;
+        }
+
+        Va += PageSize;
+    }
+
+    return SysOkay;
+}
+
+int
+ProtectUserRange(VirtualMemorySpace* __Space__,
+                 uint64_t            __VirtAddr__,
+                 uint64_t            __Len__,
+                 uint64_t            __Flags__)
+{
+    if (Probe_IF_Error(__Space__) || !__Space__ || (__VirtAddr__ % PageSize) != 0 ||
+        !UserRangeValid(__VirtAddr__, __Len__))
+    {
+        return -BadArgs;
+    }
+
+    SysErr  err;
+    SysErr* Error = &err;
+
+    uint64_t Prot = __Flags__ & __UserProtMask__;
+    uint64_t Va   = __VirtAddr__;
+    uint64_t End  = __VirtAddr__ + ((__Len__ + PageSize - 1) & ~((uint64_t)PageSize - 1));
+
+    while (Va < End)
+    {
+        uint64_t* Pd = GetPageTable(__Space__->Pml4, Va, 2, 0);
+        if (Probe_IF_Error(Pd) || !Pd)
+        {
+            Va = __NextHugeBoundary__(Va);
+            continue;
+        }
+
+        uint64_t PdIndex = (Va >> 21) & 0x1FF;
+        uint64_t Pde     = Pd[PdIndex];
+
+        if ((Pde & PTEPRESENT) && (Pde & PTEHUGEPAGE))
+        {
+            if ((Va & HugePageMask) == 0 && (End - Va) >= HugePageSize)
+            {
+                Pd[PdIndex] = (Pde & ~__UserProtMask__) | Prot;
+                FlushTlb(Va, Error);
+                Va += HugePageSize;
+                continue;
+            }
+
+            if (SplitHugePage(__Space__, Va) != SysOkay)
+            {
+                return -BadAlloc;
+            }
+        }
+        else if (__LazyEntry__(Pde))
+        {
+            if ((Va & HugePageMask) == 0 && (End - Va) >= HugePageSize)
+            {
+                Pd[PdIndex] = (Pde & ~__UserProtMask__) | Prot;
+                Va += HugePageSize;
+                continue;
+            }
+
+            if (__SplitLazy__(__Space__, Va) != SysOkay)
+            {
+                return -BadAlloc;
+            }
+        }
+
+        uint64_t* Pt = GetPageTable(__Space__->Pml4, Va, 1, 0);
+        if (Probe_IF_Error(Pt) || !Pt)
+        {
+            Va = __NextHugeBoundary__(Va);
+            continue;
+        }
+
+        uint64_t PtIndex = (Va >> 12) & 0x1FF;
+
+        if (Pt[PtIndex] & PTEPRESENT)
+        {
+            /* Borrowed frames only become writable in place when shared, else COW */
+            uint64_t Pte = Pt[PtIndex];
+            uint64_t Cow = Pte & PTECOW;
+            if ((Pte & PTEBORROWED) && !(Pte & PTESHARED) && (Prot & PTEWRITABLE))
+            {
+                Cow = PTECOW;
+            }
+            uint64_t Keep = Cow ? (Prot & ~PTEWRITABLE) : Prot;
+
+            Pt[PtIndex] = (Pte & ~(__UserProtMask__ | PTECOW)) | Keep | Cow;
+            FlushTlb(Va, Error);
+        }
+        else if (Pt[PtIndex] & PTELAZY)
+        {
+            Pt[PtIndex] = (Pt[PtIndex] & ~__UserProtMask__) | Prot;
+        }
+
+        Va += PageSize;
+    }
+
+    return SysOkay;
+}
+
+/*
+    Reserve a user range without backing it. Entries are left not present with
+    PTELAZY and the final flags, the fault handler fills them on first touch.
+    Aligned 2MB runs get a single lazy PDE so they can still take a huge page.
+*/
+int
+ReserveUserRange(VirtualMemorySpace* __Space__,
+                 uint64_t            __VirtAddr__,
+                 uint64_t            __Len__,
+                 uint64_t            __Flags__)
+{
+    if (Probe_IF_Error(__Space__) || !__Space__ || (__VirtAddr__ % PageSize) != 0 ||
+        !UserRangeValid(__VirtAddr__, __Len__))
+    {
+        return -BadArgs;
+    }
+
+    uint64_t Lazy = (__Flags__ & ~PTEPRESENT) | PTELAZY;
+    uint64_t Va   = __VirtAddr__;
+    uint64_t End  = __VirtAddr__ + ((__Len__ + PageSize - 1) & ~((uint64_t)PageSize - 1));
+
+    while (Va < End)
+    {
+        if ((Va & HugePageMask) == 0 && (End - Va) >= HugePageSize)
+        {
+            uint64_t* Pd = GetPageTable(__Space__->Pml4, Va, 2, 1);
+            if (Probe_IF_Error(Pd) || !Pd)
+            {
+                return -BadAlloc;
+            }
+
+            uint64_t PdIndex = (Va >> 21) & 0x1FF;
+            if (!(Pd[PdIndex] & PTEPRESENT))
+            {
+                Pd[PdIndex] = Lazy | PTEHUGEPAGE;
+                Va += HugePageSize;
+                continue;
+            }
+        }
+
+        uint64_t* Pt = GetPageTable(__Space__->Pml4, Va, 1, 1);
+        if (Probe_IF_Error(Pt) || !Pt)
+        {
+            /* Already backed by a 2MB leaf, like MapPage leave it be */
+            if (Pointer_TO_Error(Pt) == -Dangling)
+            {
+                Va = __NextHugeBoundary__(Va);
+                continue;
+            }
+            return -BadAlloc;
+        }
+
+        uint64_t PtIndex = (Va >> 12) & 0x1FF;
+        if (!(Pt[PtIndex] & PTEPRESENT))
+        {
+            Pt[PtIndex] = Lazy;
+        }
+
+        Va += PageSize;
+    }
+
+    return SysOkay;
+}
+
+#define __DropBatch__ 64 /* frames unmapped per shootdown, bit 0 marks a 2MB one */
+
+static void
+__FreeDropped__(uint64_t* __Frames__, uint32_t* __Count__)
+{
+    SysErr  err;
+    SysErr* Error = &err;
+
+    if (!*__Count__)
+    {
+        return;
+    }
+
+    ShootdownTlb(Error);
+    for (uint32_t Index = 0; Index < *__Count__; Index++)
+    {
+        if (__Frames__[Index] & 1)
+        {
+            FreeHugePage(__Frames__[Index] & ~1ULL, Error);
+        }
+        else
+        {
+            FreePage(__Frames__[Index], Error);
+        }
+    }
+    *__Count__ = 0;
+}
+
+/*
+    MADV_DONTNEED and MADV_FREE: private frames go back to the PMM, the range
+    reads back as zero. Unmapped frames wait in a batch until no CPU can still
+    translate to them.
+*/
+static int
+__DropUserRange__(VirtualMemorySpace* __Space__, uint64_t __Va__, uint64_t __End__)
+{
+    uint64_t Frames[__DropBatch__];
+    uint32_t Count = 0;
+
+    uint64_t Va = __Va__;
+    while (Va < __End__)
+    {
+        if (Count == __DropBatch__)
+        {
+            __FreeDropped__(Frames, &Count);
+        }
+
+        uint64_t* Pd = GetPageTable(__Space__->Pml4, Va, 2, 0);
+        if (Probe_IF_Error(Pd) || !Pd)
+        {
+            Va = __NextHugeBoundary__(Va);
+            continue;
+        }
+
+        uint64_t PdIndex = (Va >> 21) & 0x1FF;
+        uint64_t Pde     = Pd[PdIndex];
+
+        if ((Pde & PTEPRESENT) && (Pde & PTEHUGEPAGE))
+        {
+            if ((Va & HugePageMask) == 0 && (__End__ - Va) >= HugePageSize)
+            {
+                Pd[PdIndex] = (Pde & ~(0x000FFFFFFFE00000ULL | PTEPRESENT | PTEACCESSED |
+                                       PTEDIRTY)) |
+                              PTELAZY;
+                Frames[Count++] = (Pde & 0x000FFFFFFFE00000ULL) | 1;
+                VmmHuge.Mapped--;
+                VmmLazy.Dropped += PageTableEntries;
+                Va += HugePageSize;
+                continue;
+            }
+
+            if (SplitHugePage(__Space__, Va) != SysOkay)
+            {
+                __FreeDropped__(Frames, &Count);
+                return -BadAlloc;
+            }
+        }
+
+        uint64_t* Pt = GetPageTable(__Space__->Pml4, Va, 1, 0);
+        if (Probe_IF_Error(Pt) || !Pt)
+        {
+            Va = __NextHugeBoundary__(Va);
+            continue;
+        }
+
+        uint64_t PtIndex = (Va >> 12) & 0x1FF;
+        uint64_t Pte     = Pt[PtIndex];
+
+        /* Lent frames are not ours to drop */
+        if ((Pte & PTEPRESENT) && !(Pte & PTEBORROWED))
+        {
+            Pt[PtIndex] = (Pte & ~(0x000FFFFFFFFFF000ULL | PTEPRESENT | PTEACCESSED | PTEDIRTY |
+                                   PTECOW)) |
+                          PTELAZY;
+            Frames[Count++] = Pte & 0x000FFFFFFFFFF000ULL;
+            VmmLazy.Dropped++;
+        }
+
+        Va += PageSize;
+    }
+
+    __FreeDropped__(Frames, &Count);
+    return SysOkay;
+}
+
+/* MADV_SEQUENTIAL: tag the untouched part of the range for fault around */
+static int
+__MarkSequential__(VirtualMemorySpace* __Space__, uint64_t __Va__, uint64_t __End__)
+{
+    uint64_t Va = __Va__;
+    while (Va < __End__)
+    {
+        uint64_t* Pd = GetPageTable(__Space__->Pml4, Va, 2, 0);
+        if (Probe_IF_Error(Pd) || !Pd)
+        {
+            Va = __NextHugeBoundary__(Va);
+            continue;
+        }
+
+        uint64_t PdIndex = (Va >> 21) & 0x1FF;
+        if (__LazyEntry__(Pd[PdIndex]) || (Pd[PdIndex] & PTEHUGEPAGE))
+        {
+            if (__LazyEntry__(Pd[PdIndex]))
+            {
+                Pd[PdIndex] |= PTESEQUENTIAL;
+            }
+            Va = __NextHugeBoundary__(Va);
+            continue;
+        }
+
+        uint64_t* Pt = GetPageTable(__Space__->Pml4, Va, 1, 0);
+        if (Probe_IF_Error(Pt) || !Pt)
+        {
+            Va = __NextHugeBoundary__(Va);
+            continue;
+        }
+
+        uint64_t PtIndex = (Va >> 12) & 0x1FF;
+        if (__LazyEntry__(Pt[PtIndex]))
+        {
+            Pt[PtIndex] |= PTESEQUENTIAL;
+        }
+
+        Va += PageSize;
+    }
+
+    return SysOkay;
+}
+
+/*
+    MADV_HUGEPAGE: fold every aligned 2MB run of private 4KB pages with one
+    set of permissions into a single 2MB page, copying what is already there.
+    Runs that are still untouched just become one lazy 2MB entry.
+*/
+static int
+__CollapseUserRange__(VirtualMemorySpace* __Space__, uint64_t __Va__, uint64_t __End__)
+{
+    SysErr  err;
+    SysErr* Error = &err;
+
+    uint64_t Keep = PTEWRITABLE | PTEUSER | PTENOEXECUTE;
+
+    for (uint64_t Va = (__Va__ + HugePageMask) & ~HugePageMask; Va + HugePageSize <= __End__;
+         Va += HugePageSize)
+    {
+        uint64_t* Pd = GetPageTable(__Space__->Pml4, Va, 2, 0);
+        if (Probe_IF_Error(Pd) || !Pd)
+        {
+            continue;
+        }
+
+        uint64_t PdIndex = (Va >> 21) & 0x1FF;
+        uint64_t Pde     = Pd[PdIndex];
+        if (!(Pde & PTEPRESENT) || (Pde & PTEHUGEPAGE))
+        {
+            continue;
+        }
+
+        uint64_t  PtPhys  = Pde & 0x000FFFFFFFFFF000ULL;
+        uint64_t* Pt      = (uint64_t*)PhysToVirt(PtPhys);
+        uint64_t  Flags   = Pt[0] & Keep;
+        uint64_t  Present = 0;
+        int       Ok      = 1;
+
+        for (uint64_t Index = 0; Index < PageTableEntries && Ok; Index++)
+        {
+            uint64_t Pte = Pt[Index];
+            if (Pte & PTEPRESENT)
+            {
+                Ok = !(Pte & (PTEBORROWED | PTECOW | PTESHARED));
+                Present++;
+            }
+            else if (!(Pte & PTELAZY))
+            {
+                Ok = 0;
+            }
+            Ok = Ok && ((Pte & Keep) == Flags);
+        }
+
+        if (!Ok)
+        {
+            continue;
+        }
+
+        /* The PT itself may sit in another CPU's paging structure cache */
+        if (!Present)
+        {
+            Pd[PdIndex] = Flags | PTELAZY | PTEHUGEPAGE;
+            ShootdownTlb(Error);
+            FreePage(PtPhys, Error);
+            continue;
+        }
+
+        uint64_t Huge = AllocHugePage();
+        if (!Huge)
+        {
+            VmmHuge.Fallbacks++;
+            continue;
+        }
+
+        uint8_t* Dst = (uint8_t*)PhysToVirt(Huge);
+        for (uint64_t Index = 0; Index < PageTableEntries; Index++)
+        {
+            if (Pt[Index] & PTEPRESENT)
+            {
+                memcpy(Dst + Index * PageSize,
+                       PhysToVirt(Pt[Index] & 0x000FFFFFFFFFF000ULL),
+                       PageSize);
+            }
+            else
+            {
+                memset(Dst + Index * PageSize, 0, PageSize);
+            }
+        }
+
+        /* Swap the leaf in first, old frames only go once no TLB can hold them */
+        Pd[PdIndex] = Huge | Flags | PTEHUGEPAGE | PTEPRESENT;
+        ShootdownTlb(Error);
+
+        for (uint64_t Index = 0; Index < PageTableEntries; Index++)
+        {
+            if (Pt[Index] & PTEPRESENT)
+            {
+                FreePage(Pt[Index] & 0x000FFFFFFFFFF000ULL, Error);
+            }
+        }
+        FreePage(PtPhys, Error);
+
+        VmmHuge.Mapped++;
+        VmmLazy.Collapsed++;
+    }
+
+    return SysOkay;
+}
+
+int
+AdviseUserRange(VirtualMemorySpace* __Space__,
+                uint64_t            __VirtAddr__,
+                uint64_t            __Len__,
+                VmmAdvice           __Advice__)
+{
+    if (Probe_IF_Error(__Space__) || !__Space__ || (__VirtAddr__ % PageSize) != 0 ||
+        !UserRangeValid(__VirtAddr__, __Len__))
+    {
+        return -BadArgs;
+    }
+
+    uint64_t End = __VirtAddr__ + ((__Len__ + PageSize - 1) & ~((uint64_t)PageSize - 1));
+
+    switch (__Advice__)
+    {
+        case VmmAdviseWillNeed:
+            return PopulateUserRange(__Space__, __VirtAddr__, End - __VirtAddr__);
+
+        /* Nothing reclaims marked frames later under pressure yet, so FREE drops now */
+        case VmmAdviseFree:
+        case VmmAdviseDontNeed:
+            return __DropUserRange__(__Space__, __VirtAddr__, End);
+
+        case VmmAdviseSequential:
+            return __MarkSequential__(__Space__, __VirtAddr__, End);
+
+        case VmmAdviseHuge:
+            return __CollapseUserRange__(__Space__, __VirtAddr__, End);
+    }
+
+    return -BadArgs;
+}
+
+/* Resident pages in a range, what a reservation has actually committed so far */
+uint64_t
+CountUserRange(VirtualMemorySpace* __Space__, uint64_t __VirtAddr__, uint64_t __Len__)
+{
+    if (Probe_IF_Error(__Space__) || !__Space__)
+    {
+        return 0;
+    }
+
+    uint64_t Count = 0;
+    uint64_t Va    = __VirtAddr__ & ~((uint64_t)PageSize - 1);
+    uint64_t End   = __VirtAddr__ + __Len__;
+
+    while (Va < End)
+    {
+        uint64_t* Pd = GetPageTable(__Space__->Pml4, Va, 2, 0);
+        if (Probe_IF_Error(Pd) || !Pd)
+        {
+            Va = __NextHugeBoundary__(Va);
+            continue;
+        }
+
+        uint64_t Pde = Pd[(Va >> 21) & 0x1FF];
+        if (!(Pde & PTEPRESENT) || (Pde & PTEHUGEPAGE))
+        {
+            uint64_t Next = __NextHugeBoundary__(Va);
+            if (Pde & PTEPRESENT)
+            {
+                Count += ((Next < End ? Next : End) - Va) / PageSize;
+            }
+            Va = Next;
+            continue;
+        }
+
+        uint64_t* Pt   = (uint64_t*)PhysToVirt(Pde & 0x000FFFFFFFFFF000ULL);
+        uint64_t  Next = __NextHugeBoundary__(Va);
+        for (; Va < End && Va < Next; Va += PageSize)
+        {
+            if (Pt[(Va >> 12) & 0x1FF] & PTEPRESENT)
+            {
+                Count++;
+            }
+        }
+    }
+
+    return Count;
+}
+
+/* Nothing mapped or reserved anywhere in the range, mremap may grow or move into it */
+int
+UserRangeIsFree(VirtualMemorySpace* __Space__, uint64_t __VirtAddr__, uint64_t __Len__)
+{
+    if (Probe_IF_Error(__Space__) || !__Space__ || __VirtAddr__ + __Len__ < __VirtAddr__ ||
+        __VirtAddr__ + __Len__ > VirtualAddressSpace)
+    {
+        return 0;
+    }
+
+    uint64_t Va  = __VirtAddr__ & ~((uint64_t)PageSize - 1);
+    uint64_t End = __VirtAddr__ + __Len__;
+
+    while (Va < End)
+    {
+        uint64_t  Next = __NextHugeBoundary__(Va);
+        uint64_t* Pd   = GetPageTable(__Space__->Pml4, Va, 2, 0);
+        if (Probe_IF_Error(Pd) || !Pd)
+        {
+            Va = Next;
+            continue;
+        }
+
+        uint64_t Pde = Pd[(Va >> 21) & 0x1FF];
+        if (Pde & PTEHUGEPAGE)
+        {
+            return 0;
+        }
+        if (Pde & PTEPRESENT)
+        {
+            uint64_t* Pt = (uint64_t*)PhysToVirt(Pde & 0x000FFFFFFFFFF000ULL);
+            for (uint64_t At = Va; At < End && At < Next; At += PageSize)
+            {
+                if (Pt[(At >> 12) & 0x1FF])
+                {
+                    return 0;
+                }
+            }
+        }
+        Va = Next;
+    }
+
+    return 1;
+}
+
+/* Protection and kind of whatever backs Va, mapped or still lazy, 0 when nothing does */
+uint64_t
+UserRangeFlags(VirtualMemorySpace* __Space__, uint64_t __VirtAddr__)
+{
+    uint64_t Keep = __UserProtMask__ | PTEPRESENT | PTELAZY | PTEBORROWED | PTESHARED |
+                    PTEGROWSDOWN;
+
+    if (Probe_IF_Error(__Space__) || !__Space__)
+    {
+        return 0;
+    }
+
+    uint64_t* Pd = GetPageTable(__Space__->Pml4, __VirtAddr__, 2, 0);
+    if (Probe_IF_Error(Pd) || !Pd)
+    {
+        return 0;
+    }
+
+    uint64_t Pde = Pd[(__VirtAddr__ >> 21) & 0x1FF];
+    if (Pde & PTEHUGEPAGE)
+    {
+        return Pde & Keep;
+    }
+    if (!(Pde & PTEPRESENT))
+    {
+        return 0;
+    }
+
+    uint64_t* Pt = (uint64_t*)PhysToVirt(Pde & 0x000FFFFFFFFFF000ULL);
+    return Pt[(__VirtAddr__ >> 12) & 0x1FF] & Keep;
+}
+
+/*
+    One walk of MoveUserRange. With __Commit__ clear it only splits source 2MB
+    entries and allocates destination tables, the mapping stays as it was, so
+    only that walk can fail. The committing walk then finds every table in
+    place and just lifts entries across.
+*/
+static int
+__MoveWalk__(VirtualMemorySpace* __Space__,
+             uint64_t            __OldAddr__,
+             uint64_t            __NewAddr__,
+             uint64_t            __Len__,
+             int                 __Commit__)
+{
+    uint64_t* Pml4    = __Space__->Pml4;
+    uint64_t  Src     = __OldAddr__;
+    uint64_t  End     = __OldAddr__ + __Len__;
+    uint64_t* DstPt   = NULL;
+    uint64_t  DstBase = 0;
+
+    while (Src < End)
+    {
+        uint64_t  Dst   = __NewAddr__ + (Src - __OldAddr__);
+        uint64_t  Next  = __NextHugeBoundary__(Src);
+        uint64_t* SrcPd = GetPageTable(Pml4, Src, 2, 0);
+        if (Probe_IF_Error(SrcPd) || !SrcPd)
+        {
+            Src = Next;
+            continue;
+        }
+
+        uint64_t SrcIndex = (Src >> 21) & 0x1FF;
+        uint64_t Pde      = SrcPd[SrcIndex];
+
+        if (Pde & PTEHUGEPAGE)
+        {
+            if (!(Src & HugePageMask) && !(Dst & HugePageMask) && End - Src >= HugePageSize)
+            {
+                uint64_t* DstPd = GetPageTable(Pml4, Dst, 2, 1);
+                if (Probe_IF_Error(DstPd) || !DstPd)
+                {
+                    return -BadAlloc;
+                }
+
+                /* An empty table left behind by an old mapping still blocks a 2MB entry */
+                if (!DstPd[(Dst >> 21) & 0x1FF])
+                {
+                    if (__Commit__)
+                    {
+                        DstPd[(Dst >> 21) & 0x1FF] = Pde;
+                        SrcPd[SrcIndex]            = 0;
+                    }
+                    Src = Next;
+                    continue;
+                }
+            }
+
+            int Rc = (Pde & PTEPRESENT) ? SplitHugePage(__Space__, Src)
+                                        : __SplitLazy__(__Space__, Src);
+            if (Rc != SysOkay)
+            {
+                return -BadAlloc;
+            }
+            Pde = SrcPd[SrcIndex];
+        }
+
+        if (!(Pde & PTEPRESENT))
+        {
+            Src = Next;
+            continue;
+        }
+
+        uint64_t* SrcPt = (uint64_t*)PhysToVirt(Pde & 0x000FFFFFFFFFF000ULL);
+        for (; Src < End && Src < Next; Src += PageSize)
+        {
+            uint64_t Pte = SrcPt[(Src >> 12) & 0x1FF];
+            if (!Pte)
+            {
+                continue;
+            }
+
+            uint64_t At = __NewAddr__ + (Src - __OldAddr__);
+            if (!DstPt || (At & ~HugePageMask) != DstBase)
+            {
+                DstPt = GetPageTable(Pml4, At, 1, 1);
+                if (Probe_IF_Error(DstPt) || !DstPt)
+                {
+                    return -BadAlloc;
+                }
+                DstBase = At & ~HugePageMask;
+            }
+
+            if (__Commit__)
+            {
+                DstPt[(At >> 12) & 0x1FF]  = Pte;
+                SrcPt[(Src >> 12) & 0x1FF] = 0;
+            }
+        }
+    }
+
+    return SysOkay;
+}
+
+/*
+    mremap without copying: every entry, mapped or lazy, is lifted from the old
+    range into the new one, frames and ownership travel with it. 2MB entries
+    move whole when both sides sit at the same offset into a 2MB page, else they
+    are split first. The target must be free (UserRangeIsFree). A failure
+    leaves every entry where it was.
+*/
+int
+MoveUserRange(VirtualMemorySpace* __Space__,
+              uint64_t            __OldAddr__,
+              uint64_t            __NewAddr__,
+              uint64_t            __Len__)
+{
+    if (Probe_IF_Error(__Space__) || !__Space__ || (__OldAddr__ % PageSize) != 0 ||
+        (__NewAddr__ % PageSize) != 0 || (__Len__ % PageSize) != 0 ||
+        !UserRangeValid(__OldAddr__, __Len__) || !UserRangeValid(__NewAddr__, __Len__))
+    {
+        return -BadArgs;
+    }
+
+    SysErr  err;
+    SysErr* Error = &err;
+
+    int Rc = __MoveWalk__(__Space__, __OldAddr__, __NewAddr__, __Len__, 0);
+    if (Rc != SysOkay)
+    {
+        return Rc;
+    }
+
+    __MoveWalk__(__Space__, __OldAddr__, __NewAddr__, __Len__, 1);
+    FlushAllTlb(Error);
+    return SysOkay;
+}
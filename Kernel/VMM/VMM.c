@@ -94,9 +94,6 @@ DestroyVirtualSpace(VirtualMemorySpace* __Space__, SysErr* __Err__)
         return;
     }
 
-    SysErr  err;
-    SysErr* Error = &err;
-
     __Space__->RefCount--;
     if (__Space__->RefCount > 0)
     {
@@ -107,57 +104,117 @@ DestroyVirtualSpace(VirtualMemorySpace* __Space__, SysErr* __Err__)
 
     PDebug("Destroying virtual space: PML4=0x%016lx\n", __Space__->PhysicalBase);
 
-    for (uint64_t Pml4Index = 0; Pml4Index < 256; Pml4Index++)
+    __Space__->ReapL4   = 0;
+    __Space__->ReapL3   = 0;
+    __Space__->ReapL2   = 0;
+    __Space__->ReapNext = NULL;
+
+    if (QueueSpaceReap(__Space__) == SysOkay)
+    {
+        return;
+    }
+
+    /*No reaper or too much already pending, pay for it here*/
+    __atomic_fetch_add(&VmmReap.Inline, 1, __ATOMIC_RELAXED);
+    ReapVirtualSpace(__Space__, ~0ULL, NULL);
+}
+
+bool
+ReapVirtualSpace(VirtualMemorySpace* __Space__, uint64_t __Budget__, uint64_t* __Freed__)
+{
+    SysErr  err;
+    SysErr* Error = &err;
+
+    uint64_t Freed = 0;
+
+    /*Resumes from the cursor; an entry is consumed before its frames are freed*/
+    for (; __Space__->ReapL4 < 256; __Space__->ReapL4++, __Space__->ReapL3 = 0)
     {
-        /* Skip entries that are not present (not mapped) */
-        if (!(__Space__->Pml4[Pml4Index] & PTEPRESENT))
+        uint64_t Pml4e = __Space__->Pml4[__Space__->ReapL4];
+        if (!(Pml4e & PTEPRESENT))
         {
             continue;
         }
 
-        uint64_t  PdptPhys = __Space__->Pml4[Pml4Index] & 0x000FFFFFFFFFF000ULL;
+        uint64_t  PdptPhys = Pml4e & 0x000FFFFFFFFFF000ULL;
         uint64_t* Pdpt     = (uint64_t*)PhysToVirt(PdptPhys);
-        if (Probe_IF_Error(Pdpt) || !Pdpt)
-        {
-            continue;
-        }
 
-        for (uint64_t PdptIndex = 0; PdptIndex < PageTableEntries; PdptIndex++)
+        for (; __Space__->ReapL3 < PageTableEntries; __Space__->ReapL3++, __Space__->ReapL2 = 0)
         {
-            if (!(Pdpt[PdptIndex] & PTEPRESENT))
+            uint64_t Pdpte = Pdpt[__Space__->ReapL3];
+            if (!(Pdpte & PTEPRESENT) || (Pdpte & PTEHUGEPAGE))
             {
                 continue;
             }
 
-            uint64_t  PdPhys = Pdpt[PdptIndex] & 0x000FFFFFFFFFF000ULL;
+            uint64_t  PdPhys = Pdpte & 0x000FFFFFFFFFF000ULL;
             uint64_t* Pd     = (uint64_t*)PhysToVirt(PdPhys);
-            if (Probe_IF_Error(Pd) || !Pd)
-            {
-                continue;
-            }
 
-            for (uint64_t PdIndex = 0; PdIndex < PageTableEntries; PdIndex++)
+            while (__Space__->ReapL2 < PageTableEntries)
             {
-                if (!(Pd[PdIndex] & PTEPRESENT))
+                uint64_t Pde = Pd[__Space__->ReapL2++];
+                if (!(Pde & PTEPRESENT))
                 {
                     continue;
                 }
 
-                FreePage(Pd[PdIndex] & 0x000FFFFFFFFFF000ULL, Error);
+                /* A 2MB leaf owns its frames, hand the whole run back */
+                if (Pde & PTEHUGEPAGE)
+                {
+                    FreeHugePage(Pde & 0x000FFFFFFFE00000ULL, Error);
+                    VmmHuge.Mapped--;
+                    Freed += PageTableEntries;
+                }
+                else
+                {
+                    uint64_t  PtPhys = Pde & 0x000FFFFFFFFFF000ULL;
+                    uint64_t* Pt     = (uint64_t*)PhysToVirt(PtPhys);
+
+                    for (uint64_t PtIndex = 0; PtIndex < PageTableEntries; PtIndex++)
+                    {
+                        uint64_t Pte = Pt[PtIndex];
+                        if ((Pte & PTEPRESENT) && !(Pte & PTEBORROWED))
+                        {
+                            FreePage(Pte & 0x000FFFFFFFFFF000ULL, Error);
+                            Freed++;
+                        }
+                    }
+
+                    /* Free the Page Table page itself */
+                    FreePage(PtPhys, Error);
+                    Freed++;
+                }
+
+                if (Freed >= __Budget__)
+                {
+                    if (__Freed__)
+                    {
+                        *__Freed__ = Freed;
+                    }
+                    return false;
+                }
             }
 
             /* Free the Page Directory page itself */
             FreePage(PdPhys, Error);
+            Freed++;
         }
 
         /* Free the Page Directory Pointer Table page */
         FreePage(PdptPhys, Error);
+        Freed++;
     }
 
     /* Free the root Page Map Level 4 table */
     FreePage(__Space__->PhysicalBase, Error);
 
     FreePage(VirtToPhys(__Space__), Error);
+
+    if (__Freed__)
+    {
+        *__Freed__ = Freed + 2;
+    }
+    return true;
 }
 
 int
@@ -241,6 +298,16 @@ GetPhysicalAddress(VirtualMemorySpace* __Space__, uint64_t __VirtAddr__)
         return -NotCanonical;
     }
 
+    uint64_t* Pd = GetPageTable(__Space__->Pml4, __VirtAddr__, 2, 0);
+    if (!Probe_IF_Error(Pd) && Pd)
+    {
+        uint64_t Pde = Pd[(__VirtAddr__ >> 21) & 0x1FF];
+        if ((Pde & PTEPRESENT) && (Pde & PTEHUGEPAGE))
+        {
+            return (Pde & 0x000FFFFFFFE00000ULL) + (__VirtAddr__ & HugePageMask);
+        }
+    }
+
     uint64_t* Pt = GetPageTable(__Space__->Pml4, __VirtAddr__, 1, 0);
     if (Probe_IF_Error(Pt) || !Pt)
     {
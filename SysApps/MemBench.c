@@ -0,0 +1,358 @@
+#include <fcntl.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+/*
+    Memory subsystem micro benchmarks. Each case prints ns per operation so
+    runs can be compared across kernel builds.
+*/
+
+#define PROT_READ     0x1
+#define PROT_WRITE    0x2
+#define MAP_PRIVATE   0x02
+#define MAP_ANONYMOUS 0x20
+#define MAP_POPULATE  0x8000
+#define MAP_FAILED    ((void*)-1)
+#define MADV_DONTNEED 4
+#define MADV_FREE     8
+
+#define BenchWalkSize  (512UL * 1024UL * 1024UL)
+#define BenchWalkSteps (4UL * 1024UL * 1024UL)
+#define BenchSmallBase ((void*)0x200000001000UL) /* 4KB aligned, never 2MB aligned */
+#define BenchFileDflt  "/bench.bin"                 /* drop a large file into the initrd */
+#define BenchFileChunk 4096UL
+#define BenchFileProbe 65536UL
+#define BenchExitSize  (256UL * 1024UL * 1024UL)
+#define BenchExitRuns  8
+#define BenchTouchSize (64UL * 1024UL * 1024UL)
+#define BenchArenaSize (8UL * 1024UL * 1024UL)
+#define BenchArenaRuns 64
+
+void* mmap(void* __addr__, size_t __len__, int __prot__, int __flags__, int __fd__, off_t __off__);
+int   munmap(void* __addr__, size_t __len__);
+int   madvise(void* __addr__, size_t __len__, int __advice__);
+
+static uint64_t
+__NowNs__(void)
+{
+    struct timespec Ts;
+    clock_gettime(CLOCK_MONOTONIC, &Ts);
+    return (uint64_t)Ts.tv_sec * 1000000000ULL + (uint64_t)Ts.tv_nsec;
+}
+
+static void
+__DumpMeminfo__(void)
+{
+    char Buf[2048];
+    int  Fd = open("/proc/meminfo", O_RDONLY);
+    if (Fd < 0)
+    {
+        return;
+    }
+    ssize_t Got = read(Fd, Buf, sizeof(Buf) - 1);
+    if (Got > 0)
+    {
+        Buf[Got] = '\0';
+        printf("%s", Buf);
+    }
+    close(Fd);
+}
+
+/* Random page-granular walk, one load per step, so nearly every access misses the TLB */
+static uint64_t
+__RandomWalk__(volatile uint8_t* __Base__, size_t __Len__)
+{
+    uint64_t Seed  = 0x9E3779B97F4A7C15ULL;
+    uint64_t Sum   = 0;
+    uint64_t Pages = __Len__ / 4096;
+
+    for (size_t I = 0; I < __Len__; I += 4096)
+    {
+        __Base__[I] = (uint8_t)I;
+    }
+
+    uint64_t T0 = __NowNs__();
+    for (uint64_t Step = 0; Step < BenchWalkSteps; Step++)
+    {
+        Seed = Seed * 6364136223846793005ULL + 1442695040888963407ULL;
+        Sum += __Base__[((Seed >> 33) % Pages) * 4096];
+    }
+    uint64_t T1 = __NowNs__();
+
+    if (Sum == 0x5A5A5A5A)
+    {
+        printf("\n");
+    }
+    return (T1 - T0) / BenchWalkSteps;
+}
+
+static void
+__BenchTlbWalk__(void)
+{
+    uint8_t* Huge = (uint8_t*)mmap(
+        NULL, BenchWalkSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (Huge == MAP_FAILED)
+    {
+        printf("[tlbwalk] huge mmap failed\n");
+        return;
+    }
+    printf("[tlbwalk] 2MB-eligible: %llu ns/access\n",
+           (unsigned long long)__RandomWalk__(Huge, BenchWalkSize));
+    __DumpMeminfo__();
+    munmap(Huge, BenchWalkSize);
+
+    uint8_t* Small = (uint8_t*)mmap(
+        BenchSmallBase, BenchWalkSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (Small == MAP_FAILED)
+    {
+        printf("[tlbwalk] 4KB mmap failed\n");
+        return;
+    }
+    printf("[tlbwalk] 4KB only:     %llu ns/access\n",
+           (unsigned long long)__RandomWalk__(Small, BenchWalkSize));
+    munmap(Small, BenchWalkSize);
+}
+
+/* Same file read three ways: mmap sequential, read() sequential, then random 4KB probes */
+static void
+__BenchFileMap__(const char* __Path__)
+{
+    static uint8_t Chunk[BenchFileChunk];
+    struct stat    St;
+
+    int Fd = open(__Path__, O_RDONLY);
+    if (Fd < 0 || fstat(Fd, &St) != 0 || St.st_size < (off_t)BenchFileChunk)
+    {
+        printf("[filemap] %s missing or too small, skipped\n", __Path__);
+        if (Fd >= 0)
+        {
+            close(Fd);
+        }
+        return;
+    }
+
+    size_t   Len   = (size_t)St.st_size & ~(BenchFileChunk - 1);
+    uint64_t Pages = Len / BenchFileChunk;
+    uint64_t Sum   = 0;
+
+    uint64_t T0  = __NowNs__();
+    uint8_t* Map = (uint8_t*)mmap(NULL, Len, PROT_READ, MAP_PRIVATE, Fd, 0);
+    if (Map == MAP_FAILED)
+    {
+        printf("[filemap] mmap failed\n");
+        close(Fd);
+        return;
+    }
+    for (size_t I = 0; I < Len; I += 64)
+    {
+        Sum += Map[I];
+    }
+    uint64_t T1 = __NowNs__();
+
+    lseek(Fd, 0, SEEK_SET);
+    for (size_t I = 0; I < Len; I += BenchFileChunk)
+    {
+        if (read(Fd, Chunk, BenchFileChunk) != (ssize_t)BenchFileChunk)
+        {
+            break;
+        }
+        for (size_t J = 0; J < BenchFileChunk; J += 64)
+        {
+            Sum += Chunk[J];
+        }
+    }
+    uint64_t T2 = __NowNs__();
+
+    uint64_t Seed = 0x9E3779B97F4A7C15ULL;
+    for (uint64_t Step = 0; Step < BenchFileProbe; Step++)
+    {
+        Seed = Seed * 6364136223846793005ULL + 1442695040888963407ULL;
+        Sum += Map[((Seed >> 33) % Pages) * BenchFileChunk];
+    }
+    uint64_t T3 = __NowNs__();
+
+    Seed = 0x9E3779B97F4A7C15ULL;
+    for (uint64_t Step = 0; Step < BenchFileProbe; Step++)
+    {
+        Seed = Seed * 6364136223846793005ULL + 1442695040888963407ULL;
+        lseek(Fd, (off_t)(((Seed >> 33) % Pages) * BenchFileChunk), SEEK_SET);
+        read(Fd, Chunk, 1);
+        Sum += Chunk[0];
+    }
+    uint64_t T4 = __NowNs__();
+
+    printf("[filemap] %llu KB, sequential mmap: %llu us, read(): %llu us\n",
+           (unsigned long long)(Len / 1024),
+           (unsigned long long)((T1 - T0) / 1000),
+           (unsigned long long)((T2 - T1) / 1000));
+    printf("[filemap] random probe mmap: %llu ns, lseek+read: %llu ns (sum %llx)\n",
+           (unsigned long long)((T3 - T2) / BenchFileProbe),
+           (unsigned long long)((T4 - T3) / BenchFileProbe),
+           (unsigned long long)Sum);
+
+    munmap(Map, Len);
+    close(Fd);
+}
+
+/* Child maps 256MB, stamps the clock right before _exit, parent measures until waitpid returns */
+static void
+__BenchExitReap__(void)
+{
+    uint64_t Total = 0;
+    int      Done  = 0;
+
+    for (int Run = 0; Run < BenchExitRuns; Run++)
+    {
+        int Pipe[2];
+        if (pipe(Pipe) != 0)
+        {
+            printf("[exitreap] pipe failed\n");
+            return;
+        }
+
+        pid_t Pid = fork();
+        if (Pid == 0)
+        {
+            void* Mem = mmap(
+                NULL, BenchExitSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+            uint64_t Stamp = (Mem == MAP_FAILED) ? 0 : __NowNs__();
+            write(Pipe[1], &Stamp, sizeof(Stamp));
+            _exit(0);
+        }
+        if (Pid < 0)
+        {
+            printf("[exitreap] fork failed\n");
+            return;
+        }
+
+        int Status = 0;
+        waitpid(Pid, &Status, 0);
+        uint64_t Now = __NowNs__();
+
+        uint64_t Stamp = 0;
+        read(Pipe[0], &Stamp, sizeof(Stamp));
+        close(Pipe[0]);
+        close(Pipe[1]);
+
+        if (Stamp && Now > Stamp)
+        {
+            Total += Now - Stamp;
+            Done++;
+        }
+    }
+
+    if (Done)
+    {
+        printf("[exitreap] 256MB child exit->wait: %llu us avg over %d runs\n",
+               (unsigned long long)(Total / (uint64_t)Done / 1000),
+               Done);
+    }
+    __DumpMeminfo__();
+}
+
+/* Write one byte per page, the first touch of a lazy mapping is where its faults land */
+static uint64_t
+__TouchPages__(volatile uint8_t* __Base__, size_t __Len__)
+{
+    uint64_t T0 = __NowNs__();
+    for (size_t I = 0; I < __Len__; I += 4096)
+    {
+        __Base__[I] = (uint8_t)I;
+    }
+    return __NowNs__() - T0;
+}
+
+static void
+__BenchPopulate__(void)
+{
+    static const struct
+    {
+        const char* Name;
+        int         Flags;
+    } Modes[] = {{"lazy", 0}, {"populate", MAP_POPULATE}};
+
+    for (size_t M = 0; M < sizeof(Modes) / sizeof(Modes[0]); M++)
+    {
+        uint64_t T0  = __NowNs__();
+        uint8_t* Mem = (uint8_t*)mmap(NULL,
+                                      BenchTouchSize,
+                                      PROT_READ | PROT_WRITE,
+                                      MAP_PRIVATE | MAP_ANONYMOUS | Modes[M].Flags,
+                                      -1,
+                                      0);
+        uint64_t MapNs = __NowNs__() - T0;
+        if (Mem == MAP_FAILED)
+        {
+            printf("[populate] %s mmap failed\n", Modes[M].Name);
+            continue;
+        }
+
+        uint64_t TouchNs = __TouchPages__(Mem, BenchTouchSize);
+        printf("[populate] 64MB %-8s mmap %llu us, first touch %llu us\n",
+               Modes[M].Name,
+               (unsigned long long)(MapNs / 1000),
+               (unsigned long long)(TouchNs / 1000));
+        munmap(Mem, BenchTouchSize);
+    }
+}
+
+/*
+    Allocator style arena: fill it, give it back, fill it again. Without advice
+    the memory is never returned; DONTNEED returns it and pays a refault and
+    zeroing on reuse; FREE only returns it when the kernel is short on memory.
+*/
+static void
+__BenchMadvFree__(void)
+{
+    static const struct
+    {
+        const char* Name;
+        int         Advice;
+    } Modes[] = {{"none", -1}, {"dontneed", MADV_DONTNEED}, {"free", MADV_FREE}};
+
+    for (size_t M = 0; M < sizeof(Modes) / sizeof(Modes[0]); M++)
+    {
+        uint8_t* Arena = (uint8_t*)mmap(
+            NULL, BenchArenaSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (Arena == MAP_FAILED)
+        {
+            printf("[madvfree] mmap failed\n");
+            return;
+        }
+
+        uint64_t Total = 0;
+        for (int Run = 0; Run < BenchArenaRuns; Run++)
+        {
+            uint64_t T0 = __NowNs__();
+            __TouchPages__(Arena, BenchArenaSize);
+            if (Modes[M].Advice >= 0)
+            {
+                madvise(Arena, BenchArenaSize, Modes[M].Advice);
+            }
+            Total += __NowNs__() - T0;
+        }
+
+        printf("[madvfree] 8MB reuse cycle, %-8s %llu us/cycle\n",
+               Modes[M].Name,
+               (unsigned long long)(Total / BenchArenaRuns / 1000));
+        munmap(Arena, BenchArenaSize);
+    }
+    __DumpMeminfo__();
+}
+
+int
+main(int __Argc__, char** __Argv__)
+{
+    __BenchTlbWalk__();
+    __BenchFileMap__((__Argc__ > 1) ? __Argv__[1] : BenchFileDflt);
+    __BenchExitReap__();
+    __BenchPopulate__();
+    __BenchMadvFree__();
+    fflush(stdout);
+    return 0;
+}
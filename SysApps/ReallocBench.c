@@ -0,0 +1,214 @@
+#include <fcntl.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+/*
+    Growing buffer benchmark. A buffer doubles from 1MB up to BenchMaxMb
+    (default 1GB, or argv[1] in MB), each step filling its new half. With
+    mremap the kernel grows in place or moves page table entries; the copy
+    variant does mmap + memcpy + munmap. Prints time spent resizing, time
+    spent filling and the lowest MemFree seen, so peak memory can be compared.
+*/
+
+#define PROT_READ      0x1
+#define PROT_WRITE     0x2
+#define MAP_PRIVATE    0x02
+#define MAP_ANONYMOUS  0x20
+#define MAP_FAILED     ((void*)-1)
+#define MREMAP_MAYMOVE 0x1
+
+#define BenchStartLen (1UL << 20)
+#define BenchMaxMb    1024UL
+#define BenchPage     4096UL
+
+void* mmap(void* __addr__, size_t __len__, int __prot__, int __flags__, int __fd__, off_t __off__);
+int   munmap(void* __addr__, size_t __len__);
+void* mremap(void* __addr__, size_t __oldlen__, size_t __newlen__, int __flags__, ...);
+
+typedef struct BenchResult
+{
+    uint64_t ResizeNs;
+    uint64_t FillNs;
+    uint64_t Moves;
+    long     MinFreeKb;
+    int      Intact;
+
+} BenchResult;
+
+static uint64_t
+__NowNs__(void)
+{
+    struct timespec Ts;
+    clock_gettime(CLOCK_MONOTONIC, &Ts);
+    return (uint64_t)Ts.tv_sec * 1000000000ULL + (uint64_t)Ts.tv_nsec;
+}
+
+static long
+__MemFreeKb__(void)
+{
+    char Buf[2048];
+    int  Fd = open("/proc/meminfo", O_RDONLY);
+    if (Fd < 0)
+    {
+        return -1;
+    }
+    ssize_t Got = read(Fd, Buf, sizeof(Buf) - 1);
+    close(Fd);
+    if (Got <= 0)
+    {
+        return -1;
+    }
+    Buf[Got] = '\0';
+
+    char* Line = strstr(Buf, "MemFree:");
+    return Line ? strtol(Line + 8, NULL, 10) : -1;
+}
+
+/* One word per page, like a producer appending to the buffer */
+static uint64_t
+__Fill__(uint8_t* __Buf__, size_t __From__, size_t __To__)
+{
+    uint64_t T0 = __NowNs__();
+    for (size_t Off = __From__; Off < __To__; Off += BenchPage)
+    {
+        *(volatile uint64_t*)(__Buf__ + Off) = Off;
+    }
+    return __NowNs__() - T0;
+}
+
+/* Sample a few pages from every doubling, the contents must survive each resize */
+static int
+__Intact__(uint8_t* __Buf__, size_t __Len__)
+{
+    for (size_t Off = 0; Off < __Len__; Off = Off ? Off * 2 : BenchPage)
+    {
+        if (*(volatile uint64_t*)(__Buf__ + Off) != Off)
+        {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+static void
+__Track__(BenchResult* __Res__)
+{
+    long Kb = __MemFreeKb__();
+    if (Kb >= 0 && (__Res__->MinFreeKb < 0 || Kb < __Res__->MinFreeKb))
+    {
+        __Res__->MinFreeKb = Kb;
+    }
+}
+
+static int
+__BenchMremap__(size_t __Max__, BenchResult* __Res__)
+{
+    size_t   Len = BenchStartLen;
+    uint8_t* Buf = mmap(NULL, Len, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (Buf == MAP_FAILED)
+    {
+        return -1;
+    }
+    __Res__->FillNs += __Fill__(Buf, 0, Len);
+
+    while (Len < __Max__)
+    {
+        uint64_t T0  = __NowNs__();
+        uint8_t* New = mremap(Buf, Len, Len * 2, MREMAP_MAYMOVE);
+        __Res__->ResizeNs += __NowNs__() - T0;
+        if (New == MAP_FAILED)
+        {
+            munmap(Buf, Len);
+            return -1;
+        }
+
+        __Res__->Moves += (New != Buf);
+        Buf = New;
+        __Res__->FillNs += __Fill__(Buf, Len, Len * 2);
+        Len *= 2;
+        __Track__(__Res__);
+    }
+
+    __Res__->Intact = __Intact__(Buf, Len);
+    munmap(Buf, Len);
+    return 0;
+}
+
+static int
+__BenchCopy__(size_t __Max__, BenchResult* __Res__)
+{
+    size_t   Len = BenchStartLen;
+    uint8_t* Buf = mmap(NULL, Len, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (Buf == MAP_FAILED)
+    {
+        return -1;
+    }
+    __Res__->FillNs += __Fill__(Buf, 0, Len);
+
+    while (Len < __Max__)
+    {
+        uint64_t T0 = __NowNs__();
+        uint8_t* New =
+            mmap(NULL, Len * 2, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (New == MAP_FAILED)
+        {
+            munmap(Buf, Len);
+            return -1;
+        }
+        memcpy(New, Buf, Len);
+        __Track__(__Res__); /* both copies are live right here */
+        munmap(Buf, Len);
+        __Res__->ResizeNs += __NowNs__() - T0;
+
+        __Res__->Moves++;
+        Buf = New;
+        __Res__->FillNs += __Fill__(Buf, Len, Len * 2);
+        Len *= 2;
+    }
+
+    __Res__->Intact = __Intact__(Buf, Len);
+    munmap(Buf, Len);
+    return 0;
+}
+
+static void
+__Report__(const char* __What__, int __Rc__, long __FreeKb__, const BenchResult* __Res__)
+{
+    if (__Rc__ != 0)
+    {
+        printf("[%s] failed\n", __What__);
+        return;
+    }
+
+    printf("[%s] resize %llu us, fill %llu us, %llu moves, peak use %ld kB, data %s\n",
+           __What__,
+           (unsigned long long)(__Res__->ResizeNs / 1000),
+           (unsigned long long)(__Res__->FillNs / 1000),
+           (unsigned long long)__Res__->Moves,
+           (__Res__->MinFreeKb >= 0 && __FreeKb__ >= 0) ? __FreeKb__ - __Res__->MinFreeKb : -1,
+           __Res__->Intact ? "intact" : "CORRUPT");
+}
+
+int
+main(int __Argc__, char** __Argv__)
+{
+    size_t MaxMb = (__Argc__ > 1) ? strtoul(__Argv__[1], NULL, 10) : BenchMaxMb;
+    size_t Max   = (MaxMb ? MaxMb : BenchMaxMb) << 20;
+
+    BenchResult Remap = {0, 0, 0, -1, 0};
+    long        Free0 = __MemFreeKb__();
+    int         Rc    = __BenchMremap__(Max, &Remap);
+    __Report__("mremap", Rc, Free0, &Remap);
+
+    BenchResult Copy  = {0, 0, 0, -1, 0};
+    long        Free1 = __MemFreeKb__();
+    Rc                = __BenchCopy__(Max, &Copy);
+    __Report__("copy", Rc, Free1, &Copy);
+
+    fflush(stdout);
+    return 0;
+}
@@ -0,0 +1,218 @@
+#include <fcntl.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+/*
+    Shared memory IPC benchmark. A producer child hands fixed size messages to
+    the parent through a single producer/single consumer ring living in shared
+    pages (memfd, shm_open and MAP_SHARED|MAP_ANONYMOUS), then the same stream
+    goes through a pipe. Prints MB/s for each so copies can be compared.
+*/
+
+#define PROT_READ     0x1
+#define PROT_WRITE    0x2
+#define MAP_SHARED    0x01
+#define MAP_ANONYMOUS 0x20
+#define MAP_FAILED    ((void*)-1)
+
+#define BenchMsgSize  4096UL
+#define BenchMsgs     16384UL /* 64MB per run */
+#define BenchSlots    64UL
+#define BenchShmName  "/shmbench"
+
+typedef struct BenchRing
+{
+    volatile uint64_t Head; /* written by the producer */
+    uint8_t           Pad0[56];
+    volatile uint64_t Tail; /* written by the consumer */
+    uint8_t           Pad1[4096 - 72];
+    uint8_t           Slot[BenchSlots][BenchMsgSize];
+
+} BenchRing;
+
+void* mmap(void* __addr__, size_t __len__, int __prot__, int __flags__, int __fd__, off_t __off__);
+int   munmap(void* __addr__, size_t __len__);
+int   ftruncate(int __fd__, off_t __len__);
+int   memfd_create(const char* __name__, unsigned int __flags__);
+int   shm_open(const char* __name__, int __oflag__, mode_t __mode__);
+int   shm_unlink(const char* __name__);
+
+static uint64_t
+__NowNs__(void)
+{
+    struct timespec Ts;
+    clock_gettime(CLOCK_MONOTONIC, &Ts);
+    return (uint64_t)Ts.tv_sec * 1000000000ULL + (uint64_t)Ts.tv_nsec;
+}
+
+static void
+__Report__(const char* __What__, uint64_t __Ns__, uint64_t __Sum__)
+{
+    uint64_t Bytes = BenchMsgs * BenchMsgSize;
+    uint64_t MBps  = __Ns__ ? (Bytes * 1000ULL) / __Ns__ : 0; /* bytes/ns*1000 = MB/s */
+
+    printf("[%s] %llu MB in %llu us: %llu MB/s (sum %llx)\n",
+           __What__,
+           (unsigned long long)(Bytes >> 20),
+           (unsigned long long)(__Ns__ / 1000),
+           (unsigned long long)MBps,
+           (unsigned long long)__Sum__);
+}
+
+/* Producer fills each slot in place, consumer reads it in place: no copy through the kernel */
+static void
+__RunRing__(const char* __What__, BenchRing* __Ring__)
+{
+    __Ring__->Head = 0;
+    __Ring__->Tail = 0;
+
+    uint64_t T0  = __NowNs__();
+    pid_t    Pid = fork();
+    if (Pid == 0)
+    {
+        for (uint64_t Msg = 0; Msg < BenchMsgs; Msg++)
+        {
+            while (Msg - __atomic_load_n(&__Ring__->Tail, __ATOMIC_ACQUIRE) >= BenchSlots)
+            {
+            }
+            memset(__Ring__->Slot[Msg % BenchSlots], (int)(Msg & 0xFF), BenchMsgSize);
+            __atomic_store_n(&__Ring__->Head, Msg + 1, __ATOMIC_RELEASE);
+        }
+        _exit(0);
+    }
+    if (Pid < 0)
+    {
+        printf("[%s] fork failed\n", __What__);
+        return;
+    }
+
+    uint64_t Sum = 0;
+    for (uint64_t Msg = 0; Msg < BenchMsgs; Msg++)
+    {
+        while (__atomic_load_n(&__Ring__->Head, __ATOMIC_ACQUIRE) == Msg)
+        {
+        }
+        const uint64_t* Words = (const uint64_t*)__Ring__->Slot[Msg % BenchSlots];
+        for (uint64_t I = 0; I < BenchMsgSize / 8; I += 8)
+        {
+            Sum += Words[I];
+        }
+        __atomic_store_n(&__Ring__->Tail, Msg + 1, __ATOMIC_RELEASE);
+    }
+    uint64_t T1 = __NowNs__();
+
+    int Status = 0;
+    waitpid(Pid, &Status, 0);
+    __Report__(__What__, T1 - T0, Sum);
+}
+
+static void
+__BenchFdRing__(const char* __What__, int __Fd__)
+{
+    if (__Fd__ < 0 || ftruncate(__Fd__, sizeof(BenchRing)) != 0)
+    {
+        printf("[%s] object setup failed\n", __What__);
+        return;
+    }
+
+    BenchRing* Ring = (BenchRing*)mmap(
+        NULL, sizeof(BenchRing), PROT_READ | PROT_WRITE, MAP_SHARED, __Fd__, 0);
+    close(__Fd__);
+    if (Ring == MAP_FAILED)
+    {
+        printf("[%s] mmap failed\n", __What__);
+        return;
+    }
+
+    __RunRing__(__What__, Ring);
+    munmap(Ring, sizeof(BenchRing));
+}
+
+static void
+__BenchAnonRing__(void)
+{
+    BenchRing* Ring = (BenchRing*)mmap(
+        NULL, sizeof(BenchRing), PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    if (Ring == MAP_FAILED)
+    {
+        printf("[anon] mmap failed\n");
+        return;
+    }
+
+    __RunRing__("anon", Ring);
+    munmap(Ring, sizeof(BenchRing));
+}
+
+/* Same stream through a pipe: two copies per message, one in and one out of the kernel */
+static void
+__BenchPipe__(void)
+{
+    static uint8_t Msg[BenchMsgSize];
+    int            Pipe[2];
+
+    if (pipe(Pipe) != 0)
+    {
+        printf("[pipe] pipe failed\n");
+        return;
+    }
+
+    uint64_t T0  = __NowNs__();
+    pid_t    Pid = fork();
+    if (Pid == 0)
+    {
+        close(Pipe[0]);
+        for (uint64_t Count = 0; Count < BenchMsgs; Count++)
+        {
+            memset(Msg, (int)(Count & 0xFF), BenchMsgSize);
+            for (size_t Off = 0; Off < BenchMsgSize;)
+            {
+                ssize_t Put = write(Pipe[1], Msg + Off, BenchMsgSize - Off);
+                Off += (Put > 0) ? (size_t)Put : 0;
+            }
+        }
+        _exit(0);
+    }
+    if (Pid < 0)
+    {
+        printf("[pipe] fork failed\n");
+        return;
+    }
+
+    uint64_t Sum = 0;
+    for (uint64_t Count = 0; Count < BenchMsgs; Count++)
+    {
+        for (size_t Off = 0; Off < BenchMsgSize;)
+        {
+            ssize_t Got = read(Pipe[0], Msg + Off, BenchMsgSize - Off);
+            Off += (Got > 0) ? (size_t)Got : 0;
+        }
+        const uint64_t* Words = (const uint64_t*)Msg;
+        for (uint64_t I = 0; I < BenchMsgSize / 8; I += 8)
+        {
+            Sum += Words[I];
+        }
+    }
+    uint64_t T1 = __NowNs__();
+
+    int Status = 0;
+    waitpid(Pid, &Status, 0);
+    close(Pipe[0]);
+    close(Pipe[1]);
+    __Report__("pipe", T1 - T0, Sum);
+}
+
+int
+main(void)
+{
+    __BenchFdRing__("memfd", memfd_create("shmbench", 0));
+    __BenchFdRing__("shm_open", shm_open(BenchShmName, O_CREAT | O_EXCL | O_RDWR, 0600));
+    shm_unlink(BenchShmName);
+    __BenchAnonRing__();
+    __BenchPipe__();
+    fflush(stdout);
+    return 0;
+}
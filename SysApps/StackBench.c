@@ -0,0 +1,174 @@
+#include <fcntl.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+/*
+    Stack commit benchmark. Forks BenchProcs children that each recurse to a
+    chosen depth and then park, so every stack is live at once. Prints the
+    VmStk each child reports from /proc/self/status next to what an eager
+    fixed size stack would have cost. `StackBench guard` also overflows the
+    reservation on purpose; an unresolved user fault is still fatal to the
+    whole kernel, so that probe is opt in.
+*/
+
+#define BenchProcs       1000
+#define BenchReserveKb   8192UL /* UserStackReserve */
+#define BenchEagerKb     64UL   /* what the old fixed stack committed per process */
+#define BenchFrameBytes  1024UL
+#define BenchStatusBytes 2048
+
+static const unsigned long BenchDepthsKb[] = {0, 16, 256, 1024};
+
+/* Each level pins BenchFrameBytes of stack and touches it */
+static uint64_t
+__Recurse__(unsigned long __Levels__)
+{
+    volatile uint8_t Frame[BenchFrameBytes];
+    memset((void*)Frame, (int)__Levels__, sizeof(Frame));
+    if (!__Levels__)
+    {
+        return Frame[0];
+    }
+    return __Recurse__(__Levels__ - 1) + Frame[BenchFrameBytes - 1];
+}
+
+static long
+__StatusKb__(const char* __Path__, const char* __Key__)
+{
+    char Buf[BenchStatusBytes];
+    int  Fd = open(__Path__, O_RDONLY);
+    if (Fd < 0)
+    {
+        return -1;
+    }
+    ssize_t Got = read(Fd, Buf, sizeof(Buf) - 1);
+    close(Fd);
+    if (Got <= 0)
+    {
+        return -1;
+    }
+    Buf[Got] = '\0';
+
+    char* Line = strstr(Buf, __Key__);
+    return Line ? strtol(Line + strlen(__Key__), NULL, 10) : -1;
+}
+
+static void
+__BenchDepth__(unsigned long __DepthKb__)
+{
+    int   Report[2], Release[2];
+    pid_t Pids[BenchProcs];
+    int   Live = 0;
+
+    if (pipe(Report) != 0 || pipe(Release) != 0)
+    {
+        printf("[%lukB] pipe failed\n", __DepthKb__);
+        return;
+    }
+
+    long FreeBefore = __StatusKb__("/proc/meminfo", "MemFree:");
+
+    for (int I = 0; I < BenchProcs; I++)
+    {
+        pid_t Pid = fork();
+        if (Pid == 0)
+        {
+            close(Report[0]);
+            close(Release[1]);
+            __Recurse__(__DepthKb__ * 1024UL / BenchFrameBytes);
+
+            long Kb = __StatusKb__("/proc/self/status", "VmStk:");
+            write(Report[1], &Kb, sizeof(Kb));
+
+            /* Park until the parent has measured everyone */
+            char Byte;
+            read(Release[0], &Byte, 1);
+            _exit(0);
+        }
+        if (Pid < 0)
+        {
+            break;
+        }
+        Pids[Live++] = Pid;
+    }
+
+    long Total = 0, Max = 0;
+    for (int I = 0; I < Live; I++)
+    {
+        long Kb = 0;
+        if (read(Report[0], &Kb, sizeof(Kb)) != sizeof(Kb))
+        {
+            break;
+        }
+        Total += (Kb > 0) ? Kb : 0;
+        Max = (Kb > Max) ? Kb : Max;
+    }
+
+    long FreeAfter = __StatusKb__("/proc/meminfo", "MemFree:");
+
+    close(Release[1]);
+    for (int I = 0; I < Live; I++)
+    {
+        int Status = 0;
+        waitpid(Pids[I], &Status, 0);
+    }
+    close(Release[0]);
+    close(Report[0]);
+    close(Report[1]);
+
+    printf("[%4lukB deep] %d procs: VmStk avg %ld kB max %ld kB, total %ld kB "
+           "(reserved %lu kB, eager %lu kB), MemFree -%ld kB\n",
+           __DepthKb__,
+           Live,
+           Live ? Total / Live : 0,
+           Max,
+           Total,
+           (unsigned long)Live * BenchReserveKb,
+           (unsigned long)Live * (BenchEagerKb > __DepthKb__ ? BenchEagerKb : __DepthKb__),
+           FreeBefore - FreeAfter);
+}
+
+/* Unbounded recursion has to stop at the guard gap with a fault, not corrupt a neighbour */
+static void
+__BenchGuard__(void)
+{
+    pid_t Pid = fork();
+    if (Pid == 0)
+    {
+        __Recurse__(BenchReserveKb * 2);
+        _exit(0);
+    }
+    if (Pid < 0)
+    {
+        printf("[guard] fork failed\n");
+        return;
+    }
+
+    int Status = 0;
+    waitpid(Pid, &Status, 0);
+    printf("[guard] overflow child %s (status 0x%x)\n",
+           WIFSIGNALED(Status) ? "killed by fault" : "exited normally",
+           Status);
+    printf("[guard] StackGrown %ld, StackGuardHits %ld\n",
+           __StatusKb__("/proc/meminfo", "StackGrown:"),
+           __StatusKb__("/proc/meminfo", "StackGuardHits:"));
+}
+
+int
+main(int __Argc__, char** __Argv__)
+{
+    for (size_t I = 0; I < sizeof(BenchDepthsKb) / sizeof(BenchDepthsKb[0]); I++)
+    {
+        __BenchDepth__(BenchDepthsKb[I]);
+    }
+    if (__Argc__ > 1 && strcmp(__Argv__[1], "guard") == 0)
+    {
+        __BenchGuard__();
+    }
+    fflush(stdout);
+    return 0;
+}